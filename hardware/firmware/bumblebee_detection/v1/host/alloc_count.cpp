@@ -0,0 +1,114 @@
+#include "alloc_count.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace hostalloc {
+
+static std::atomic<bool> s_counting{false};
+static std::atomic<uint64_t> s_count{0};
+
+static inline void count() {
+    if (s_counting.load(std::memory_order_relaxed)) {
+        s_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void start() {
+    s_count.store(0);
+    s_counting.store(true);
+}
+
+uint64_t stop() {
+    s_counting.store(false);
+    return s_count.load();
+}
+
+bool suspend() {
+    return s_counting.exchange(false);
+}
+
+void resume(bool counting) {
+    s_counting.store(counting);
+}
+
+} // namespace hostalloc
+
+// --------- malloc (-Wl,--wrap) ----------------------------------
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+void *__real_aligned_alloc(size_t alignment, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    hostalloc::count();
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    hostalloc::count();
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    hostalloc::count();
+    return __real_realloc(p, size);
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size) {
+    hostalloc::count();
+    return __real_aligned_alloc(alignment, size);
+}
+}
+
+// --------- operator new ----------------------------------
+
+// Alle Varianten über malloc/free, damit new und delete zueinander passen (auch unter ASan).
+// __real_malloc, sonst zählte __wrap_malloc dieselbe Allokation noch einmal.
+void *operator new(std::size_t size) {
+    hostalloc::count();
+    if (void *p = __real_malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    hostalloc::count();
+    return __real_malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    free(p);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+// Zählt Heap-Allokationen des Host-Builds: operator new überall, malloc/calloc/realloc/
+// aligned_alloc nur aus statisch gelinktem Code (-Wl,--wrap, also Firmware-Module und Shims).
+// Allokationen innerhalb von libc und libjpeg sieht der Zähler nicht.
+namespace hostalloc {
+
+// Startet ein neues Messfenster
+void start();
+// Beendet das Messfenster und liefert die Anzahl Allokationen darin
+uint64_t stop();
+// Unterbricht bzw. setzt das Messfenster fort, z.B. um Testgerüst auszunehmen
+bool suspend();
+void resume(bool counting);
+
+} // namespace hostalloc
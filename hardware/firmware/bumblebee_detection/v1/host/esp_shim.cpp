@@ -0,0 +1,48 @@
+#include <chrono>
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+
+// Laufzeit der ESP-IDF-Funktionen, die die portablen Firmware-Module verwenden
+
+int host_log_level = 3;
+
+static const std::chrono::steady_clock::time_point s_start = std::chrono::steady_clock::now();
+static uint32_t s_random = 0x2545F491;
+static bool s_manual_time = false;
+static int64_t s_time_us = 0;
+
+int64_t esp_timer_get_time() {
+    if (s_manual_time) {
+        return s_time_us;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_start).count();
+}
+
+void host_timer_set(int64_t us) {
+    s_manual_time = true;
+    s_time_us = us;
+}
+
+uint32_t esp_cpu_get_cycle_count() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_start)
+        .count();
+}
+
+uint32_t esp_rom_get_cpu_ticks_per_us() {
+    return 1000;
+}
+
+uint32_t esp_random() {
+    // xorshift32
+    s_random ^= s_random << 13;
+    s_random ^= s_random >> 17;
+    s_random ^= s_random << 5;
+    return s_random;
+}
+
+void host_random_seed(uint32_t seed) {
+    s_random = seed ? seed : 0x2545F491;
+}
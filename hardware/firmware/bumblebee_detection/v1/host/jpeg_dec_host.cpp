@@ -0,0 +1,169 @@
+#include "esp_jpeg_dec.h"
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <jpeglib.h>
+
+// esp_new_jpeg-Decoder über libjpeg für den Host-Build. Ausgabe RGB565 (big oder little
+// endian) oder RGB888; Skalierung 1/2, 1/4, 1/8 über scale_denom. Im Blockmodus liefert
+// jeder jpeg_dec_process() BLOCK_ROWS Zeilen, auf dem Gerät ist es eine MCU-Zeile.
+
+namespace {
+
+constexpr int BLOCK_ROWS = 16;
+
+struct error_mgr_t {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+struct decoder_t {
+    jpeg_dec_config_t cfg;
+    jpeg_decompress_struct cinfo;
+    error_mgr_t err;
+    bool started;
+    std::vector<uint8_t> row;   // eine Zeile RGB888 von libjpeg
+};
+
+void on_error(j_common_ptr cinfo) {
+    longjmp(reinterpret_cast<error_mgr_t *>(cinfo->err)->jump, 1);
+}
+
+void on_message(j_common_ptr) {}
+
+int bytes_per_pixel(jpeg_pixel_format_t type) {
+    return type == JPEG_PIXEL_FORMAT_RGB888 ? 3 : 2;
+}
+
+int rows_per_process(const decoder_t *dec) {
+    return dec->cfg.block_enable ? BLOCK_ROWS : (int)dec->cinfo.output_height;
+}
+
+void store_row(const decoder_t *dec, const uint8_t *rgb, uint8_t *out) {
+    const int width = dec->cinfo.output_width;
+    if (dec->cfg.output_type == JPEG_PIXEL_FORMAT_RGB888) {
+        memcpy(out, rgb, (size_t)width * 3);
+        return;
+    }
+    const bool big_endian = dec->cfg.output_type == JPEG_PIXEL_FORMAT_RGB565_BE;
+    for (int x = 0; x < width; ++x, rgb += 3, out += 2) {
+        const uint16_t v = (uint16_t)(((rgb[0] & 0xF8) << 8) | ((rgb[1] & 0xFC) << 3) | (rgb[2] >> 3));
+        out[big_endian ? 0 : 1] = v >> 8;
+        out[big_endian ? 1 : 0] = v & 0xFF;
+    }
+}
+
+// Ohne C++-Objekte mit Destruktor, longjmp springt hier heraus
+jpeg_error_t start(decoder_t *dec, jpeg_dec_io_t *io, jpeg_dec_header_info_t *info) {
+    if (setjmp(dec->err.jump)) {
+        return JPEG_ERR_BAD_DATA;
+    }
+    jpeg_mem_src(&dec->cinfo, io->inbuf, (unsigned long)io->inbuf_len);
+    jpeg_read_header(&dec->cinfo, TRUE);
+    info->width = dec->cinfo.image_width;
+    info->height = dec->cinfo.image_height;
+    dec->cinfo.out_color_space = JCS_RGB;
+    if (dec->cfg.scale.width > 0) {
+        const unsigned denom = dec->cinfo.image_width / dec->cfg.scale.width;
+        if ((denom != 2 && denom != 4 && denom != 8) || dec->cinfo.image_width != dec->cfg.scale.width * denom ||
+            dec->cinfo.image_height != dec->cfg.scale.height * denom) {
+            return JPEG_ERR_INVALID_PARAM;
+        }
+        dec->cinfo.scale_num = 1;
+        dec->cinfo.scale_denom = denom;
+    }
+    jpeg_start_decompress(&dec->cinfo);
+    dec->started = true;
+    dec->row.resize((size_t)dec->cinfo.output_width * 3);
+    // libjpeg liest die Quelle selbst weiter
+    io->inbuf_remain = 0;
+    return JPEG_ERR_OK;
+}
+
+jpeg_error_t decode_rows(decoder_t *dec, uint8_t *out) {
+    if (setjmp(dec->err.jump)) {
+        return JPEG_ERR_BAD_DATA;
+    }
+    const size_t stride = (size_t)dec->cinfo.output_width * bytes_per_pixel(dec->cfg.output_type);
+    for (int i = 0; i < rows_per_process(dec) && dec->cinfo.output_scanline < dec->cinfo.output_height; ++i) {
+        JSAMPROW rows[1] = {dec->row.data()};
+        jpeg_read_scanlines(&dec->cinfo, rows, 1);
+        store_row(dec, dec->row.data(), out + i * stride);
+    }
+    return JPEG_ERR_OK;
+}
+
+} // namespace
+
+jpeg_error_t jpeg_dec_open(jpeg_dec_config_t *config, jpeg_dec_handle_t *jpeg_dec) {
+    if (!config || !jpeg_dec || config->rotate != JPEG_ROTATE_0D || config->clipper.width ||
+        config->clipper.height ||
+        (config->output_type != JPEG_PIXEL_FORMAT_RGB565_BE && config->output_type != JPEG_PIXEL_FORMAT_RGB565_LE &&
+         config->output_type != JPEG_PIXEL_FORMAT_RGB888)) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    decoder_t *dec = new decoder_t();
+    dec->cfg = *config;
+    dec->cinfo.err = jpeg_std_error(&dec->err.pub);
+    dec->err.pub.error_exit = on_error;
+    dec->err.pub.output_message = on_message;
+    jpeg_create_decompress(&dec->cinfo);
+    *jpeg_dec = dec;
+    return JPEG_ERR_OK;
+}
+
+jpeg_error_t jpeg_dec_parse_header(jpeg_dec_handle_t jpeg_dec, jpeg_dec_io_t *io, jpeg_dec_header_info_t *out_info) {
+    decoder_t *dec = static_cast<decoder_t *>(jpeg_dec);
+    if (!dec || !io || !io->inbuf || io->inbuf_len <= 0 || !out_info) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    // Wie esp_new_jpeg: ein neuer Header beginnt das nächste Bild, auch wenn das vorige
+    // nicht zu Ende dekodiert wurde; der Speicher von libjpeg bleibt dabei erhalten
+    if (dec->started) {
+        jpeg_abort_decompress(&dec->cinfo);
+        dec->started = false;
+    }
+    return start(dec, io, out_info);
+}
+
+jpeg_error_t jpeg_dec_get_outbuf_len(jpeg_dec_handle_t jpeg_dec, int *outbuf_len) {
+    decoder_t *dec = static_cast<decoder_t *>(jpeg_dec);
+    if (!dec || !dec->started || !outbuf_len) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    *outbuf_len = (int)dec->cinfo.output_width * bytes_per_pixel(dec->cfg.output_type) * rows_per_process(dec);
+    return JPEG_ERR_OK;
+}
+
+jpeg_error_t jpeg_dec_get_process_count(jpeg_dec_handle_t jpeg_dec, int *process_count) {
+    decoder_t *dec = static_cast<decoder_t *>(jpeg_dec);
+    if (!dec || !dec->started || !process_count) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    const int rows = rows_per_process(dec);
+    *process_count = ((int)dec->cinfo.output_height + rows - 1) / rows;
+    return JPEG_ERR_OK;
+}
+
+jpeg_error_t jpeg_dec_process(jpeg_dec_handle_t jpeg_dec, jpeg_dec_io_t *io) {
+    decoder_t *dec = static_cast<decoder_t *>(jpeg_dec);
+    if (!dec || !dec->started || !io || !io->outbuf) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    if (dec->cinfo.output_scanline >= dec->cinfo.output_height) {
+        return JPEG_ERR_NO_MORE_DATA;
+    }
+    return decode_rows(dec, io->outbuf);
+}
+
+jpeg_error_t jpeg_dec_close(jpeg_dec_handle_t jpeg_dec) {
+    decoder_t *dec = static_cast<decoder_t *>(jpeg_dec);
+    if (dec) {
+        // Abbruch mitten im Bild ist erlaubt, jpeg_destroy gibt alles frei
+        jpeg_destroy_decompress(&dec->cinfo);
+        delete dec;
+    }
+    return JPEG_ERR_OK;
+}
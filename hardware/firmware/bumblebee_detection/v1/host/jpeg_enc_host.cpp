@@ -0,0 +1,157 @@
+#include "esp_jpeg_enc.h"
+
+#include <csetjmp>
+#include <cstdio>
+#include <vector>
+#include <jpeglib.h>
+#include <jerror.h>
+
+// esp_new_jpeg-Encoder über libjpeg für den Host-Build. Deterministisch bei gleicher
+// libjpeg-Version; YCbYCr wird zeilenweise auf YCbCr 4:4:4 aufgefächert, das Subsampling
+// übernehmen die Abtastfaktoren wie auf dem Gerät.
+
+namespace {
+
+struct encoder_t {
+    jpeg_enc_config_t cfg;
+    std::vector<uint8_t> row;   // eine Zeile YCbCr bei YCbYCr-Eingang
+};
+
+struct error_mgr_t {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+// Fester Ausgabepuffer; läuft er über, bricht der Encoder ab
+struct dest_mgr_t {
+    jpeg_destination_mgr pub;
+    volatile bool overflow;   // wird nach dem longjmp gelesen
+};
+
+void on_error(j_common_ptr cinfo) {
+    longjmp(reinterpret_cast<error_mgr_t *>(cinfo->err)->jump, 1);
+}
+
+void on_message(j_common_ptr) {}
+
+void init_destination(j_compress_ptr) {}
+
+boolean empty_output_buffer(j_compress_ptr cinfo) {
+    reinterpret_cast<dest_mgr_t *>(cinfo->dest)->overflow = true;
+    ERREXIT(cinfo, JERR_BUFFER_SIZE);
+    return FALSE;
+}
+
+void term_destination(j_compress_ptr) {}
+
+void set_sampling(jpeg_compress_struct &cinfo, jpeg_subsampling_t subsampling) {
+    if (cinfo.num_components != 3) {
+        return;
+    }
+    cinfo.comp_info[0].h_samp_factor = subsampling == JPEG_SUBSAMPLE_444 ? 1 : 2;
+    cinfo.comp_info[0].v_samp_factor = subsampling == JPEG_SUBSAMPLE_420 ? 2 : 1;
+    for (int c = 1; c < 3; ++c) {
+        cinfo.comp_info[c].h_samp_factor = 1;
+        cinfo.comp_info[c].v_samp_factor = 1;
+    }
+}
+
+// Ohne C++-Objekte mit Destruktor, longjmp springt hier heraus
+jpeg_error_t compress(encoder_t *enc, const uint8_t *in, uint8_t *out, int out_size, int *written) {
+    const jpeg_enc_config_t &cfg = enc->cfg;
+    jpeg_compress_struct cinfo;
+    error_mgr_t err;
+    dest_mgr_t dest;
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = on_error;
+    err.pub.output_message = on_message;
+    dest.pub.next_output_byte = out;
+    dest.pub.free_in_buffer = (size_t)out_size;
+    dest.pub.init_destination = init_destination;
+    dest.pub.empty_output_buffer = empty_output_buffer;
+    dest.pub.term_destination = term_destination;
+    dest.overflow = false;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        return dest.overflow ? JPEG_ERR_NO_MEM : JPEG_ERR_FAIL;
+    }
+
+    jpeg_create_compress(&cinfo);
+    cinfo.dest = &dest.pub;
+    cinfo.image_width = cfg.width;
+    cinfo.image_height = cfg.height;
+    if (cfg.src_type == JPEG_PIXEL_FORMAT_GRAY) {
+        cinfo.input_components = 1;
+        cinfo.in_color_space = JCS_GRAYSCALE;
+    } else {
+        cinfo.input_components = 3;
+        cinfo.in_color_space = cfg.src_type == JPEG_PIXEL_FORMAT_YCbYCr ? JCS_YCbCr : JCS_RGB;
+    }
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, cfg.quality, TRUE);
+    set_sampling(cinfo, cfg.subsampling);
+    jpeg_start_compress(&cinfo, TRUE);
+
+    const int width = cfg.width;
+    while (cinfo.next_scanline < cinfo.image_height) {
+        const size_t y = cinfo.next_scanline;
+        JSAMPROW row;
+        if (cfg.src_type == JPEG_PIXEL_FORMAT_YCbYCr) {
+            const uint8_t *src = in + y * width * 2;
+            uint8_t *dst = enc->row.data();
+            for (int x = 0; x < width; x += 2, src += 4, dst += 6) {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[3];
+                dst[3] = src[2];
+                dst[4] = src[1];
+                dst[5] = src[3];
+            }
+            row = enc->row.data();
+        } else {
+            row = const_cast<JSAMPROW>(in + y * width * cinfo.input_components);
+        }
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    *written = out_size - (int)dest.pub.free_in_buffer;
+    jpeg_destroy_compress(&cinfo);
+    return JPEG_ERR_OK;
+}
+
+} // namespace
+
+jpeg_error_t jpeg_enc_open(jpeg_enc_config_t *info, jpeg_enc_handle_t *jpeg_enc) {
+    if (!info || !jpeg_enc || info->width <= 0 || info->height <= 0 || info->quality == 0 || info->quality > 100 ||
+        info->rotate != JPEG_ROTATE_0D || info->src_type == JPEG_PIXEL_FORMAT_RGBA ||
+        (info->src_type == JPEG_PIXEL_FORMAT_YCbYCr && (info->width & 1))) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    encoder_t *enc = new encoder_t{*info, {}};
+    if (info->src_type == JPEG_PIXEL_FORMAT_YCbYCr) {
+        enc->row.resize((size_t)info->width * 3);
+    }
+    *jpeg_enc = enc;
+    return JPEG_ERR_OK;
+}
+
+jpeg_error_t jpeg_enc_process(const jpeg_enc_handle_t jpeg_enc, const uint8_t *inbuf, int inbuf_size, uint8_t *outbuf,
+                              int outbuf_size, int *out_size) {
+    encoder_t *enc = static_cast<encoder_t *>(jpeg_enc);
+    if (!enc || !inbuf || !outbuf || !out_size || outbuf_size <= 0) {
+        return JPEG_ERR_INVALID_PARAM;
+    }
+    const int bpp = enc->cfg.src_type == JPEG_PIXEL_FORMAT_GRAY     ? 1
+                    : enc->cfg.src_type == JPEG_PIXEL_FORMAT_YCbYCr ? 2
+                                                                    : 3;
+    if (inbuf_size < enc->cfg.width * enc->cfg.height * bpp) {
+        return JPEG_ERR_NO_MORE_DATA;
+    }
+    *out_size = 0;
+    return compress(enc, inbuf, outbuf, outbuf_size, out_size);
+}
+
+jpeg_error_t jpeg_enc_close(jpeg_enc_handle_t jpeg_enc) {
+    delete static_cast<encoder_t *>(jpeg_enc);
+    return JPEG_ERR_OK;
+}
@@ -0,0 +1,417 @@
+// Replay der Firmware-Pipeline auf dem Host: aufgezeichnete Frames statt Kamera, vorberechnete
+// Detektionen oder ein Stub statt Modell, ein Verzeichnis statt SD-Karte. Die Stufen sind
+// dieselben wie auf dem Gerät (stages::Stages aus pipeline_stages.cpp: capture -> gate -> ROI
+// -> detect -> track -> encode -> Write-Behind-Ring -> store, Boxen in detections.bdet), nur
+// nacheinander in einem Thread statt in Tasks und mit virtueller Uhr: Zeitstempel, Intervalle
+// des Schedulers und die Group Commits der Segmente sind in jedem Lauf gleich. Der Digest
+// über alle Records im Ring ändert sich nur, wenn sich die Ausgabe ändert.
+// Der ROI wird am ersten Frame festgelegt, wie auf dem Gerät beim Start der Pipeline.
+// Mit --capture jpeg sind die JPEG-Dateien das Sensor-JPEG (pipeline::CAPTURE_JPEG): nur der
+// ROI wird dekodiert, Vollbilder gehen unverändert ins Archiv. Vollbilder bleiben unbemalt,
+// außer mit --annotate (CONFIG_BEESENSE_ANNOTATE_FRAMES).
+// --check-allocs zählt die Heap-Allokationen ab dem zweiten Durchlauf (nach dem Aufwärmen) und
+// scheitert, wenn die Stufen im eingeschwungenen Zustand allokieren; das ist der Code, den auf
+// dem Gerät die Tasks rufen. Der Stand-in-Detektor (Label-Dateien) zählt nicht mit, auf dem
+// Gerät läuft an seiner Stelle esp-dl.
+//
+//   replay --frames data/images/test --detections data/labels/test --archive thumbs
+//   replay --frames data/images/test --capture jpeg --decode-shift 1 --roi 224
+//   replay --frames data/images/test --detections data/labels/test --loops 2 --check-allocs
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include "alloc_count.hpp"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "jpeg_decoder.hpp"
+#include "pipeline.hpp"
+#include "pipeline_stages.hpp"
+#include "replay_detector.hpp"
+#include "replay_source.hpp"
+#include "sd_card.hpp"
+#include "span_profiler.hpp"
+#include "storage_posix.hpp"
+#include "thumbnail.hpp"
+
+static const char *TAG = "REPLAY";
+
+static constexpr int64_t START_US = 1000000;
+// Größter Wert von CONFIG_BEESENSE_CAPTURE_JPEG_MAX_KB, damit jedes Sensor-JPEG archiviert wird
+static constexpr size_t SENSOR_JPEG_MAX_BYTES = 512 * 1024;
+// CONFIG_BEESENSE_WRITE_RING_KB
+static constexpr size_t RING_BYTES = 1024 * 1024;
+
+struct options_t {
+    std::string frames = "data/images/test";
+    std::string detections;            // leer: Stub-Detektor
+    std::string root = "/tmp/beesense_replay";
+    int raw_width = 0;
+    int raw_height = 0;
+    int roi = 224;                      // Kantenlänge des Modellausschnitts, höchstens Framegröße
+    bool capture_jpeg = false;          // Frames als Sensor-JPEG, nur der ROI wird dekodiert
+    int decode_shift = 0;               // JPEG-Aufnahme: Decoder skaliert um 1 / 2^shift
+    int loops = 1;
+    bool segments = true;
+    bool thumbs = false;
+    bool gate = true;
+    bool tracker = true;
+    bool annotate = false;              // CONFIG_BEESENSE_ANNOTATE_FRAMES
+    bool check_allocs = false;          // Allokationen ab dem zweiten Durchlauf zählen, > 0 ist ein Fehler
+    uint32_t interval_ms = 0;           // 0: CaptureScheduler wie auf dem Gerät
+    float min_score = 0.35f;            // SCORE_THR in app_main.cpp
+    uint8_t quality = 80;
+    jpeg_subsampling_t subsampling = JPEG_SUBSAMPLE_444;
+    int thumb_size = 96;
+    float thumb_padding = 0.25f;
+    uint32_t context_s = 60;
+    uint32_t segment_mb = 64;
+    uint32_t flush_ms = 5000;
+    uint32_t batch_kb = 32;
+};
+
+// Was nur der Replay zählt; Gate, Tracker, Aufnahme und Archiv zählen die Stufen selbst
+struct run_stats_t {
+    uint32_t frames;
+    uint32_t inferred;
+    uint32_t detections;
+    uint32_t failed;
+    uint64_t digest;
+};
+
+static void usage() {
+    printf("usage: replay [--frames DIR] [--detections DIR] [--raw WxH] [--root DIR] [--loops N]\n"
+           "              [--mode files|segments] [--archive frames|thumbs] [--roi PX] [--interval-ms MS]\n"
+           "              [--min-score F] [--quality Q] [--subsampling 444|422|420] [--thumb-size PX]\n"
+           "              [--capture rgb565|jpeg] [--decode-shift 0..3] [--no-gate] [--no-tracker] [--annotate]\n"
+           "              [--check-allocs] [--verbose]\n");
+}
+
+static bool parse(int argc, char **argv, options_t &opt) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--verbose") == 0) {
+            host_log_level = 4;
+            continue;
+        }
+        if (strcmp(arg, "--no-gate") == 0) {
+            opt.gate = false;
+            continue;
+        }
+        if (strcmp(arg, "--no-tracker") == 0) {
+            opt.tracker = false;
+            continue;
+        }
+        if (strcmp(arg, "--annotate") == 0) {
+            opt.annotate = true;
+            continue;
+        }
+        if (strcmp(arg, "--check-allocs") == 0) {
+            opt.check_allocs = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char *value = argv[++i];
+        const uint32_t n = (uint32_t)strtoul(value, nullptr, 10);
+        if (strcmp(arg, "--frames") == 0) {
+            opt.frames = value;
+        } else if (strcmp(arg, "--detections") == 0) {
+            opt.detections = value;
+        } else if (strcmp(arg, "--raw") == 0) {
+            if (sscanf(value, "%dx%d", &opt.raw_width, &opt.raw_height) != 2) {
+                return false;
+            }
+        } else if (strcmp(arg, "--root") == 0) {
+            opt.root = value;
+        } else if (strcmp(arg, "--loops") == 0) {
+            opt.loops = (int)n;
+        } else if (strcmp(arg, "--mode") == 0) {
+            opt.segments = strcmp(value, "segments") == 0;
+            if (!opt.segments && strcmp(value, "files") != 0) {
+                return false;
+            }
+        } else if (strcmp(arg, "--archive") == 0) {
+            opt.thumbs = strcmp(value, "thumbs") == 0;
+            if (!opt.thumbs && strcmp(value, "frames") != 0) {
+                return false;
+            }
+        } else if (strcmp(arg, "--roi") == 0) {
+            opt.roi = (int)n;
+        } else if (strcmp(arg, "--interval-ms") == 0) {
+            opt.interval_ms = n;
+        } else if (strcmp(arg, "--min-score") == 0) {
+            opt.min_score = strtof(value, nullptr);
+        } else if (strcmp(arg, "--quality") == 0) {
+            opt.quality = (uint8_t)n;
+        } else if (strcmp(arg, "--subsampling") == 0) {
+            opt.subsampling = n == 420 ? JPEG_SUBSAMPLE_420 : n == 422 ? JPEG_SUBSAMPLE_422 : JPEG_SUBSAMPLE_444;
+        } else if (strcmp(arg, "--thumb-size") == 0) {
+            opt.thumb_size = (int)n;
+        } else if (strcmp(arg, "--capture") == 0) {
+            opt.capture_jpeg = strcmp(value, "jpeg") == 0;
+            if (!opt.capture_jpeg && strcmp(value, "rgb565") != 0) {
+                return false;
+            }
+        } else if (strcmp(arg, "--decode-shift") == 0) {
+            opt.decode_shift = (int)n;
+        } else {
+            return false;
+        }
+    }
+    return opt.loops > 0 && opt.roi > 0 && opt.quality > 0 && opt.quality <= 100 && opt.thumb_size > 0 &&
+           opt.thumb_size <= thumbs::MAX_SIZE && (opt.segments || !opt.thumbs) &&
+           opt.decode_shift <= jpegdec::MAX_SCALE_SHIFT && (opt.capture_jpeg || opt.decode_shift == 0) &&
+           (!opt.check_allocs || opt.loops > 1);
+}
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// FNV-1a, 64 Bit
+static void hash(uint64_t &h, const void *data, size_t len) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < len; ++i) {
+        h = (h ^ p[i]) * 0x100000001B3ULL;
+    }
+}
+
+// --------- Pipeline ----------------------------------
+
+// Replay-Sitzung: ein Frame-Record, die Stufen nacheinander, Reihenfolge wie die Tasks in pipeline.cpp
+class Replay {
+public:
+    Replay(const options_t &opt, replay::Detector &detector) : m_opt(opt), m_detector(detector) {}
+
+    bool init(const char *dir, const replay::frame_t &first);
+    void process(const replay::frame_t &frame);
+    bool finish();
+    const run_stats_t &stats() const { return m_stats; }
+    const stages::Stages &stages() const { return m_stages; }
+
+private:
+    static void ring_full(void *ctx);
+    bool drain();
+
+    const options_t &m_opt;
+    replay::Detector &m_detector;
+    stages::Stages m_stages;
+    stages::frame_t m_frame = {};
+    int64_t m_now_us = START_US;
+    run_stats_t m_stats = {};
+};
+
+// POLICY_BLOCK: statt auf den Storage-Task zu warten, selbst einen Record schreiben
+void Replay::ring_full(void *ctx) {
+    static_cast<Replay *>(ctx)->drain();
+}
+
+// storage: ältesten Record in den Digest, dann wie auf dem Gerät ablegen
+bool Replay::drain() {
+    uint32_t len = 0;
+    const uint8_t *rec = m_stages.ring().peek(len);
+    if (!rec) {
+        return false;
+    }
+    hash(m_stats.digest, rec, len);
+    if (!m_stages.store_next()) {
+        m_stats.failed++;
+    }
+    return true;
+}
+
+bool Replay::init(const char *dir, const replay::frame_t &first) {
+    m_stats.digest = 0xCBF29CE484222325ULL;
+    host_timer_set(m_now_us);
+    const int shift = m_opt.decode_shift;
+    const int frame_width = first.width >> shift;
+    const int frame_height = first.height >> shift;
+
+    // Konfiguration wie pipeline::default_config(), Kconfig-Werte aus den Optionen
+    pipeline::config_t cfg = {};
+    cfg.frame_width = frame_width;
+    cfg.frame_height = frame_height;
+    cfg.capture = m_opt.capture_jpeg ? pipeline::CAPTURE_JPEG : pipeline::CAPTURE_RGB565;
+    cfg.jpeg_capture = {shift, SENSOR_JPEG_MAX_BYTES};
+    // Ohne --interval-ms der CaptureScheduler wie auf dem Gerät
+    cfg.capture_interval_ms = m_opt.interval_ms;
+    cfg.policy[pipeline::STAGE_STORAGE] = pipeline::POLICY_BLOCK;
+    cfg.out_dir = dir;
+    cfg.gate_enabled = m_opt.gate;
+    cfg.gate = motion::default_gate_config();
+    cfg.tracker_enabled = m_opt.tracker;
+    cfg.tracker = tracking::default_tracker_config(frame_width, frame_height);
+    cfg.scheduler_enabled = m_opt.interval_ms == 0;
+    cfg.scheduler = scheduler::default_scheduler_config();
+    cfg.archive = m_opt.thumbs ? pipeline::ARCHIVE_THUMBNAILS : pipeline::ARCHIVE_FULL_FRAME;
+    cfg.thumb = {m_opt.thumb_size, m_opt.thumb_padding, m_opt.context_s * 1000};
+    cfg.annotate = m_opt.annotate;
+    cfg.storage = {m_opt.segments, m_opt.segment_mb * 1024 * 1024, m_opt.flush_ms, m_opt.batch_kb * 1024, true,
+                   m_opt.flush_ms, RING_BYTES};
+    cfg.jpeg_quality = m_opt.quality;
+    cfg.jpeg_subsampling = m_opt.subsampling;
+
+    // RGB565 geht paarweise in den Encoder, daher gerade Breite
+    stages::setup_t setup = {};
+    setup.roi_width = std::min(m_opt.roi, frame_width) & ~1;
+    setup.roi_height = std::min(m_opt.roi, frame_height);
+    setup.frame_records = 1;
+    setup.decoded_slots = 1;
+    setup.hooks = {this, nullptr, ring_full, nullptr};
+    if (!m_stages.init(cfg, setup, &m_detector)) {
+        return false;
+    }
+    m_stages.reset_frame(&m_frame);
+    ESP_LOGI(TAG, "Frames %dx%d, ROI %dx%d", frame_width, frame_height, setup.roi_width, setup.roi_height);
+    return true;
+}
+
+void Replay::process(const replay::frame_t &frame) {
+    host_timer_set(m_now_us);
+    m_stats.frames++;
+    const bool jpeg = m_opt.capture_jpeg;
+    m_detector.begin_frame(frame.stem, frame.width >> m_opt.decode_shift, frame.height >> m_opt.decode_shift);
+
+    // capture: auf dem Gerät das Leasen des Framebuffers, hier liegt der Frame schon bereit
+    PROFILE_SPAN(capture_span, profiler::SPAN_CAPTURE);
+    const std::vector<uint8_t> &data = jpeg ? frame.jpeg : frame.rgb565;
+    const stages::sensor_image_t img = {data.empty() ? nullptr : data.data(), data.size(), frame.width,
+                                        frame.height};
+    PROFILE_SPAN_END(capture_span);
+    const stages::capture_result_t r = m_stages.capture(&m_frame, img, m_now_us);
+    bool ok = r.ok;
+    if (ok && r.run_detector) {
+        m_stats.inferred++;
+        ok = m_stages.infer(&m_frame);
+        if (ok) {
+            m_stats.detections += m_frame.results.size();
+            ok = m_stages.encode(&m_frame);
+        }
+    }
+    if (!ok) {
+        m_stats.failed++;
+    }
+    m_stages.reset_frame(&m_frame);
+    while (drain()) {
+    }
+    // Ohne gemessene Latenz, damit das Intervall nur von den Frames abhängt
+    m_now_us += (int64_t)m_stages.schedule(m_now_us, r.motion, 0) * 1000;
+}
+
+bool Replay::finish() {
+    host_timer_set(m_now_us);
+    const bool log_closed = sdcard::close_detection_log();
+    return (!m_opt.segments || sdcard::close_segment()) && log_closed;
+}
+
+// --------- main ----------------------------------
+
+int main(int argc, char **argv) {
+    options_t opt;
+    host_log_level = 2;
+    if (!parse(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+    host_random_seed(1);
+    profiler::init();
+
+    replay::FrameSource source;
+    if (!source.open(opt.frames.c_str(), opt.raw_width, opt.raw_height)) {
+        printf("No frames in %s\n", opt.frames.c_str());
+        return 1;
+    }
+    std::unique_ptr<replay::Detector> detector =
+        opt.detections.empty() ? replay::make_stub_detector(opt.min_score)
+                              : replay::make_label_detector(opt.detections.c_str(), opt.min_score);
+
+    storage::PosixBackend fs(opt.root.c_str());
+    if (!sdcard::init(fs)) {
+        printf("Could not use %s\n", opt.root.c_str());
+        return 1;
+    }
+    // Der erste Frame legt ROI und Puffergrößen fest
+    replay::frame_t frame;
+    if (!source.load(0, frame)) {
+        printf("Could not load the first frame from %s\n", opt.frames.c_str());
+        return 1;
+    }
+    const char *dir = "/sdcard/replay";
+    Replay replay(opt, *detector);
+    if (!sdcard::create_dir(dir) || !replay.init(dir, frame)) {
+        return 1;
+    }
+
+    // Laden und Dekodieren der Frames zählt nicht zur Pipeline-Zeit
+    int64_t pipeline_us = 0;
+    uint64_t allocs = 0;
+    uint32_t counted_frames = 0;
+    for (int loop = 0; loop < opt.loops; ++loop) {
+        for (size_t i = 0; i < source.count(); ++i) {
+            if (!source.load(i, frame)) {
+                continue;
+            }
+            const bool count = opt.check_allocs && loop > 0;
+            const int64_t t0 = now_us();
+            if (count) {
+                hostalloc::start();
+            }
+            replay.process(frame);
+            if (count) {
+                allocs += hostalloc::stop();
+                counted_frames++;
+            }
+            pipeline_us += now_us() - t0;
+        }
+    }
+    const int64_t t0 = now_us();
+    const bool closed = replay.finish();
+    pipeline_us += now_us() - t0;
+
+    const run_stats_t &st = replay.stats();
+    const stages::Stages &stages = replay.stages();
+    const motion::gate_stats_t &gs = stages.gate().stats();
+    const tracking::tracker_stats_t &ts = stages.tracker().stats();
+    const stages::archive_stats_t &as = stages.archive();
+    const stages::capture_cost_t &cc = stages.capture_cost();
+    const uint32_t records = as.frames + as.thumbs;
+    const storage::posix_stats_t &io = fs.stats();
+    const double seconds = pipeline_us / 1e6;
+    printf("frames %u from %s (%zu files x %d), detector %s, archive %s/%s\n", st.frames, opt.frames.c_str(),
+           source.count(), opt.loops, detector->name(), opt.thumbs ? "thumbs" : "frames",
+           opt.segments ? "segments" : "files");
+    printf("gate: %u init, %u motion, %u forced, %u skipped; detector ran on %u frames, %u detections, "
+           "%u crossings\n",
+           gs.decisions[motion::DECISION_INIT], gs.decisions[motion::DECISION_MOTION],
+           gs.decisions[motion::DECISION_FORCED], gs.decisions[motion::DECISION_SKIP], st.inferred, st.detections,
+           ts.crossings[tracking::DIRECTION_IN] + ts.crossings[tracking::DIRECTION_OUT]);
+    printf("stored %u frames, %u thumbs, %llu JPEG bytes (%.0f per record), %llu bytes written, %u dropped, "
+           "%u failed\n",
+           as.frames, as.thumbs, (unsigned long long)as.bytes, records ? (double)as.bytes / records : 0.0,
+           (unsigned long long)io.bytes, as.dropped, st.failed);
+    // Zeiten bis zum Modell-Input misst die virtuelle Uhr nicht, siehe decode/convert/preprocess in den Spans
+    const uint32_t captured = std::max<uint32_t>(cc.frames, 1);
+    printf("capture %s: per frame %llu bytes sensor, %llu decoded, %llu converted, %llu copied; "
+           "not archived: too large %u, no slot %u\n",
+           opt.capture_jpeg ? "jpeg" : "rgb565", (unsigned long long)(cc.sensor_bytes / captured),
+           (unsigned long long)(cc.decoded_bytes / captured), (unsigned long long)(cc.converted_bytes / captured),
+           (unsigned long long)(cc.copied_bytes / captured), cc.too_large, cc.no_slot);
+    printf("%.1f frames/s, %.3f s in the pipeline\n", seconds > 0 ? st.frames / seconds : 0.0, seconds);
+    printf("digest %016llx\n", (unsigned long long)st.digest);
+    if (opt.check_allocs) {
+        printf("allocations in steady state: %llu in %u frames\n", (unsigned long long)allocs, counted_frames);
+    }
+    // Zeiten aus den Spans; die Encoder-Statistik misst mit der virtuellen Uhr und bleibt bei 0
+    host_log_level = std::max(host_log_level, 3);
+    profiler::log_report();
+    return st.failed || as.dropped || !closed || allocs ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+#include "replay_detector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "alloc_count.hpp"
+#include "rgb565_tensor.hpp"
+
+namespace replay {
+
+// nms_thr des 224er-Modells (model_registry.cpp, auf dem Host nicht gebaut)
+static constexpr float NMS_THR = 0.7f;
+
+// --------- Internal helpers ----------------------------------
+
+namespace {
+
+class ReplayDetector : public Detector {
+public:
+    explicit ReplayDetector(float min_score) : m_min_score(min_score) {
+        // Input-Normalisierung der ESPDet-Modelle: v / 255, Exponent -7
+        const float mean[3] = {0.0f, 0.0f, 0.0f};
+        const float std[3] = {255.0f, 255.0f, 255.0f};
+        bumblebee_detect::make_rgb565_lut(mean, std, -7, m_lut);
+    }
+
+    void begin_frame(const std::string &stem, int frame_width, int frame_height) override {
+        m_stem = &stem;
+        m_frame_width = frame_width;
+        m_frame_height = frame_height;
+    }
+
+    // Ein Modell, keine Kaskade
+    bool cascade_enabled() const override { return false; }
+    int model_index() const override { return 0; }
+    float min_score() const override { return m_min_score; }
+    float nms_threshold() const override { return NMS_THR; }
+
+    // Modell-Input wie ESPDet::preprocess, ohne Modell nur für die Zeitmessung
+    void preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area) override {
+        int x0 = 0, y0 = 0, w = img.width, h = img.height;
+        if (crop_area.size() == 4) {
+            x0 = crop_area[0];
+            y0 = crop_area[1];
+            w = crop_area[2] - crop_area[0];
+            h = crop_area[3] - crop_area[1];
+        }
+        m_tensor.resize((size_t)w * h * 3);
+        bumblebee_detect::rgb565_roi_to_tensor(static_cast<const uint8_t *>(img.data), img.width, img.height, x0, y0,
+                                               w, h, m_lut, m_tensor.data());
+    }
+
+    const detector::ResultList &infer(int img_width, int img_height) override {
+        // Der Stand-in zählt nicht mit, auf dem Gerät läuft an seiner Stelle esp-dl
+        const bool counting = hostalloc::suspend();
+        m_raw.clear();
+        if (m_stem) {
+            read(*m_stem, m_raw);
+        }
+        hostalloc::resume(counting);
+        collect(img_width, img_height);
+        return m_results;
+    }
+
+    const detector::ResultList &detect(const dl::image::img_t &img, const std::vector<int> &) override {
+        return infer(img.width, img.height);
+    }
+
+protected:
+    // Boxen in Framekoordinaten, absteigend nach Score
+    virtual void read(const std::string &, std::vector<dl::detect::result_t> &) {}
+
+    int m_frame_width = 0;
+    int m_frame_height = 0;
+
+private:
+    // DetectorService::collect. Ist das Bild kleiner als der Frame, ist es der zentrierte ROI
+    // (dekodierter ROI bei JPEG-Aufnahme); Boxen kommen in dessen Koordinaten zurück.
+    void collect(int img_width, int img_height) {
+        const int dx = (m_frame_width - img_width) / 2;
+        const int dy = (m_frame_height - img_height) / 2;
+        m_results.clear();
+        for (const auto &res : m_raw) {
+            if (res.category == 0 && res.score > m_min_score && m_results.push_back(res)) {
+                // result_t::box ist ein std::vector: nicht kopieren, im Slot verschieben
+                std::vector<int> &box = m_results[m_results.size() - 1].box;
+                box = {res.box[0] - dx, res.box[1] - dy, res.box[2] - dx, res.box[3] - dy};
+            }
+        }
+    }
+
+    float m_min_score;
+    bumblebee_detect::rgb565_lut_t m_lut;
+    std::vector<int8_t> m_tensor;
+    const std::string *m_stem = nullptr;
+    std::vector<dl::detect::result_t> m_raw;
+    detector::ResultList m_results;
+};
+
+class StubDetector : public ReplayDetector {
+public:
+    using ReplayDetector::ReplayDetector;
+    const char *name() const override { return "stub"; }
+};
+
+class LabelDetector : public ReplayDetector {
+public:
+    LabelDetector(const char *dir, float min_score) : ReplayDetector(min_score), m_dir(dir) {}
+    const char *name() const override { return "labels"; }
+
+protected:
+    void read(const std::string &stem, std::vector<dl::detect::result_t> &out) override {
+        const std::string path = m_dir + "/" + stem + ".txt";
+        FILE *f = fopen(path.c_str(), "r");
+        if (!f) {
+            return;
+        }
+        const int w = m_frame_width;
+        const int h = m_frame_height;
+        char line[160];
+        while (fgets(line, sizeof(line), f)) {
+            int category;
+            float cx, cy, bw, bh, score = 1.0f;
+            if (sscanf(line, "%d %f %f %f %f %f", &category, &cx, &cy, &bw, &bh, &score) < 5) {
+                continue;
+            }
+            dl::detect::result_t res;
+            res.category = category;
+            res.score = score;
+            res.box = {std::clamp((int)lroundf((cx - bw / 2) * w), 0, w - 1),
+                       std::clamp((int)lroundf((cy - bh / 2) * h), 0, h - 1),
+                       std::clamp((int)lroundf((cx + bw / 2) * w), 0, w - 1),
+                       std::clamp((int)lroundf((cy + bh / 2) * h), 0, h - 1)};
+            out.push_back(res);
+        }
+        fclose(f);
+        // Wie das Postprocessing: absteigend nach Score
+        std::stable_sort(out.begin(), out.end(),
+                         [](const dl::detect::result_t &a, const dl::detect::result_t &b) { return a.score > b.score; });
+    }
+
+private:
+    std::string m_dir;
+};
+
+} // namespace
+
+// --------- Public API ----------------------------------
+
+std::unique_ptr<Detector> make_stub_detector(float min_score) {
+    return std::make_unique<StubDetector>(min_score);
+}
+
+std::unique_ptr<Detector> make_label_detector(const char *dir, float min_score) {
+    return std::make_unique<LabelDetector>(dir, min_score);
+}
+
+} // namespace replay
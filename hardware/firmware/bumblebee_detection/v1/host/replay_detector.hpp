@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "detector.hpp"
+
+// Ersatz für DetectorService im Replay, hinter derselben Schnittstelle (detector::Detector),
+// die pipeline_stages.cpp auf dem Gerät ruft. preprocess() baut den int8-Modell-Input wie
+// ESPDet, statt des Modells liefert infer() die Boxen des Frames; danach filtert es wie
+// DetectorService::collect (Kategorie 0, Score über min_score, höchstens MAX_RESULTS).
+namespace replay {
+
+class Detector : public detector::Detector {
+public:
+    virtual const char *name() const = 0;
+    // Vor jedem Frame: Dateiname ohne Endung und Framegröße (bei JPEG-Aufnahme nach Skalierung)
+    virtual void begin_frame(const std::string &stem, int frame_width, int frame_height) = 0;
+};
+
+// Keine Detektionen; misst Gate, Konvertierung, Encode und Ablage ohne Modell
+std::unique_ptr<Detector> make_stub_detector(float min_score);
+
+// Vorberechnete Detektionen: je Frame <dir>/<stem>.txt im YOLO-Format
+// "class cx cy w h [score]", normiert auf den Frame (Labels oder yolo predict save_conf).
+// Ohne Score-Spalte gilt 1.0, fehlende Dateien bedeuten keine Detektion.
+std::unique_ptr<Detector> make_label_detector(const char *dir, float min_score);
+
+} // namespace replay
@@ -0,0 +1,137 @@
+#include "replay_source.hpp"
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <filesystem>
+#include <jpeglib.h>
+#include "esp_log.h"
+
+namespace replay {
+
+static const char *TAG = "REPLAY";
+static constexpr int MAX_WIDTH = 4096;
+
+// --------- Internal helpers ----------------------------------
+
+static bool is_jpeg(const std::string &ext) {
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".JPG" || ext == ".JPEG";
+}
+
+static bool is_raw(const std::string &ext) {
+    return ext == ".rgb565" || ext == ".raw";
+}
+
+struct error_mgr_t {
+    jpeg_error_mgr pub;
+    jmp_buf jump;
+};
+
+static void on_error(j_common_ptr cinfo) {
+    longjmp(reinterpret_cast<error_mgr_t *>(cinfo->err)->jump, 1);
+}
+
+static void on_message(j_common_ptr) {}
+
+// Ohne C++-Objekte mit Destruktor, longjmp springt hier heraus
+static bool decode_jpeg(frame_t &out) {
+    jpeg_decompress_struct cinfo;
+    error_mgr_t err;
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = on_error;
+    err.pub.output_message = on_message;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, out.jpeg.data(), (unsigned long)out.jpeg.size());
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+    const int width = cinfo.output_width;
+    uint8_t row[MAX_WIDTH * 3];
+    if (width > MAX_WIDTH) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    out.width = width;
+    out.height = cinfo.output_height;
+    out.rgb565.resize((size_t)out.width * out.height * 2);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        const size_t y = cinfo.output_scanline;
+        JSAMPROW rows[1] = {row};
+        jpeg_read_scanlines(&cinfo, rows, 1);
+        rgb888_to_rgb565_be(row, width, out.rgb565.data() + y * width * 2);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+// --------- Public API ----------------------------------
+
+void rgb888_to_rgb565_be(const uint8_t *rgb, size_t pixels, uint8_t *out) {
+    for (size_t i = 0; i < pixels; ++i, rgb += 3, out += 2) {
+        const uint16_t v = (uint16_t)(((rgb[0] & 0xF8) << 8) | ((rgb[1] & 0xFC) << 3) | (rgb[2] >> 3));
+        out[0] = v >> 8;
+        out[1] = v & 0xFF;
+    }
+}
+
+bool FrameSource::open(const char *dir, int raw_width, int raw_height) {
+    namespace fs = std::filesystem;
+    m_paths.clear();
+    m_raw_width = raw_width;
+    m_raw_height = raw_height;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file()) {
+            continue;
+        }
+        const std::string ext = it->path().extension().string();
+        if (is_jpeg(ext) || (is_raw(ext) && raw_width > 0 && raw_height > 0)) {
+            m_paths.push_back(it->path().string());
+        }
+    }
+    if (ec) {
+        ESP_LOGE(TAG, "Could not read %s: %s", dir, ec.message().c_str());
+        return false;
+    }
+    std::sort(m_paths.begin(), m_paths.end());
+    return !m_paths.empty();
+}
+
+bool FrameSource::load(size_t index, frame_t &out) const {
+    const std::filesystem::path path(m_paths[index]);
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        ESP_LOGE(TAG, "Could not open %s", path.c_str());
+        return false;
+    }
+    out.stem = path.stem().string();
+    out.jpeg.clear();
+    bool ok;
+    if (is_raw(path.extension().string())) {
+        out.width = m_raw_width;
+        out.height = m_raw_height;
+        out.rgb565.resize((size_t)m_raw_width * m_raw_height * 2);
+        ok = fread(out.rgb565.data(), 1, out.rgb565.size(), f) == out.rgb565.size();
+        fclose(f);
+    } else {
+        // Dateiinhalt bleibt als "Sensor-JPEG" für die JPEG-Aufnahme erhalten
+        uint8_t chunk[4096];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            out.jpeg.insert(out.jpeg.end(), chunk, chunk + n);
+        }
+        fclose(f);
+        ok = !out.jpeg.empty() && decode_jpeg(out);
+    }
+    if (!ok) {
+        ESP_LOGE(TAG, "Could not decode %s", path.c_str());
+    }
+    return ok;
+}
+
+} // namespace replay
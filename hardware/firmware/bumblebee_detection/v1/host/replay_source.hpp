@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Ersatz für die Kamera im Replay: Bilder aus einem Verzeichnis (rekursiv, nach Pfad sortiert,
+// damit jeder Lauf dieselbe Reihenfolge sieht). JPEGs werden dekodiert, .rgb565/.raw-Dateien
+// sind Framebuffer-Abzüge in der Größe raw_width x raw_height. Geliefert wird wie von der
+// Kamera RGB565 big endian, bei JPEG-Dateien zusätzlich der Dateiinhalt wie bei PIXFORMAT_JPEG.
+namespace replay {
+
+struct frame_t {
+    std::vector<uint8_t> rgb565;
+    std::vector<uint8_t> jpeg;   // Dateiinhalt, leer bei Framebuffer-Abzügen
+    int width = 0;
+    int height = 0;
+    std::string stem;    // Dateiname ohne Endung, für die zugehörigen Detektionen
+};
+
+class FrameSource {
+public:
+    // false, wenn dir keine lesbaren Bilder enthält
+    bool open(const char *dir, int raw_width = 0, int raw_height = 0);
+    size_t count() const { return m_paths.size(); }
+    const std::string &path(size_t index) const { return m_paths[index]; }
+    bool load(size_t index, frame_t &out) const;
+
+private:
+    std::vector<std::string> m_paths;
+    int m_raw_width = 0;
+    int m_raw_height = 0;
+};
+
+// RGB888 -> RGB565 big endian, wie der Kamera-Framebuffer
+void rgb888_to_rgb565_be(const uint8_t *rgb, size_t pixels, uint8_t *out);
+
+} // namespace replay
@@ -0,0 +1,63 @@
+// Durchsatz der ROI-Konvertierung (rgb565_roi.cpp) auf dem Host, mit derselben Messung wie
+// CONFIG_BEESENSE_ROI_BENCH auf dem Gerät (roi_bench.cpp): skalare Referenz, wortweiser Pfad
+// und als Untergrenze ein memcpy derselben Bytemenge. Auf dem Host liegt alles im Cache, die
+// Untergrenze ist hier viel niedriger als aus dem PSRAM des ESP32-S3. Die PIE-Zeile misst
+// hier das Lane-Modell des Kerns, nicht den Kern; aussagekräftig ist sie nur auf dem Gerät.
+//
+//   roi_bench [--roi 224] [--frame 320x240] [--iterations 2000]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "roi_bench.hpp"
+
+struct options_t {
+    int frame_width = 320;
+    int frame_height = 240;
+    int roi = 224;
+    int iterations = 2000;
+};
+
+static bool parse(int argc, char **argv, options_t &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *arg = argv[i];
+        const char *value = argv[i + 1];
+        if (strcmp(arg, "--roi") == 0) {
+            opt.roi = atoi(value);
+        } else if (strcmp(arg, "--frame") == 0) {
+            if (sscanf(value, "%dx%d", &opt.frame_width, &opt.frame_height) != 2) {
+                return false;
+            }
+        } else if (strcmp(arg, "--iterations") == 0) {
+            opt.iterations = atoi(value);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.roi > 0 && opt.roi <= std::min(opt.frame_width, opt.frame_height) &&
+           opt.iterations > 0;
+}
+
+int main(int argc, char **argv) {
+    options_t opt;
+    if (!parse(argc, argv, opt)) {
+        printf("usage: roi_bench [--roi PX] [--frame WxH] [--iterations N]\n");
+        return 2;
+    }
+    host_random_seed(1);
+    std::vector<uint8_t> frame((size_t)opt.frame_width * opt.frame_height * 2);
+    for (auto &b : frame) {
+        b = (uint8_t)esp_random();
+    }
+    std::vector<uint8_t> dst((size_t)opt.roi * opt.roi * 3);
+    printf("roi %dx%d from %dx%d, %d iterations, best of 5\n", opt.roi, opt.roi, opt.frame_width, opt.frame_height,
+           opt.iterations);
+    const imgconv::roi_bench_t r =
+        imgconv::bench_rgb565_roi(frame.data(), opt.frame_width, opt.frame_height, opt.roi, dst.data(), opt.iterations);
+    imgconv::log_roi_bench(r);
+    return 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace dl {
+namespace cls {
+
+typedef struct {
+    const char *cat_name;
+    float score;
+} result_t;
+
+} // namespace cls
+} // namespace dl
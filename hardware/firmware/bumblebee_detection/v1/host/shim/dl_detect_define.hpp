@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+namespace dl {
+namespace detect {
+
+typedef struct {
+    int category;
+    float score;
+    std::vector<int> box;
+    std::vector<int> keypoint;
+} result_t;
+
+} // namespace detect
+} // namespace dl
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Nur die Typen aus esp-dl, die die Firmware-Schnittstellen verwenden
+namespace dl {
+namespace image {
+
+typedef enum {
+    DL_IMAGE_PIX_TYPE_RGB888 = 0,
+    DL_IMAGE_PIX_TYPE_BGR888,
+    DL_IMAGE_PIX_TYPE_RGB565,
+    DL_IMAGE_PIX_TYPE_BGR565,
+    DL_IMAGE_PIX_TYPE_GRAY,
+} pix_type_t;
+
+typedef struct {
+    void *data;
+    uint16_t width;
+    uint16_t height;
+    pix_type_t pix_type;
+} img_t;
+
+typedef struct {
+    void *data;
+    size_t data_len;
+} jpeg_img_t;
+
+} // namespace image
+} // namespace dl
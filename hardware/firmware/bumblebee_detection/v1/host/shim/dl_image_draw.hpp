@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "dl_image_define.hpp"
+
+// Host-Nachbau von dl::image::draw_hollow_rectangle für RGB888-Bilder: Rahmen der Breite
+// line_width innerhalb von (x1, y1)..(x2, y2), Koordinaten inklusive
+namespace dl {
+namespace image {
+
+inline void draw_hollow_rectangle(img_t &img, int x1, int y1, int x2, int y2, const std::vector<uint8_t> &color,
+                                  uint8_t line_width = 1) {
+    if (img.pix_type != DL_IMAGE_PIX_TYPE_RGB888 || color.size() < 3 || !line_width) {
+        return;
+    }
+    uint8_t *data = static_cast<uint8_t *>(img.data);
+    auto fill = [&](int xa, int ya, int xb, int yb) {
+        xa = std::max(xa, 0);
+        ya = std::max(ya, 0);
+        xb = std::min(xb, (int)img.width - 1);
+        yb = std::min(yb, (int)img.height - 1);
+        for (int y = ya; y <= yb; ++y) {
+            for (int x = xa; x <= xb; ++x) {
+                uint8_t *p = data + ((size_t)y * img.width + x) * 3;
+                p[0] = color[0];
+                p[1] = color[1];
+                p[2] = color[2];
+            }
+        }
+    };
+    const int w = line_width - 1;
+    fill(x1, y1, x2, y1 + w);
+    fill(x1, y2 - w, x2, y2);
+    fill(x1, y1, x1 + w, y2);
+    fill(x2 - w, y1, x2, y2);
+}
+
+} // namespace image
+} // namespace dl
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "dl_image_define.hpp"
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// "Zyklen" auf dem Host: Nanosekunden seit Programmstart, siehe esp_rom_get_cpu_ticks_per_us()
+uint32_t esp_cpu_get_cycle_count();
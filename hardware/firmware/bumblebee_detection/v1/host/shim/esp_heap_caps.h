@@ -0,0 +1,44 @@
+#pragma once
+
+#include <malloc.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_EXEC     (1 << 0)
+#define MALLOC_CAP_32BIT    (1 << 1)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+// Auf dem Host gibt es nur einen Heap
+inline void *heap_caps_malloc(size_t size, uint32_t) {
+    return malloc(size);
+}
+
+inline void *heap_caps_calloc(size_t n, size_t size, uint32_t) {
+    return calloc(n, size);
+}
+
+inline void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t) {
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+inline void heap_caps_free(void *p) {
+    free(p);
+}
+
+// Freier Speicher der malloc-Arena, ohne Speicherarten; Grenzen wie auf dem Gerät gibt es nicht
+inline size_t heap_caps_get_free_size(uint32_t) {
+    return mallinfo2().fordblks;
+}
+
+inline size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+inline size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
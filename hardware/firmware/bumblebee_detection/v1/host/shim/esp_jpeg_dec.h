@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include "esp_jpeg_common.h"
+
+// Schnittstelle von esp_new_jpeg (esp_jpeg_dec.h), soweit jpeg_decoder.cpp sie verwendet.
+// Im Host-Build dekodiert libjpeg (jpeg_dec_host.cpp). Blockmodus: 16 Zeilen je
+// jpeg_dec_process(), Skalierung über scale_denom von libjpeg.
+
+typedef struct {
+    jpeg_pixel_format_t output_type;
+    jpeg_resolution_t scale;     // Ausgabegröße nach Skalierung, {0, 0} = unskaliert
+    jpeg_resolution_t clipper;   // im Shim nicht unterstützt
+    jpeg_rotate_t rotate;
+    bool block_enable;           // jpeg_dec_process() liefert je Aufruf eine Blockzeile
+} jpeg_dec_config_t;
+
+#define DEFAULT_JPEG_DEC_CONFIG()                                                                                   \
+    {                                                                                                               \
+        .output_type = JPEG_PIXEL_FORMAT_RGB565_LE, .scale = {0, 0}, .clipper = {0, 0}, .rotate = JPEG_ROTATE_0D,  \
+        .block_enable = false,                                                                                      \
+    }
+
+typedef struct {
+    uint8_t *inbuf;
+    int inbuf_len;
+    int inbuf_remain;   // nach dem Aufruf noch nicht verbrauchte Eingangsbytes
+    uint8_t *outbuf;
+    int out_size;
+} jpeg_dec_io_t;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+} jpeg_dec_header_info_t;
+
+typedef void *jpeg_dec_handle_t;
+
+jpeg_error_t jpeg_dec_open(jpeg_dec_config_t *config, jpeg_dec_handle_t *jpeg_dec);
+jpeg_error_t jpeg_dec_parse_header(jpeg_dec_handle_t jpeg_dec, jpeg_dec_io_t *io, jpeg_dec_header_info_t *out_info);
+// Bytes je jpeg_dec_process(): eine Blockzeile im Blockmodus, sonst das ganze Bild
+jpeg_error_t jpeg_dec_get_outbuf_len(jpeg_dec_handle_t jpeg_dec, int *outbuf_len);
+jpeg_error_t jpeg_dec_get_process_count(jpeg_dec_handle_t jpeg_dec, int *process_count);
+jpeg_error_t jpeg_dec_process(jpeg_dec_handle_t jpeg_dec, jpeg_dec_io_t *io);
+jpeg_error_t jpeg_dec_close(jpeg_dec_handle_t jpeg_dec);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include "esp_jpeg_common.h"
+
+// Schnittstelle von esp_new_jpeg (esp_jpeg_enc.h), soweit jpeg_encoder.cpp sie verwendet.
+// Im Host-Build kodiert libjpeg (jpeg_enc_host.cpp): gleiche Eingangsformate und
+// Subsampling-Stufen, die Bytes unterscheiden sich aber von denen des Geräts.
+
+typedef struct {
+    int width;
+    int height;
+    jpeg_pixel_format_t src_type;
+    jpeg_subsampling_t subsampling;
+    uint8_t quality;
+    jpeg_rotate_t rotate;
+    bool task_enable;
+    int hfm_task_priority;
+    int hfm_task_core;
+} jpeg_enc_config_t;
+
+typedef void *jpeg_enc_handle_t;
+
+jpeg_error_t jpeg_enc_open(jpeg_enc_config_t *info, jpeg_enc_handle_t *jpeg_enc);
+// JPEG_ERR_NO_MEM, wenn das Bild nicht in outbuf passt
+jpeg_error_t jpeg_enc_process(const jpeg_enc_handle_t jpeg_enc, const uint8_t *inbuf, int inbuf_size, uint8_t *outbuf,
+                              int outbuf_size, int *out_size);
+jpeg_error_t jpeg_enc_close(jpeg_enc_handle_t jpeg_enc);
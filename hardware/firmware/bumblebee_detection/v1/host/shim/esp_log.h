@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdio>
+
+// ESP_LOGx auf stdout; Ausgabe bis host_log_level (1 = Fehler ... 3 = Info, 4 = Debug)
+extern int host_log_level;
+
+#define HOST_LOG(level, letter, tag, format, ...)                                   \
+    do {                                                                            \
+        if (host_log_level >= (level)) {                                            \
+            printf(letter " (%s) " format "\n", tag, ##__VA_ARGS__);                \
+        }                                                                           \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG(1, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG(2, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG(3, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG(4, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) HOST_LOG(5, "V", tag, format, ##__VA_ARGS__)
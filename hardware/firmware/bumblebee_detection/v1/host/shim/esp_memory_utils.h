@@ -0,0 +1,5 @@
+#pragma once
+
+inline bool esp_ptr_internal(const void *) {
+    return true;
+}
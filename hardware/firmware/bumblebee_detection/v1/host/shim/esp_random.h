@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// Reproduzierbar: fester Startwert, damit Host-Läufe vergleichbar bleiben
+uint32_t esp_random();
+void host_random_seed(uint32_t seed);
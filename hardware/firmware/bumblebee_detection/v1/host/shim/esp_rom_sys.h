@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// 1000 passend zu esp_cpu_get_cycle_count() im Host-Build
+uint32_t esp_rom_get_cpu_ticks_per_us();
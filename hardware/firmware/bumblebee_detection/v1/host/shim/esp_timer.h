@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+// Mikrosekunden seit Programmstart (steady_clock)
+int64_t esp_timer_get_time();
+// Virtuelle Zeit: ab dem ersten Aufruf liefert esp_timer_get_time() den gesetzten Wert,
+// damit Wiederholungsläufe dieselben Zeitstempel und Intervalle sehen
+void host_timer_set(int64_t us);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+
+// Nur der FatFs-Typ für get_fattime()
+typedef uint32_t DWORD;
+
+DWORD get_fattime(void);
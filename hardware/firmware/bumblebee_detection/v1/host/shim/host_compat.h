@@ -0,0 +1,25 @@
+#pragma once
+
+// Wird im Host-Build jeder Übersetzungseinheit vorangestellt (-include): was newlib auf dem
+// Gerät mitbringt, glibc aber erst ab 2.38
+#include <string.h>
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+    const size_t len = strlen(src);
+    if (size) {
+        const size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+inline size_t strlcat(char *dst, const char *src, size_t size) {
+    const size_t used = strnlen(dst, size);
+    if (used == size) {
+        return size + strlen(src);
+    }
+    return used + strlcpy(dst + used, src, size - used);
+}
+#endif
@@ -0,0 +1,5 @@
+#pragma once
+
+// Konfiguration des Host-Builds, soweit die portablen Module sie abfragen
+#define CONFIG_BEESENSE_PROFILER 1
+#define CONFIG_BEESENSE_PROFILER_WINDOW 128
@@ -0,0 +1,223 @@
+// I/O-Benchmark der Speicherpfade aus sd_card.cpp auf dem Host: legt Bilder wie die Firmware ab
+// (einzelne JPEG-Dateien mit Dateiindex und Stunden-Shards oder Segment-Container mit
+// Group Commit) und misst Dateien/s, Bytes/s und die Latenzverteilung je Speichervorgang.
+// Langsame Karten über die Latenzoptionen von PosixBackend.
+// --mode fill schreibt (ohne --count) 10000 Einzeldateien in ein Verzeichnis und zeigt die Latenz
+// je Speichervorgang bei N = 100, 1000, 10000 Dateien: mit dem Dateiindex bleibt sie flach.
+//
+//   storage_bench --mode segments --count 2000 --write-us-per-kb 400 --stall-every 200 --stall-ms 250
+//   storage_bench --mode fill --root /tmp/beesense_fill
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "sd_card.hpp"
+#include "span_profiler.hpp"
+#include "storage_posix.hpp"
+
+// Messstellen für --mode fill: Dateien im Verzeichnis, ausgewertet über die letzten FILL_WINDOW
+static const uint32_t FILL_CHECKPOINTS[] = {100, 1000, 10000, 100000};
+static constexpr uint32_t FILL_WINDOW = 50;
+static constexpr uint32_t FILL_DEFAULT = 10000;
+
+struct options_t {
+    std::string root = "/tmp/beesense_bench";
+    bool segments = false;
+    bool fill = false;                // Einzeldateien, Latenz nach Dateinummer
+    int count = 0;                    // 0 = 500, bei fill bis zur letzten Messstelle
+    uint32_t size = 20 * 1024;        // mittlere JPEG-Größe, einzelne Bilder ±25 %
+    uint32_t batch_kb = 32;           // Segmente: Schreibpuffer (0 = stdio)
+    uint32_t segment_mb = 64;
+    uint32_t flush_ms = 5000;
+    storage::latency_config_t latency = {};
+};
+
+static void usage() {
+    printf("usage: storage_bench [--root DIR] [--mode files|segments|fill] [--count N] [--size BYTES]\n"
+           "                     [--batch-kb KB] [--segment-mb MB] [--flush-ms MS]\n"
+           "                     [--op-us US] [--write-us-per-kb US] [--sync-us US]\n"
+           "                     [--stall-every N] [--stall-ms MS] [--verbose]\n");
+}
+
+static bool parse(int argc, char **argv, options_t &opt) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--verbose") == 0) {
+            host_log_level = 3;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char *value = argv[++i];
+        const uint32_t n = (uint32_t)strtoul(value, nullptr, 10);
+        if (strcmp(arg, "--root") == 0) {
+            opt.root = value;
+        } else if (strcmp(arg, "--mode") == 0) {
+            opt.segments = strcmp(value, "segments") == 0;
+            opt.fill = strcmp(value, "fill") == 0;
+            if (!opt.segments && !opt.fill && strcmp(value, "files") != 0) {
+                return false;
+            }
+        } else if (strcmp(arg, "--count") == 0) {
+            opt.count = (int)n;
+        } else if (strcmp(arg, "--size") == 0) {
+            opt.size = n;
+        } else if (strcmp(arg, "--batch-kb") == 0) {
+            opt.batch_kb = n;
+        } else if (strcmp(arg, "--segment-mb") == 0) {
+            opt.segment_mb = n;
+        } else if (strcmp(arg, "--flush-ms") == 0) {
+            opt.flush_ms = n;
+        } else if (strcmp(arg, "--op-us") == 0) {
+            opt.latency.op_us = n;
+        } else if (strcmp(arg, "--write-us-per-kb") == 0) {
+            opt.latency.write_us_per_kb = n;
+        } else if (strcmp(arg, "--sync-us") == 0) {
+            opt.latency.sync_us = n;
+        } else if (strcmp(arg, "--stall-every") == 0) {
+            opt.latency.stall_every = n;
+        } else if (strcmp(arg, "--stall-ms") == 0) {
+            opt.latency.stall_ms = n;
+        } else {
+            return false;
+        }
+    }
+    if (opt.count == 0) {
+        opt.count = opt.fill ? (int)FILL_DEFAULT : 500;
+    }
+    return opt.count > 0 && opt.size > 0;
+}
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static int64_t percentile(const std::vector<int64_t> &sorted, int p) {
+    return sorted[std::min(sorted.size() - 1, sorted.size() * p / 100)];
+}
+
+// Latenz der Speichervorgänge, nach denen FILL_WINDOW Dateien bis einschließlich Nummer n im
+// Verzeichnis lagen. Die Nummern kommen aus dem Dateiindex, ein Lauf auf einem schon gefüllten
+// Verzeichnis setzt also bei dessen Dateizahl fort.
+static void report_fill(const std::vector<uint32_t> &seqs, const std::vector<int64_t> &latency) {
+    printf("save latency by files in directory (last %u saves each):\n", (unsigned)FILL_WINDOW);
+    int64_t first_p50 = 0;
+    int64_t last_p50 = 0;
+    for (uint32_t n : FILL_CHECKPOINTS) {
+        std::vector<int64_t> window;
+        for (size_t i = 0; i < seqs.size(); ++i) {
+            if (seqs[i] <= n && seqs[i] + FILL_WINDOW > n) {
+                window.push_back(latency[i]);
+            }
+        }
+        if (window.size() < FILL_WINDOW) {
+            continue;
+        }
+        std::sort(window.begin(), window.end());
+        printf("  N %6u: p50 %lld us, p95 %lld us, max %lld us\n", (unsigned)n, (long long)percentile(window, 50),
+               (long long)percentile(window, 95), (long long)window.back());
+        first_p50 = first_p50 ? first_p50 : percentile(window, 50);
+        last_p50 = percentile(window, 50);
+    }
+    if (first_p50) {
+        printf("p50 at largest N / p50 at smallest N: %.2f\n", (double)last_p50 / first_p50);
+    } else {
+        printf("  no checkpoint reached, use an empty --root or a larger --count\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    options_t opt;
+    host_log_level = 2;
+    if (!parse(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+    host_random_seed(1);
+    profiler::init();
+
+    storage::PosixBackend fs(opt.root.c_str(), opt.latency);
+    if (!sdcard::init(fs)) {
+        printf("Could not use %s\n", opt.root.c_str());
+        return 1;
+    }
+    const char *dir = "/sdcard/bench";
+    if (!sdcard::create_dir(dir)) {
+        return 1;
+    }
+    if (opt.segments) {
+        if ((opt.batch_kb && !sdcard::init_write_batch(opt.batch_kb * 1024)) ||
+            !sdcard::open_segment(dir, opt.segment_mb * 1024 * 1024, opt.flush_ms)) {
+            return 1;
+        }
+    }
+
+    // Gleiche Bildgrößen und Inhalte in jedem Lauf
+    std::vector<uint8_t> payload(opt.size + opt.size / 4);
+    for (auto &b : payload) {
+        b = (uint8_t)esp_random();
+    }
+    const segment::box_meta_t boxes[2] = {{10, 20, 60, 70, 870, 0}, {100, 40, 150, 90, 640, 0}};
+
+    std::vector<int64_t> latency;
+    latency.reserve(opt.count);
+    std::vector<uint32_t> seqs;  // Dateinummer je Speichervorgang, nur fill
+    seqs.reserve(opt.fill ? opt.count : 0);
+    uint64_t bytes = 0;
+    int failed = 0;
+    const int64_t start = now_us();
+    for (int i = 0; i < opt.count; ++i) {
+        dl::image::jpeg_img_t jpeg;
+        jpeg.data = payload.data();
+        jpeg.data_len = opt.size - opt.size / 4 + esp_random() % (opt.size / 2 + 1);
+
+        detlog::image_ref_t ref = {};
+        const int64_t t0 = now_us();
+        bool ok = opt.segments ? sdcard::append_detected_jpeg(jpeg, boxes, 2, t0)
+                               : sdcard::write_detected_jpeg(jpeg, dir, &ref);
+        latency.push_back(now_us() - t0);
+        if (opt.fill) {
+            seqs.push_back(ok ? ref.seq : 0);
+        }
+        if (ok) {
+            bytes += jpeg.data_len;
+        } else {
+            failed++;
+        }
+    }
+    if (opt.segments) {
+        sdcard::close_segment();
+    }
+    const double seconds = (now_us() - start) / 1e6;
+
+    const std::vector<int64_t> by_save = opt.fill ? latency : std::vector<int64_t>();
+    std::sort(latency.begin(), latency.end());
+    const storage::posix_stats_t &st = fs.stats();
+    printf("mode %s, %d images of ~%u bytes, root %s\n", opt.segments ? "segments" : opt.fill ? "fill" : "files",
+           opt.count, (unsigned)opt.size, opt.root.c_str());
+    printf("latency: op %u us, write %u us/KB, sync %u us, stall %u ms every %u writes\n", opt.latency.op_us,
+           opt.latency.write_us_per_kb, opt.latency.sync_us, opt.latency.stall_ms, opt.latency.stall_every);
+    printf("%.1f files/s, %.2f MB/s, %d failed, %.2f s total\n", opt.count / seconds, bytes / seconds / 1e6, failed,
+           seconds);
+    printf("save latency us: p50 %lld, p95 %lld, p99 %lld, max %lld\n", (long long)percentile(latency, 50),
+           (long long)percentile(latency, 95), (long long)percentile(latency, 99), (long long)latency.back());
+    if (opt.fill) {
+        report_fill(seqs, by_save);
+    }
+    printf("backend: %u ops, %u writes, %llu KB, %u syncs, %u stalls, %lld ms injected\n", st.ops, st.writes,
+           (unsigned long long)(st.bytes / 1024), st.syncs, st.stalls, (long long)(st.injected_us / 1000));
+    // Aufschlüsselung aus den Spans in sd_card.cpp, wie profile.csv auf der Karte
+    host_log_level = std::max(host_log_level, 3);
+    profiler::log_report();
+    profiler::write_csv(fs, "/sdcard/bench/profile.csv");
+    return failed ? 1 : 0;
+}
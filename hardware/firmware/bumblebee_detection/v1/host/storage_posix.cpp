@@ -0,0 +1,191 @@
+#include "storage_posix.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace storage {
+
+struct PosixBackend::cookie_t {
+    PosixBackend *fs;
+    int fd;
+    FILE *file;
+};
+
+// --------- Internal helpers ----------------------------------
+
+static int open_flags(const char *mode) {
+    const bool plus = strchr(mode, '+') != nullptr;
+    switch (mode[0]) {
+    case 'r':
+        return plus ? O_RDWR : O_RDONLY;
+    case 'w':
+        return (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+    case 'a':
+        return (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND;
+    default:
+        return -1;
+    }
+}
+
+void PosixBackend::delay(int64_t us) {
+    if (us <= 0) {
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+    m_stats.injected_us += us;
+}
+
+void PosixBackend::on_op() {
+    m_stats.ops++;
+    delay(m_latency.op_us);
+}
+
+void PosixBackend::on_write(size_t bytes) {
+    m_stats.writes++;
+    m_stats.bytes += bytes;
+    int64_t us = m_latency.op_us + (int64_t)bytes * m_latency.write_us_per_kb / 1024;
+    if (m_latency.stall_every && m_latency.stall_ms && m_stats.writes % m_latency.stall_every == 0) {
+        m_stats.stalls++;
+        us += (int64_t)m_latency.stall_ms * 1000;
+    }
+    delay(us);
+}
+
+int PosixBackend::descriptor(FILE *f) const {
+    auto it = m_files.find(f);
+    return it == m_files.end() ? fileno(f) : it->second->fd;
+}
+
+ssize_t PosixBackend::cookie_read(void *c, char *buf, size_t size) {
+    return ::read(static_cast<cookie_t *>(c)->fd, buf, size);
+}
+
+ssize_t PosixBackend::cookie_write(void *c, const char *buf, size_t size) {
+    cookie_t *cookie = static_cast<cookie_t *>(c);
+    cookie->fs->on_write(size);
+    return ::write(cookie->fd, buf, size);
+}
+
+int PosixBackend::cookie_seek(void *c, off64_t *offset, int whence) {
+    off_t pos = lseek(static_cast<cookie_t *>(c)->fd, *offset, whence);
+    if (pos < 0) {
+        return -1;
+    }
+    *offset = pos;
+    return 0;
+}
+
+int PosixBackend::cookie_close(void *c) {
+    cookie_t *cookie = static_cast<cookie_t *>(c);
+    cookie->fs->m_files.erase(cookie->file);
+    int ret = ::close(cookie->fd);
+    delete cookie;
+    return ret;
+}
+
+// --------- Public API ----------------------------------
+
+PosixBackend::PosixBackend(const char *root, const latency_config_t &latency, const char *mount_point)
+    : m_root(root), m_mount_point(mount_point), m_latency(latency) {
+}
+
+std::string PosixBackend::host_path(const char *path) const {
+    const size_t n = m_mount_point.size();
+    if (strncmp(path, m_mount_point.c_str(), n) == 0 && (path[n] == '/' || path[n] == '\0')) {
+        return m_root + (path + n);
+    }
+    return path;
+}
+
+bool PosixBackend::mount() {
+    m_mounted = Backend::make_dir(m_root.c_str());
+    return m_mounted;
+}
+
+bool PosixBackend::free_space(space_t &space) {
+    struct statvfs st;
+    if (statvfs(m_root.c_str(), &st) != 0) {
+        space = {};
+        return false;
+    }
+    space.total = (uint64_t)st.f_blocks * st.f_frsize;
+    space.free = (uint64_t)st.f_bavail * st.f_frsize;
+    return true;
+}
+
+bool PosixBackend::make_dir(const char *path) {
+    on_op();
+    return Backend::make_dir(host_path(path).c_str());
+}
+
+bool PosixBackend::list_dir(const char *path, dir_visitor_t visit, void *ctx) {
+    on_op();
+    return Backend::list_dir(host_path(path).c_str(), visit, ctx);
+}
+
+bool PosixBackend::rename(const char *from, const char *to) {
+    on_op();
+    return Backend::rename(host_path(from).c_str(), host_path(to).c_str());
+}
+
+FILE *PosixBackend::open(const char *path, const char *mode) {
+    on_op();
+    const int flags = open_flags(mode);
+    if (flags < 0) {
+        return nullptr;
+    }
+    const int fd = ::open(host_path(path).c_str(), flags, 0664);
+    if (fd < 0) {
+        return nullptr;
+    }
+    cookie_t *cookie = new cookie_t{this, fd, nullptr};
+    FILE *f = fopencookie(cookie, mode, {cookie_read, cookie_write, cookie_seek, cookie_close});
+    if (!f) {
+        ::close(fd);
+        delete cookie;
+        return nullptr;
+    }
+    cookie->file = f;
+    m_files[f] = cookie;
+    return f;
+}
+
+bool PosixBackend::sync(FILE *f) {
+    if (fflush(f) != 0) {
+        return false;
+    }
+    m_stats.syncs++;
+    delay(m_latency.sync_us);
+    return fsync(descriptor(f)) == 0;
+}
+
+bool PosixBackend::truncate(FILE *f, uint32_t size) {
+    on_op();
+    return fflush(f) == 0 && ftruncate(descriptor(f), size) == 0;
+}
+
+bool PosixBackend::preallocate(const char *path, uint32_t size) {
+    on_op();
+    const int fd = ::open(host_path(path).c_str(), O_RDWR | O_CREAT, 0664);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = posix_fallocate(fd, 0, size) == 0;
+    ok = (::close(fd) == 0) && ok;
+    return ok;
+}
+
+bool PosixBackend::set_file_time(const char *path, const struct tm &time) {
+    on_op();
+    struct tm t = time;
+    const struct timeval tv[2] = {{mktime(&t), 0}, {mktime(&t), 0}};
+    return utimes(host_path(path).c_str(), tv) == 0;
+}
+
+} // namespace storage
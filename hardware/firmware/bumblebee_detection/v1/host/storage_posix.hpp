@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include "storage_backend.hpp"
+
+namespace storage {
+
+// Künstliche Latenz, um langsame Karten nachzubilden. Alles 0 = so schnell wie das Host-Dateisystem.
+struct latency_config_t {
+    uint32_t op_us;            // je Verzeichnis-, Öffnen-, Umbenennen- und Schreiboperation
+    uint32_t write_us_per_kb;  // Schreibrate der Karte
+    uint32_t sync_us;          // zusätzlich je sync() (Flush des Kartencaches)
+    uint32_t stall_every;      // jede n-te Schreiboperation hängt ...
+    uint32_t stall_ms;         // ... so lange (interne Garbage Collection), 0 = nie
+};
+
+struct posix_stats_t {
+    uint32_t ops;
+    uint32_t writes;
+    uint64_t bytes;
+    uint32_t syncs;
+    uint32_t stalls;
+    int64_t injected_us;       // insgesamt künstlich gewartet
+};
+
+// Linux-Dateisystem unter root statt der SD-Karte. Pfade unter mount_point (wie in der
+// Firmware "/sdcard/...") werden nach root abgebildet. Dateien sind stdio-Streams über
+// fopencookie, damit auch Schreibzugriffe aus segment_file und write_behind verzögert werden.
+class PosixBackend : public Backend {
+public:
+    PosixBackend(const char *root, const latency_config_t &latency = {}, const char *mount_point = "/sdcard");
+
+    const char *name() const override { return "posix"; }
+    bool mount() override;
+    void unmount() override { m_mounted = false; }
+    bool is_mounted() const override { return m_mounted; }
+    bool free_space(space_t &space) override;
+
+    bool make_dir(const char *path) override;
+    bool list_dir(const char *path, dir_visitor_t visit, void *ctx) override;
+    bool rename(const char *from, const char *to) override;
+
+    FILE *open(const char *path, const char *mode) override;
+    bool sync(FILE *f) override;
+    bool truncate(FILE *f, uint32_t size) override;
+
+    bool preallocate(const char *path, uint32_t size) override;
+    bool set_file_time(const char *path, const struct tm &time) override;
+
+    const posix_stats_t &stats() const { return m_stats; }
+    const latency_config_t &latency() const { return m_latency; }
+    std::string host_path(const char *path) const;
+
+private:
+    struct cookie_t;
+    static ssize_t cookie_read(void *c, char *buf, size_t size);
+    static ssize_t cookie_write(void *c, const char *buf, size_t size);
+    static int cookie_seek(void *c, off64_t *offset, int whence);
+    static int cookie_close(void *c);
+
+    void delay(int64_t us);
+    void on_op();
+    void on_write(size_t bytes);
+    int descriptor(FILE *f) const;
+
+    std::string m_root;
+    std::string m_mount_point;
+    latency_config_t m_latency;
+    bool m_mounted = false;
+    std::unordered_map<FILE *, cookie_t *> m_files;
+    posix_stats_t m_stats = {};
+};
+
+} // namespace storage
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+// Prüfmakros der Host-Tests, ohne Testframework. Ein Fehlschlag wird gemeldet und gezählt,
+// der Test läuft weiter; TEST_MAIN liefert den Exit-Code für CTest.
+namespace hosttest {
+
+inline int &failures() {
+    static int n = 0;
+    return n;
+}
+
+inline void fail(const char *file, int line, const char *expr) {
+    fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expr);
+    failures()++;
+}
+
+// Deterministische Testdaten, unabhängig von esp_random()
+struct Rng {
+    uint32_t state;
+    explicit Rng(uint32_t seed) : state(seed ? seed : 1) {}
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    int range(int lo, int hi) { return lo + (int)(next() % (uint32_t)(hi - lo + 1)); }
+};
+
+// Leeres Verzeichnis unter /tmp als Wurzel für ein PosixBackend, wird am Ende gelöscht
+struct TempDir {
+    std::string path;
+    TempDir() {
+        char tmpl[] = "/tmp/beesense_test_XXXXXX";
+        path = mkdtemp(tmpl) ? tmpl : "";
+    }
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+} // namespace hosttest
+
+#define CHECK(cond)                                          \
+    do {                                                     \
+        if (!(cond)) {                                       \
+            hosttest::fail(__FILE__, __LINE__, #cond);       \
+        }                                                    \
+    } while (0)
+
+// Führt die Testfunktionen nacheinander aus
+#define RUN_TEST(fn)                                         \
+    do {                                                     \
+        const int before = hosttest::failures();             \
+        fn();                                                \
+        printf("%-40s %s\n", #fn, hosttest::failures() == before ? "ok" : "FAILED");   \
+    } while (0)
+
+#define TEST_RESULT() (hosttest::failures() ? EXIT_FAILURE : EXIT_SUCCESS)
@@ -0,0 +1,209 @@
+// CaptureScheduler: Backoff in der Ruhe, Halten nach Detektionen, Rückkehr zur Höchstrate
+
+#include <cstdio>
+#include "capture_scheduler.hpp"
+#include "host_test.hpp"
+
+using scheduler::CaptureScheduler;
+
+// Virtuelle Uhr: die nächste Entscheidung fällt ein Intervall nach der letzten
+struct Clock {
+    CaptureScheduler sched;
+    int64_t t_us = 0;
+    uint32_t pipeline_us = 0;
+
+    explicit Clock(const scheduler::scheduler_config_t &cfg = scheduler::default_scheduler_config()) {
+        sched.init(cfg);
+    }
+
+    scheduler::decision_t step(uint32_t detections = 0, bool motion = false) {
+        const scheduler::decision_t d = sched.update({t_us, detections, motion, pipeline_us});
+        t_us += (int64_t)d.interval_ms * 1000;
+        return d;
+    }
+};
+
+// Start mit dem Mindestintervall, ohne Aktivität Backoff bis ceiling (früherer fester 2-s-Takt)
+static void test_idle_backs_off_to_ceiling() {
+    Clock c;
+    CHECK(c.sched.interval_ms() == 200);
+    const uint32_t expected[] = {400, 800, 1600, 2000, 2000, 2000, 2000, 2000, 2000, 2000};
+    for (uint32_t interval : expected) {
+        const scheduler::decision_t d = c.step();
+        CHECK(d.reason == scheduler::REASON_BACKOFF);
+        CHECK(d.interval_ms == interval);
+    }
+    CHECK(c.sched.stats().changes == 4);
+    CHECK(c.sched.stats().decisions[scheduler::REASON_BACKOFF] == 10);
+}
+
+// Ein Besuch von wenigen Sekunden direkt nach dem Booten oder nach langer Ruhe wird aufgenommen
+static void test_short_visit_is_seen() {
+    Clock c;
+    for (int i = 0; i < 50; ++i) {
+        c.step();
+    }
+    // Biene von t0 bis t0 + 2 s vor der Kamera: mindestens eine Aufnahme fällt hinein
+    const int64_t t0 = c.t_us + 1;
+    int seen = 0;
+    while (c.t_us < t0 + 2000 * 1000) {
+        const bool present = c.t_us >= t0;
+        c.step(present ? 1 : 0, present);
+        seen += present;
+    }
+    CHECK(seen >= 1);
+
+    Clock boot;
+    CHECK(boot.step().interval_ms <= 2000);
+    CHECK(boot.t_us <= 2000 * 1000);
+}
+
+// Mindestintervall aus der Pipeline-Latenz mal headroom, begrenzt durch floor und ceiling
+static void test_sustainable_interval() {
+    Clock c;
+    CHECK(c.step(1).interval_ms == 200);
+    c.pipeline_us = 300000;
+    scheduler::decision_t d = c.step(1);
+    CHECK(d.reason == scheduler::REASON_ACTIVE);
+    CHECK(d.sustainable_ms == 360);
+    CHECK(d.interval_ms == 360);
+    c.pipeline_us = 100000;
+    CHECK(c.step(1).interval_ms == 200);
+    c.pipeline_us = 60000000;
+    CHECK(c.step(1).interval_ms == 2000);
+}
+
+// Nach der letzten Detektion: geglättete Dichte, dann hold_ms halten, dann verdoppeln bis ceiling
+static void test_hold_then_backoff() {
+    Clock c;
+    c.pipeline_us = 150000;  // 180 ms, floor 200 gilt
+    CHECK(c.step(2).reason == scheduler::REASON_ACTIVE);
+
+    // Dichte 0.6 klingt mit alpha 0.3 ab: 0.42, 0.294, 0.206 noch über 0.2
+    for (int i = 0; i < 3; ++i) {
+        CHECK(c.step().reason == scheduler::REASON_ACTIVE);
+    }
+    const int64_t last_active_us = c.t_us - 200 * 1000;
+    int64_t decided_us = c.t_us;
+    scheduler::decision_t d = c.step();
+    int hold = 0;
+    while (d.reason == scheduler::REASON_HOLD) {
+        CHECK(d.interval_ms == 200);
+        hold++;
+        decided_us = c.t_us;
+        d = c.step();
+    }
+    // 20 s hold ab der letzten ACTIVE-Entscheidung im 200-ms-Takt, der Backoff beginnt genau danach
+    CHECK(hold == 99);
+    CHECK(decided_us - last_active_us == 20000 * 1000);
+
+    const uint32_t expected[] = {400, 800, 1600, 2000, 2000};
+    CHECK(d.reason == scheduler::REASON_BACKOFF);
+    CHECK(d.interval_ms == expected[0]);
+    for (size_t i = 1; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+        d = c.step();
+        CHECK(d.reason == scheduler::REASON_BACKOFF);
+        CHECK(d.interval_ms == expected[i]);
+    }
+}
+
+// Eine einzelne Detektion im Leerlauf-Takt zieht sofort auf die Höchstrate zurück
+static void test_recovery_from_ceiling() {
+    Clock c;
+    c.step(1);
+    while (c.sched.interval_ms() < 2000) {
+        c.step();
+    }
+    const uint32_t changes = c.sched.stats().changes;
+    scheduler::decision_t d = c.step(1);
+    CHECK(d.reason == scheduler::REASON_ACTIVE);
+    CHECK(d.interval_ms == 200);
+    CHECK(c.sched.stats().changes == changes + 1);
+    CHECK(c.step().reason == scheduler::REASON_ACTIVE);
+}
+
+// Bewegung ohne Detektion halbiert das Intervall, nie unter das Mindestintervall
+static void test_motion_halves() {
+    Clock c;
+    c.pipeline_us = 400000;  // 480 ms
+    while (c.sched.interval_ms() < 2000) {
+        c.step();
+    }
+    const uint32_t expected[] = {1000, 500, 480, 480};
+    for (uint32_t interval : expected) {
+        const scheduler::decision_t d = c.step(0, true);
+        CHECK(d.reason == scheduler::REASON_MOTION);
+        CHECK(d.interval_ms == interval);
+    }
+    // Bewegung vorbei: wieder Backoff ab dem erreichten Intervall
+    CHECK(c.step().interval_ms == 960);
+    CHECK(c.step().interval_ms == 1920);
+    CHECK(c.step().interval_ms == 2000);
+}
+
+// Vor der ersten Aktivität gibt es nichts zu halten
+static void test_no_hold_before_activity() {
+    Clock c;
+    c.t_us = 1000;
+    CHECK(c.step().reason == scheduler::REASON_BACKOFF);
+    CHECK(c.sched.stats().decisions[scheduler::REASON_HOLD] == 0);
+}
+
+static void test_config_clamped() {
+    scheduler::scheduler_config_t cfg = scheduler::default_scheduler_config();
+    cfg.floor_ms = 1000;
+    cfg.ceiling_ms = 500;
+    cfg.backoff = 0.5f;
+    Clock c(cfg);
+    CHECK(c.sched.interval_ms() == 1000);
+    CHECK(c.step(1).interval_ms == 1000);
+
+    cfg = scheduler::default_scheduler_config();
+    cfg.backoff = 0.5f;
+    cfg.hold_ms = 0;
+    Clock flat(cfg);
+    flat.step(1);
+    for (int i = 0; i < 5; ++i) {
+        flat.step();
+    }
+    // backoff < 1 gilt als 1: das Intervall wächst nicht, schrumpft aber auch nicht
+    CHECK(flat.step().interval_ms == 200);
+    CHECK(flat.sched.stats().decisions[scheduler::REASON_BACKOFF] > 0);
+}
+
+static void test_format_parses_back() {
+    Clock c;
+    c.t_us = 12345678;
+    c.pipeline_us = 250000;
+    const scheduler::observation_t obs = {c.t_us, 3, true, c.pipeline_us};
+    const scheduler::decision_t d = c.sched.update(obs);
+    char line[96];
+    const int n = CaptureScheduler::format(line, sizeof(line), obs, d);
+    CHECK(n > 0 && n < (int)sizeof(line));
+
+    long long t_ms = 0;
+    unsigned long interval = 0, det = 0, pipe_ms = 0;
+    char reason = 0;
+    int motion = 0;
+    float density = 0;
+    CHECK(sscanf(line, "S,%lld,%lu,%c,%lu,%d,%lu,%f", &t_ms, &interval, &reason, &det, &motion, &pipe_ms,
+                 &density) == 7);
+    CHECK(t_ms == 12345);
+    CHECK(interval == d.interval_ms);
+    CHECK(reason == 'A');
+    CHECK(det == 3 && motion == 1 && pipe_ms == 250);
+    CHECK(density > 0.89f && density < 0.91f);
+}
+
+int main() {
+    RUN_TEST(test_idle_backs_off_to_ceiling);
+    RUN_TEST(test_short_visit_is_seen);
+    RUN_TEST(test_sustainable_interval);
+    RUN_TEST(test_hold_then_backoff);
+    RUN_TEST(test_recovery_from_ceiling);
+    RUN_TEST(test_motion_halves);
+    RUN_TEST(test_no_hold_before_activity);
+    RUN_TEST(test_config_clamped);
+    RUN_TEST(test_format_parses_back);
+    return TEST_RESULT();
+}
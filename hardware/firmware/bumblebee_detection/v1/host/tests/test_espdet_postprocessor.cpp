@@ -0,0 +1,419 @@
+// ESPDetQuantPostProcessor gegen eine Float-Referenz wie der generische esp-dl-Pfad:
+// alles dequantisieren, Sigmoid, DFL-Softmax, sortiert einfügen, NMS, top_k, begrenzen.
+// Dazu Abzüge vom Gerät (CONFIG_BUMBLEBEE_DETECT_DUMP_HEADS) in data/espdet_heads/.
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <list>
+#include <vector>
+#include "espdet_postprocessor.hpp"
+#include "host_test.hpp"
+
+using bumblebee_detect::ESPDetQuantPostProcessor;
+using bumblebee_detect::head_tensor_t;
+using bumblebee_detect::heads_dump_t;
+using dl::detect::result_t;
+
+static constexpr int REG_MAX = ESPDetQuantPostProcessor::REG_MAX;
+static constexpr int INPUT = 96;
+static const std::vector<std::vector<int>> STRIDES = {{8, 8, 4, 4}, {16, 16, 8, 8}, {32, 32, 16, 16}};
+
+struct params_t {
+    float score_thr;
+    float nms_thr;
+    int top_k;
+    float scale;         // Modell-Input / Bild
+    int top_left_x;
+    int top_left_y;
+    int img_width;
+    int img_height;
+};
+
+struct Head {
+    std::vector<int8_t> score;
+    std::vector<int8_t> box;
+    head_tensor_t tensor;
+};
+
+// --------- Float-Referenz ----------------------------------
+
+static float sigmoid(float x) {
+    return 1.0f / (1.0f + expf(-x));
+}
+
+static void reference_nms(std::list<result_t> &boxes, float nms_thr, int top_k) {
+    int kept_number = 0;
+    for (auto kept = boxes.begin(); kept != boxes.end(); ++kept) {
+        kept_number++;
+        if (kept_number >= top_k) {
+            boxes.erase(std::next(kept), boxes.end());
+            break;
+        }
+        const int kept_area = (kept->box[2] - kept->box[0] + 1) * (kept->box[3] - kept->box[1] + 1);
+        for (auto other = std::next(kept); other != boxes.end();) {
+            const int inter_w = std::min(kept->box[2], other->box[2]) - std::max(kept->box[0], other->box[0]) + 1;
+            const int inter_h = std::min(kept->box[3], other->box[3]) - std::max(kept->box[1], other->box[1]) + 1;
+            if (inter_w <= 0 || inter_h <= 0) {
+                ++other;
+                continue;
+            }
+            const int inter_area = inter_w * inter_h;
+            const int other_area = (other->box[2] - other->box[0] + 1) * (other->box[3] - other->box[1] + 1);
+            if ((float)inter_area / (float)(kept_area + other_area - inter_area) > nms_thr) {
+                other = boxes.erase(other);
+            } else {
+                ++other;
+            }
+        }
+    }
+}
+
+static std::list<result_t> reference(const std::vector<Head> &heads, const params_t &p) {
+    std::list<result_t> boxes;
+    for (size_t h = 0; h < heads.size(); ++h) {
+        const head_tensor_t &t = heads[h].tensor;
+        const std::vector<int> &s = STRIDES[h];
+        const float score_scale = ldexpf(1.0f, t.score_exponent);
+        const float box_scale = ldexpf(1.0f, t.box_exponent);
+        for (int y = 0; y < t.height; ++y) {
+            for (int x = 0; x < t.width; ++x) {
+                const int cell = y * t.width + x;
+                for (int c = 0; c < t.classes; ++c) {
+                    const float score = sigmoid(t.score[cell * t.classes + c] * score_scale);
+                    if (!(score > p.score_thr)) {
+                        continue;
+                    }
+                    float dist[4];
+                    for (int k = 0; k < 4; ++k) {
+                        float v[REG_MAX];
+                        float vmax = -1e30f;
+                        for (int j = 0; j < REG_MAX; ++j) {
+                            v[j] = t.box[(size_t)cell * 4 * REG_MAX + k * REG_MAX + j] * box_scale;
+                            vmax = std::max(vmax, v[j]);
+                        }
+                        float sum = 0.0f;
+                        float weighted = 0.0f;
+                        for (int j = 0; j < REG_MAX; ++j) {
+                            const float e = expf(v[j] - vmax);
+                            sum += e;
+                            weighted += e * j;
+                        }
+                        dist[k] = weighted / sum;
+                    }
+                    const float cx = (float)(x * s[1] + s[3]);
+                    const float cy = (float)(y * s[0] + s[2]);
+                    result_t res;
+                    res.category = c;
+                    res.score = score;
+                    res.box = {(int)((cx - dist[0] * s[1]) / p.scale + p.top_left_x),
+                               (int)((cy - dist[1] * s[0]) / p.scale + p.top_left_y),
+                               (int)((cx + dist[2] * s[1]) / p.scale + p.top_left_x),
+                               (int)((cy + dist[3] * s[0]) / p.scale + p.top_left_y)};
+                    auto pos = std::upper_bound(boxes.begin(), boxes.end(), res,
+                                                [](const result_t &a, const result_t &b) { return a.score > b.score; });
+                    boxes.insert(pos, res);
+                }
+            }
+        }
+    }
+    reference_nms(boxes, p.nms_thr, p.top_k);
+    for (auto &res : boxes) {
+        res.box[0] = std::min(std::max(res.box[0], 0), p.img_width - 1);
+        res.box[1] = std::min(std::max(res.box[1], 0), p.img_height - 1);
+        res.box[2] = std::min(std::max(res.box[2], 0), p.img_width - 1);
+        res.box[3] = std::min(std::max(res.box[3], 0), p.img_height - 1);
+    }
+    return boxes;
+}
+
+// --------- Testdaten ----------------------------------
+
+// Kleinstes q mit sigmoid(q * 2^exponent) > thr, wie es die Referenz sieht
+static int boundary_q(float thr, int exponent) {
+    const float scale = ldexpf(1.0f, exponent);
+    for (int q = -128; q <= 127; ++q) {
+        if (sigmoid(q * scale) > thr) {
+            return q;
+        }
+    }
+    return 128;
+}
+
+// Hintergrund unter der Schwelle, einzelne Zellen und Nachbarschaften darüber (überlappende
+// Boxen für den NMS), Werte genau an der Schwelle und an den int8-Grenzen
+static std::vector<Head> make_heads(hosttest::Rng &rng, int score_exponent, int box_exponent, int classes,
+                                    float score_thr) {
+    std::vector<Head> heads(STRIDES.size());
+    const int edge = boundary_q(score_thr, score_exponent);
+    for (size_t h = 0; h < heads.size(); ++h) {
+        Head &head = heads[h];
+        const int grid = INPUT / STRIDES[h][0];
+        head.score.resize((size_t)grid * grid * classes);
+        head.box.resize((size_t)grid * grid * 4 * REG_MAX);
+        for (auto &q : head.score) {
+            const uint32_t r = rng.next() % 100;
+            if (r < 80) {
+                q = (int8_t)rng.range(-128, std::max(-128, std::min(edge - 1, 127)));
+            } else if (r < 90) {
+                q = (int8_t)rng.range(-128, 127);
+            } else if (r < 94) {
+                q = (int8_t)std::max(-128, std::min(edge, 127));
+            } else if (r < 97) {
+                q = (int8_t)std::max(-128, std::min(edge - 1, 127));
+            } else {
+                q = (int8_t)(r % 2 ? 127 : -128);
+            }
+        }
+        // Ein Objekt über 2x2 Zellen mit gleichem Score: Gleichstand entscheidet die Scanreihenfolge
+        if (grid >= 4) {
+            const int y0 = rng.range(0, grid - 2);
+            const int x0 = rng.range(0, grid - 2);
+            for (int c = 0; c < 2; ++c) {
+                for (int r = 0; r < 2; ++r) {
+                    head.score[((size_t)(y0 + r) * grid + x0 + c) * classes] = 100;
+                }
+            }
+        }
+        for (auto &q : head.box) {
+            q = (int8_t)rng.range(-128, 127);
+        }
+        head.tensor = {head.score.data(), head.box.data(), grid, grid, classes, score_exponent, box_exponent};
+    }
+    return heads;
+}
+
+static std::list<result_t> run(ESPDetQuantPostProcessor &post, const std::vector<Head> &heads, const params_t &p) {
+    std::vector<head_tensor_t> tensors;
+    for (const Head &h : heads) {
+        tensors.push_back(h.tensor);
+    }
+    post.set_resize_scale(p.scale, p.scale);
+    post.set_top_left(p.top_left_x, p.top_left_y);
+    return post.postprocess(tensors.data(), (int)tensors.size(), p.img_width, p.img_height);
+}
+
+static bool same(const std::list<result_t> &a, const std::list<result_t> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (auto i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j) {
+        if (i->category != j->category || i->score != j->score || i->box != j->box) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --------- Tests ----------------------------------
+
+// Ohne Budget: dieselben Boxen, Scores und dieselbe Reihenfolge wie die Referenz, über
+// Score- und Box-Exponenten, Schwellen, top_k und Abbildungen ins Bild. Derselbe
+// Postprozessor läuft über alle Fälle, damit auch recycelte Knoten geprüft werden.
+static void test_matches_reference() {
+    const params_t cases[] = {
+        {0.35f, 0.7f, 10, 1.0f, 0, 0, 96, 96},
+        {0.5f, 0.45f, 100, 0.5f, 10, 20, 240, 240},
+        {0.05f, 0.7f, 300, 0.4f, 0, 0, 160, 120},  // sehr viele Kandidaten, Begrenzung am Bildrand
+        {0.9f, 0.3f, 5, 1.0f, 64, 8, 320, 240},
+        {0.999f, 0.7f, 10, 1.0f, 0, 0, 96, 96},
+    };
+    const int score_exponents[] = {-5, -4, -3, -2, 0};
+    const int box_exponents[] = {-4, -3, -2};
+    hosttest::Rng rng(42);
+    int compared = 0;
+    int nonempty = 0;
+    for (const params_t &p : cases) {
+        ESPDetQuantPostProcessor post(p.score_thr, p.nms_thr, p.top_k, STRIDES, 0);
+        for (int se : score_exponents) {
+            for (int be : box_exponents) {
+                for (int classes = 1; classes <= 2; ++classes) {
+                    const std::vector<Head> heads = make_heads(rng, se, be, classes, p.score_thr);
+                    const std::list<result_t> expected = reference(heads, p);
+                    const std::list<result_t> &got = run(post, heads, p);
+                    CHECK(same(got, expected));
+                    compared++;
+                    nonempty += !expected.empty();
+                }
+            }
+        }
+    }
+    CHECK(compared == 150);
+    CHECK(nonempty > 100);
+}
+
+// Nichts über der Schwelle und Schwelle über dem größten darstellbaren Score
+static void test_empty() {
+    const params_t p = {0.35f, 0.7f, 10, 1.0f, 0, 0, 96, 96};
+    hosttest::Rng rng(1);
+    std::vector<Head> heads = make_heads(rng, -3, -3, 1, p.score_thr);
+    for (Head &h : heads) {
+        std::fill(h.score.begin(), h.score.end(), (int8_t)-128);
+    }
+    ESPDetQuantPostProcessor post(p.score_thr, p.nms_thr, p.top_k, STRIDES, 0);
+    CHECK(run(post, heads, p).empty());
+    CHECK(post.stats().candidates == 0);
+
+    // sigmoid(127 / 8) liegt in float unter 1
+    for (Head &h : heads) {
+        std::fill(h.score.begin(), h.score.end(), (int8_t)127);
+    }
+    ESPDetQuantPostProcessor strict(1.0f, p.nms_thr, p.top_k, STRIDES, 0);
+    CHECK(run(strict, heads, p).empty());
+    CHECK(reference(heads, {1.0f, 0.7f, 10, 1.0f, 0, 0, 96, 96}).empty());
+}
+
+// Mit Budget bleiben die stärksten Kandidaten: der beste Treffer ist derselbe, dekodiert wird
+// höchstens das Budget
+static void test_budget_keeps_strongest() {
+    const params_t p = {0.2f, 0.7f, 10, 1.0f, 0, 0, 96, 96};
+    hosttest::Rng rng(9);
+    for (int round = 0; round < 20; ++round) {
+        const std::vector<Head> heads = make_heads(rng, -3, -3, 1, p.score_thr);
+        const std::list<result_t> expected = reference(heads, p);
+        ESPDetQuantPostProcessor post(p.score_thr, p.nms_thr, p.top_k, STRIDES, 8);
+        const std::list<result_t> &got = run(post, heads, p);
+        CHECK(post.stats().decoded <= 8);
+        CHECK(!got.empty() && !expected.empty());
+        if (!got.empty() && !expected.empty()) {
+            CHECK(got.front().score == expected.front().score);
+            CHECK(got.front().box == expected.front().box);
+        }
+        // Schwächere Kandidaten verdrängen im NMS keine stärkeren: Anfang der Referenz
+        CHECK(bumblebee_detect::matches_generic(got, expected, true));
+    }
+}
+
+// Toleranzen des Selbsttests beim Laden
+static void test_matches_generic() {
+    std::list<result_t> generic;
+    for (int i = 0; i < 3; ++i) {
+        generic.push_back({0, 0.9f - 0.1f * i, {10 * i, 10 * i, 10 * i + 20, 10 * i + 20}, {}});
+    }
+    std::list<result_t> quant = generic;
+    CHECK(bumblebee_detect::matches_generic(quant, generic, false));
+    quant.front().score += 5e-5f;
+    quant.front().box[2] += 1;
+    CHECK(bumblebee_detect::matches_generic(quant, generic, false));
+    quant.front().box[2] += 1;
+    CHECK(!bumblebee_detect::matches_generic(quant, generic, false));
+    quant = generic;
+    quant.back().score += 1e-3f;
+    CHECK(!bumblebee_detect::matches_generic(quant, generic, false));
+    quant = generic;
+    quant.back().category = 1;
+    CHECK(!bumblebee_detect::matches_generic(quant, generic, false));
+
+    // Mit Budget nur ein Anfang, nicht mehr und nicht vertauscht
+    quant = generic;
+    quant.pop_back();
+    CHECK(!bumblebee_detect::matches_generic(quant, generic, false));
+    CHECK(bumblebee_detect::matches_generic(quant, generic, true));
+    quant.reverse();
+    CHECK(!bumblebee_detect::matches_generic(quant, generic, true));
+    quant = generic;
+    quant.push_back(generic.back());
+    CHECK(!bumblebee_detect::matches_generic(quant, generic, true));
+}
+
+// Abzug schreiben und lesen, mit den Exponenten des 96x96-Modells (score -4/-4/-5, box -3/-3/-4)
+static void test_dump_roundtrip() {
+    const params_t p = {0.35f, 0.7f, 10, 0.4f, 3, 5, 240, 240};
+    hosttest::Rng rng(17);
+    std::vector<Head> heads = make_heads(rng, -4, -3, 1, p.score_thr);
+    heads[2].tensor.score_exponent = -5;
+    heads[2].tensor.box_exponent = -4;
+
+    heads_dump_t dump;
+    dump.score_thr = p.score_thr;
+    dump.nms_thr = p.nms_thr;
+    dump.top_k = p.top_k;
+    dump.scale_x = p.scale;
+    dump.scale_y = p.scale;
+    dump.top_left_x = p.top_left_x;
+    dump.top_left_y = p.top_left_y;
+    dump.img_width = p.img_width;
+    dump.img_height = p.img_height;
+    dump.strides = STRIDES;
+    for (const Head &h : heads) {
+        dump.heads.push_back(h.tensor);
+    }
+    dump.generic = reference(heads, p);
+    CHECK(!dump.generic.empty());
+
+    hosttest::TempDir dir;
+    const std::string path = dir.path + "/heads_96x96.bin";
+    FILE *f = fopen(path.c_str(), "wb");
+    CHECK(f && bumblebee_detect::write_heads_dump(f, dump));
+    fclose(f);
+
+    heads_dump_t back;
+    f = fopen(path.c_str(), "rb");
+    CHECK(f && bumblebee_detect::read_heads_dump(f, back));
+    fclose(f);
+    CHECK(back.top_k == p.top_k && back.img_width == p.img_width && back.top_left_y == p.top_left_y);
+    CHECK(back.strides == STRIDES);
+    CHECK(back.heads.size() == heads.size());
+    for (size_t h = 0; h < heads.size() && h < back.heads.size(); ++h) {
+        const head_tensor_t &a = heads[h].tensor;
+        const head_tensor_t &b = back.heads[h];
+        CHECK(a.height == b.height && a.width == b.width && a.classes == b.classes);
+        CHECK(a.score_exponent == b.score_exponent && a.box_exponent == b.box_exponent);
+        CHECK(std::equal(heads[h].score.begin(), heads[h].score.end(), b.score));
+        CHECK(std::equal(heads[h].box.begin(), heads[h].box.end(), b.box));
+    }
+    CHECK(same(back.generic, dump.generic));
+
+    // Abgeschnittene Datei
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    f = fopen(path.c_str(), "rb");
+    CHECK(f && !bumblebee_detect::read_heads_dump(f, back));
+    fclose(f);
+}
+
+// Heads des echten Modells vom Gerät: der int8-Pfad muss die Boxen von ESPDetPostProcessor
+// liefern, ohne Budget vollständig, mit dem Standardbudget (4 x top_k) als Anfang davon
+static void test_device_dumps() {
+    const std::filesystem::path dir = ESPDET_HEADS_DIR;
+    int checked = 0;
+    if (std::filesystem::is_directory(dir)) {
+        for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() != ".bin") {
+                continue;
+            }
+            heads_dump_t dump;
+            FILE *f = fopen(entry.path().c_str(), "rb");
+            const bool ok = f && bumblebee_detect::read_heads_dump(f, dump);
+            if (f) {
+                fclose(f);
+            }
+            CHECK(ok);
+            if (!ok) {
+                continue;
+            }
+            for (int budget : {0, 4 * dump.top_k}) {
+                ESPDetQuantPostProcessor post(dump.score_thr, dump.nms_thr, dump.top_k, dump.strides, budget);
+                post.set_resize_scale(dump.scale_x, dump.scale_y);
+                post.set_top_left(dump.top_left_x, dump.top_left_y);
+                const std::list<result_t> &got =
+                    post.postprocess(dump.heads.data(), (int)dump.heads.size(), dump.img_width, dump.img_height);
+                CHECK(bumblebee_detect::matches_generic(got, dump.generic, budget > 0));
+            }
+            printf("  %s: %u box(es)\n", entry.path().filename().c_str(), (unsigned)dump.generic.size());
+            checked++;
+        }
+    }
+    if (!checked) {
+        printf("  no device dumps in %s\n", dir.c_str());
+    }
+}
+
+int main() {
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_empty);
+    RUN_TEST(test_budget_keeps_strongest);
+    RUN_TEST(test_matches_generic);
+    RUN_TEST(test_dump_roundtrip);
+    RUN_TEST(test_device_dumps);
+    return TEST_RESULT();
+}
@@ -0,0 +1,282 @@
+// MotionGate: Auslösen über Fläche und Schwelle, Nachführen des Hintergrunds, erzwungene Inferenz
+
+#include <algorithm>
+#include <vector>
+#include "host_test.hpp"
+#include "motion_gate.hpp"
+#include "replay_source.hpp"
+
+using motion::MotionGate;
+
+static constexpr int FRAME_W = 320;
+static constexpr int FRAME_H = 240;
+static constexpr int ROI = 224;
+static constexpr int X0 = (FRAME_W - ROI) / 2;
+static constexpr int Y0 = (FRAME_H - ROI) / 2;
+
+// RGB565 big endian wie der Kamera-Framebuffer
+struct Frame {
+    std::vector<uint8_t> px = std::vector<uint8_t>((size_t)FRAME_W * FRAME_H * 2);
+
+    void fill_rect(int x, int y, int w, int h, uint8_t gray) {
+        const uint16_t v = (uint16_t)(((gray & 0xF8) << 8) | ((gray & 0xFC) << 3) | (gray >> 3));
+        for (int yy = y; yy < y + h; ++yy) {
+            for (int xx = x; xx < x + w; ++xx) {
+                px[((size_t)yy * FRAME_W + xx) * 2] = v >> 8;
+                px[((size_t)yy * FRAME_W + xx) * 2 + 1] = v & 0xFF;
+            }
+        }
+    }
+    void fill(uint8_t gray) { fill_rect(0, 0, FRAME_W, FRAME_H, gray); }
+};
+
+static motion::gate_config_t config(uint32_t force_every = 0) {
+    motion::gate_config_t cfg = motion::default_gate_config();
+    cfg.force_every = force_every;
+    return cfg;
+}
+
+static motion::decision_t update(MotionGate &gate, const Frame &f) {
+    return gate.update(f.px.data(), FRAME_W, X0, Y0);
+}
+
+static void test_init_and_static_scene() {
+    MotionGate gate;
+    CHECK(gate.init(config(), ROI, ROI));
+    Frame f;
+    f.fill(80);
+    CHECK(update(gate, f) == motion::DECISION_INIT);
+    for (int i = 0; i < 50; ++i) {
+        CHECK(update(gate, f) == motion::DECISION_SKIP);
+    }
+    CHECK(gate.stats().frames == 51);
+    CHECK(gate.stats().decisions[motion::DECISION_SKIP] == 50);
+    CHECK(gate.skip_ratio() > 0.97f);
+}
+
+// 56x56 Stützstellen bei step 4; 1 % sind 31 Stützstellen
+static void test_area_threshold() {
+    MotionGate gate;
+    CHECK(gate.init(config(), ROI, ROI));
+    Frame bg;
+    bg.fill(40);
+    update(gate, bg);
+
+    // 16x16 px = 16 Stützstellen: unter der Fläche
+    Frame small = bg;
+    small.fill_rect(X0 + 64, Y0 + 64, 16, 16, 250);
+    CHECK(update(gate, small) == motion::DECISION_SKIP);
+    CHECK(gate.stats().last_changed_ratio > 0.0f);
+    CHECK(gate.stats().last_changed_ratio < 0.01f);
+
+    // 32x32 px = 64 Stützstellen: darüber
+    MotionGate gate2;
+    CHECK(gate2.init(config(), ROI, ROI));
+    update(gate2, bg);
+    Frame big = bg;
+    big.fill_rect(X0 + 64, Y0 + 64, 32, 32, 250);
+    CHECK(update(gate2, big) == motion::DECISION_MOTION);
+    CHECK(gate2.stats().last_changed_ratio > 0.01f);
+}
+
+static void test_diff_threshold() {
+    MotionGate gate;
+    CHECK(gate.init(config(), ROI, ROI));
+    Frame bg;
+    bg.fill(100);
+    update(gate, bg);
+
+    // Ganzer Ausschnitt etwas heller, aber unter diff_threshold (24)
+    Frame dim;
+    dim.fill(116);
+    CHECK(update(gate, dim) == motion::DECISION_SKIP);
+    CHECK(gate.stats().last_changed_ratio == 0.0f);
+
+    Frame bright;
+    bright.fill(160);
+    CHECK(update(gate, bright) == motion::DECISION_MOTION);
+    CHECK(gate.stats().last_changed_ratio == 1.0f);
+}
+
+// Außerhalb des Ausschnitts darf sich alles ändern
+static void test_outside_roi_ignored() {
+    MotionGate gate;
+    CHECK(gate.init(config(), ROI, ROI));
+    Frame f;
+    f.fill(60);
+    update(gate, f);
+    f.fill_rect(0, 0, X0, FRAME_H, 255);
+    f.fill_rect(X0 + ROI, 0, FRAME_W - X0 - ROI, FRAME_H, 255);
+    CHECK(update(gate, f) == motion::DECISION_SKIP);
+}
+
+// Ein Objekt, das liegen bleibt, wird in den Hintergrund gelernt: erst Bewegung, dann
+// wieder Ruhe. Verschwindet es, löst die Lücke erneut aus, bis auch sie gelernt ist.
+static void test_background_absorbs_static_change() {
+    MotionGate gate;
+    CHECK(gate.init(config(), ROI, ROI));
+    Frame bg;
+    bg.fill(20);
+    update(gate, bg);
+    Frame obj = bg;
+    obj.fill_rect(X0 + 40, Y0 + 40, 64, 64, 230);
+
+    int motion_frames = 0;
+    while (motion_frames < 200 && update(gate, obj) == motion::DECISION_MOTION) {
+        motion_frames++;
+    }
+    // bg_shift 4: Abstand 210 fällt je Frame um 1/16, unter 24 nach etwa 34 Frames
+    CHECK(motion_frames >= 20);
+    CHECK(motion_frames <= 60);
+    for (int i = 0; i < 30; ++i) {
+        CHECK(update(gate, obj) == motion::DECISION_SKIP);
+    }
+
+    CHECK(update(gate, bg) == motion::DECISION_MOTION);
+    int gone_frames = 1;
+    while (gone_frames < 200 && update(gate, bg) == motion::DECISION_MOTION) {
+        gone_frames++;
+    }
+    CHECK(gone_frames >= 20);
+    CHECK(gone_frames <= 60);
+    CHECK(update(gate, bg) == motion::DECISION_SKIP);
+}
+
+// Langsame Helligkeitsänderung (Sonne, Wolken) folgt der Hintergrund, ohne auszulösen
+static void test_slow_drift_absorbed() {
+    MotionGate gate;
+    CHECK(gate.init(config(), ROI, ROI));
+    Frame f;
+    f.fill(40);
+    update(gate, f);
+    for (int i = 0; i < 300; ++i) {
+        f.fill((uint8_t)(40 + i / 2));
+        CHECK(update(gate, f) == motion::DECISION_SKIP);
+    }
+}
+
+static void test_force_every() {
+    MotionGate gate;
+    CHECK(gate.init(config(15), ROI, ROI));
+    Frame f;
+    f.fill(90);
+    CHECK(update(gate, f) == motion::DECISION_INIT);
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 14; ++i) {
+            CHECK(update(gate, f) == motion::DECISION_SKIP);
+        }
+        CHECK(update(gate, f) == motion::DECISION_FORCED);
+    }
+
+    // Bewegung setzt den Zähler zurück; ein einzelner Blitz verschiebt den Hintergrund
+    // nur um 1/16, danach ist die Szene wieder ruhig
+    for (int i = 0; i < 10; ++i) {
+        CHECK(update(gate, f) == motion::DECISION_SKIP);
+    }
+    Frame flash = f;
+    flash.fill_rect(X0, Y0, 64, 64, 255);
+    CHECK(update(gate, flash) == motion::DECISION_MOTION);
+    for (int i = 0; i < 14; ++i) {
+        CHECK(update(gate, f) == motion::DECISION_SKIP);
+    }
+    CHECK(update(gate, f) == motion::DECISION_FORCED);
+    CHECK(gate.stats().decisions[motion::DECISION_FORCED] == 4);
+
+    // force_every 0: nie erzwungen
+    MotionGate never;
+    CHECK(never.init(config(0), ROI, ROI));
+    update(never, f);
+    for (int i = 0; i < 100; ++i) {
+        CHECK(update(never, f) == motion::DECISION_SKIP);
+    }
+}
+
+static void test_invalid_config() {
+    MotionGate gate;
+    motion::gate_config_t cfg = config();
+    CHECK(!gate.init(cfg, 2, ROI));
+    cfg.step = 0;
+    CHECK(!gate.init(cfg, ROI, ROI));
+    CHECK(MotionGate::runs_detector(motion::DECISION_INIT));
+    CHECK(MotionGate::runs_detector(motion::DECISION_FORCED));
+    CHECK(!MotionGate::runs_detector(motion::DECISION_SKIP));
+}
+
+// Aufgenommene Sequenz aus data/images/test (relativ zum Repo-Wurzelverzeichnis, wie replay):
+// jedes Bild steht HOLD Frames lang, so wie die Kamera zwischen zwei Besuchen dieselbe Szene
+// sieht. Jeder Szenenwechsel muss auslösen, danach muss das Gate zur Ruhe kommen und nur noch
+// alle force_every Frames erzwungen inferieren.
+static void test_recorded_sequence() {
+    static constexpr int HOLD = 60;
+    replay::FrameSource source;
+    CHECK(source.open("data/images/test"));
+    CHECK(source.count() >= 5);
+
+    const motion::gate_config_t cfg = config(15);
+    MotionGate gate;
+    bool initialized = false;
+    for (size_t i = 0; i < source.count(); ++i) {
+        replay::frame_t frame;
+        CHECK(source.load(i, frame));
+        if (!initialized) {
+            CHECK(gate.init(cfg, std::min(ROI, frame.width), std::min(ROI, frame.height)));
+            initialized = true;
+        }
+        const int x0 = (frame.width - std::min(ROI, frame.width)) / 2;
+        const int y0 = (frame.height - std::min(ROI, frame.height)) / 2;
+
+        int motion_frames = 0;
+        int settled_at = -1;
+        uint32_t since_inference = 0;
+        for (int h = 0; h < HOLD; ++h) {
+            const motion::decision_t d = gate.update(frame.rgb565.data(), frame.width, x0, y0);
+            if (h == 0) {
+                CHECK(d == (i == 0 ? motion::DECISION_INIT : motion::DECISION_MOTION));
+            }
+            if (d == motion::DECISION_MOTION) {
+                motion_frames++;
+                // Bewegung nur als zusammenhängender Block ab dem Szenenwechsel
+                CHECK(settled_at < 0);
+            } else if (h > 0 && settled_at < 0) {
+                settled_at = h;
+            }
+            if (d == motion::DECISION_SKIP) {
+                since_inference++;
+                CHECK(since_inference < cfg.force_every);
+            } else {
+                since_inference = 0;
+            }
+        }
+        // Szenenwechsel zwischen zwei Aufnahmen liegen weit über diff_threshold; bg_shift 4
+        // lernt sie in etwa 10..35 Frames ein (vgl. test_background_absorbs_static_change)
+        if (i > 0) {
+            CHECK(motion_frames >= 5);
+        }
+        CHECK(settled_at > 0);
+        CHECK(settled_at < HOLD - (int)cfg.force_every);
+    }
+
+    const motion::gate_stats_t &st = gate.stats();
+    printf("  %u frames: %u init, %u motion, %u forced, %u skipped, skip ratio %.2f\n", st.frames,
+           st.decisions[motion::DECISION_INIT], st.decisions[motion::DECISION_MOTION],
+           st.decisions[motion::DECISION_FORCED], st.decisions[motion::DECISION_SKIP], gate.skip_ratio());
+    CHECK(st.frames == source.count() * HOLD);
+    CHECK(st.decisions[motion::DECISION_INIT] == 1);
+    CHECK(st.decisions[motion::DECISION_FORCED] >= source.count());
+    // Bei 60 Frames je Szene und 10..35 Frames Einlernen bleibt gut die Hälfte übersprungen
+    CHECK(gate.skip_ratio() > 0.4f);
+    CHECK(gate.skip_ratio() < 0.8f);
+}
+
+int main() {
+    RUN_TEST(test_init_and_static_scene);
+    RUN_TEST(test_area_threshold);
+    RUN_TEST(test_diff_threshold);
+    RUN_TEST(test_outside_roi_ignored);
+    RUN_TEST(test_background_absorbs_static_change);
+    RUN_TEST(test_slow_drift_absorbed);
+    RUN_TEST(test_force_every);
+    RUN_TEST(test_invalid_config);
+    RUN_TEST(test_recorded_sequence);
+    return TEST_RESULT();
+}
@@ -0,0 +1,157 @@
+// rgb565_roi_to_rgb888 (wortweise) und der PIE-Pfad (auf dem Host das Lane-Modell von
+// rgb565_roi_esp32s3.S) gegen die skalare Referenz, bitgenau
+
+#include <cstring>
+#include <vector>
+#include "host_test.hpp"
+#include "rgb565_roi.hpp"
+
+using hosttest::Rng;
+
+static constexpr int FRAME_W = 320;
+static constexpr int FRAME_H = 240;
+
+// Vergleicht beide Pfade für eine ROI; src_shift/dst_shift verschieben die Puffer gegen
+// die 4-Byte-Ausrichtung, damit auch der skalare Rückfallpfad läuft
+static bool same_as_ref(const std::vector<uint8_t> &frame, int x0, int y0, int w, int h, int src_shift,
+                        int dst_shift, bool pie = false) {
+    std::vector<uint8_t> src(frame.size() + 4);
+    memcpy(src.data() + src_shift, frame.data(), frame.size());
+    const size_t out = (size_t)w * h * 3;
+    std::vector<uint8_t> fast(out + 4 + 16, 0xAB);
+    std::vector<uint8_t> ref(out, 0xCD);
+    const auto convert = pie ? imgconv::rgb565_roi_to_rgb888_pie : imgconv::rgb565_roi_to_rgb888;
+    const bool ok = convert(src.data() + src_shift, FRAME_W, FRAME_H, x0, y0, w, h, fast.data() + dst_shift);
+    const bool ref_ok = imgconv::rgb565_roi_to_rgb888_ref(frame.data(), FRAME_W, FRAME_H, x0, y0, w, h, ref.data());
+    if (!ok || !ref_ok || memcmp(fast.data() + dst_shift, ref.data(), out) != 0) {
+        return false;
+    }
+    // Nichts hinter dem Ausschnitt überschrieben
+    for (size_t i = dst_shift + out; i < fast.size(); ++i) {
+        if (fast[i] != 0xAB) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::vector<uint8_t> random_frame(Rng &rng) {
+    std::vector<uint8_t> frame((size_t)FRAME_W * FRAME_H * 2);
+    for (auto &b : frame) {
+        b = (uint8_t)rng.next();
+    }
+    return frame;
+}
+
+static void test_full_frame() {
+    Rng rng(1);
+    const std::vector<uint8_t> frame = random_frame(rng);
+    CHECK(same_as_ref(frame, 0, 0, FRAME_W, FRAME_H, 0, 0));
+    CHECK(same_as_ref(frame, 0, 0, FRAME_W, FRAME_H, 2, 1));
+}
+
+static void test_single_pixel() {
+    Rng rng(2);
+    const std::vector<uint8_t> frame = random_frame(rng);
+    CHECK(same_as_ref(frame, 0, 0, 1, 1, 0, 0));
+    CHECK(same_as_ref(frame, FRAME_W - 1, FRAME_H - 1, 1, 1, 0, 0));
+    CHECK(same_as_ref(frame, 17, 33, 1, 1, 2, 3));
+}
+
+static void test_odd_offsets_and_widths() {
+    Rng rng(3);
+    const std::vector<uint8_t> frame = random_frame(rng);
+    for (int x0 : {1, 3, 47}) {
+        for (int w : {1, 3, 5, 7, 9, 223, 225}) {
+            if (x0 + w <= FRAME_W) {
+                CHECK(same_as_ref(frame, x0, 5, w, 7, 0, 0));
+            }
+        }
+    }
+}
+
+static void test_random_rois() {
+    Rng rng(4);
+    const std::vector<uint8_t> frame = random_frame(rng);
+    for (int i = 0; i < 500; ++i) {
+        const int w = rng.range(1, FRAME_W);
+        const int h = rng.range(1, 32);
+        const int x0 = rng.range(0, FRAME_W - w);
+        const int y0 = rng.range(0, FRAME_H - h);
+        CHECK(same_as_ref(frame, x0, y0, w, h, rng.range(0, 3), rng.range(0, 3)));
+    }
+}
+
+static void test_every_pixel_value() {
+    // Alle 65536 RGB565-Werte, big endian wie vom Kamera-Treiber
+    std::vector<uint8_t> src(65536 * 2);
+    for (int v = 0; v < 65536; ++v) {
+        src[v * 2] = (uint8_t)(v >> 8);
+        src[v * 2 + 1] = (uint8_t)v;
+    }
+    std::vector<uint8_t> fast(65536 * 3), ref(65536 * 3);
+    CHECK(imgconv::rgb565_roi_to_rgb888(src.data(), 256, 256, 0, 0, 256, 256, fast.data()));
+    CHECK(imgconv::rgb565_roi_to_rgb888_ref(src.data(), 256, 256, 0, 0, 256, 256, ref.data()));
+    CHECK(fast == ref);
+    // Stichprobe gegen die Formel von dl::image::RGB5652RGB888<true, false>
+    CHECK(ref[0xFFFF * 3] == 0xF8 && ref[0xFFFF * 3 + 1] == 0xFC && ref[0xFFFF * 3 + 2] == 0xF8);
+    CHECK(ref[0xF800 * 3] == 0xF8 && ref[0xF800 * 3 + 1] == 0 && ref[0xF800 * 3 + 2] == 0);
+    CHECK(ref[0x07E0 * 3] == 0 && ref[0x07E0 * 3 + 1] == 0xFC && ref[0x07E0 * 3 + 2] == 0);
+    CHECK(ref[0x001F * 3] == 0 && ref[0x001F * 3 + 1] == 0 && ref[0x001F * 3 + 2] == 0xF8);
+}
+
+static void test_pie_random_rois() {
+    Rng rng(5);
+    const std::vector<uint8_t> frame = random_frame(rng);
+    // 224er-Ausschnitt wie im Betrieb: Zeilenanfang 16-Byte-ausgerichtet, 14 Blöcke ohne Rest
+    CHECK(same_as_ref(frame, 48, 8, 224, 224, 0, 0, true));
+    for (int i = 0; i < 500; ++i) {
+        const int w = rng.range(1, FRAME_W);
+        const int h = rng.range(1, 16);
+        const int x0 = rng.range(0, FRAME_W - w);
+        const int y0 = rng.range(0, FRAME_H - h);
+        CHECK(same_as_ref(frame, x0, y0, w, h, rng.range(0, 3), rng.range(0, 3), true));
+    }
+}
+
+static void test_pie_every_pixel_value() {
+    std::vector<uint8_t> src(65536 * 2);
+    for (int v = 0; v < 65536; ++v) {
+        src[v * 2] = (uint8_t)(v >> 8);
+        src[v * 2 + 1] = (uint8_t)v;
+    }
+    std::vector<uint8_t> pie(65536 * 3), ref(65536 * 3);
+    CHECK(imgconv::rgb565_roi_to_rgb888_pie(src.data(), 256, 256, 0, 0, 256, 256, pie.data()));
+    CHECK(imgconv::rgb565_roi_to_rgb888_ref(src.data(), 256, 256, 0, 0, 256, 256, ref.data()));
+    CHECK(pie == ref);
+}
+
+static void test_pie_self_check() {
+    // Die Startprüfung besteht mit dem Modell; aktiv wird der Kern nur auf dem ESP32-S3
+    CHECK(imgconv::pie_kernel_matches_ref());
+    CHECK(!imgconv::enable_pie_kernel());
+}
+
+static void test_invalid_roi() {
+    std::vector<uint8_t> frame((size_t)FRAME_W * FRAME_H * 2);
+    std::vector<uint8_t> dst(16);
+    CHECK(!imgconv::rgb565_roi_to_rgb888(frame.data(), FRAME_W, FRAME_H, FRAME_W - 1, 0, 2, 1, dst.data()));
+    CHECK(!imgconv::rgb565_roi_to_rgb888(frame.data(), FRAME_W, FRAME_H, 0, FRAME_H, 1, 1, dst.data()));
+    CHECK(!imgconv::rgb565_roi_to_rgb888(frame.data(), FRAME_W, FRAME_H, -1, 0, 1, 1, dst.data()));
+    CHECK(!imgconv::rgb565_roi_to_rgb888(frame.data(), FRAME_W, FRAME_H, 0, 0, 0, 1, dst.data()));
+    CHECK(!imgconv::rgb565_roi_to_rgb888(nullptr, FRAME_W, FRAME_H, 0, 0, 1, 1, dst.data()));
+    CHECK(!imgconv::rgb565_roi_to_rgb888_pie(frame.data(), FRAME_W, FRAME_H, FRAME_W - 1, 0, 2, 1, dst.data()));
+}
+
+int main() {
+    RUN_TEST(test_full_frame);
+    RUN_TEST(test_single_pixel);
+    RUN_TEST(test_odd_offsets_and_widths);
+    RUN_TEST(test_random_rois);
+    RUN_TEST(test_every_pixel_value);
+    RUN_TEST(test_pie_random_rois);
+    RUN_TEST(test_pie_every_pixel_value);
+    RUN_TEST(test_pie_self_check);
+    RUN_TEST(test_invalid_roi);
+    return TEST_RESULT();
+}
@@ -0,0 +1,219 @@
+// rgb565_roi_to_tensor gegen die skalare Referenz: alle RGB565-Werte, zufällige ROIs mit
+// ungeraden Breiten, unausgerichtete Zeiger, mehrere Normalisierungen und Exponenten.
+// Dazu das Testmuster, wie es der ImagePreprocessor auf dem Gerät quantisiert hat
+// (CONFIG_BUMBLEBEE_DETECT_DUMP_PREPROCESS, data/rgb565_tensor/).
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include "host_test.hpp"
+#include "rgb565_tensor.hpp"
+
+using bumblebee_detect::rgb565_lut_t;
+
+struct norm_t {
+    float mean[3];
+    float std[3];
+    int exponent;
+};
+
+// Wie die Modelle ([0, 1] bzw. [-1, 1]), ImageNet-Normalisierung und Exponenten, bei denen
+// ein Teil der Werte in die int8-Sättigung läuft
+static const norm_t NORMS[] = {
+    {{0, 0, 0}, {255, 255, 255}, -7},
+    {{127.5f, 127.5f, 127.5f}, {127.5f, 127.5f, 127.5f}, -7},
+    {{123.675f, 116.28f, 103.53f}, {58.395f, 57.12f, 57.375f}, -4},
+    {{123.675f, 116.28f, 103.53f}, {58.395f, 57.12f, 57.375f}, -6},
+    {{0, 0, 0}, {1, 1, 1}, 1},
+    {{0, 0, 0}, {255, 255, 255}, -5},
+};
+
+static constexpr uint8_t GUARD = 0xA5;
+
+// Quelle ab einem beliebigen Byte-Versatz, damit auch ungerade Adressen vorkommen
+struct Source {
+    std::vector<uint8_t> mem;
+    const uint8_t *px;
+    Source(int width, int height, int misalign, hosttest::Rng &rng) : mem((size_t)width * height * 2 + 8) {
+        for (auto &b : mem) {
+            b = (uint8_t)rng.next();
+        }
+        px = mem.data() + misalign;
+    }
+};
+
+// Vergleicht schnellen Pfad und Referenz; dst liegt mit Versatz in einem Puffer mit Schutzbytes
+static bool compare(const uint8_t *src, int w, int h, int x0, int y0, int rw, int rh, const norm_t &n,
+                    int dst_misalign) {
+    rgb565_lut_t lut;
+    bumblebee_detect::make_rgb565_lut(n.mean, n.std, n.exponent, lut);
+    const size_t len = (size_t)rw * rh * 3;
+    std::vector<uint8_t> fast(len + 16, GUARD);
+    std::vector<int8_t> ref(len);
+    int8_t *dst = reinterpret_cast<int8_t *>(fast.data() + dst_misalign);
+    if (!bumblebee_detect::rgb565_roi_to_tensor(src, w, h, x0, y0, rw, rh, lut, dst) ||
+        !bumblebee_detect::rgb565_roi_to_tensor_ref(src, w, h, x0, y0, rw, rh, n.mean, n.std, n.exponent,
+                                                    ref.data())) {
+        return false;
+    }
+    for (size_t i = 0; i < fast.size(); ++i) {
+        const bool inside = i >= (size_t)dst_misalign && i < dst_misalign + len;
+        if (!inside && fast[i] != GUARD) {
+            return false;
+        }
+    }
+    return memcmp(dst, ref.data(), len) == 0;
+}
+
+// Jeder der 65536 RGB565-Werte einmal, je Normalisierung
+static void test_all_pixel_values() {
+    std::vector<uint8_t> img(256 * 256 * 2);
+    for (int v = 0; v < 65536; ++v) {
+        img[(size_t)v * 2] = (uint8_t)(v >> 8);  // big endian wie der Kamera-Treiber
+        img[(size_t)v * 2 + 1] = (uint8_t)v;
+    }
+    for (const norm_t &n : NORMS) {
+        CHECK(compare(img.data(), 256, 256, 0, 0, 256, 256, n, 0));
+    }
+}
+
+static void test_random_rois() {
+    hosttest::Rng rng(19);
+    int cases = 0;
+    for (int i = 0; i < 400; ++i) {
+        const int w = rng.range(1, 97);
+        const int h = rng.range(1, 40);
+        const int rw = rng.range(1, w);
+        const int rh = rng.range(1, h);
+        const int x0 = rng.range(0, w - rw);
+        const int y0 = rng.range(0, h - rh);
+        Source src(w, h, rng.range(0, 3), rng);
+        const norm_t &n = NORMS[i % (sizeof(NORMS) / sizeof(NORMS[0]))];
+        CHECK(compare(src.px, w, h, x0, y0, rw, rh, n, rng.range(0, 3)));
+        cases++;
+    }
+    CHECK(cases == 400);
+}
+
+// Ungerade Breiten und Startspalten: der letzte Pixel einer Zeile geht über den Einzelpfad,
+// gelesen wird dabei nichts hinter der ROI
+static void test_odd_widths_at_right_edge() {
+    hosttest::Rng rng(23);
+    for (int rw = 1; rw <= 9; ++rw) {
+        const int w = 16;
+        const int x0 = w - rw;  // ROI endet am Bildrand
+        std::vector<uint8_t> mem((size_t)w * 5 * 2);
+        for (auto &b : mem) {
+            b = (uint8_t)rng.next();
+        }
+        // Genau so groß wie das Bild: ASan meldet jeden Lesezugriff dahinter
+        for (int misalign = 0; misalign < 2; ++misalign) {
+            std::vector<uint8_t> exact(mem.size() + misalign);
+            memcpy(exact.data() + misalign, mem.data(), mem.size());
+            CHECK(compare(exact.data() + misalign, w, 5, x0, 0, rw, 5, NORMS[2], misalign));
+        }
+    }
+}
+
+static void test_invalid_roi() {
+    std::vector<uint8_t> img(8 * 8 * 2);
+    std::vector<int8_t> dst(8 * 8 * 3);
+    rgb565_lut_t lut;
+    const norm_t &n = NORMS[0];
+    bumblebee_detect::make_rgb565_lut(n.mean, n.std, n.exponent, lut);
+    const int rois[][4] = {{0, 0, 9, 1}, {1, 0, 8, 1}, {0, 4, 8, 5}, {-1, 0, 2, 2}, {0, 0, 0, 4}, {0, 0, 4, 0}};
+    for (const auto &r : rois) {
+        CHECK(!bumblebee_detect::rgb565_roi_to_tensor(img.data(), 8, 8, r[0], r[1], r[2], r[3], lut, dst.data()));
+        CHECK(!bumblebee_detect::rgb565_roi_to_tensor_ref(img.data(), 8, 8, r[0], r[1], r[2], r[3], n.mean, n.std,
+                                                          n.exponent, dst.data()));
+    }
+    CHECK(!bumblebee_detect::rgb565_roi_to_tensor(nullptr, 8, 8, 0, 0, 4, 4, lut, dst.data()));
+    CHECK(!bumblebee_detect::rgb565_roi_to_tensor(img.data(), 8, 8, 0, 0, 4, 4, lut, nullptr));
+}
+
+// Schreiben, lesen, abgeschnittene Datei
+static void test_dump_roundtrip() {
+    const norm_t &n = NORMS[0];
+    bumblebee_detect::tensor_dump_t dump;
+    dump.width = 12;
+    dump.height = 5;
+    dump.exponent = n.exponent;
+    memcpy(dump.mean, n.mean, sizeof(dump.mean));
+    memcpy(dump.std, n.std, sizeof(dump.std));
+    std::vector<uint8_t> pattern((size_t)dump.width * dump.height * 2);
+    bumblebee_detect::make_rgb565_pattern(pattern.data(), dump.width, dump.height);
+    dump.tensor.resize((size_t)dump.width * dump.height * 3);
+    CHECK(bumblebee_detect::rgb565_roi_to_tensor_ref(pattern.data(), dump.width, dump.height, 0, 0, dump.width,
+                                                     dump.height, n.mean, n.std, n.exponent, dump.tensor.data()));
+
+    hosttest::TempDir dir;
+    const std::string path = dir.path + "/preprocess_12x5.bin";
+    FILE *f = fopen(path.c_str(), "wb");
+    CHECK(f && bumblebee_detect::write_tensor_dump(f, dump));
+    fclose(f);
+    bumblebee_detect::tensor_dump_t back;
+    f = fopen(path.c_str(), "rb");
+    CHECK(f && bumblebee_detect::read_tensor_dump(f, back));
+    fclose(f);
+    CHECK(back.width == dump.width && back.height == dump.height && back.exponent == dump.exponent);
+    CHECK(memcmp(back.mean, dump.mean, sizeof(dump.mean)) == 0 && memcmp(back.std, dump.std, sizeof(dump.std)) == 0);
+    CHECK(back.tensor == dump.tensor);
+
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    f = fopen(path.c_str(), "rb");
+    CHECK(f && !bumblebee_detect::read_tensor_dump(f, back));
+    fclose(f);
+}
+
+// ImagePreprocessor auf dem Gerät für das Testmuster der Ladeprüfung: Tabellen und Referenz
+// müssen bitgleich sein
+static void test_device_dumps() {
+    const std::filesystem::path dir = RGB565_TENSOR_DIR;
+    int checked = 0;
+    if (std::filesystem::is_directory(dir)) {
+        for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+            if (entry.path().extension() != ".bin") {
+                continue;
+            }
+            bumblebee_detect::tensor_dump_t dump;
+            FILE *f = fopen(entry.path().c_str(), "rb");
+            const bool ok = f && bumblebee_detect::read_tensor_dump(f, dump);
+            if (f) {
+                fclose(f);
+            }
+            CHECK(ok);
+            if (!ok) {
+                continue;
+            }
+            std::vector<uint8_t> pattern((size_t)dump.width * dump.height * 2);
+            bumblebee_detect::make_rgb565_pattern(pattern.data(), dump.width, dump.height);
+            rgb565_lut_t lut;
+            bumblebee_detect::make_rgb565_lut(dump.mean, dump.std, dump.exponent, lut);
+            std::vector<int8_t> fast(dump.tensor.size());
+            std::vector<int8_t> ref(dump.tensor.size());
+            CHECK(bumblebee_detect::rgb565_roi_to_tensor(pattern.data(), dump.width, dump.height, 0, 0, dump.width,
+                                                         dump.height, lut, fast.data()));
+            CHECK(bumblebee_detect::rgb565_roi_to_tensor_ref(pattern.data(), dump.width, dump.height, 0, 0,
+                                                             dump.width, dump.height, dump.mean, dump.std,
+                                                             dump.exponent, ref.data()));
+            CHECK(fast == dump.tensor);
+            CHECK(ref == dump.tensor);
+            printf("  %s: %dx%d, exponent %d\n", entry.path().filename().c_str(), dump.width, dump.height,
+                   dump.exponent);
+            checked++;
+        }
+    }
+    if (!checked) {
+        printf("  no device dumps in %s\n", dir.c_str());
+    }
+}
+
+int main() {
+    RUN_TEST(test_all_pixel_values);
+    RUN_TEST(test_random_rois);
+    RUN_TEST(test_odd_widths_at_right_edge);
+    RUN_TEST(test_invalid_roi);
+    RUN_TEST(test_dump_roundtrip);
+    RUN_TEST(test_device_dumps);
+    return TEST_RESULT();
+}
@@ -0,0 +1,353 @@
+// Segment-Container: Schreiben und Zurücklesen über PosixBackend, INDEX-Kette, Recovery
+// nach abgerissenem oder beschädigtem Record und nach Absturz ohne close()
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+#include "host_test.hpp"
+#include "segment_file.hpp"
+#include "storage_posix.hpp"
+
+using segment::record_header_t;
+
+static const char *PATH = "/sdcard/seg_test.open";
+
+struct Record {
+    uint16_t type;
+    int64_t t_us;
+    std::vector<uint8_t> meta;
+    std::vector<uint8_t> payload;
+};
+
+static std::vector<uint8_t> random_bytes(hosttest::Rng &rng, size_t n) {
+    std::vector<uint8_t> v(n);
+    for (auto &b : v) {
+        b = (uint8_t)rng.next();
+    }
+    return v;
+}
+
+static std::vector<uint8_t> read_file(const std::string &path) {
+    std::vector<uint8_t> data;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        return data;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(f);
+    return data;
+}
+
+static void write_file(const std::string &path, const std::vector<uint8_t> &data) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (f) {
+        fwrite(data.data(), 1, data.size(), f);
+        fclose(f);
+    }
+}
+
+static segment::writer_config_t config(storage::Backend &fs, uint32_t session, uint32_t capacity = 1 << 20) {
+    segment::writer_config_t cfg = {};
+    cfg.session = session;
+    cfg.capacity = capacity;
+    cfg.index_interval = 4;
+    cfg.flush_interval_us = 1000000000;  // nur explizit
+    cfg.fs = &fs;
+    return cfg;
+}
+
+// Hängt count JPEG- und THUMB-Records mit zufälliger Länge an (auch nicht durch 4 teilbar)
+static std::vector<Record> append_random(segment::Writer &w, hosttest::Rng &rng, int count) {
+    std::vector<Record> written;
+    for (int i = 0; i < count; ++i) {
+        Record r;
+        r.t_us = 1700000000000000LL + i * 250000LL;
+        r.payload = random_bytes(rng, (size_t)rng.range(1, 3000));
+        if (i % 3 == 2) {
+            segment::thumb_meta_t meta = {};
+            meta.frame_id = (uint32_t)i;
+            meta.crop_x1 = (int16_t)i;
+            meta.box = {1, 2, 3, 4, 900, 0};
+            r.type = segment::RECORD_THUMB;
+            r.meta.assign((const uint8_t *)&meta, (const uint8_t *)&meta + sizeof(meta));
+            CHECK(w.append_thumb(r.t_us, meta, r.payload.data(), (uint32_t)r.payload.size()));
+        } else {
+            std::vector<segment::box_meta_t> boxes((size_t)(i % 3));
+            for (size_t b = 0; b < boxes.size(); ++b) {
+                boxes[b] = {(int16_t)i, (int16_t)b, 50, 60, (uint16_t)(500 + b), 0};
+            }
+            r.type = segment::RECORD_JPEG;
+            r.meta.assign((const uint8_t *)boxes.data(), (const uint8_t *)(boxes.data() + boxes.size()));
+            CHECK(w.append(r.t_us, boxes.data(), (uint16_t)boxes.size(), r.payload.data(),
+                           (uint32_t)r.payload.size()));
+        }
+        written.push_back(r);
+    }
+    return written;
+}
+
+struct Parsed {
+    segment::file_header_t header = {};
+    std::vector<record_header_t> headers;
+    std::vector<uint32_t> offsets;
+    std::vector<Record> records;
+    uint32_t end = 0;
+};
+
+// Unabhängiger Leser nach dem Format in segment_file.hpp, wie extract_segments.py
+static Parsed parse(const std::vector<uint8_t> &data) {
+    Parsed p;
+    if (data.size() < sizeof(p.header)) {
+        return p;
+    }
+    memcpy(&p.header, data.data(), sizeof(p.header));
+    uint32_t offset = p.header.header_size;
+    while (offset + sizeof(record_header_t) <= data.size()) {
+        record_header_t rh;
+        memcpy(&rh, &data[offset], sizeof(rh));
+        const uint32_t body = (uint32_t)rh.meta_len + rh.payload_len;
+        const uint32_t size = sizeof(rh) + ((body + 3) & ~3u);
+        if (rh.magic != segment::RECORD_MAGIC || rh.session != p.header.session || rh.seq != p.headers.size() ||
+            offset + size > data.size()) {
+            break;
+        }
+        record_header_t zeroed = rh;
+        zeroed.crc = 0;
+        uint32_t crc = segment::crc32(0, &zeroed, sizeof(zeroed));
+        crc = segment::crc32(crc, &data[offset + sizeof(rh)], body);
+        if (crc != rh.crc) {
+            break;
+        }
+        const uint8_t *meta = &data[offset + sizeof(rh)];
+        p.headers.push_back(rh);
+        p.offsets.push_back(offset);
+        p.records.push_back({rh.type, rh.t_us, std::vector<uint8_t>(meta, meta + rh.meta_len),
+                             std::vector<uint8_t>(meta + rh.meta_len, meta + body)});
+        offset += size;
+    }
+    p.end = offset;
+    return p;
+}
+
+static void test_round_trip() {
+    hosttest::TempDir dir;
+    storage::PosixBackend fs(dir.path.c_str());
+    CHECK(fs.mount());
+    hosttest::Rng rng(7);
+
+    segment::Writer w;
+    CHECK(w.create(PATH, config(fs, 0xB0B0CAFE)));
+    const std::vector<Record> written = append_random(w, rng, 10);
+    CHECK(w.last_seq() > 0);
+    CHECK(w.stats().index_blocks == 2);
+    CHECK(w.close());
+    CHECK(w.stats().index_blocks == 3);  // Rest der Records im abschließenden INDEX
+
+    const std::vector<uint8_t> data = read_file(fs.host_path(PATH));
+    const Parsed p = parse(data);
+    CHECK(p.header.magic == segment::FILE_MAGIC);
+    CHECK(p.header.version == segment::VERSION);
+    CHECK(p.header.session == 0xB0B0CAFE);
+    CHECK(p.header.index_interval == 4);
+    CHECK(p.header.crc == segment::crc32(0, &p.header, offsetof(segment::file_header_t, crc)));
+    // close() kürzt auf den belegten Bereich
+    CHECK(p.end == data.size());
+
+    // Records in Schreibreihenfolge, INDEX nach je 4 Bild-Records und am Ende
+    size_t next = 0;
+    uint32_t prev_index = 0;
+    std::vector<segment::index_entry_t> indexed;
+    for (size_t i = 0; i < p.records.size(); ++i) {
+        const Record &r = p.records[i];
+        if (r.type == segment::RECORD_INDEX) {
+            uint32_t prev = 0;
+            CHECK(r.meta.size() == sizeof(prev));
+            memcpy(&prev, r.meta.data(), sizeof(prev));
+            CHECK(prev == prev_index);
+            prev_index = p.offsets[i];
+            const size_t n = r.payload.size() / sizeof(segment::index_entry_t);
+            CHECK(n == (indexed.size() < 8 ? 4u : 2u));
+            for (size_t k = 0; k < n; ++k) {
+                segment::index_entry_t e;
+                memcpy(&e, &r.payload[k * sizeof(e)], sizeof(e));
+                CHECK(e.seq < p.headers.size() && p.offsets[e.seq] == e.offset);
+                CHECK(p.records[e.seq].type != segment::RECORD_INDEX);
+                indexed.push_back(e);
+            }
+            continue;
+        }
+        CHECK(next < written.size());
+        if (next >= written.size()) {
+            break;
+        }
+        CHECK(r.type == written[next].type);
+        CHECK(r.t_us == written[next].t_us);
+        CHECK(r.meta == written[next].meta);
+        CHECK(r.payload == written[next].payload);
+        next++;
+    }
+    CHECK(next == written.size());
+    CHECK(indexed.size() == written.size());
+
+    FILE *f = fopen(fs.host_path(PATH).c_str(), "rb");
+    segment::scan_result_t res;
+    CHECK(f && segment::scan(f, res));
+    if (f) {
+        fclose(f);
+    }
+    CHECK(res.header_ok);
+    CHECK(res.session == 0xB0B0CAFE);
+    CHECK(res.records == 13);
+    CHECK(res.jpegs == 7);
+    CHECK(res.thumbs == 3);
+    CHECK(res.valid_end == data.size());
+    CHECK(res.last_index == prev_index);
+}
+
+// Ist die Kapazität erschöpft, wird abgelehnt; Platz für den letzten INDEX bleibt frei
+static void test_capacity() {
+    hosttest::TempDir dir;
+    storage::PosixBackend fs(dir.path.c_str());
+    CHECK(fs.mount());
+    const uint8_t payload[1000] = {};
+    segment::Writer w;
+    CHECK(w.create(PATH, config(fs, 1, 4096)));
+    int appended = 0;
+    while (w.append(appended, nullptr, 0, payload, sizeof(payload))) {
+        appended++;
+    }
+    CHECK(appended == 3);
+    CHECK(w.stats().full == 1);
+    CHECK(w.remaining() < sizeof(record_header_t) + sizeof(payload));
+    CHECK(w.close());
+
+    segment::scan_result_t res;
+    CHECK(segment::recover(PATH, res, &fs));
+    CHECK(res.jpegs == 3);
+    CHECK(std::filesystem::file_size(fs.host_path(PATH)) <= 4096);
+}
+
+// Abgerissener letzter Record (Strom weg mitten im Schreiben): Recovery schneidet ihn ab,
+// alle Records davor bleiben
+static void test_torn_record() {
+    hosttest::TempDir dir;
+    storage::PosixBackend fs(dir.path.c_str());
+    CHECK(fs.mount());
+    hosttest::Rng rng(11);
+    segment::Writer w;
+    CHECK(w.create(PATH, config(fs, 5)));
+    append_random(w, rng, 6);
+    CHECK(w.close());
+
+    const std::string host = fs.host_path(PATH);
+    const std::vector<uint8_t> full = read_file(host);
+    const Parsed p = parse(full);
+    CHECK(p.records.size() == 8);
+    const uint32_t last = p.offsets.back();
+
+    // Jede Schnittstelle im letzten Record, auch mitten im Header
+    const uint32_t cuts[] = {last + 1, last + (uint32_t)sizeof(record_header_t) - 1,
+                             last + (uint32_t)sizeof(record_header_t) + 3, (uint32_t)full.size() - 1};
+    for (uint32_t cut : cuts) {
+        write_file(host, std::vector<uint8_t>(full.begin(), full.begin() + cut));
+        segment::scan_result_t res;
+        CHECK(segment::recover(PATH, res, &fs));
+        CHECK(res.records == 7);
+        CHECK(res.valid_end == last);
+        CHECK(std::filesystem::file_size(host) == last);
+    }
+}
+
+// Ein beschädigtes Byte in Record k: Leser und Recovery hören davor auf
+static void test_corrupt_record() {
+    hosttest::TempDir dir;
+    storage::PosixBackend fs(dir.path.c_str());
+    CHECK(fs.mount());
+    hosttest::Rng rng(13);
+    segment::Writer w;
+    CHECK(w.create(PATH, config(fs, 6)));
+    append_random(w, rng, 6);
+    CHECK(w.close());
+
+    const std::string host = fs.host_path(PATH);
+    std::vector<uint8_t> data = read_file(host);
+    const Parsed p = parse(data);
+    data[p.offsets[3] + sizeof(record_header_t) + p.headers[3].meta_len] ^= 0x40;
+    write_file(host, data);
+
+    segment::scan_result_t res;
+    CHECK(segment::recover(PATH, res, &fs));
+    CHECK(res.records == 3);
+    CHECK(res.valid_end == p.offsets[3]);
+    CHECK(std::filesystem::file_size(host) == p.offsets[3]);
+
+    // Kaputter Dateiheader: nichts zu retten, Datei bleibt unverändert
+    data = read_file(host);
+    data[8] ^= 1;
+    write_file(host, data);
+    CHECK(!segment::recover(PATH, res, &fs));
+    CHECK(!res.header_ok);
+    CHECK(std::filesystem::file_size(host) == p.offsets[3]);
+}
+
+// Absturz ohne close(): die Datei hat noch die volle Vorallokation, dahinter liegen Records einer
+// früheren Sitzung in denselben Clustern. Gelesen wird bis zum letzten Record der neuen Sitzung.
+static void test_crash_before_close() {
+    hosttest::TempDir dir;
+    storage::PosixBackend fs(dir.path.c_str());
+    CHECK(fs.mount());
+    hosttest::Rng rng(17);
+    const uint32_t capacity = 64 * 1024;
+    {
+        segment::Writer old;
+        CHECK(old.create(PATH, config(fs, 1, capacity)));
+        append_random(old, rng, 12);
+        CHECK(old.flush());
+        // Vorallokation wie auf der Karte behalten
+        std::filesystem::copy_file(fs.host_path(PATH), dir.path + "/old.bin");
+    }
+    std::filesystem::rename(dir.path + "/old.bin", fs.host_path(PATH));
+    CHECK(std::filesystem::file_size(fs.host_path(PATH)) == capacity);
+
+    const std::string crashed = dir.path + "/crashed.bin";
+    std::vector<Record> written;
+    uint32_t expected_end = 0;
+    {
+        segment::Writer w;
+        CHECK(w.create(PATH, config(fs, 2, capacity)));
+        written = append_random(w, rng, 5);
+        CHECK(w.flush());
+        expected_end = w.stats().bytes;
+        std::filesystem::copy_file(fs.host_path(PATH), crashed);
+    }
+    std::filesystem::rename(crashed, fs.host_path(PATH));
+    CHECK(std::filesystem::file_size(fs.host_path(PATH)) == capacity);
+
+    segment::scan_result_t res;
+    CHECK(segment::recover(PATH, res, &fs));
+    CHECK(res.session == 2);
+    CHECK(res.records == 6);  // 5 Bilder und der INDEX nach dem vierten
+    CHECK(res.valid_end == expected_end);
+    const Parsed p = parse(read_file(fs.host_path(PATH)));
+    CHECK(p.end == expected_end);
+    size_t next = 0;
+    for (const Record &r : p.records) {
+        if (r.type != segment::RECORD_INDEX && next < written.size()) {
+            CHECK(r.payload == written[next++].payload);
+        }
+    }
+    CHECK(next == written.size());
+}
+
+int main() {
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_capacity);
+    RUN_TEST(test_torn_record);
+    RUN_TEST(test_corrupt_record);
+    RUN_TEST(test_crash_before_close);
+    return TEST_RESULT();
+}
@@ -0,0 +1,162 @@
+// Span-Profiler: Ring der letzten Werte, Nearest-rank-Perzentile gegen eine sortierte Referenz,
+// Überlauf des Zykluszählers und die 64-Bit-Summe unter gleichzeitigem Lesen
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "esp_rom_sys.h"
+#include "host_test.hpp"
+#include "span_profiler.hpp"
+
+using profiler::SampleRing;
+
+// Nach k Werten enthält der Ring genau die letzten min(k, N)
+static void test_ring_wrap() {
+    SampleRing<8> ring;
+    CHECK(ring.total() == 0 && ring.size() == 0);
+    for (uint32_t k = 1; k <= 30; ++k) {
+        ring.push(k * 10);
+        std::vector<uint32_t> out(8);
+        const size_t n = ring.copy(out.data());
+        CHECK(ring.total() == k);
+        CHECK(n == std::min<size_t>(k, 8));
+        std::sort(out.begin(), out.begin() + n);
+        bool last = true;
+        for (size_t i = 0; i < n; ++i) {
+            last = last && out[i] == (k - n + 1 + i) * 10;
+        }
+        CHECK(last);
+    }
+    ring.reset();
+    CHECK(ring.total() == 0 && ring.size() == 0);
+    ring.push(7);
+    uint32_t one;
+    CHECK(ring.copy(&one) == 1 && one == 7);
+}
+
+// Referenz: kleinster Rang k mit k >= pct/100 * n, aus der vollständig sortierten Folge
+static uint32_t reference_percentile(std::vector<uint32_t> v, int pct) {
+    std::sort(v.begin(), v.end());
+    const double exact = (double)pct * v.size() / 100.0;
+    size_t rank = 1;
+    while (rank < v.size() && (double)rank < exact) {
+        rank++;
+    }
+    return v[rank - 1];
+}
+
+static void test_percentile_vs_sorted() {
+    hosttest::Rng rng(20);
+    static const int PCTS[] = {0, 1, 5, 50, 94, 95, 96, 99, 100};
+    int mismatches = 0;
+    for (int i = 0; i < 600; ++i) {
+        const size_t n = (size_t)rng.range(1, 200);
+        const uint32_t spread = i % 3 == 0 ? 4 : 100000;  // auch viele gleiche Werte
+        std::vector<uint32_t> v(n);
+        for (auto &x : v) {
+            x = rng.next() % spread;
+        }
+        const int pct = i % 2 ? PCTS[i / 2 % 9] : rng.range(0, 100);
+        std::vector<uint32_t> work = v;
+        if (profiler::percentile(work.data(), n, pct) != reference_percentile(v, pct)) {
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(profiler::percentile(nullptr, 0, 50) == 0);
+    uint32_t single = 42;
+    CHECK(profiler::percentile(&single, 1, 0) == 42 && profiler::percentile(&single, 1, 100) == 42);
+}
+
+// Host: 1000 "Zyklen" pro µs, der Zähler läuft also nach 4.29 s über
+static void test_span_us_wrap() {
+    const uint32_t tpu = esp_rom_get_cpu_ticks_per_us();
+    CHECK(tpu == 1000);
+    // kurz: Zyklen zählen, der esp_timer ist dafür zu grob
+    CHECK(profiler::span_us(5999, 5) == 5);
+    // virtuelle Uhr im Replay steht oder springt zurück
+    CHECK(profiler::span_us(250000, 0) == 250);
+    CHECK(profiler::span_us(250000, -3000000) == 250);
+    // 10 s: die Zyklendifferenz ist übergelaufen, der esp_timer nicht
+    const uint64_t cycles = 10000000ull * tpu;
+    CHECK(profiler::span_us((uint32_t)cycles, 10000000) == 10000000);
+    // genau an der Grenze (halbe Überlaufzeit) übernimmt der esp_timer
+    const int64_t trusted = ((int64_t)1 << 31) / tpu;
+    CHECK(profiler::span_us((uint32_t)((trusted - 1) * tpu), trusted - 1) == (uint32_t)(trusted - 1));
+    CHECK(profiler::span_us(0, trusted) == (uint32_t)trusted);
+    // Begrenzung statt Abschneiden
+    CHECK(profiler::span_us(0, (int64_t)1 << 40) == UINT32_MAX);
+}
+
+static void test_record_summarize() {
+    profiler::summary_t s;
+    CHECK(!profiler::summarize(profiler::SPAN_SD_ROTATE, s) && s.count == 0);
+    const uint32_t n = profiler::WINDOW + 172;
+    uint64_t sum = 0;
+    for (uint32_t v = 1; v <= n; ++v) {
+        profiler::record(profiler::SPAN_SD_ROTATE, v);
+        sum += v;
+    }
+    CHECK(profiler::summarize(profiler::SPAN_SD_ROTATE, s));
+    CHECK(s.count == n && s.window == profiler::WINDOW);
+    // ausgewertet werden nur die letzten WINDOW Werte: 173..n
+    std::vector<uint32_t> last;
+    for (uint32_t v = n - profiler::WINDOW + 1; v <= n; ++v) {
+        last.push_back(v);
+    }
+    CHECK(s.p50_us == reference_percentile(last, 50));
+    CHECK(s.p95_us == reference_percentile(last, 95));
+    CHECK(s.max_us == n);
+    CHECK(s.total_us == sum);
+
+    // die Summe läuft über 32 Bit hinaus
+    profiler::record(profiler::SPAN_SD_FILE_TIME, UINT32_MAX);
+    profiler::record(profiler::SPAN_SD_FILE_TIME, UINT32_MAX);
+    CHECK(profiler::summarize(profiler::SPAN_SD_FILE_TIME, s));
+    CHECK(s.total_us == 2ull * UINT32_MAX && s.max_us == UINT32_MAX);
+}
+
+// Jeder Schritt ändert beide Hälften; ein halb gelesener Wert ist kein Vielfaches mehr
+// oder geht rückwärts
+static void test_running_total_concurrent() {
+    profiler::RunningTotal total;
+    constexpr uint32_t STEP = 0xFFFFFFFFu;
+    constexpr int ADDS = 300000;
+    std::atomic<bool> started{false};
+    std::atomic<bool> done{false};
+    int torn = 0;
+    int reads = 0;
+    std::thread reader([&] {
+        uint64_t prev = 0;
+        started.store(true, std::memory_order_release);
+        do {
+            const uint64_t v = total.load();
+            if (v % STEP != 0 || v < prev) {
+                torn++;
+            }
+            prev = v;
+            reads++;
+        } while (!done.load(std::memory_order_acquire));
+    });
+    while (!started.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    for (int i = 0; i < ADDS; ++i) {
+        total.add(STEP);
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+    CHECK(torn == 0);
+    CHECK(reads > 0);
+    CHECK(total.load() == (uint64_t)ADDS * STEP);
+}
+
+int main() {
+    profiler::init();
+    RUN_TEST(test_ring_wrap);
+    RUN_TEST(test_percentile_vs_sorted);
+    RUN_TEST(test_span_us_wrap);
+    RUN_TEST(test_record_summarize);
+    RUN_TEST(test_running_total_concurrent);
+    return TEST_RESULT();
+}
@@ -0,0 +1,243 @@
+// Tracker: IDs über Verdeckung und sich kreuzende Bahnen, Linienquerungen mit Hysterese
+
+#include <cmath>
+#include "host_test.hpp"
+#include "tracker.hpp"
+
+using tracking::Tracker;
+
+static constexpr int FRAME_W = 640;
+static constexpr int FRAME_H = 480;
+static constexpr float BOX = 40.0f;
+static constexpr int64_t SECOND_US = 1000000;
+
+static tracking::detection_t det_at(float cx, float cy, float score = 0.8f) {
+    return {{cx - BOX / 2, cy - BOX / 2, cx + BOX / 2, cy + BOX / 2}, score};
+}
+
+static Tracker make_tracker() {
+    Tracker tracker;
+    tracker.init(tracking::default_tracker_config(FRAME_W, FRAME_H));
+    return tracker;
+}
+
+// ID des Tracks, dessen letzte Position (cx, cy) ist; 0, wenn keiner dort steht
+static uint32_t id_at(const Tracker &tracker, float cx, float cy) {
+    for (int i = 0; i < tracker.count(); ++i) {
+        const tracking::track_t &t = tracker.track(i);
+        if (std::fabs(t.cx - cx) < 0.5f && std::fabs(t.cy - cy) < 0.5f) {
+            return t.id;
+        }
+    }
+    return 0;
+}
+
+// Senkrecht nach unten durch die Linie bei y = 240: ein Track, eine Querung IN
+static void test_single_flight_in() {
+    Tracker tracker = make_tracker();
+    int crossings = 0;
+    uint32_t id = 0;
+    for (int i = 0; i < 8; ++i) {
+        const tracking::detection_t d = det_at(320, 100 + 40.0f * i);
+        const int n = tracker.update(&d, 1, i * SECOND_US / 2);
+        for (int e = 0; e < n; ++e) {
+            CHECK(tracker.crossing(e).direction == tracking::DIRECTION_IN);
+            CHECK(tracker.crossing(e).track_id == id);
+        }
+        crossings += n;
+        CHECK(tracker.count() == 1);
+        if (i == 0) {
+            id = tracker.track(0).id;
+            CHECK(!tracker.track(0).confirmed);
+        } else {
+            CHECK(tracker.track(0).id == id);
+            CHECK(tracker.track(0).confirmed);
+        }
+    }
+    CHECK(crossings == 1);
+    CHECK(tracker.stats().tracks_created == 1);
+    CHECK(tracker.stats().crossings[tracking::DIRECTION_IN] == 1);
+    // 40 px pro 0,5 s
+    CHECK(std::fabs(tracker.track(0).vy - 80.0f) < 1.0f);
+}
+
+// Hummel verschwindet für drei Inferenzen (z.B. hinter einer Blüte) und taucht an der
+// vorhergesagten Stelle wieder auf: gleiche ID, die Querung während der Lücke zählt
+static void test_occlusion_keeps_id() {
+    Tracker tracker = make_tracker();
+    int crossings = 0;
+    int64_t t_us = 0;
+    for (int i = 0; i < 3; ++i, t_us += SECOND_US / 2) {
+        const tracking::detection_t d = det_at(320, 100 + 40.0f * i);
+        crossings += tracker.update(&d, 1, t_us);
+    }
+    const uint32_t id = tracker.track(0).id;
+    for (int i = 3; i < 6; ++i, t_us += SECOND_US / 2) {
+        crossings += tracker.update(nullptr, 0, t_us);
+        CHECK(tracker.count() == 1);
+        // Vorhersage läuft mit konstanter Geschwindigkeit weiter
+        const tracking::box_t p = Tracker::predict(tracker.track(0), t_us);
+        CHECK(std::fabs((p.y1 + p.y2) / 2 - (100 + 40.0f * i)) < 1.0f);
+    }
+    for (int i = 6; i < 9; ++i, t_us += SECOND_US / 2) {
+        const tracking::detection_t d = det_at(320, 100 + 40.0f * i);
+        crossings += tracker.update(&d, 1, t_us);
+        CHECK(tracker.count() == 1);
+        CHECK(tracker.track(0).id == id);
+    }
+    CHECK(crossings == 1);
+    CHECK(tracker.stats().tracks_created == 1);
+}
+
+// Länger als max_coast_us verschwunden: der alte Track ist weg, es gibt eine neue ID
+static void test_long_occlusion_new_id() {
+    Tracker tracker = make_tracker();
+    const tracking::detection_t d0 = det_at(200, 100);
+    const tracking::detection_t d1 = det_at(200, 120);
+    tracker.update(&d0, 1, 0);
+    tracker.update(&d1, 1, SECOND_US / 2);
+    const uint32_t id = tracker.track(0).id;
+    const int64_t coast = tracking::default_tracker_config(FRAME_W, FRAME_H).max_coast_us;
+
+    tracker.update(nullptr, 0, SECOND_US / 2 + coast);
+    CHECK(tracker.count() == 1);
+    tracker.update(nullptr, 0, SECOND_US / 2 + coast + 1);
+    CHECK(tracker.count() == 0);
+    tracker.update(&d1, 1, SECOND_US / 2 + coast + 2);
+    CHECK(tracker.count() == 1);
+    CHECK(tracker.track(0).id != id);
+}
+
+// Zwei Hummeln auf X-förmigen Bahnen, in einem Frame an genau derselben Stelle. Die
+// Vorhersage trennt sie danach wieder: jede behält ihre ID, beide queren einmal
+static void test_crossing_paths_keep_ids() {
+    Tracker tracker = make_tracker();
+    const float vx = 100.0f;
+    const float vy = 60.0f;
+    uint32_t id_a = 0;
+    uint32_t id_b = 0;
+    int crossings = 0;
+    for (int i = 0; i <= 18; ++i) {
+        const float t = i * 0.25f;
+        const float dt = t - 2.25f;  // Begegnung bei (320, 240) in Frame 9
+        const float ax = 320 + vx * dt;
+        const float bx = 320 - vx * dt;
+        const float y = 240 + vy * dt;
+        const tracking::detection_t dets[2] = {det_at(ax, y), det_at(bx, y)};
+        crossings += tracker.update(dets, 2, (int64_t)(t * SECOND_US));
+        if (i == 0) {
+            id_a = id_at(tracker, ax, y);
+            id_b = id_at(tracker, bx, y);
+            CHECK(id_a && id_b && id_a != id_b);
+        } else if (i != 9) {
+            CHECK(id_at(tracker, ax, y) == id_a);
+            CHECK(id_at(tracker, bx, y) == id_b);
+        }
+        CHECK(tracker.count() == 2);
+    }
+    CHECK(crossings == 2);
+    CHECK(tracker.stats().crossings[tracking::DIRECTION_IN] == 2);
+    CHECK(tracker.stats().tracks_created == 2);
+}
+
+// Gegenläufig auf fast derselben Höhe aneinander vorbei, eine der beiden kurz verdeckt
+static void test_passing_with_occlusion() {
+    Tracker tracker = make_tracker();
+    uint32_t id_a = 0;
+    uint32_t id_b = 0;
+    for (int i = 0; i <= 12; ++i) {
+        const int64_t t_us = i * SECOND_US / 2;
+        const float ax = 100 + 40.0f * i;
+        const float bx = 580 - 40.0f * i;
+        tracking::detection_t dets[2] = {det_at(ax, 100), det_at(bx, 110)};
+        // b ist in Frame 5 und 6 verdeckt, genau beim Vorbeiflug
+        const int count = (i == 5 || i == 6) ? 1 : 2;
+        tracker.update(dets, count, t_us);
+        if (i == 0) {
+            id_a = id_at(tracker, ax, 100);
+            id_b = id_at(tracker, bx, 110);
+            CHECK(id_a && id_b && id_a != id_b);
+        } else {
+            CHECK(id_at(tracker, ax, 100) == id_a);
+            if (count == 2) {
+                CHECK(id_at(tracker, bx, 110) == id_b);
+            }
+        }
+    }
+    CHECK(tracker.stats().tracks_created == 2);
+}
+
+// Innerhalb der Hysterese um die Linie zählt Zittern nicht als Querung
+static void test_line_hysteresis() {
+    Tracker tracker = make_tracker();
+    int64_t t_us = 0;
+    int in = 0;
+    int out = 0;
+    auto step = [&](float cy) {
+        const tracking::detection_t d = det_at(320, cy);
+        const int n = tracker.update(&d, 1, t_us);
+        for (int e = 0; e < n; ++e) {
+            (tracker.crossing(e).direction == tracking::DIRECTION_IN ? in : out)++;
+        }
+        t_us += SECOND_US / 4;
+    };
+    for (float y = 200; y <= 252; y += 4) {
+        step(y);
+    }
+    CHECK(in == 1);
+    CHECK(out == 0);
+    // ±5 px um die Linie, Hysterese 8 px
+    for (int i = 0; i < 20; ++i) {
+        step(i % 2 ? 235.0f : 245.0f);
+    }
+    CHECK(in == 1);
+    CHECK(out == 0);
+    for (float y = 236; y >= 200; y -= 4) {
+        step(y);
+    }
+    CHECK(in == 1);
+    CHECK(out == 1);
+    CHECK(tracker.stats().tracks_created == 1);
+}
+
+// Ein einzelner Treffer bestätigt keinen Track und zählt keine Querung
+static void test_unconfirmed_no_crossing() {
+    Tracker tracker = make_tracker();
+    const tracking::detection_t above = det_at(100, 200);
+    const tracking::detection_t below = det_at(500, 300);
+    CHECK(tracker.update(&above, 1, 0) == 0);
+    // Zu weit für den Suchradius: neuer Track statt Querung
+    CHECK(tracker.update(&below, 1, SECOND_US / 2) == 0);
+    CHECK(tracker.stats().tracks_created == 2);
+    CHECK(tracker.stats().tracks_confirmed == 0);
+}
+
+static void test_capacity() {
+    Tracker tracker = make_tracker();
+    tracking::detection_t dets[tracking::MAX_DETECTIONS];
+    for (int i = 0; i < tracking::MAX_DETECTIONS; ++i) {
+        dets[i] = det_at(30 + 36.0f * i, 60);
+    }
+    tracker.update(dets, tracking::MAX_DETECTIONS, 0);
+    CHECK(tracker.count() == tracking::MAX_TRACKS);
+    // Alle Plätze belegt: eine weitere Hummel weit weg wird verworfen
+    for (int i = 0; i < tracking::MAX_DETECTIONS; ++i) {
+        dets[i] = det_at(30 + 36.0f * i, 60);
+    }
+    dets[0] = det_at(320, 420);
+    tracker.update(dets, tracking::MAX_DETECTIONS, SECOND_US / 2);
+    CHECK(tracker.count() == tracking::MAX_TRACKS);
+    CHECK(tracker.stats().dropped == 1);
+}
+
+int main() {
+    RUN_TEST(test_single_flight_in);
+    RUN_TEST(test_occlusion_keeps_id);
+    RUN_TEST(test_long_occlusion_new_id);
+    RUN_TEST(test_crossing_paths_keep_ids);
+    RUN_TEST(test_passing_with_occlusion);
+    RUN_TEST(test_line_hysteresis);
+    RUN_TEST(test_unconfirmed_no_crossing);
+    RUN_TEST(test_capacity);
+    return TEST_RESULT();
+}
@@ -0,0 +1,371 @@
+// Write-behind: SpscRing über viele Umläufe und mit zwei Threads, BatchFile gegen eine
+// dateibasierte Karte (PosixBackend), die Offset und Länge jedes Schreibzugriffs mitschreibt
+
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "host_test.hpp"
+#include "storage_posix.hpp"
+#include "write_behind.hpp"
+
+using writebehind::BatchFile;
+using writebehind::SpscRing;
+
+// --------- SpscRing ----------------------------------
+
+static bool push_one(SpscRing &ring, const std::vector<uint8_t> &rec) {
+    const void *parts[1] = {rec.data()};
+    const uint32_t lens[1] = {(uint32_t)rec.size()};
+    return ring.push(parts, lens, 1);
+}
+
+static void test_ring_init() {
+    alignas(4) static uint8_t mem[1000];
+    SpscRing ring;
+    CHECK(!ring.init(nullptr, sizeof(mem)));
+    CHECK(!ring.init(mem, 63));
+    CHECK(!ring.init(mem + 1, 512));
+    CHECK(ring.init(mem, sizeof(mem)));
+    CHECK(ring.capacity() == 512);
+    CHECK(ring.max_record() == 252);
+    uint32_t len = 0;
+    CHECK(ring.peek(len) == nullptr);
+}
+
+// Ein Record aus mehreren Teilen kommt am Stück heraus
+static void test_ring_parts() {
+    alignas(4) static uint8_t mem[256];
+    SpscRing ring;
+    CHECK(ring.init(mem, sizeof(mem)));
+    const char head[] = "head";
+    const char body[] = "0123456789";
+    const void *parts[2] = {head, body};
+    const uint32_t lens[2] = {4, 10};
+    CHECK(ring.push(parts, lens, 2));
+    CHECK(ring.records() == 1);
+    uint32_t len = 0;
+    const uint8_t *p = ring.peek(len);
+    CHECK(p && len == 14 && memcmp(p, "head0123456789", 14) == 0);
+    ring.pop();
+    CHECK(ring.records() == 0);
+    CHECK(ring.used() == 0);
+}
+
+// Zufällige Längen über viele Umläufe, gegen eine Referenz-Queue: Reihenfolge, Inhalt,
+// Lücke am Ringende und Ablehnung bei vollem Ring
+static void test_ring_wrap() {
+    alignas(4) static uint8_t mem[256];
+    SpscRing ring;
+    CHECK(ring.init(mem, sizeof(mem)));
+    hosttest::Rng rng(3);
+    std::deque<std::vector<uint8_t>> expected;
+    uint32_t rejected = 0;
+    for (int i = 0; i < 20000; ++i) {
+        if (rng.next() % 3) {
+            std::vector<uint8_t> rec((size_t)rng.range(1, (int)ring.max_record()));
+            for (auto &b : rec) {
+                b = (uint8_t)rng.next();
+            }
+            const size_t used = ring.used();
+            if (push_one(ring, rec)) {
+                expected.push_back(rec);
+            } else {
+                // Der leere Ring nimmt jeden Record bis max_record, auch mit Lücke am Ende
+                CHECK(used > 0);
+                CHECK(ring.used() == used);
+                rejected++;
+            }
+        } else {
+            uint32_t len = 0;
+            const uint8_t *p = ring.peek(len);
+            CHECK((p != nullptr) == !expected.empty());
+            if (p) {
+                CHECK(len == expected.front().size());
+                CHECK(memcmp(p, expected.front().data(), len) == 0);
+                ring.pop();
+                expected.pop_front();
+            }
+        }
+        CHECK(ring.records() == expected.size());
+        CHECK(ring.used() <= ring.capacity());
+    }
+    CHECK(rejected > 0);
+    while (!expected.empty()) {
+        uint32_t len = 0;
+        CHECK(ring.peek(len));
+        ring.pop();
+        expected.pop_front();
+    }
+    // Zu groß passt nie, auch nicht in den leeren Ring
+    CHECK(!push_one(ring, std::vector<uint8_t>(ring.max_record() + 1)));
+    CHECK(push_one(ring, std::vector<uint8_t>(ring.max_record())));
+    CHECK(ring.stats().pushed == ring.stats().popped + 1);
+    CHECK(ring.stats().max_used <= ring.capacity());
+}
+
+// Produzent und Konsument in eigenen Threads wie Pipeline und Storage-Task
+static void test_ring_threads() {
+    alignas(4) static uint8_t mem[4096];
+    SpscRing ring;
+    CHECK(ring.init(mem, sizeof(mem)));
+    const uint32_t count = 50000;
+
+    std::thread producer([&] {
+        hosttest::Rng rng(5);
+        uint8_t buf[1024];
+        for (uint32_t seq = 0; seq < count; ++seq) {
+            const uint32_t len = 4 + (uint32_t)rng.range(0, 1000);
+            memcpy(buf, &seq, 4);
+            for (uint32_t i = 4; i < len; ++i) {
+                buf[i] = (uint8_t)(seq + i);
+            }
+            const void *parts[1] = {buf};
+            while (!ring.push(parts, &len, 1)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t next = 0;
+    uint32_t bad = 0;
+    while (next < count) {
+        uint32_t len = 0;
+        const uint8_t *p = ring.peek(len);
+        if (!p) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t seq = 0;
+        memcpy(&seq, p, 4);
+        bad += seq != next;
+        for (uint32_t i = 4; i < len; ++i) {
+            bad += p[i] != (uint8_t)(seq + i);
+        }
+        ring.pop();
+        next++;
+    }
+    producer.join();
+    CHECK(bad == 0);
+    CHECK(ring.records() == 0);
+    CHECK(ring.stats().popped == count);
+}
+
+// --------- BatchFile ----------------------------------
+
+// Dateibasierte Karte: PosixBackend, dessen Streams Offset und Länge jedes Schreibzugriffs
+// mitschreiben, bevor er an die Datei geht
+class RecordingCard : public storage::PosixBackend {
+public:
+    struct write_t {
+        uint64_t offset;
+        uint32_t len;
+    };
+
+    explicit RecordingCard(const char *root) : PosixBackend(root) {}
+
+    FILE *open(const char *path, const char *mode) override {
+        FILE *inner = PosixBackend::open(path, mode);
+        if (!inner) {
+            return nullptr;
+        }
+        setvbuf(inner, nullptr, _IONBF, 0);
+        stream_t *s = new stream_t{this, inner, 0};
+        FILE *f = fopencookie(s, mode, {read_fn, write_fn, seek_fn, close_fn});
+        if (!f) {
+            fclose(inner);
+            delete s;
+            return nullptr;
+        }
+        m_inner[f] = inner;
+        return f;
+    }
+    bool sync(FILE *f) override { return fflush(f) == 0 && PosixBackend::sync(m_inner[f]); }
+    bool truncate(FILE *f, uint32_t size) override {
+        return fflush(f) == 0 && PosixBackend::truncate(m_inner[f], size);
+    }
+
+    std::vector<write_t> writes;
+
+private:
+    struct stream_t {
+        RecordingCard *card;
+        FILE *inner;
+        uint64_t pos;
+    };
+
+    static ssize_t read_fn(void *c, char *buf, size_t size) {
+        stream_t *s = static_cast<stream_t *>(c);
+        const size_t n = fread(buf, 1, size, s->inner);
+        s->pos += n;
+        return (ssize_t)n;
+    }
+    static ssize_t write_fn(void *c, const char *buf, size_t size) {
+        stream_t *s = static_cast<stream_t *>(c);
+        s->card->writes.push_back({s->pos, (uint32_t)size});
+        const size_t n = fwrite(buf, 1, size, s->inner);
+        s->pos += n;
+        return n ? (ssize_t)n : -1;
+    }
+    static int seek_fn(void *c, off64_t *offset, int whence) {
+        stream_t *s = static_cast<stream_t *>(c);
+        if (fseeko(s->inner, *offset, whence) != 0) {
+            return -1;
+        }
+        *offset = ftello(s->inner);
+        s->pos = (uint64_t)*offset;
+        return 0;
+    }
+    static int close_fn(void *c) {
+        stream_t *s = static_cast<stream_t *>(c);
+        const int rc = fclose(s->inner);
+        delete s;
+        return rc;
+    }
+
+    std::unordered_map<FILE *, FILE *> m_inner;
+};
+
+static constexpr uint32_t UNIT = 512;
+
+static std::vector<uint8_t> read_back(RecordingCard &card, const char *path) {
+    std::vector<uint8_t> data;
+    FILE *f = fopen(card.host_path(path).c_str(), "rb");
+    if (f) {
+        uint8_t buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            data.insert(data.end(), buf, buf + n);
+        }
+        fclose(f);
+    }
+    return data;
+}
+
+// Ohne sync() gehen nur volle Puffer an die Karte, jeweils ab einer unit-Grenze
+static void test_batch_full_blocks() {
+    hosttest::TempDir dir;
+    RecordingCard card(dir.path.c_str());
+    CHECK(card.mount());
+    FILE *f = card.open("/sdcard/batch.bin", "w+b");
+    CHECK(f);
+    setvbuf(f, nullptr, _IONBF, 0);
+    std::vector<uint8_t> buf(4 * UNIT);
+    BatchFile batch;
+    CHECK(!batch.attach(f, 0, buf.data(), 4 * UNIT + 1, UNIT, &card));
+    CHECK(batch.attach(f, 0, buf.data(), (uint32_t)buf.size(), UNIT, &card));
+
+    hosttest::Rng rng(21);
+    std::vector<uint8_t> expected;
+    while (expected.size() < 20 * buf.size() + 100) {
+        std::vector<uint8_t> chunk((size_t)rng.range(1, 3000));
+        for (auto &b : chunk) {
+            b = (uint8_t)rng.next();
+        }
+        CHECK(batch.write(chunk.data(), (uint32_t)chunk.size()));
+        expected.insert(expected.end(), chunk.begin(), chunk.end());
+    }
+    CHECK(batch.offset() == expected.size());
+    const size_t full = expected.size() / buf.size();
+    CHECK(card.writes.size() == full);
+    for (size_t i = 0; i < card.writes.size(); ++i) {
+        CHECK(card.writes[i].offset == i * buf.size());
+        CHECK(card.writes[i].len == buf.size());
+    }
+    CHECK(batch.stats().writes == full);
+    CHECK(batch.stats().rewritten == 0);
+
+    CHECK(batch.sync());
+    CHECK(fclose(f) == 0);
+    CHECK(read_back(card, "/sdcard/batch.bin") == expected);
+}
+
+// sync() schreibt den angebrochenen Block, der nächste Schreibzugriff beginnt wieder an
+// dessen unit-Grenze und wiederholt ihn. Die Datei ist nach jedem sync() vollständig.
+static void test_batch_sync_rewrites_partial_block() {
+    hosttest::TempDir dir;
+    RecordingCard card(dir.path.c_str());
+    CHECK(card.mount());
+    FILE *f = card.open("/sdcard/batch.bin", "w+b");
+    CHECK(f);
+    setvbuf(f, nullptr, _IONBF, 0);
+    std::vector<uint8_t> buf(4 * UNIT);
+    BatchFile batch;
+    CHECK(batch.attach(f, 0, buf.data(), (uint32_t)buf.size(), UNIT, &card));
+
+    hosttest::Rng rng(23);
+    std::vector<uint8_t> expected;
+    for (int round = 0; round < 30; ++round) {
+        std::vector<uint8_t> chunk((size_t)rng.range(1, 2500));
+        for (auto &b : chunk) {
+            b = (uint8_t)rng.next();
+        }
+        CHECK(batch.write(chunk.data(), (uint32_t)chunk.size()));
+        expected.insert(expected.end(), chunk.begin(), chunk.end());
+        const size_t before = card.writes.size();
+        CHECK(batch.sync());
+        CHECK(card.writes.size() >= before);
+        CHECK(read_back(card, "/sdcard/batch.bin") == expected);
+    }
+    // Jeder Schreibzugriff beginnt an einer unit-Grenze; nur der letzte vor einem sync()
+    // darf kürzer als ein Vielfaches von unit sein
+    for (const auto &w : card.writes) {
+        CHECK(w.offset % UNIT == 0);
+        CHECK(w.len <= buf.size());
+    }
+    CHECK(batch.stats().syncs == 30);
+    CHECK(batch.stats().rewritten > 0);
+    CHECK(batch.stats().bytes >= expected.size());
+    CHECK(fclose(f) == 0);
+}
+
+// attach() mitten in einem Block liest dessen Anfang zurück und schreibt ihn mit
+static void test_batch_attach_unaligned() {
+    hosttest::TempDir dir;
+    RecordingCard card(dir.path.c_str());
+    CHECK(card.mount());
+    hosttest::Rng rng(29);
+    std::vector<uint8_t> expected(UNIT + 100);
+    for (auto &b : expected) {
+        b = (uint8_t)rng.next();
+    }
+    CHECK(card.write_file("/sdcard/batch.bin", expected.data(), expected.size()));
+
+    FILE *f = card.open("/sdcard/batch.bin", "r+b");
+    CHECK(f);
+    setvbuf(f, nullptr, _IONBF, 0);
+    card.writes.clear();
+    std::vector<uint8_t> buf(2 * UNIT);
+    BatchFile batch;
+    CHECK(batch.attach(f, (uint32_t)expected.size(), buf.data(), (uint32_t)buf.size(), UNIT, &card));
+    CHECK(batch.offset() == expected.size());
+
+    std::vector<uint8_t> more(3 * UNIT);
+    for (auto &b : more) {
+        b = (uint8_t)rng.next();
+    }
+    CHECK(batch.write(more.data(), (uint32_t)more.size()));
+    CHECK(batch.sync());
+    expected.insert(expected.end(), more.begin(), more.end());
+    CHECK(!card.writes.empty());
+    if (!card.writes.empty()) {
+        CHECK(card.writes.front().offset == UNIT);
+    }
+    for (const auto &w : card.writes) {
+        CHECK(w.offset % UNIT == 0);
+    }
+    CHECK(fclose(f) == 0);
+    CHECK(read_back(card, "/sdcard/batch.bin") == expected);
+}
+
+int main() {
+    RUN_TEST(test_ring_init);
+    RUN_TEST(test_ring_parts);
+    RUN_TEST(test_ring_wrap);
+    RUN_TEST(test_ring_threads);
+    RUN_TEST(test_batch_full_blocks);
+    RUN_TEST(test_batch_sync_rewrites_partial_block);
+    RUN_TEST(test_batch_attach_unaligned);
+    return TEST_RESULT();
+}
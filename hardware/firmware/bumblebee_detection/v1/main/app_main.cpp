@@ -1,13 +1,23 @@
 
 #include "esp_imgfx_crop.h"
 #include "dl_image.hpp"
-#define MODEL_IMG_SIZE 224
+#define SCORE_THR 0.35f
+#define STATS_INTERVAL_MS 30000
 #include <stdio.h>
 #include <algorithm>
 #include "bumblebee_detect.hpp"
 #include "esp_camera.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "sd_card.hpp"
+#include "storage_sdspi.hpp"
+#include "frame_lease.hpp"
+#include "detector_service.hpp"
+#include "pipeline.hpp"
+#include "model_registry.hpp"
+#include "mem_telemetry.hpp"
+#include "rgb565_roi.hpp"
+#include "roi_bench.hpp"
 #include <esp_system.h>
 #include <string.h>
 #include <vector>
@@ -15,13 +25,30 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "include/camera_pins.h"
-#include "dl_image_draw.hpp"
-#include "dl_image_color.hpp"
 
 extern const uint8_t bumblebee_jpg_start[] asm("_binary_bumblebee_jpg_start");
 extern const uint8_t bumblebee_jpg_end[] asm("_binary_bumblebee_jpg_end");
 const char *TAG = "bumblebee_detect";
 
+#if CONFIG_BEESENSE_CAPTURE_JPEG
+// Sensor komprimiert, die Pipeline dekodiert nur den ROI (pipeline::CAPTURE_JPEG)
+#define CAMERA_PIXEL_FORMAT PIXFORMAT_JPEG
+#if CONFIG_BEESENSE_CAPTURE_JPEG_SVGA
+#define CAMERA_FRAME_SIZE FRAMESIZE_SVGA
+#elif CONFIG_BEESENSE_CAPTURE_JPEG_VGA
+#define CAMERA_FRAME_SIZE FRAMESIZE_VGA
+#else
+#define CAMERA_FRAME_SIZE FRAMESIZE_QVGA
+#endif
+#define CAMERA_JPEG_QUALITY CONFIG_BEESENSE_CAPTURE_JPEG_QUALITY
+#define CAMERA_FB_COUNT CONFIG_BEESENSE_CAPTURE_FB_COUNT
+#else
+#define CAMERA_PIXEL_FORMAT PIXFORMAT_RGB565
+#define CAMERA_FRAME_SIZE FRAMESIZE_QVGA
+#define CAMERA_JPEG_QUALITY 8
+#define CAMERA_FB_COUNT 2
+#endif
+
 // Camera Module pin mapping
 static camera_config_t camera_config = {
     .pin_pwdn = PWDN_GPIO_NUM,
@@ -47,14 +74,14 @@ static camera_config_t camera_config = {
     .ledc_timer = LEDC_TIMER_0,
     .ledc_channel = LEDC_CHANNEL_0,
 
-    .pixel_format = PIXFORMAT_RGB565, // PIXFORMAT_RGB565 , PIXFORMAT_JPEG
-    .frame_size = FRAMESIZE_QVGA, // [<<320x240>> (QVGA, 4:3); FRAMESIZE_320X320, 240x176 (HQVGA, 15:11); 400x296 (CIF,
+    .pixel_format = CAMERA_PIXEL_FORMAT, // PIXFORMAT_RGB565 , PIXFORMAT_JPEG
+    .frame_size = CAMERA_FRAME_SIZE, // [<<320x240>> (QVGA, 4:3); FRAMESIZE_320X320, 240x176 (HQVGA, 15:11); 400x296 (CIF,
                                   // 50:37)],FRAMESIZE_QVGA,FRAMESIZE_VGA
 
-    .jpeg_quality = 8, // 0-63 lower number means higher quality.  Reduce quality if stack overflow in cam_task
-    .fb_count = 2,     // if more than one, i2s runs in continuous mode. Use only with JPEG
+    .jpeg_quality = CAMERA_JPEG_QUALITY, // 0-63 lower number means higher quality.  Reduce quality if stack overflow in cam_task
+    .fb_count = CAMERA_FB_COUNT,     // if more than one, i2s runs in continuous mode. Use only with JPEG
     .fb_location = CAMERA_FB_IN_PSRAM,
-    .grab_mode = CAMERA_GRAB_WHEN_EMPTY,
+    .grab_mode = CAMERA_GRAB_LATEST, // DMA füllt den freien Puffer weiter, solange ein Frame geleast ist
     .sccb_i2c_port = 0 // optional
 };
 
@@ -68,77 +95,15 @@ static esp_err_t init_camera(void)
     return err;
 }
 
-// Hilfsfunktion: Bild aufnehmen, croppen und in RGB888 konvertieren
-static bool capture_and_convert_image(dl::image::img_t &cropped_img) {
-    camera_fb_t *pic = esp_camera_fb_get();
-    if (!pic) {
-        ESP_LOGE("CAM", "Failed to capture image");
-        return false;
-    }
-    dl::image::img_t img;
-    img.height = pic->height;
-    img.width = pic->width;
-    img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565;
-    img.data = malloc(pic->len);
-    if (!img.data) {
-        ESP_LOGE("MEM", "Memory allocation failed");
-        esp_camera_fb_return(pic);
-        return false;
-    }
-
-    memcpy(img.data, pic->buf, pic->len);
-    esp_camera_fb_return(pic);
-
-    // RGB565 -> RGB888 (ohne Crop)
-    dl::image::img_t rgb888_img;
-    rgb888_img.height = img.height;
-    rgb888_img.width = img.width;
-    rgb888_img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB888;
-    rgb888_img.data = malloc(img.width * img.height * 3);
-    if (!rgb888_img.data) {
-        ESP_LOGE("MEM", "Failed to allocate rgb888 buffer");
-        free(img.data);
-        return false;
-    }
-    dl::image::RGB5652RGB888<true, false> converter;
-    uint8_t* src = (uint8_t*)img.data;
-    uint8_t* dst = (uint8_t*)rgb888_img.data;
-    for (int i = 0; i < img.width * img.height; ++i) {
-        converter(src, dst);
-        src += 2;
-        dst += 3;
-    }
-
-    // Crop auf 224x224
-    cropped_img.height = MODEL_IMG_SIZE;
-    cropped_img.width = MODEL_IMG_SIZE;
-    cropped_img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB888;
-    cropped_img.data = malloc(MODEL_IMG_SIZE * MODEL_IMG_SIZE * 3);
-    if (!cropped_img.data) {
-        ESP_LOGE("MEM", "Failed to allocate cropped buffer");
-        free(img.data);
-        free(rgb888_img.data);
-        return false;
-    }
-    int x0 = (rgb888_img.width - MODEL_IMG_SIZE) / 2;
-    int y0 = (rgb888_img.height - MODEL_IMG_SIZE) / 2;
-    for (int y = 0; y < MODEL_IMG_SIZE; ++y) {
-        int src_y = y0 + y;
-        memcpy(
-            (uint8_t*)cropped_img.data + y * MODEL_IMG_SIZE * 3,
-            (uint8_t*)rgb888_img.data + (src_y * rgb888_img.width + x0) * 3,
-            MODEL_IMG_SIZE * 3);
-    }
-
-    free(img.data);
-    free(rgb888_img.data);
-    return true;
-}
-
 extern "C" void app_main(void)
 {
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+    // Ausgangsstand vor SD, Kamera und Modell
+    memtel::init(CONFIG_BEESENSE_MEM_WARN_MARGIN);
+#endif
     ESP_LOGI("SD", "Mounting SD card...");
-    bool mounted = sdcard::init();
+    static storage::SdspiBackend sd;
+    bool mounted = sdcard::init(sd);
     if (!mounted) {
         ESP_LOGE("SD", "SD card init/mount failed");
         return;
@@ -149,59 +114,78 @@ extern "C" void app_main(void)
         return;
     }
 
+#if CONFIG_BEESENSE_ROI_BENCH
+    {
+        // QVGA-Frame und 224er-Ausschnitt im PSRAM, wie Framebuffer und ROI-Slot im Betrieb
+        uint8_t *frame = static_cast<uint8_t *>(heap_caps_malloc(320 * 240 * 2, MALLOC_CAP_SPIRAM));
+        uint8_t *roi = static_cast<uint8_t *>(heap_caps_malloc(224 * 224 * 3, MALLOC_CAP_SPIRAM));
+        if (frame && roi) {
+            memset(frame, 0x5A, 320 * 240 * 2);
+            imgconv::log_roi_bench(imgconv::bench_rgb565_roi(frame, 320, 240, 224, roi, 20));
+        }
+        heap_caps_free(frame);
+        heap_caps_free(roi);
+    }
+#endif
+
+    // PIE-Kern der ROI-Konvertierung erst nach dem Benchmark, der den wortweisen Pfad misst
+    if (imgconv::enable_pie_kernel()) {
+        ESP_LOGI("APP", "ROI conversion uses the PIE kernel");
+    } else {
+#if CONFIG_IDF_TARGET_ESP32S3
+        ESP_LOGW("APP", "PIE kernel differs from the reference, ROI conversion stays word-wise");
+#endif
+    }
+
 #if CONFIG_BUMBLEBEE_DETECT_MODEL_IN_SDCARD
     ESP_ERROR_CHECK(bsp_sdcard_mount());
 #endif
 
-    
-    while (true) {
-        ESP_LOGI("MEM", "Free heap at start of loop: %lu bytes", esp_get_free_heap_size());
-
-        dl::image::img_t cropped_img;
-        if (!capture_and_convert_image(cropped_img)) {
-            ESP_LOGE("CAM", "Could not take or convert picture");
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            continue;
-        }
+    // Modell einmalig laden und mit dem eingebetteten Referenzbild aufwärmen
+    detector::cascade_config_t cascade = {};
+#if CONFIG_BEESENSE_CASCADE
+    cascade.enabled = true;
+    cascade.screen_thr = CONFIG_BEESENSE_CASCADE_SCREEN_THR / 100.0f;
+#if CONFIG_BEESENSE_CASCADE_REFINE
+    cascade.refine = true;
+    cascade.refine_margin = CONFIG_BEESENSE_CASCADE_REFINE_MARGIN;
+    cascade.refine_min_size = 96;
+#endif
+#endif
+    static detector::DetectorService detector(SCORE_THR, cascade);
+    bumblebee_detect::log_models();
+#if CONFIG_BEESENSE_INFER_BUDGET_MS
+    detector.use_model(bumblebee_detect::select_model(CONFIG_BEESENSE_INFER_BUDGET_MS));
+#endif
+    dl::image::jpeg_img_t warmup_jpeg = {
+        .data = (void *)bumblebee_jpg_start,
+        .data_len = (size_t)(bumblebee_jpg_end - bumblebee_jpg_start),
+    };
+    if (!detector.start(&warmup_jpeg)) {
+        ESP_LOGE("APP", "Detector initialization failed");
+        return;
+    }
 
-        BumblebeeDetect *detect = new BumblebeeDetect();
-        auto &detect_results = detect->run(cropped_img);
-        int result_count = 0;
-        // BBoxen auf das 224x224 Bild zeichnen (gelb)
-        for (const auto &res : detect_results) {
-            if (res.category == 0 && res.score > 0.35f) {
-                ESP_LOGI(TAG,
-                         "[category: %d, score: %f, x1: %d, y1: %d, x2: %d, y2: %d]",
-                         res.category,
-                         res.score,
-                         res.box[0],
-                         res.box[1],
-                         res.box[2],
-                         res.box[3]);
-                int x1 = res.box[0];
-                int y1 = res.box[1];
-                int x2 = res.box[2];
-                int y2 = res.box[3];
-                // Sortiere die Koordinaten, damit x1 < x2 und y1 < y2
-                if (x2 < x1) std::swap(x1, x2);
-                if (y2 < y1) std::swap(y1, y2);
-                std::vector<uint8_t> color = {255, 0, 0}; // Rot
-                dl::image::draw_hollow_rectangle(cropped_img, x1, y1, x2, y2, color, 2);
-                ++result_count;
-            }
-        }
-        if (result_count == 0) {
-            ESP_LOGI(TAG, "Detection done, nothing detected (class 0 & score > 0.35)");
-        } else {
-            ESP_LOGI(TAG, "Detection done, results: %d", result_count);
-        }
-        // Bild mit BBoxen speichern
-        dl::cls::result_t dummy_result = {};
-        sdcard::save_detected_jpeg(cropped_img, dummy_result, "/sdcard/bumblebee_detect");
-        delete detect;
-        heap_caps_free(cropped_img.data);
+    pipeline::config_t pipeline_cfg = pipeline::default_config();
+    if (!pipeline::start(pipeline_cfg, &detector)) {
+        ESP_LOGE("APP", "Pipeline start failed");
+        return;
+    }
 
-        vTaskDelay(pdMS_TO_TICKS(2000));
+    // Die Stufen laufen in eigenen Tasks, hier nur noch periodische Statistik
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(STATS_INTERVAL_MS));
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+        memtel::log_report();
+#else
+        ESP_LOGI("MEM", "Free heap: %lu bytes", esp_get_free_heap_size());
+#endif
+        pipeline::log_stats();
+        camera::log_lease_stats();
+        detector.log_stats();
+#if CONFIG_BEESENSE_INFER_BUDGET_MS
+        detector.apply_budget(CONFIG_BEESENSE_INFER_BUDGET_MS);
+#endif
     }
 
 #if CONFIG_BUMBLEBEE_DETECT_MODEL_IN_SDCARD
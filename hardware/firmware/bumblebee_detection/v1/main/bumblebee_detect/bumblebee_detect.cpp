@@ -1,28 +1,67 @@
 #include "bumblebee_detect.hpp"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <filesystem>
+#include <string>
 
 #if CONFIG_BUMBLEBEE_DETECT_MODEL_IN_FLASH_RODATA
 extern const uint8_t bumblebee_detect_espdl[] asm("_binary_bumblebee_detect_espdl_start");
 static const char *path = (const char *)bumblebee_detect_espdl;
 #elif CONFIG_BUMBLEBEE_DETECT_MODEL_IN_FLASH_PARTITION
 static const char *path = "bumblebee_det";
-#else
+#endif
 #if !defined(CONFIG_BSP_SD_MOUNT_POINT)
 #define CONFIG_BSP_SD_MOUNT_POINT "/sdcard"
 #endif
-#endif
 namespace bumblebee_detect {
-ESPDet::ESPDet(const char *model_name, float score_thr, float nms_thr)
+static const char *TAG = "bumblebee_detect";
+
+// Normalisierung wie beim ImagePreprocessor unten
+static const float INPUT_MEAN[3] = {0, 0, 0};
+static const float INPUT_STD[3] = {255, 255, 255};
+
+static heap_mark_t heap_mark()
 {
+    static const uint32_t caps[2] = {MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_SPIRAM};
+    heap_mark_t mark;
+    for (int i = 0; i < 2; ++i) {
+        mark.free[i] = heap_caps_get_free_size(caps[i]);
+        mark.largest[i] = heap_caps_get_largest_free_block(caps[i]);
+        mark.min_free[i] = heap_caps_get_minimum_free_size(caps[i]);
+    }
+    return mark;
+}
+
+ESPDet::ESPDet(const model_info_t &info, float score_thr, float nms_thr)
+{
+    m_load_marks.before = heap_mark();
 #if !CONFIG_BUMBLEBEE_DETECT_MODEL_IN_SDCARD
     m_model =
-        new dl::Model(path, model_name, static_cast<fbs::model_location_type_t>(CONFIG_BUMBLEBEE_DETECT_MODEL_LOCATION));
+        new dl::Model(path, info.name, static_cast<fbs::model_location_type_t>(CONFIG_BUMBLEBEE_DETECT_MODEL_LOCATION));
 #else
-    auto sd_path = std::filesystem::path(CONFIG_BSP_SD_MOUNT_POINT) / CONFIG_BUMBLEBEE_DETECT_MODEL_SDCARD_DIR / model_name;
+    auto sd_path = std::filesystem::path(CONFIG_BSP_SD_MOUNT_POINT) / CONFIG_BUMBLEBEE_DETECT_MODEL_SDCARD_DIR / info.name;
     m_model = new dl::Model(sd_path.c_str(), fbs::MODEL_LOCATION_IN_SDCARD);
 #endif
+    m_load_marks.loaded = heap_mark();
+    // dl::Model meldet einen Ladefehler nur im Log und hat dann keine Inputs
+    if (m_model->get_inputs().empty()) {
+        ESP_LOGE(TAG, "Could not load %s", info.name);
+        m_image_preprocessor = nullptr;
+        m_postprocessor = nullptr;
+        return;
+    }
+    if (!matches_manifest(info)) {
+        m_image_preprocessor = nullptr;
+        m_postprocessor = nullptr;
+        return;
+    }
+    m_valid = true;
     m_model->minimize();
+    m_load_marks.minimized = heap_mark();
 #if CONFIG_IDF_TARGET_ESP32P4
     m_image_preprocessor = new dl::image::ImagePreprocessor(m_model, {0, 0, 0}, {255, 255, 255});
 #else
@@ -31,16 +70,303 @@ ESPDet::ESPDet(const char *model_name, float score_thr, float nms_thr)
 #endif
     m_image_preprocessor->enable_letterbox({114, 114, 114});
     m_postprocessor = new dl::detect::ESPDetPostProcessor(
-        m_model, m_image_preprocessor, score_thr, nms_thr, 10, {{8, 8, 4, 4}, {16, 16, 8, 8}, {32, 32, 16, 16}});
+        m_model, m_image_preprocessor, score_thr, nms_thr, info.top_k, info.strides);
+#if CONFIG_BUMBLEBEE_DETECT_DIRECT_PREPROCESS
+    init_direct_preprocess();
+#endif
+#if CONFIG_BUMBLEBEE_DETECT_QUANT_POSTPROCESS
+    // Budget je Ergebnisplatz: ab top_k Kandidaten bricht die Suche früh ab
+    m_quant_post = new ESPDetQuantPostProcessor(score_thr, nms_thr, info.top_k, info.strides,
+                                                CONFIG_BUMBLEBEE_DETECT_CANDIDATES_PER_BOX * info.top_k);
+#endif
+}
+
+ESPDet::~ESPDet()
+{
+    delete m_quant_post;
+}
+
+// Das Manifest ist einkompiliert, das Modell kommt aus Partition, rodata oder von der SD-Karte.
+// Passen Input-Größe oder Heads nicht zum Eintrag, wären Strides und Skalierung falsch.
+bool ESPDet::matches_manifest(const model_info_t &info)
+{
+    const dl::TensorBase *input = m_model->get_inputs().begin()->second;
+    const std::vector<int> &in = input->shape;  // NHWC
+    if (in.size() != 4 || in[1] != info.input_height || in[2] != info.input_width) {
+        ESP_LOGE(TAG, "%s: model input %dx%d, manifest expects %dx%d", info.name, in.size() == 4 ? in[2] : -1,
+                 in.size() == 4 ? in[1] : -1, info.input_width, info.input_height);
+        return false;
+    }
+    if (strcmp(info.quant, "int8") == 0 && input->dtype != dl::DATA_TYPE_INT8) {
+        ESP_LOGE(TAG, "%s: model input is not int8 as listed in the manifest", info.name);
+        return false;
+    }
+    auto outputs = m_model->get_outputs();
+    for (size_t i = 0; i < info.strides.size(); ++i) {
+        auto score = outputs.find("score" + std::to_string(i));
+        auto box = outputs.find("box" + std::to_string(i));
+        if (score == outputs.end() || box == outputs.end()) {
+            ESP_LOGE(TAG, "%s: head %u missing, manifest lists %u", info.name, (unsigned)i,
+                     (unsigned)info.strides.size());
+            return false;
+        }
+        const std::vector<int> &shape = score->second->shape;
+        const int rows = info.input_height / info.strides[i][0];
+        const int cols = info.input_width / info.strides[i][1];
+        if (shape.size() != 4 || shape[1] != rows || shape[2] != cols) {
+            ESP_LOGE(TAG, "%s: head %u does not match stride %d of the manifest", info.name, (unsigned)i,
+                     info.strides[i][0]);
+            return false;
+        }
+    }
+    ESP_LOGI(TAG, "%s matches its manifest entry", info.name);
+    return true;
+}
+
+void ESPDet::init_direct_preprocess()
+{
+    dl::TensorBase *input = m_model->get_inputs().begin()->second;
+    if (input->dtype != dl::DATA_TYPE_INT8 || input->shape.size() != 4 || input->shape[3] != 3) {
+        ESP_LOGW(TAG, "Model input is not int8 RGB, direct preprocessing disabled");
+        return;
+    }
+    make_rgb565_lut(INPUT_MEAN, INPUT_STD, input->exponent, m_lut);
+    m_direct = verify_direct_preprocess();
+}
+
+// Einmal beim Laden: Testmuster über beide Wege, der direkte Weg muss bitgleich sein
+bool ESPDet::verify_direct_preprocess()
+{
+    dl::TensorBase *input = m_model->get_inputs().begin()->second;
+    const int width = input->shape[2];
+    const int height = input->shape[1];
+    const size_t pixels = (size_t)width * height;
+    uint8_t *pattern = (uint8_t *)heap_caps_malloc(pixels * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    int8_t *expected = (int8_t *)heap_caps_malloc(pixels * 3, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    bool ok = pattern && expected;
+    if (ok) {
+        make_rgb565_pattern(pattern, width, height);
+        dl::image::img_t img = {pattern, (uint16_t)width, (uint16_t)height, dl::image::DL_IMAGE_PIX_TYPE_RGB565};
+        m_image_preprocessor->preprocess(img);
+        memcpy(expected, input->get_element_ptr<int8_t>(), pixels * 3);
+#if CONFIG_BUMBLEBEE_DETECT_DUMP_PREPROCESS
+        dump_preprocess(expected, width, height, input->exponent);
+#endif
+        rgb565_roi_to_tensor(pattern, width, height, 0, 0, width, height, m_lut, input->get_element_ptr<int8_t>());
+        ok = memcmp(expected, input->get_element_ptr<int8_t>(), pixels * 3) == 0;
+        if (!ok) {
+            ESP_LOGW(TAG, "Direct preprocessing differs from ImagePreprocessor, disabled");
+        }
+    }
+    heap_caps_free(pattern);
+    heap_caps_free(expected);
+    return ok;
+}
+
+// ImagePreprocessor-Ergebnis für das Testmuster, für test_rgb565_tensor auf die SD-Karte
+void ESPDet::dump_preprocess(const int8_t *tensor, int width, int height, int exponent)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s/preprocess_%dx%d.bin", CONFIG_BSP_SD_MOUNT_POINT, width, height);
+    tensor_dump_t dump;
+    dump.width = width;
+    dump.height = height;
+    dump.exponent = exponent;
+    memcpy(dump.mean, INPUT_MEAN, sizeof(dump.mean));
+    memcpy(dump.std, INPUT_STD, sizeof(dump.std));
+    dump.tensor.assign(tensor, tensor + (size_t)width * height * 3);
+    FILE *f = fopen(path, "wb");
+    const bool ok = f && write_tensor_dump(f, dump);
+    if (f) {
+        fclose(f);
+    }
+    if (ok) {
+        ESP_LOGI(TAG, "Wrote preprocessed test pattern to %s", path);
+    } else {
+        ESP_LOGW(TAG, "Could not write preprocessed test pattern to %s", path);
+    }
+}
+
+bool ESPDet::preprocess_direct(const dl::image::img_t &img, const std::vector<int> &crop_area)
+{
+    dl::TensorBase *input = m_model->get_inputs().begin()->second;
+    const int x0 = crop_area.empty() ? 0 : crop_area[0];
+    const int y0 = crop_area.empty() ? 0 : crop_area[1];
+    const int x1 = crop_area.empty() ? img.width : crop_area[2];
+    const int y1 = crop_area.empty() ? img.height : crop_area[3];
+    // Nur wenn die Quelle schon Input-Größe hat; sonst skaliert der ImagePreprocessor
+    if (img.pix_type != dl::image::DL_IMAGE_PIX_TYPE_RGB565 || x1 - x0 != input->shape[2] ||
+        y1 - y0 != input->shape[1]) {
+        return false;
+    }
+    if (!rgb565_roi_to_tensor(static_cast<const uint8_t *>(img.data), img.width, img.height, x0, y0, x1 - x0,
+                              y1 - y0, m_lut, input->get_element_ptr<int8_t>())) {
+        return false;
+    }
+    m_direct_x0 = x0;
+    m_direct_y0 = y0;
+    return true;
+}
+
+void ESPDet::preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area)
+{
+    m_last_direct = m_direct && preprocess_direct(img, crop_area);
+    if (!m_last_direct) {
+        m_image_preprocessor->preprocess(img, crop_area);
+    }
+}
+
+// Heads "score<i>"/"box<i>" direkt aus den int8-Ausgaben, ohne Dequantisierung
+int ESPDet::quant_heads(head_tensor_t *heads, int max_heads)
+{
+    const int head_count = std::min(m_quant_post->head_count(), max_heads);
+    auto outputs = m_model->get_outputs();
+    for (int i = 0; i < head_count; ++i) {
+        auto score = outputs.find("score" + std::to_string(i));
+        auto box = outputs.find("box" + std::to_string(i));
+        if (score == outputs.end() || box == outputs.end() || score->second->dtype != dl::DATA_TYPE_INT8 ||
+            box->second->dtype != dl::DATA_TYPE_INT8 ||
+            box->second->shape[3] != 4 * ESPDetQuantPostProcessor::REG_MAX) {
+            return 0;
+        }
+        const std::vector<int> &shape = score->second->shape;  // NHWC
+        heads[i] = {score->second->get_element_ptr<int8_t>(),
+                    box->second->get_element_ptr<int8_t>(),
+                    shape[1],
+                    shape[2],
+                    shape[3],
+                    score->second->exponent,
+                    box->second->exponent};
+    }
+    return head_count;
+}
+
+std::list<dl::detect::result_t> &ESPDet::postprocess_quant(const head_tensor_t *heads, int head_count, int img_width,
+                                                           int img_height)
+{
+    if (m_last_direct) {
+        m_quant_post->set_resize_scale(1.0f, 1.0f);
+        m_quant_post->set_top_left(m_direct_x0, m_direct_y0);
+    } else {
+        m_quant_post->set_resize_scale(m_image_preprocessor->get_resize_scale_x(),
+                                       m_image_preprocessor->get_resize_scale_y());
+        m_quant_post->set_top_left(m_image_preprocessor->get_top_left_x(), m_image_preprocessor->get_top_left_y());
+    }
+    return m_quant_post->postprocess(heads, head_count, img_width, img_height);
+}
+
+std::list<dl::detect::result_t> &ESPDet::postprocess_generic(int img_width, int img_height)
+{
+    m_postprocessor->clear_result();
+    if (m_last_direct) {
+        m_postprocessor->set_resize_scale_x(1.0f);
+        m_postprocessor->set_resize_scale_y(1.0f);
+        m_postprocessor->set_top_left_x(m_direct_x0);
+        m_postprocessor->set_top_left_y(m_direct_y0);
+    } else {
+        m_postprocessor->set_resize_scale_x(m_image_preprocessor->get_resize_scale_x());
+        m_postprocessor->set_resize_scale_y(m_image_preprocessor->get_resize_scale_y());
+        m_postprocessor->set_top_left_x(m_image_preprocessor->get_top_left_x());
+        m_postprocessor->set_top_left_y(m_image_preprocessor->get_top_left_y());
+    }
+    m_postprocessor->postprocess();
+    return m_postprocessor->get_result(img_width, img_height);
+}
+
+// Einmal, auf den ersten Ausgaben (Warmup): derselbe Lauf durch ESPDetPostProcessor muss
+// dieselben Boxen liefern, sonst bleibt es beim generischen Pfad
+bool ESPDet::verify_quant_postprocess(const head_tensor_t *heads, int head_count,
+                                      const std::list<dl::detect::result_t> &quant, int img_width, int img_height)
+{
+    m_quant_verified = true;
+    const std::list<dl::detect::result_t> &generic = postprocess_generic(img_width, img_height);
+#if CONFIG_BUMBLEBEE_DETECT_DUMP_HEADS
+    dump_heads(heads, head_count, generic, img_width, img_height);
+#else
+    (void)heads;
+    (void)head_count;
+#endif
+    if (!matches_generic(quant, generic, m_quant_post->candidate_budget() > 0)) {
+        ESP_LOGW(TAG, "int8 postprocessing returned %u box(es), ESPDetPostProcessor %u",
+                 (unsigned)quant.size(), (unsigned)generic.size());
+        return false;
+    }
+    ESP_LOGI(TAG, "int8 postprocessing matches ESPDetPostProcessor (%u box(es), %u candidate(s))",
+             (unsigned)quant.size(), (unsigned)m_quant_post->stats().candidates);
+    return true;
+}
+
+// Rohe Heads und das generische Ergebnis für test_espdet_postprocessor auf die SD-Karte
+void ESPDet::dump_heads(const head_tensor_t *heads, int head_count, const std::list<dl::detect::result_t> &generic,
+                        int img_width, int img_height)
+{
+    dl::TensorBase *input = m_model->get_inputs().begin()->second;
+    char path[64];
+    snprintf(path, sizeof(path), "%s/heads_%dx%d.bin", CONFIG_BSP_SD_MOUNT_POINT, input->shape[2], input->shape[1]);
+    heads_dump_t dump;
+    dump.score_thr = m_quant_post->score_thr();
+    dump.nms_thr = m_quant_post->nms_thr();
+    dump.top_k = m_quant_post->top_k();
+    dump.scale_x = m_last_direct ? 1.0f : m_image_preprocessor->get_resize_scale_x();
+    dump.scale_y = m_last_direct ? 1.0f : m_image_preprocessor->get_resize_scale_y();
+    dump.top_left_x = m_last_direct ? m_direct_x0 : m_image_preprocessor->get_top_left_x();
+    dump.top_left_y = m_last_direct ? m_direct_y0 : m_image_preprocessor->get_top_left_y();
+    dump.img_width = img_width;
+    dump.img_height = img_height;
+    dump.strides = m_quant_post->strides();
+    dump.heads.assign(heads, heads + head_count);
+    dump.generic = generic;
+    FILE *f = fopen(path, "wb");
+    const bool ok = f && write_heads_dump(f, dump);
+    if (f) {
+        fclose(f);
+    }
+    if (ok) {
+        ESP_LOGI(TAG, "Wrote int8 heads to %s", path);
+    } else {
+        ESP_LOGW(TAG, "Could not write int8 heads to %s", path);
+    }
+}
+
+std::list<dl::detect::result_t> &ESPDet::infer(int img_width, int img_height)
+{
+    m_model->run();
+    int64_t start_us = esp_timer_get_time();
+    if (m_quant_post) {
+        head_tensor_t heads[3];
+        const int head_count = quant_heads(heads, 3);
+        if (head_count) {
+            std::list<dl::detect::result_t> &result = postprocess_quant(heads, head_count, img_width, img_height);
+            m_last_postprocess_us = esp_timer_get_time() - start_us;
+            if (m_quant_verified || verify_quant_postprocess(heads, head_count, result, img_width, img_height)) {
+                return result;
+            }
+            ESP_LOGW(TAG, "int8 postprocessing differs from ESPDetPostProcessor, disabled");
+        } else {
+            ESP_LOGW(TAG, "Model outputs are not int8, using generic postprocessor");
+        }
+        delete m_quant_post;
+        m_quant_post = nullptr;
+        start_us = esp_timer_get_time();
+    }
+    std::list<dl::detect::result_t> &result = postprocess_generic(img_width, img_height);
+    m_last_postprocess_us = esp_timer_get_time() - start_us;
+    return result;
+}
+
+std::list<dl::detect::result_t> &ESPDet::run(const dl::image::img_t &img)
+{
+    preprocess(img);
+    return infer(img.width, img.height);
 }
 
 } // namespace bumblebee_detect
 
 
-BumblebeeDetect::BumblebeeDetect(bool lazy_load)
+BumblebeeDetect::BumblebeeDetect(model_type_t model_type, bool lazy_load, float score_thr) : m_model_type(model_type)
 {
-    m_score_thr[0] = bumblebee_detect::ESPDet::default_score_thr;
-    m_nms_thr[0] = bumblebee_detect::ESPDet::default_nms_thr;
+    m_score_thr[0] = score_thr < 0 ? info().score_thr : score_thr;
+    m_nms_thr[0] = info().nms_thr;
     if (lazy_load) {
         m_model = nullptr;
     } else {
@@ -50,9 +376,48 @@ BumblebeeDetect::BumblebeeDetect(bool lazy_load)
 
 void BumblebeeDetect::load_model()
 {
-    #if CONFIG_FLASH_ESPDET_PICO_224_224_BUMBLEBEE || CONFIG_BUMBLEBEE_DETECT_MODEL_IN_SDCARD
-        m_model = new bumblebee_detect::ESPDet("espdet_pico_224_224_bumblebee.espdl", m_score_thr[0], m_nms_thr[0]);
-    #else
-        ESP_LOGE("bumblebee_detect", "espdet_pico_224_224_bumblebee is not selected in menuconfig.");
-    #endif
+    const bumblebee_detect::model_info_t &model = info();
+    if (!model.packed) {
+        ESP_LOGE(bumblebee_detect::TAG, "%s is not selected in menuconfig.", model.name);
+        return;
+    }
+    auto *espdet = new bumblebee_detect::ESPDet(model, m_score_thr[0], m_nms_thr[0]);
+    if (!espdet->is_valid()) {
+        delete espdet;
+        return;
+    }
+    m_model = espdet;
+}
+
+bumblebee_detect::ESPDet *BumblebeeDetect::espdet()
+{
+    if (!m_model) {
+        load_model();
+    }
+    return static_cast<bumblebee_detect::ESPDet *>(m_model);
+}
+
+int64_t BumblebeeDetect::last_postprocess_us() const
+{
+    return m_model ? static_cast<const bumblebee_detect::ESPDet *>(m_model)->last_postprocess_us() : 0;
+}
+
+const bumblebee_detect::load_marks_t *BumblebeeDetect::load_marks() const
+{
+    return m_model ? &static_cast<const bumblebee_detect::ESPDet *>(m_model)->load_marks() : nullptr;
+}
+
+void BumblebeeDetect::preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area)
+{
+    if (espdet()) {
+        espdet()->preprocess(img, crop_area);
+    }
+}
+
+std::list<dl::detect::result_t> &BumblebeeDetect::infer(int img_width, int img_height)
+{
+    if (!espdet()) {
+        return m_no_results;
+    }
+    return espdet()->infer(img_width, img_height);
 }
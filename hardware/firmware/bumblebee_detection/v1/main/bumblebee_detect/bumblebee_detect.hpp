@@ -1,20 +1,105 @@
 #pragma once
+#include "sdkconfig.h"
 #include "dl_detect_base.hpp"
 #include "dl_detect_espdet_postprocessor.hpp"
+#include "espdet_postprocessor.hpp"
+#include "model_registry.hpp"
+#include "rgb565_tensor.hpp"
 
 namespace bumblebee_detect {
+// Heap-Stand für internen RAM ([0]) und PSRAM ([1])
+struct heap_mark_t {
+    uint32_t free[2];
+    uint32_t largest[2];
+    uint32_t min_free[2];
+};
+
+// Stände rund ums Laden: davor, nach dem Laden, nach minimize()
+struct load_marks_t {
+    heap_mark_t before;
+    heap_mark_t loaded;
+    heap_mark_t minimized;
+};
+
 class ESPDet : public dl::detect::DetectImpl {
 public:
-    static inline constexpr float default_score_thr = 0.3;
-    static inline constexpr float default_nms_thr = 0.7;
-    ESPDet(const char *model_name, float score_thr, float nms_thr);
+    // Input, Heads und top_k kommen aus dem Manifest
+    ESPDet(const model_info_t &info, float score_thr, float nms_thr);
+    ~ESPDet();
+    // false, wenn das Modell nicht geladen werden konnte (Partition leer, Datei fehlt)
+    bool is_valid() const { return m_valid; }
+
+    // Füllt nur den Modell-Input. Danach wird img nicht mehr gelesen und kann
+    // (z.B. als Kamera-Framebuffer) sofort zurückgegeben werden. Ein RGB565-Ausschnitt in
+    // Input-Größe geht ohne Zwischenbild und Letterbox direkt in den int8-Input.
+    void preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area = {});
+    // Inferenz und Postprocessing auf dem zuvor gefüllten Input.
+    // Die Boxen sind in Koordinaten des an preprocess() übergebenen Bildes.
+    std::list<dl::detect::result_t> &infer(int img_width, int img_height);
+    // Wie DetectImpl::run(), aber über infer(), damit auch der Warmup den int8-Pfad nimmt
+    std::list<dl::detect::result_t> &run(const dl::image::img_t &img) override;
+
+    // Dauer des letzten Postprocessings (generisch oder int8), ohne Modell
+    int64_t last_postprocess_us() const { return m_last_postprocess_us; }
+    bool quant_postprocess() const { return m_quant_post != nullptr; }
+    bool direct_preprocess() const { return m_direct; }
+    const load_marks_t &load_marks() const { return m_load_marks; }
+
+private:
+    bool matches_manifest(const model_info_t &info);
+    void init_direct_preprocess();
+    bool preprocess_direct(const dl::image::img_t &img, const std::vector<int> &crop_area);
+    bool verify_direct_preprocess();
+    void dump_preprocess(const int8_t *tensor, int width, int height, int exponent);
+    // Anzahl Heads, 0 wenn die Ausgaben nicht als int8 vorliegen
+    int quant_heads(head_tensor_t *heads, int max_heads);
+    std::list<dl::detect::result_t> &postprocess_quant(const head_tensor_t *heads, int head_count, int img_width,
+                                                       int img_height);
+    std::list<dl::detect::result_t> &postprocess_generic(int img_width, int img_height);
+    bool verify_quant_postprocess(const head_tensor_t *heads, int head_count,
+                                  const std::list<dl::detect::result_t> &quant, int img_width, int img_height);
+    void dump_heads(const head_tensor_t *heads, int head_count, const std::list<dl::detect::result_t> &generic,
+                    int img_width, int img_height);
+
+    ESPDetQuantPostProcessor *m_quant_post = nullptr;
+    bool m_quant_verified = false;  // int8-Postprocessing schon gegen den generischen Pfad geprüft
+    bool m_valid = false;
+    rgb565_lut_t m_lut;
+    bool m_direct = false;       // RGB565 -> int8 ohne ImagePreprocessor möglich
+    bool m_last_direct = false;  // letzter preprocess() lief direkt, Boxen nur um den Ausschnitt verschieben
+    int m_direct_x0 = 0;
+    int m_direct_y0 = 0;
+    int64_t m_last_postprocess_us = 0;
+    load_marks_t m_load_marks = {};
 };
 } // namespace bumblebee_detect
 
 class BumblebeeDetect : public dl::detect::DetectWrapper {
 public:
-    BumblebeeDetect(bool lazy_load = true);
+    typedef enum {
+        ESPDET_PICO_224_224_BUMBLEBEE,
+        ESPDET_PICO_96_96_BUMBLEBEE,
+    } model_type_t;
+    // score_thr < 0: Schwelle aus dem Manifest
+    BumblebeeDetect(model_type_t model_type = static_cast<model_type_t>(CONFIG_DEFAULT_BUMBLEBEE_DETECT_MODEL),
+                    bool lazy_load = true,
+                    float score_thr = -1.0f);
+
+    void preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area = {});
+    std::list<dl::detect::result_t> &infer(int img_width, int img_height);
+    // Ein Modell, das nicht geladen werden konnte, gilt nicht als geladen; preprocess()
+    // tut dann nichts, infer() liefert keine Boxen
+    bool is_loaded() const { return m_model != nullptr; }
+    int64_t last_postprocess_us() const;
+    // nullptr, solange das Modell nicht geladen ist
+    const bumblebee_detect::load_marks_t *load_marks() const;
+    model_type_t model_type() const { return m_model_type; }
+    const bumblebee_detect::model_info_t &info() const { return bumblebee_detect::model_info(m_model_type); }
 
 private:
     void load_model() override;
+    bumblebee_detect::ESPDet *espdet();
+
+    model_type_t m_model_type;
+    std::list<dl::detect::result_t> m_no_results;
 };
@@ -0,0 +1,419 @@
+#include "espdet_postprocessor.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace bumblebee_detect {
+
+// --------- Internal helpers ----------------------------------
+
+static int64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static float sigmoid(float x)
+{
+    return 1.0f / (1.0f + expf(-x));
+}
+
+// Irgendein int8 in w größer als thr (-128 <= thr < 127). Vier Lanes auf einmal: nach
+// w ^ 0x80 ist die Reihenfolge vorzeichenlos; Übertrag aus einer Lane >= 128 kann nur
+// Nachbarn treffen, wenn das Ergebnis ohnehin schon wahr ist.
+static inline bool any_above(uint32_t w, int thr)
+{
+    constexpr uint32_t L = 0x01010101u;
+    constexpr uint32_t H = 0x80808080u;
+    const uint32_t u = w ^ H;
+    const uint32_t n = (uint32_t)(thr + 128);
+    if (n < 128) {
+        return (((u + L * (127 - n)) | u) & H) != 0;
+    }
+    const uint32_t low = u & ~H;
+    return (((low + L * (255 - n)) | low) & H & u) != 0;
+}
+
+static constexpr char DUMP_MAGIC[4] = {'B', 'H', 'D', 'S'};
+static constexpr uint32_t DUMP_VERSION = 1;
+
+// Gerät und Host sind little endian, Werte gehen roh in die Datei
+template <typename T>
+static bool put(FILE *f, const T &v)
+{
+    return fwrite(&v, sizeof(v), 1, f) == 1;
+}
+
+template <typename T>
+static bool get(FILE *f, T &v)
+{
+    return fread(&v, sizeof(v), 1, f) == 1;
+}
+
+static size_t score_size(const head_tensor_t &h)
+{
+    return (size_t)h.height * h.width * h.classes;
+}
+
+static size_t box_size(const head_tensor_t &h)
+{
+    return (size_t)h.height * h.width * 4 * ESPDetQuantPostProcessor::REG_MAX;
+}
+
+// --------- Public API ----------------------------------
+
+ESPDetQuantPostProcessor::ESPDetQuantPostProcessor(float score_thr, float nms_thr, int top_k,
+                                                   const std::vector<std::vector<int>> &strides,
+                                                   int candidate_budget) :
+    m_score_thr(score_thr), m_nms_thr(nms_thr), m_top_k(top_k), m_budget(std::max(candidate_budget, 0)),
+    m_strides(strides)
+{
+    m_candidates.reserve(m_budget ? m_budget : 64);
+}
+
+void ESPDetQuantPostProcessor::set_resize_scale(float scale_x, float scale_y)
+{
+    m_scale_x = scale_x;
+    m_scale_y = scale_y;
+}
+
+void ESPDetQuantPostProcessor::set_top_left(int x, int y)
+{
+    m_top_left_x = x;
+    m_top_left_y = y;
+}
+
+// Größter Wert t, für den q > t genau die Zellen mit sigmoid(q * 2^e) > score_thr liefert.
+// -129: alle Zellen, 127: keine.
+int ESPDetQuantPostProcessor::head_threshold(const head_tensor_t &head) const
+{
+    const float scale = ldexpf(1.0f, head.score_exponent);
+    const float logit = logf(m_score_thr / (1.0f - m_score_thr));
+    int q = (int)floorf(logit / scale) + 1;
+    q = std::min(std::max(q, -128), 128);
+    // Rundung von logf/expf: an der Grenze mit derselben Formel wie beim Dekodieren prüfen
+    while (q > -128 && sigmoid((q - 1) * scale) > m_score_thr) {
+        q--;
+    }
+    while (q <= 127 && !(sigmoid(q * scale) > m_score_thr)) {
+        q++;
+    }
+    return q - 1;
+}
+
+void ESPDetQuantPostProcessor::offer(const candidate_t &cand)
+{
+    if (!m_budget || (int)m_candidates.size() < m_budget) {
+        m_candidates.push_back(cand);
+    } else {
+        // Rangfolge wie im generischen Pfad: Score, bei Gleichstand der frühere
+        const candidate_t &weakest = m_candidates[m_weakest];
+        if (!(cand.score > weakest.score)) {
+            return;
+        }
+        m_candidates[m_weakest] = cand;
+    }
+    if (m_budget && (int)m_candidates.size() == m_budget) {
+        // Schwächster: kleinster Score, bei Gleichstand der spätere
+        m_weakest = 0;
+        for (int i = 1; i < m_budget; ++i) {
+            const candidate_t &c = m_candidates[i];
+            const candidate_t &w = m_candidates[m_weakest];
+            if (c.score < w.score || (c.score == w.score && c.order > w.order)) {
+                m_weakest = i;
+            }
+        }
+    }
+}
+
+void ESPDetQuantPostProcessor::scan_head(const head_tensor_t &head, int index, int base)
+{
+    const float scale = ldexpf(1.0f, head.score_exponent);
+    const int n = head.height * head.width * head.classes;
+    const int8_t *score = head.score;
+
+    // Schwelle dieses Heads: Grundschwelle oder, bei vollem Budget, knapp über dem Schwächsten.
+    // Darunter liegt der Score höchstens gleichauf, und später gescannt verliert er den Gleichstand.
+    auto threshold = [&]() {
+        if (m_weakest < 0) {
+            return base;
+        }
+        const int t = (int)floorf(m_candidates[m_weakest].logit / scale);
+        return std::max(base, std::min(t, 127));
+    };
+    int thr = threshold();
+    if (thr >= 127) {
+        m_stats.skipped_heads++;
+        m_order += n;
+        return;
+    }
+
+    auto check = [&](int i) {
+        if (score[i] > thr) {
+            m_stats.candidates++;
+            const float logit = score[i] * scale;
+            offer({logit, sigmoid(logit), m_order + (uint32_t)i, index, i / head.classes, i % head.classes});
+            thr = threshold();
+        }
+    };
+    int i = 0;
+    for (; i + 4 <= n && thr < 127; i += 4) {
+        uint32_t w;
+        memcpy(&w, score + i, sizeof(w));
+        if (thr < -128 || any_above(w, thr)) {
+            check(i);
+            check(i + 1);
+            check(i + 2);
+            check(i + 3);
+        }
+    }
+    for (; i < n && thr < 127; ++i) {
+        check(i);
+    }
+    m_order += n;
+}
+
+void ESPDetQuantPostProcessor::decode(const head_tensor_t &head, const candidate_t &cand,
+                                      dl::detect::result_t &res)
+{
+    const std::vector<int> &s = m_strides[cand.head];
+    const int y = cand.cell / head.width;
+    const int x = cand.cell % head.width;
+    const float center_y = (float)(y * s[0] + s[2]);
+    const float center_x = (float)(x * s[1] + s[3]);
+
+    // exp(-d * scale) für alle Abstände zum Maximum; gilt, solange der Exponent gleich bleibt
+    if (!m_exp_valid || m_exp_exponent != head.box_exponent) {
+        const float scale = ldexpf(1.0f, head.box_exponent);
+        for (int d = 0; d < 256; ++d) {
+            m_exp_lut[d] = expf(-d * scale);
+        }
+        m_exp_exponent = head.box_exponent;
+        m_exp_valid = true;
+    }
+
+    // DFL: Erwartungswert der Softmax über REG_MAX Bins je Seite
+    const int8_t *bins = head.box + (size_t)cand.cell * 4 * REG_MAX;
+    float dist[4];
+    for (int k = 0; k < 4; ++k, bins += REG_MAX) {
+        int8_t qmax = bins[0];
+        for (int j = 1; j < REG_MAX; ++j) {
+            qmax = std::max(qmax, bins[j]);
+        }
+        float sum = 0.0f;
+        float weighted = 0.0f;
+        for (int j = 0; j < REG_MAX; ++j) {
+            const float e = m_exp_lut[qmax - bins[j]];
+            sum += e;
+            weighted += e * j;
+        }
+        dist[k] = weighted / sum;
+    }
+
+    res.category = cand.category;
+    res.score = cand.score;
+    res.box = {(int)((center_x - dist[0] * s[1]) / m_scale_x + m_top_left_x),
+               (int)((center_y - dist[1] * s[0]) / m_scale_y + m_top_left_y),
+               (int)((center_x + dist[2] * s[1]) / m_scale_x + m_top_left_x),
+               (int)((center_y + dist[3] * s[0]) / m_scale_y + m_top_left_y)};
+}
+
+// Wie DetectPostprocessor::nms(): Liste absteigend sortiert, überlappende schwächere
+// Boxen verwerfen, nach top_k Boxen abbrechen. Verworfene Knoten gehen nach m_spare.
+void ESPDetQuantPostProcessor::nms()
+{
+    int kept_number = 0;
+    for (auto kept = m_results.begin(); kept != m_results.end(); ++kept) {
+        kept_number++;
+        if (kept_number >= m_top_k) {
+            m_spare.splice(m_spare.end(), m_results, std::next(kept), m_results.end());
+            break;
+        }
+        const int kept_area = (kept->box[2] - kept->box[0] + 1) * (kept->box[3] - kept->box[1] + 1);
+        for (auto other = std::next(kept); other != m_results.end();) {
+            const int inter_w = std::min(kept->box[2], other->box[2]) - std::max(kept->box[0], other->box[0]) + 1;
+            const int inter_h = std::min(kept->box[3], other->box[3]) - std::max(kept->box[1], other->box[1]) + 1;
+            if (inter_w <= 0 || inter_h <= 0) {
+                ++other;
+                continue;
+            }
+            const int inter_area = inter_w * inter_h;
+            const int other_area = (other->box[2] - other->box[0] + 1) * (other->box[3] - other->box[1] + 1);
+            if ((float)inter_area / (float)(kept_area + other_area - inter_area) > m_nms_thr) {
+                m_spare.splice(m_spare.end(), m_results, other++);
+            } else {
+                ++other;
+            }
+        }
+    }
+}
+
+std::list<dl::detect::result_t> &ESPDetQuantPostProcessor::postprocess(const head_tensor_t *heads, int head_count,
+                                                                        int img_width, int img_height)
+{
+    const int64_t start_us = now_us();
+    // Knoten samt Box-Kapazität wiederverwenden: nach den ersten Läufen allokiert nichts mehr
+    m_spare.splice(m_spare.end(), m_results);
+    m_candidates.clear();
+    m_weakest = -1;
+    m_order = 0;
+    m_stats.candidates = 0;
+    head_count = std::min(head_count, (int)m_strides.size());
+
+    for (int h = 0; h < head_count; ++h) {
+        scan_head(heads[h], h, head_threshold(heads[h]));
+    }
+    m_stats.decoded = m_candidates.size();
+
+    // Scanreihenfolge beibehalten: bei gleichem Score gewinnt wie im generischen Pfad der frühere
+    std::sort(m_candidates.begin(), m_candidates.end(),
+              [](const candidate_t &a, const candidate_t &b) { return a.order < b.order; });
+    for (const candidate_t &cand : m_candidates) {
+        if (m_spare.empty()) {
+            m_spare.emplace_back();
+            m_spare.back().box.reserve(4);
+        }
+        dl::detect::result_t &res = m_spare.front();
+        decode(heads[cand.head], cand, res);
+        auto pos = std::upper_bound(m_results.begin(), m_results.end(), res,
+                                    [](const dl::detect::result_t &a, const dl::detect::result_t &b) {
+                                        return a.score > b.score;
+                                    });
+        m_results.splice(pos, m_spare, m_spare.begin());
+    }
+    nms();
+    for (auto &res : m_results) {
+        res.box[0] = std::min(std::max(res.box[0], 0), img_width - 1);
+        res.box[1] = std::min(std::max(res.box[1], 0), img_height - 1);
+        res.box[2] = std::min(std::max(res.box[2], 0), img_width - 1);
+        res.box[3] = std::min(std::max(res.box[3], 0), img_height - 1);
+    }
+
+    const int64_t us = now_us() - start_us;
+    m_stats.runs++;
+    m_stats.last_us = us;
+    m_stats.total_us += us;
+    m_stats.max_us = std::max(m_stats.max_us, us);
+    return m_results;
+}
+
+bool matches_generic(const std::list<dl::detect::result_t> &quant, const std::list<dl::detect::result_t> &generic,
+                     bool budgeted)
+{
+    if (quant.size() > generic.size() || (!budgeted && quant.size() != generic.size())) {
+        return false;
+    }
+    auto g = generic.begin();
+    for (const dl::detect::result_t &q : quant) {
+        if (q.category != g->category || fabsf(q.score - g->score) > 1e-4f || q.box.size() != g->box.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < q.box.size(); ++i) {
+            if (std::abs(q.box[i] - g->box[i]) > 1) {
+                return false;
+            }
+        }
+        ++g;
+    }
+    return true;
+}
+
+bool write_heads_dump(FILE *f, const heads_dump_t &dump)
+{
+    bool ok = fwrite(DUMP_MAGIC, sizeof(DUMP_MAGIC), 1, f) == 1 && put(f, DUMP_VERSION) && put(f, dump.score_thr) &&
+              put(f, dump.nms_thr) && put(f, (int32_t)dump.top_k) && put(f, dump.scale_x) && put(f, dump.scale_y) &&
+              put(f, (int32_t)dump.top_left_x) && put(f, (int32_t)dump.top_left_y) &&
+              put(f, (int32_t)dump.img_width) && put(f, (int32_t)dump.img_height) &&
+              put(f, (uint32_t)dump.heads.size()) && dump.strides.size() >= dump.heads.size();
+    for (size_t i = 0; ok && i < dump.heads.size(); ++i) {
+        const head_tensor_t &h = dump.heads[i];
+        ok = put(f, (int32_t)h.height) && put(f, (int32_t)h.width) && put(f, (int32_t)h.classes) &&
+             put(f, (int32_t)h.score_exponent) && put(f, (int32_t)h.box_exponent) && dump.strides[i].size() == 4;
+        for (int k = 0; ok && k < 4; ++k) {
+            ok = put(f, (int32_t)dump.strides[i][k]);
+        }
+    }
+    for (size_t i = 0; ok && i < dump.heads.size(); ++i) {
+        const head_tensor_t &h = dump.heads[i];
+        ok = fwrite(h.score, 1, score_size(h), f) == score_size(h) && fwrite(h.box, 1, box_size(h), f) == box_size(h);
+    }
+    ok = ok && put(f, (uint32_t)dump.generic.size());
+    for (auto it = dump.generic.begin(); ok && it != dump.generic.end(); ++it) {
+        ok = put(f, (int32_t)it->category) && put(f, it->score) && it->box.size() == 4;
+        for (int k = 0; ok && k < 4; ++k) {
+            ok = put(f, (int32_t)it->box[k]);
+        }
+    }
+    return ok;
+}
+
+bool read_heads_dump(FILE *f, heads_dump_t &dump)
+{
+    char magic[sizeof(DUMP_MAGIC)];
+    uint32_t version = 0;
+    int32_t top_k, top_left_x, top_left_y, img_width, img_height;
+    uint32_t head_count = 0;
+    if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, DUMP_MAGIC, sizeof(magic)) != 0 ||
+        !get(f, version) || version != DUMP_VERSION || !get(f, dump.score_thr) || !get(f, dump.nms_thr) ||
+        !get(f, top_k) || !get(f, dump.scale_x) || !get(f, dump.scale_y) || !get(f, top_left_x) ||
+        !get(f, top_left_y) || !get(f, img_width) || !get(f, img_height) || !get(f, head_count) || head_count > 8) {
+        return false;
+    }
+    dump.top_k = top_k;
+    dump.top_left_x = top_left_x;
+    dump.top_left_y = top_left_y;
+    dump.img_width = img_width;
+    dump.img_height = img_height;
+    dump.heads.assign(head_count, head_tensor_t{});
+    dump.strides.assign(head_count, std::vector<int>(4));
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < head_count; ++i) {
+        int32_t v[9];
+        for (int32_t &x : v) {
+            if (!get(f, x)) {
+                return false;
+            }
+        }
+        head_tensor_t &h = dump.heads[i];
+        h = {nullptr, nullptr, v[0], v[1], v[2], v[3], v[4]};
+        if (h.height <= 0 || h.width <= 0 || h.classes <= 0 || h.height * h.width > 1 << 16 || h.classes > 256) {
+            return false;
+        }
+        dump.strides[i] = {v[5], v[6], v[7], v[8]};
+        bytes += score_size(h) + box_size(h);
+    }
+    dump.data.resize(bytes);
+    if (fread(dump.data.data(), 1, bytes, f) != bytes) {
+        return false;
+    }
+    int8_t *p = dump.data.data();
+    for (head_tensor_t &h : dump.heads) {
+        h.score = p;
+        p += score_size(h);
+        h.box = p;
+        p += box_size(h);
+    }
+    uint32_t result_count = 0;
+    if (!get(f, result_count) || result_count > 1000) {
+        return false;
+    }
+    dump.generic.clear();
+    for (uint32_t i = 0; i < result_count; ++i) {
+        int32_t category;
+        float score;
+        int32_t box[4];
+        if (!get(f, category) || !get(f, score) || !get(f, box)) {
+            return false;
+        }
+        dl::detect::result_t res;
+        res.category = category;
+        res.score = score;
+        res.box = {box[0], box[1], box[2], box[3]};
+        dump.generic.push_back(res);
+    }
+    return true;
+}
+
+} // namespace bumblebee_detect
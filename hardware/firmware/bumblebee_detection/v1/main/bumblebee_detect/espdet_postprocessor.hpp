@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <vector>
+#include "dl_detect_define.hpp"
+
+namespace bumblebee_detect {
+
+// Rohe int8-Ausgabe eines ESPDet-Heads (NHWC, Batch 1): score [H, W, C] Logits,
+// box [H, W, 4 * REG_MAX] DFL-Verteilungen für links, oben, rechts, unten
+struct head_tensor_t {
+    const int8_t *score;
+    const int8_t *box;
+    int height;
+    int width;
+    int classes;
+    int score_exponent;
+    int box_exponent;
+};
+
+struct postprocess_stats_t {
+    uint32_t runs;
+    uint32_t candidates;     // Zellen über der Schwelle, letzter Lauf
+    uint32_t decoded;        // davon dekodiert (höchstens candidate_budget)
+    uint32_t skipped_heads;  // Heads, die nach vollem Budget gar nicht mehr gelesen wurden
+    int64_t last_us;
+    int64_t total_us;
+    int64_t max_us;
+};
+
+// Postprocessing für ESPDet direkt auf den int8-Ausgaben. Die Score-Schwelle wird je Head
+// einmal in die Logit-Domäne übersetzt; gesucht wird vier Zellen auf einmal mit
+// 32-Bit-Vergleichen, Box-Regressionen (DFL) werden nur für Treffer dekodiert.
+// Mit candidate_budget > 0 werden höchstens so viele Kandidaten vor dem NMS behalten: ist das
+// Budget voll, steigt die Schwelle auf den schwächsten behaltenen Kandidaten, und Heads, die
+// darüber nichts mehr liefern können, werden übersprungen. Schwächere Kandidaten können
+// stärkere im NMS nicht verdrängen, das Ergebnis ist daher ein Anfang des Ergebnisses ohne
+// Budget. candidate_budget = 0 entspricht dem generischen dl::detect::ESPDetPostProcessor
+// (alle Kandidaten, dann NMS und top_k).
+class ESPDetQuantPostProcessor {
+public:
+    static constexpr int REG_MAX = 16;
+
+    // strides wie im Manifest: {stride_y, stride_x, offset_y, offset_x} je Head
+    ESPDetQuantPostProcessor(float score_thr, float nms_thr, int top_k,
+                             const std::vector<std::vector<int>> &strides, int candidate_budget = 0);
+
+    // Abbildung Modell-Input -> Bild wie beim ImagePreprocessor: x / scale + top_left
+    void set_resize_scale(float scale_x, float scale_y);
+    void set_top_left(int x, int y);
+
+    // heads in der Reihenfolge der strides; Boxen in Bildkoordinaten, auf das Bild begrenzt,
+    // absteigend nach Score. Gültig bis zum nächsten Aufruf. Listenknoten werden recycelt,
+    // allokiert wird nur, wenn ein Lauf mehr Kandidaten dekodiert als alle vorherigen.
+    std::list<dl::detect::result_t> &postprocess(const head_tensor_t *heads, int head_count, int img_width,
+                                                 int img_height);
+
+    int head_count() const { return (int)m_strides.size(); }
+    float score_thr() const { return m_score_thr; }
+    float nms_thr() const { return m_nms_thr; }
+    int top_k() const { return m_top_k; }
+    int candidate_budget() const { return m_budget; }
+    const std::vector<std::vector<int>> &strides() const { return m_strides; }
+    const postprocess_stats_t &stats() const { return m_stats; }
+
+private:
+    struct candidate_t {
+        float logit;      // Score-Logit (dequantisiert), vergleichbar über Heads hinweg
+        float score;      // sigmoid(logit); nahe 1 fallen verschiedene Logits auf denselben Score
+        uint32_t order;   // Scanreihenfolge, entscheidet bei Gleichstand wie im generischen Pfad
+        int head;
+        int cell;         // y * width + x
+        int category;
+    };
+
+    void scan_head(const head_tensor_t &head, int index, int base_threshold);
+    void offer(const candidate_t &cand);
+    int head_threshold(const head_tensor_t &head) const;
+    void decode(const head_tensor_t &head, const candidate_t &cand, dl::detect::result_t &res);
+    void nms();
+
+    float m_score_thr;
+    float m_nms_thr;
+    int m_top_k;
+    int m_budget;
+    std::vector<std::vector<int>> m_strides;
+    float m_scale_x = 1.0f;
+    float m_scale_y = 1.0f;
+    int m_top_left_x = 0;
+    int m_top_left_y = 0;
+
+    std::vector<candidate_t> m_candidates;
+    int m_weakest = -1;          // Index des schwächsten Kandidaten, sobald das Budget voll ist
+    uint32_t m_order = 0;
+    bool m_exp_valid = false;
+    int m_exp_exponent = 0;      // Exponent, für den m_exp_lut gilt
+    float m_exp_lut[256] = {};   // exp(-d * 2^exponent), d = 0..255
+    std::list<dl::detect::result_t> m_results;
+    std::list<dl::detect::result_t> m_spare;   // freie Knoten, behalten ihre Box-Kapazität
+    postprocess_stats_t m_stats = {};
+};
+
+// Vergleich mit dem generischen Pfad: gleiche Klassen und Reihenfolge, Scores bis 1e-4 und
+// Boxen bis 1 px gleich (expf und Rundung nach int können zwischen den Pfaden abweichen).
+// Mit Budget darf quant kürzer sein, muss aber ein Anfang von generic sein.
+bool matches_generic(const std::list<dl::detect::result_t> &quant, const std::list<dl::detect::result_t> &generic,
+                     bool budgeted);
+
+// Abzug eines Postprocessing-Laufs auf dem Gerät (CONFIG_BUMBLEBEE_DETECT_DUMP_HEADS) für die
+// Host-Tests: die int8-Heads wie vom Modell geliefert, die Abbildung ins Bild und das Ergebnis
+// des generischen ESPDetPostProcessor. Little endian:
+//   "BHDS", u32 version, f32 score_thr, f32 nms_thr, i32 top_k, f32 scale_x, f32 scale_y,
+//   i32 top_left_x, i32 top_left_y, i32 img_width, i32 img_height, u32 head_count,
+//   je Head i32 height, width, classes, score_exponent, box_exponent, stride[4],
+//   je Head score[height * width * classes], box[height * width * 4 * REG_MAX],
+//   u32 result_count, je Box i32 category, f32 score, i32 box[4]
+struct heads_dump_t {
+    float score_thr = 0.0f;
+    float nms_thr = 0.0f;
+    int top_k = 0;
+    float scale_x = 1.0f;
+    float scale_y = 1.0f;
+    int top_left_x = 0;
+    int top_left_y = 0;
+    int img_width = 0;
+    int img_height = 0;
+    std::vector<std::vector<int>> strides;
+    std::vector<head_tensor_t> heads;
+    std::list<dl::detect::result_t> generic;
+    std::vector<int8_t> data;  // nur beim Lesen: Speicher, in den heads zeigen
+};
+
+bool write_heads_dump(FILE *f, const heads_dump_t &dump);
+bool read_heads_dump(FILE *f, heads_dump_t &dump);
+
+} // namespace bumblebee_detect
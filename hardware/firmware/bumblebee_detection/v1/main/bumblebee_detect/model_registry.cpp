@@ -0,0 +1,144 @@
+#include "model_registry.hpp"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "fbs_loader.hpp"
+#include <cstring>
+
+namespace bumblebee_detect {
+
+static const char *TAG = "bumblebee_detect";
+
+#if CONFIG_BUMBLEBEE_DETECT_MODEL_IN_FLASH_RODATA
+extern const uint8_t bumblebee_detect_espdl[] asm("_binary_bumblebee_detect_espdl_start");
+#endif
+
+// Reihenfolge = BumblebeeDetect::model_type_t. Die Latenzen sind Schätzungen, keine
+// Messungen auf dem Gerät; ersetzt werden sie zur Laufzeit durch set_measured_latency().
+static const model_info_t s_manifest[] = {
+    {
+        .name = "espdet_pico_224_224_bumblebee.espdl",
+        .input_width = 224,
+        .input_height = 224,
+        .quant = "int8",
+        .strides = {{8, 8, 4, 4}, {16, 16, 8, 8}, {32, 32, 16, 16}},
+        .score_thr = 0.3f,
+        .nms_thr = 0.7f,
+        .top_k = 10,
+        .latency_placeholder_ms = 135,
+#if CONFIG_FLASH_ESPDET_PICO_224_224_BUMBLEBEE || CONFIG_BUMBLEBEE_DETECT_MODEL_IN_SDCARD
+        .packed = true,
+#else
+        .packed = false,
+#endif
+    },
+    {
+        .name = "espdet_pico_96_96_bumblebee.espdl",
+        .input_width = 96,
+        .input_height = 96,
+        .quant = "int8",
+        .strides = {{8, 8, 4, 4}, {16, 16, 8, 8}, {32, 32, 16, 16}},
+        .score_thr = 0.3f,
+        .nms_thr = 0.7f,
+        .top_k = 10,
+        .latency_placeholder_ms = 30,
+#if CONFIG_FLASH_ESPDET_PICO_96_96_BUMBLEBEE || CONFIG_BUMBLEBEE_DETECT_MODEL_IN_SDCARD
+        .packed = true,
+#else
+        .packed = false,
+#endif
+    },
+};
+
+static constexpr int MODEL_COUNT = sizeof(s_manifest) / sizeof(s_manifest[0]);
+static int s_measured_ms[MODEL_COUNT] = {};
+
+int model_count()
+{
+    return MODEL_COUNT;
+}
+
+const model_info_t &model_info(int index)
+{
+    return s_manifest[index];
+}
+
+int find_model(const char *name)
+{
+    for (int i = 0; i < MODEL_COUNT; ++i) {
+        if (strcmp(s_manifest[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void log_models()
+{
+    int packed = 0;
+    for (int i = 0; i < MODEL_COUNT; ++i) {
+        const model_info_t &m = s_manifest[i];
+        packed += m.packed;
+        ESP_LOGI(TAG, "[%d] %s %dx%d %s, %u heads, score %.2f, nms %.2f, %d ms %s%s", i, m.name, m.input_width,
+                 m.input_height, m.quant, (unsigned)m.strides.size(), m.score_thr, m.nms_thr, latency_ms(i),
+                 latency_measured(i) ? "measured" : "placeholder", m.packed ? "" : " (not packed)");
+    }
+
+#if CONFIG_BUMBLEBEE_DETECT_MODEL_IN_FLASH_RODATA || CONFIG_BUMBLEBEE_DETECT_MODEL_IN_FLASH_PARTITION
+#if CONFIG_BUMBLEBEE_DETECT_MODEL_IN_FLASH_RODATA
+    fbs::FbsLoader loader((const char *)bumblebee_detect_espdl, fbs::MODEL_LOCATION_IN_FLASH_RODATA);
+#else
+    fbs::FbsLoader loader("bumblebee_det", fbs::MODEL_LOCATION_IN_FLASH_PARTITION);
+#endif
+    int found = loader.get_model_num();
+    if (found != packed) {
+        ESP_LOGW(TAG, "Manifest lists %d packed model(s), image contains %d", packed, found);
+    }
+#endif
+}
+
+void set_measured_latency(int index, int latency_ms)
+{
+    if (index >= 0 && index < MODEL_COUNT) {
+        s_measured_ms[index] = latency_ms;
+    }
+}
+
+int latency_ms(int index)
+{
+    return latency_measured(index) ? s_measured_ms[index] : s_manifest[index].latency_placeholder_ms;
+}
+
+bool latency_measured(int index)
+{
+    return s_measured_ms[index] > 0;
+}
+
+// Latenz, mit der die Auswahl rechnet: gemessen oder der Platzhalter mit Sicherheitsfaktor
+static int budget_latency_ms(int index)
+{
+    return latency_measured(index) ? s_measured_ms[index]
+                                   : s_manifest[index].latency_placeholder_ms * PLACEHOLDER_FACTOR;
+}
+
+int select_model(int budget_ms)
+{
+    int best = -1;
+    int fastest = -1;
+    for (int i = 0; i < MODEL_COUNT; ++i) {
+        const model_info_t &m = s_manifest[i];
+        if (!m.packed) {
+            continue;
+        }
+        if (fastest < 0 || budget_latency_ms(i) < budget_latency_ms(fastest)) {
+            fastest = i;
+        }
+        int area = m.input_width * m.input_height;
+        if (budget_latency_ms(i) <= budget_ms &&
+            (best < 0 || area > s_manifest[best].input_width * s_manifest[best].input_height)) {
+            best = i;
+        }
+    }
+    return best >= 0 ? best : fastest;
+}
+
+} // namespace bumblebee_detect
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Manifest der Modellvarianten, die in bumblebee_det (bzw. rodata oder SD-Karte)
+// liegen können. Der Index eines Eintrags entspricht BumblebeeDetect::model_type_t.
+namespace bumblebee_detect {
+
+struct model_info_t {
+    const char *name;                       // Dateiname im gepackten Modell
+    int input_width;
+    int input_height;
+    const char *quant;                      // Quantisierung, z.B. "int8"
+    std::vector<std::vector<int>> strides;  // ESPDet-Heads {stride_y, stride_x, offset_y, offset_x}
+    float score_thr;
+    float nms_thr;
+    int top_k;
+    int latency_placeholder_ms;             // Platzhalter ESP32-S3 inkl. Pre-/Postprocessing, nicht gemessen
+    bool packed;                            // per menuconfig geflasht bzw. auf der SD-Karte erwartet
+};
+
+int model_count();
+const model_info_t &model_info(int index);
+int find_model(const char *name);
+
+// Listet das Manifest beim Boot und prüft die Anzahl gegen das gepackte Modell. Ob ein
+// geladenes Modell zu seinem Eintrag passt, prüft ESPDet beim Laden.
+void log_models();
+
+// Gemessene Latenz eines Modells, ersetzt den Platzhalter aus dem Manifest.
+void set_measured_latency(int index, int latency_ms);
+int latency_ms(int index);
+bool latency_measured(int index);
+
+// Sicherheitsfaktor für ungemessene Latenzen bei der Modellwahl
+static constexpr int PLACEHOLDER_FACTOR = 2;
+
+// Genauestes (größter Input) gepacktes Modell, dessen Latenz ins Budget passt; ungemessene
+// zählen mit PLACEHOLDER_FACTOR mal ihrem Platzhalter.
+// Passt keines, das schnellste gepackte Modell; -1, wenn keines gepackt ist.
+int select_model(int budget_ms);
+
+} // namespace bumblebee_detect
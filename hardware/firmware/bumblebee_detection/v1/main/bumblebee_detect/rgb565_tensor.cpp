@@ -0,0 +1,144 @@
+#include "rgb565_tensor.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace bumblebee_detect {
+
+// --------- Internal helpers ----------------------------------
+
+static bool roi_is_valid(const uint8_t *src, int src_width, int src_height, int x0, int y0, int roi_width,
+                         int roi_height, const int8_t *dst)
+{
+    return src && dst && roi_width > 0 && roi_height > 0 && x0 >= 0 && y0 >= 0 && x0 + roi_width <= src_width &&
+        y0 + roi_height <= src_height;
+}
+
+static int8_t quantize(int value, float mean, float std, int exponent)
+{
+    const int q = (int)nearbyintf(((float)value - mean) / std * ldexpf(1.0f, -exponent));
+    return (int8_t)(q < -128 ? -128 : (q > 127 ? 127 : q));
+}
+
+// src[0] = RRRRRGGG, src[1] = GGGBBBBB
+static inline void convert_pixel(const uint8_t *src, const rgb565_lut_t &lut, int8_t *dst)
+{
+    dst[0] = lut.r[src[0] >> 3];
+    dst[1] = lut.g[((src[0] & 0x07) << 3) | (src[1] >> 5)];
+    dst[2] = lut.b[src[1] & 0x1F];
+}
+
+static void convert_row(const uint8_t *src, const rgb565_lut_t &lut, int8_t *dst, int width)
+{
+    int x = 0;
+    // Zwei Pixel pro Lesezugriff, sechs Ausgabebytes am Stück
+    for (; x + 2 <= width; x += 2) {
+        uint32_t w;
+        memcpy(&w, src, sizeof(w));
+        const uint32_t hi0 = w & 0xFF, lo0 = (w >> 8) & 0xFF;
+        const uint32_t hi1 = (w >> 16) & 0xFF, lo1 = w >> 24;
+        int8_t px[6] = {lut.r[hi0 >> 3], lut.g[((hi0 & 0x07) << 3) | (lo0 >> 5)], lut.b[lo0 & 0x1F],
+                        lut.r[hi1 >> 3], lut.g[((hi1 & 0x07) << 3) | (lo1 >> 5)], lut.b[lo1 & 0x1F]};
+        memcpy(dst, px, sizeof(px));
+        src += 4;
+        dst += 6;
+    }
+    if (x < width) {
+        convert_pixel(src, lut, dst);
+    }
+}
+
+static constexpr char DUMP_MAGIC[4] = {'B', 'P', 'R', 'E'};
+static constexpr uint32_t DUMP_VERSION = 1;
+
+// --------- Public API ----------------------------------
+
+void make_rgb565_lut(const float mean[3], const float std[3], int exponent, rgb565_lut_t &lut)
+{
+    for (int i = 0; i < 32; ++i) {
+        lut.r[i] = quantize(i << 3, mean[0], std[0], exponent);
+        lut.b[i] = quantize(i << 3, mean[2], std[2], exponent);
+    }
+    for (int i = 0; i < 64; ++i) {
+        lut.g[i] = quantize(i << 2, mean[1], std[1], exponent);
+    }
+}
+
+bool rgb565_roi_to_tensor(const uint8_t *src, int src_width, int src_height, int x0, int y0, int roi_width,
+                          int roi_height, const rgb565_lut_t &lut, int8_t *dst)
+{
+    if (!roi_is_valid(src, src_width, src_height, x0, y0, roi_width, roi_height, dst)) {
+        return false;
+    }
+    const size_t src_stride = (size_t)src_width * 2;
+    const size_t dst_stride = (size_t)roi_width * 3;
+    const uint8_t *src_row = src + y0 * src_stride + x0 * 2;
+    for (int y = 0; y < roi_height; ++y) {
+        convert_row(src_row, lut, dst, roi_width);
+        src_row += src_stride;
+        dst += dst_stride;
+    }
+    return true;
+}
+
+bool rgb565_roi_to_tensor_ref(const uint8_t *src, int src_width, int src_height, int x0, int y0, int roi_width,
+                              int roi_height, const float mean[3], const float std[3], int exponent, int8_t *dst)
+{
+    if (!roi_is_valid(src, src_width, src_height, x0, y0, roi_width, roi_height, dst)) {
+        return false;
+    }
+    for (int y = 0; y < roi_height; ++y) {
+        const uint8_t *px = src + ((size_t)(y0 + y) * src_width + x0) * 2;
+        for (int x = 0; x < roi_width; ++x, px += 2, dst += 3) {
+            const int rgb[3] = {px[0] & 0xF8, ((px[0] & 0x07) << 5) | ((px[1] & 0xE0) >> 3), (px[1] & 0x1F) << 3};
+            for (int c = 0; c < 3; ++c) {
+                dst[c] = quantize(rgb[c], mean[c], std[c], exponent);
+            }
+        }
+    }
+    return true;
+}
+
+void make_rgb565_pattern(uint8_t *dst, int width, int height)
+{
+    const size_t pixels = (size_t)width * height;
+    for (size_t i = 0; i < pixels; ++i) {
+        const uint16_t v = (uint16_t)(i * 40503u);
+        dst[i * 2] = v >> 8;
+        dst[i * 2 + 1] = v & 0xFF;
+    }
+}
+
+// Gerät und Host sind little endian, Werte gehen roh in die Datei
+bool write_tensor_dump(FILE *f, const tensor_dump_t &dump)
+{
+    const int32_t header[3] = {dump.width, dump.height, dump.exponent};
+    return dump.tensor.size() == (size_t)dump.width * dump.height * 3 &&
+        fwrite(DUMP_MAGIC, sizeof(DUMP_MAGIC), 1, f) == 1 && fwrite(&DUMP_VERSION, sizeof(DUMP_VERSION), 1, f) == 1 &&
+        fwrite(header, sizeof(header), 1, f) == 1 && fwrite(dump.mean, sizeof(dump.mean), 1, f) == 1 &&
+        fwrite(dump.std, sizeof(dump.std), 1, f) == 1 &&
+        fwrite(dump.tensor.data(), 1, dump.tensor.size(), f) == dump.tensor.size();
+}
+
+bool read_tensor_dump(FILE *f, tensor_dump_t &dump)
+{
+    char magic[sizeof(DUMP_MAGIC)];
+    uint32_t version = 0;
+    int32_t header[3];
+    if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, DUMP_MAGIC, sizeof(magic)) != 0 ||
+        fread(&version, sizeof(version), 1, f) != 1 || version != DUMP_VERSION ||
+        fread(header, sizeof(header), 1, f) != 1 || fread(dump.mean, sizeof(dump.mean), 1, f) != 1 ||
+        fread(dump.std, sizeof(dump.std), 1, f) != 1) {
+        return false;
+    }
+    if (header[0] <= 0 || header[1] <= 0 || header[0] > 4096 || header[1] > 4096) {
+        return false;
+    }
+    dump.width = header[0];
+    dump.height = header[1];
+    dump.exponent = header[2];
+    dump.tensor.resize((size_t)dump.width * dump.height * 3);
+    return fread(dump.tensor.data(), 1, dump.tensor.size(), f) == dump.tensor.size();
+}
+
+} // namespace bumblebee_detect
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace bumblebee_detect {
+
+// Normalisierung und Quantisierung des Modell-Inputs je Kanal als Tabelle über die
+// RGB565-Feldwerte: r[32], g[64], b[32]. Da RGB565 -> RGB888 nur schiebt (wie
+// dl::image::RGB5652RGB888), hängt jeder int8-Wert nur vom jeweiligen Feld ab.
+struct rgb565_lut_t {
+    int8_t r[32];
+    int8_t g[64];
+    int8_t b[32];
+};
+
+// Wie ImagePreprocessor: q = clip(round(((v - mean) / std) * 2^-exponent))
+void make_rgb565_lut(const float mean[3], const float std[3], int exponent, rgb565_lut_t &lut);
+
+// ROI eines RGB565-Bildes (big endian, wie vom Kamera-Treiber) in einem Durchgang in den
+// int8-Input (HWC, RGB) schreiben. dst muss roi_width * roi_height * 3 Bytes fassen.
+// Liefert false, wenn die ROI nicht vollständig im Quellbild liegt.
+bool rgb565_roi_to_tensor(const uint8_t *src, int src_width, int src_height, int x0, int y0, int roi_width,
+                          int roi_height, const rgb565_lut_t &lut, int8_t *dst);
+
+// Skalare Referenz des bisherigen Wegs: RGB565 -> RGB888 -> normalisieren -> quantisieren,
+// je Pixel in float wie der ImagePreprocessor ohne Letterbox (Quelle = Input-Größe)
+bool rgb565_roi_to_tensor_ref(const uint8_t *src, int src_width, int src_height, int x0, int y0, int roi_width,
+                              int roi_height, const float mean[3], const float std[3], int exponent, int8_t *dst);
+
+// Testmuster der Prüfung beim Laden, width * height Pixel RGB565 big endian: ungerader
+// Faktor, verschiedene Werte je Pixel, alle Feldwerte kommen vor
+void make_rgb565_pattern(uint8_t *dst, int width, int height);
+
+// Abzug des ImagePreprocessor-Ergebnisses für das Testmuster (CONFIG_BUMBLEBEE_DETECT_DUMP_PREPROCESS),
+// für die Host-Tests. Little endian: "BPRE", u32 version, i32 width, i32 height, i32 exponent,
+// f32 mean[3], f32 std[3], int8 tensor[height * width * 3] (HWC, RGB)
+struct tensor_dump_t {
+    int width = 0;
+    int height = 0;
+    int exponent = 0;
+    float mean[3] = {};
+    float std[3] = {};
+    std::vector<int8_t> tensor;
+};
+
+bool write_tensor_dump(FILE *f, const tensor_dump_t &dump);
+bool read_tensor_dump(FILE *f, tensor_dump_t &dump);
+
+} // namespace bumblebee_detect
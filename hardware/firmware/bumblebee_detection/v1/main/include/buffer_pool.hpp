@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace bufpool {
+
+enum slot_type_t {
+    SLOT_RGB565_FRAME = 0,  // Kamera-Frame über den Lease hinaus, bei JPEG-Aufnahme der dekodierte ROI
+    SLOT_RGB888_ROI,        // Modell-Ausschnitt in RGB888 (Archiv/Annotation)
+    SLOT_JPEG_OUT,          // Ausgabepuffer des JPEG-Encoders
+    SLOT_JPEG_IN,           // Kopie des Sensor-JPEGs bis zur Übergabe an storage
+    SLOT_TYPE_COUNT
+};
+
+static constexpr int MAX_SLOTS_PER_TYPE = 16;
+
+struct slot_config_t {
+    size_t bytes;
+    uint8_t count;
+    uint32_t caps;           // heap_caps für die Platzierung (MALLOC_CAP_SPIRAM / MALLOC_CAP_INTERNAL ...)
+    uint32_t fallback_caps;  // 0 = kein Ausweichen, sonst zweiter Versuch mit diesen caps
+};
+
+struct pool_config_t {
+    slot_config_t slots[SLOT_TYPE_COUNT];
+};
+
+// Standardgrößen aus Framegröße und Modell-Input
+pool_config_t make_config(int frame_width, int frame_height, int model_width, int model_height,
+                          uint8_t frames, uint8_t rois, uint8_t jpegs);
+
+class BufferPool;
+
+// RAII-Handle auf einen Slot; gibt ihn im Destruktor an den Pool zurück.
+class Buffer {
+public:
+    Buffer() = default;
+    ~Buffer() { reset(); }
+    Buffer(Buffer &&other);
+    Buffer &operator=(Buffer &&other);
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
+
+    explicit operator bool() const { return m_data != nullptr; }
+    uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    void reset();
+
+private:
+    friend class BufferPool;
+    Buffer(BufferPool *pool, slot_type_t type, int index, uint8_t *data, size_t size)
+        : m_pool(pool), m_type(type), m_index(index), m_data(data), m_size(size) {}
+
+    BufferPool *m_pool = nullptr;
+    slot_type_t m_type = SLOT_TYPE_COUNT;
+    int m_index = -1;
+    uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// Pool fester Kapazität: alle Slots werden einmalig in init() allokiert,
+// acquire()/release sind danach allokationsfrei und lock-free.
+class BufferPool {
+public:
+    BufferPool() = default;
+    ~BufferPool();
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    bool init(const pool_config_t &cfg);
+
+    // Leeres Handle, wenn kein Slot frei ist (es wird nie auf den Heap ausgewichen)
+    Buffer acquire(slot_type_t type);
+
+    int free_slots(slot_type_t type) const;
+    size_t slot_bytes(slot_type_t type) const { return m_cfg.slots[type].bytes; }
+    uint32_t exhausted(slot_type_t type) const { return m_exhausted[type].load(); }
+    void log_stats() const;
+
+private:
+    friend class Buffer;
+    void release(slot_type_t type, int index);
+
+    pool_config_t m_cfg = {};
+    uint8_t *m_data[SLOT_TYPE_COUNT][MAX_SLOTS_PER_TYPE] = {};
+    std::atomic<uint32_t> m_free_mask[SLOT_TYPE_COUNT] = {};  // Bit gesetzt = Slot frei
+    std::atomic<uint32_t> m_exhausted[SLOT_TYPE_COUNT] = {};
+};
+
+} // namespace bufpool
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include "segment_file.hpp"
+#include "storage_backend.hpp"
+
+// Append-only Sidecar mit den Detektionen je archiviertem Frame, getrennt vom Bild: die
+// Frames bleiben unbemalt (Trainingsdaten), Vorschau und YOLO-Labels entstehen auf dem Host.
+//
+//   [file_header_t 32 B][record_t][record_t]...
+//
+// Alle Records haben dieselbe Größe (record_size im Header), Record n liegt also bei
+// header_size + n * record_size. Jeder Record trägt CRC32 (IEEE, wie zlib.crc32) über
+// alles vor dem CRC-Feld. Über mehrere Boots wird weiter angehängt; ein abgerissener
+// Record am Ende wird beim Öffnen abgeschnitten. Little endian.
+// Leser auf dem Host: scripts/detections.py
+namespace detlog {
+
+static constexpr uint32_t FILE_MAGIC = 0x54454442;  // "BDET"
+static constexpr uint16_t VERSION = 1;
+static constexpr int MAX_BOXES = 10;                // wie MAX_RESULTS in pipeline.cpp
+
+enum record_flag_t : uint8_t {
+    FLAG_ANNOTATED = 1 << 0,      // Boxen sind ins Bild gezeichnet (CONFIG_BEESENSE_ANNOTATE_FRAMES)
+    FLAG_SENSOR_JPEG = 1 << 1,    // Bild ist das unveränderte Sensor-JPEG (JPEG-Aufnahme)
+};
+
+struct file_header_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint16_t record_size;
+    uint16_t max_boxes;
+    uint32_t reserved[4];
+    uint32_t crc;             // über die ersten 28 Byte
+};
+static_assert(sizeof(file_header_t) == 32, "detection log header must be 32 bytes");
+
+// Wo das Bild zum Record liegt: Segment-Session und Record-Nummer im Segment
+// (seg_<session>.bseg), bei Einzeldateien session 0 und die Dateinummer (bumblebee_<seq>.jpg)
+struct image_ref_t {
+    uint32_t session;
+    uint32_t seq;
+};
+
+struct record_t {
+    uint32_t frame_id;
+    image_ref_t image;
+    uint16_t model_id;        // Index im Modellmanifest (model_registry.cpp)
+    uint8_t box_count;
+    uint8_t flags;            // record_flag_t
+    int64_t t_us;             // Aufnahmezeitpunkt, esp_timer (monoton ab Boot)
+    uint16_t image_width;     // Größe des gespeicherten Bildes, Bezug der Boxen
+    uint16_t image_height;
+    uint16_t score_thr_permille;
+    uint16_t nms_thr_permille;
+    segment::box_meta_t boxes[MAX_BOXES];
+    uint32_t reserved;
+    uint32_t crc;             // über alles davor
+};
+static_assert(sizeof(record_t) == 160, "detection record must be 160 bytes");
+
+struct writer_stats_t {
+    uint32_t records;         // in diesem Lauf angehängt
+    uint32_t existing;        // beim Öffnen schon vorhanden
+    uint32_t truncated;       // beim Öffnen abgeschnittene Bytes (abgerissener Record)
+    uint32_t flushes;
+};
+
+class Writer {
+public:
+    ~Writer();
+
+    // Legt die Datei an oder hängt an eine bestehende an. Eine Datei mit anderem
+    // Format (Magic, Version, Recordgröße) wird nicht angefasst.
+    bool open(const char *path, int64_t flush_interval_us, storage::Backend *fs = nullptr);
+    bool is_open() const { return m_file != nullptr; }
+
+    // Setzt rec.crc; Group Commit wie beim Segment, spätestens nach flush_interval_us
+    bool append(record_t &rec);
+    bool flush();
+    bool close();
+
+    const writer_stats_t &stats() const { return m_stats; }
+
+private:
+    bool create_header();
+    bool check_header();
+
+    FILE *m_file = nullptr;
+    storage::Backend *m_fs = nullptr;
+    int64_t m_flush_interval_us = 0;
+    int64_t m_last_flush_us = 0;
+    bool m_dirty = false;
+    writer_stats_t m_stats = {};
+};
+
+} // namespace detlog
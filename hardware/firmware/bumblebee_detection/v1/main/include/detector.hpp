@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include "dl_image_define.hpp"
+#include "result_list.hpp"
+
+namespace detector {
+
+// Was die Pipeline-Stufen (pipeline_stages.hpp) vom Detektor brauchen. Auf dem Gerät
+// DetectorService mit esp-dl, im Host-Replay ein Stand-in ohne Modell.
+// Boxen kommen in Koordinaten des übergebenen Bildes zurück; die ResultList gilt bis
+// zum nächsten Aufruf.
+class Detector {
+public:
+    virtual ~Detector() = default;
+
+    virtual bool cascade_enabled() const = 0;
+    virtual int model_index() const = 0;
+    // Schwellen der gemeldeten Boxen, für den Detektions-Sidecar
+    virtual float min_score() const = 0;
+    virtual float nms_threshold() const = 0;
+
+    // Zweiteiliger Aufruf: nach preprocess() wird img nicht mehr gelesen.
+    virtual void preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area = {}) = 0;
+    virtual const ResultList &infer(int img_width, int img_height) = 0;
+
+    // Einstufig oder als Kaskade. img muss bis zur Rückkehr gültig bleiben.
+    virtual const ResultList &detect(const dl::image::img_t &img, const std::vector<int> &crop_area = {}) = 0;
+};
+
+} // namespace detector
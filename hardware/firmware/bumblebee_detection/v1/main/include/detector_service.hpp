@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "bumblebee_detect.hpp"
+#include "detector.hpp"
+#include "dl_image_jpeg.hpp"
+#include "result_list.hpp"
+
+namespace detector {
+
+struct detector_stats_t {
+    uint32_t loads;             // Anzahl Modell-Ladevorgänge (Boot + reload)
+    int64_t last_load_us;       // Dauer des letzten Ladevorgangs inkl. minimize()
+    int64_t last_warmup_us;     // erste Inferenz nach dem Laden
+    uint32_t calls;             // Inferenzen im Betrieb
+    int64_t last_preprocess_us;
+    int64_t last_infer_us;      // Modell + Postprocessing
+    int64_t last_postprocess_us;  // davon Postprocessing
+    int64_t total_call_us;
+    int64_t max_call_us;
+    uint32_t screen_fired;      // Kaskade: Zyklen, in denen Stufe 2 lief
+    int64_t last_screen_us;     // Kaskade: Stufe 1 inkl. Pre-/Postprocessing
+    int64_t last_confirm_us;    // Kaskade: Stufe 2 inkl. Pre-/Postprocessing
+};
+
+// Zweistufige Kaskade: das 96x96-Modell prüft jeden Ausschnitt, das 224x224-Modell
+// läuft nur, wenn Stufe 1 über screen_thr anschlägt. Beide Modelle bleiben resident.
+struct cascade_config_t {
+    bool enabled;
+    float screen_thr;           // Stufe 1, bewusst niedrig; Stufe 2 nutzt min_score
+    bool refine;                // Stufe 2 nur um die Stufe-1-Boxen statt auf dem ganzen Ausschnitt
+    int refine_margin;          // Rand um die vereinigten Stufe-1-Boxen (px)
+    int refine_min_size;        // Mindestkantenlänge der Stufe-2-Region (px)
+};
+
+// Langlebiger Detektor: das Modell wird einmal beim Boot geladen und bleibt
+// resident. Ergebnisse werden in einer wiederverwendeten ResultList abgelegt,
+// die bis zum nächsten Aufruf gültig ist.
+//
+// Nach start() läuft alles außer use_model(), apply_budget(), stats() und log_stats() im
+// Inferenz-Task; die vier dürfen aus einem anderen Task kommen.
+class DetectorService : public Detector {
+public:
+    explicit DetectorService(float min_score = 0.35f, const cascade_config_t &cascade = {});
+    ~DetectorService();
+    DetectorService(const DetectorService &) = delete;
+    DetectorService &operator=(const DetectorService &) = delete;
+
+    // Lädt das Modell und wärmt es optional mit einem JPEG (z.B. bumblebee.jpg) auf.
+    bool start(const dl::image::jpeg_img_t *warmup_jpeg = nullptr);
+    // Verwirft das geladene Modell und lädt es neu, ohne Neustart.
+    bool reload(const dl::image::jpeg_img_t *warmup_jpeg = nullptr);
+    void stop();
+    bool is_ready() const { return m_detect != nullptr; }
+    bool cascade_enabled() const override { return m_cascade.enabled; }
+
+    // Modellwahl aus dem Manifest (bumblebee_detect::model_info). Vor start() wirkt sie
+    // sofort, danach wird beim nächsten Aufruf aus dem Inferenz-Task umgeschaltet.
+    void use_model(int index);
+    // Beim nächsten Aufruf im Inferenz-Task: Latenz des aktiven Modells übernehmen und das
+    // genaueste Modell wählen, das ins Budget (ms pro Inferenz) passt.
+    void apply_budget(int budget_ms);
+    int model_index() const override { return m_model_index.load(std::memory_order_relaxed); }
+    float min_score() const override { return m_min_score; }
+    float nms_threshold() const override { return bumblebee_detect::model_info(model_index()).nms_thr; }
+
+    // preprocess()/infer() immer einstufig mit dem 224x224-Modell, detect() als Kaskade,
+    // wenn sie aktiviert ist
+    void preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area = {}) override;
+    const ResultList &infer(int img_width, int img_height) override;
+    const ResultList &detect(const dl::image::img_t &img, const std::vector<int> &crop_area = {}) override;
+
+    // Stand nach dem letzten Aufruf, Kopie unter Sperre
+    detector_stats_t stats() const;
+    void log_stats() const;
+
+private:
+    bool load();
+    void warmup(const dl::image::jpeg_img_t *warmup_jpeg);
+    const ResultList &collect(std::list<dl::detect::result_t> &raw);
+    const ResultList &cascade(const dl::image::img_t &img, const std::vector<int> &crop_area);
+    void record_call(int64_t end_us);
+    void publish_stats();
+    void select_for_budget(int budget_ms);
+    void switch_pending();
+
+    BumblebeeDetect *m_detect = nullptr;
+    BumblebeeDetect *m_screen = nullptr;  // 96x96, nur mit aktivierter Kaskade
+    float m_min_score;
+    cascade_config_t m_cascade;
+    std::atomic<int> m_model_index{BumblebeeDetect::ESPDET_PICO_224_224_BUMBLEBEE};  // Hauptmodell bzw. Stufe 2
+    std::atomic<int> m_pending_model{-1};
+    std::atomic<int> m_pending_budget_ms{-1};
+    ResultList m_results;
+    std::vector<int> m_area;       // Kaskade: Region der Stufe 2, wiederverwendet
+    detector_stats_t m_stats = {};      // nur der Inferenz-Task schreibt
+    mutable std::mutex m_stats_lock;
+    detector_stats_t m_published = {};  // Kopie für andere Tasks, unter m_stats_lock
+    int64_t m_call_start_us = 0;
+};
+
+} // namespace detector
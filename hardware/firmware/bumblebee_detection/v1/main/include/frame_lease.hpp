@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include "esp_camera.h"
+#include "dl_image_define.hpp"
+
+namespace camera {
+
+// Ein Frame, der länger als dieses Budget gehalten wird, blockiert den zweiten
+// Framebuffer des Treibers (fb_count = 2) und wird als "late release" gezählt.
+static constexpr int64_t LEASE_HOLD_BUDGET_US = 50 * 1000;
+
+struct lease_stats_t {
+    uint32_t leases;         // zurückgegebene Frames
+    uint32_t late_releases;  // länger als LEASE_HOLD_BUDGET_US gehalten
+    int64_t last_hold_us;
+    int64_t max_hold_us;
+    int64_t total_hold_us;
+};
+
+// Besitz eines Kamera-Framebuffers (esp_camera_fb_get/esp_camera_fb_return).
+// Der Treiberpuffer wird ohne Kopie gelesen und spätestens im Destruktor
+// zurückgegeben; release() gibt ihn früher frei, sobald er nicht mehr gebraucht wird.
+class FrameLease {
+public:
+    static FrameLease acquire();
+
+    FrameLease() = default;
+    ~FrameLease();
+    FrameLease(FrameLease &&other);
+    FrameLease &operator=(FrameLease &&other);
+    FrameLease(const FrameLease &) = delete;
+    FrameLease &operator=(const FrameLease &) = delete;
+
+    explicit operator bool() const { return m_fb != nullptr; }
+    const camera_fb_t *fb() const { return m_fb; }
+    int width() const { return m_fb ? m_fb->width : 0; }
+    int height() const { return m_fb ? m_fb->height : 0; }
+
+    // RGB565-Sicht auf den Treiberpuffer, nur gültig solange der Lease gehalten wird.
+    dl::image::img_t image() const;
+
+    void release();
+
+private:
+    explicit FrameLease(camera_fb_t *fb);
+
+    camera_fb_t *m_fb = nullptr;
+    int64_t m_acquired_us = 0;
+};
+
+// Momentaufnahme; Frames werden aus capture (Core 0) und infer (Core 1) zurückgegeben
+lease_stats_t lease_stats();
+void log_lease_stats();
+
+} // namespace camera
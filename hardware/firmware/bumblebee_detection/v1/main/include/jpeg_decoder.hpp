@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_jpeg_dec.h"
+
+namespace jpegdec {
+
+static constexpr int MAX_SCALE_SHIFT = 3;   // esp_new_jpeg skaliert um 1/2, 1/4, 1/8
+
+struct decode_stats_t {
+    uint32_t images;
+    uint32_t failed;
+    uint32_t last_us;
+    int64_t total_us;
+    uint32_t max_us;
+    uint64_t in_bytes;         // gelesene JPEG-Bytes
+    uint64_t out_bytes;        // in den Ausschnitt geschriebene RGB565-Bytes
+    uint32_t blocks;           // dekodierte Blockzeilen
+    uint32_t blocks_skipped;   // Blockzeilen unter dem Ausschnitt, gar nicht dekodiert
+};
+
+// Dekodiert aus einem JPEG (PIXFORMAT_JPEG der Kamera) nur den Ausschnitt, den die Inferenz
+// braucht, als RGB565 big endian wie der Kamera-Framebuffer. esp_new_jpeg läuft im Blockmodus:
+// eine Blockzeile (eine MCU-Zeile) nach der anderen in einen kleinen Puffer im internen RAM,
+// kopiert werden nur die Spalten des Ausschnitts; nach dessen letzter Zeile bricht der
+// Decoder ab. Mit scale_shift skaliert der Decoder schon bei der IDCT um 1 / 2^shift, die
+// Koordinaten des Ausschnitts gelten dann im skalierten Bild.
+// Handle und Blockpuffer bleiben zwischen den Bildern offen, neu geöffnet wird nur bei
+// geänderter Ausgabegröße: im Betrieb dekodiert der Decoder ohne Heap-Allokation.
+// Nicht threadsicher.
+class Decoder {
+public:
+    ~Decoder();
+
+    // width/height: Größe des JPEGs (camera_fb_t), wird gegen den Header geprüft.
+    // dst muss roi_width * roi_height * 2 Bytes fassen.
+    bool decode_roi(const uint8_t *jpeg, size_t len, int width, int height, int scale_shift, int x0, int y0,
+                    int roi_width, int roi_height, uint8_t *dst);
+    void close();
+
+    const decode_stats_t &stats() const { return m_stats; }
+    void log_stats() const;
+
+private:
+    bool run(jpeg_dec_handle_t handle, const uint8_t *jpeg, size_t len, int width, int height, int scale_shift,
+             int x0, int y0, int roi_width, int roi_height, uint8_t *dst);
+    bool open_handle(int out_width, int out_height, int scale_shift);
+    void close_handle();
+    bool reserve_block(size_t size);
+
+    jpeg_dec_handle_t m_handle = nullptr;
+    int m_out_width = 0;
+    int m_out_height = 0;
+    int m_scale_shift = 0;
+    uint8_t *m_block = nullptr;
+    size_t m_block_size = 0;
+    decode_stats_t m_stats = {};
+};
+
+} // namespace jpegdec
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "sdkconfig.h"
+#include "storage_backend.hpp"
+
+// Speicher-Telemetrie für internen RAM und PSRAM: freier Speicher und Tiefstand seit dem Boot
+// (heap_caps_get_minimum_free_size), jeweils rund um die Phasen beim Start (Modell laden,
+// minimize(), Warmup, Pipeline-Start) und um jeden Durchlauf der Pipeline-Stufen. Beides sind
+// Zählerstände und kosten fast nichts. Den größten freien Block (ein Lauf über die Freiliste)
+// lesen nur check(), log_report() und write_csv(); je Stufe gibt es ihn nur für Phasen, deren
+// Stände ihn mitbringen (Laden und minimize() aus dem ESPDet-Konstruktor).
+//
+// Jede Stufe hat eine eigene Sperre gegen den Bericht; die Pipeline-Tasks teilen keine.
+//
+// Spitzen: Setzt eine Stufe während ihres Durchlaufs einen neuen Tiefstand, wird ihr der
+// Verbrauch über ihren Startstand zugeschrieben. Die Stufen laufen parallel auf zwei Cores;
+// eine Spitze kann deshalb auch von einer gleichzeitig laufenden Stufe stammen.
+//
+// Warnungen: Jede Stufe kann einen benötigten zusammenhängenden Block je Speicher haben
+// (require(), z.B. das Modell für reload()). Fällt der größte freie Block unter diesen Bedarf
+// plus Reserve oder der freie Speicher unter die beobachtete Spitze einer laufenden Stufe plus
+// Reserve, wird einmal gewarnt, bis sich der Speicher wieder erholt. Geprüft wird in check()
+// und log_report(), nicht bei jedem Durchlauf.
+namespace memtel {
+
+enum pool_t {
+    POOL_INTERNAL = 0,
+    POOL_PSRAM,
+    POOL_COUNT
+};
+
+enum stage_t : uint8_t {
+    STAGE_BOOT = 0,
+    STAGE_MODEL_LOAD,      // dl::Model laden, bis vor minimize()
+    STAGE_MINIMIZE,
+    STAGE_WARMUP,          // JPEG dekodieren und erste Inferenz
+    STAGE_PIPELINE_START,  // Puffer-Pool, Encoder, Write-Ring, Segment
+    STAGE_CAPTURE,
+    STAGE_INFER,
+    STAGE_ENCODE,
+    STAGE_STORAGE,
+    STAGE_COUNT
+};
+
+struct heap_t {
+    uint32_t free;
+    uint32_t largest;    // größter zusammenhängender freier Block
+    uint32_t min_free;   // Tiefstand seit dem Boot
+};
+
+struct snapshot_t {
+    heap_t pool[POOL_COUNT];
+};
+
+struct stage_mem_t {
+    uint32_t runs;
+    heap_t last[POOL_COUNT];          // nach dem letzten Durchlauf
+    uint32_t low_free[POOL_COUNT];    // kleinster freier Speicher nach einem Durchlauf
+    uint32_t low_largest[POOL_COUNT]; // 0 = nie gemessen (Pipeline-Stufen)
+    uint32_t peak_use[POOL_COUNT];    // größter Verbrauch über den Startstand bei neuem Tiefstand
+    int32_t retained[POOL_COUNT];     // letzter Durchlauf: Ende minus Start (>0 = belegt)
+    uint32_t required[POOL_COUNT];    // benötigter zusammenhängender Block, 0 = unbekannt
+};
+
+// warn_margin_pct: Reserve über Bedarf bzw. Spitze, bevor gewarnt wird
+void init(uint8_t warn_margin_pct);
+// Der größte freie Block kostet einen Lauf über die Freiliste, ohne with_largest bleibt er 0
+snapshot_t capture(bool with_largest = true);
+
+// Phase zwischen zwei Snapshots verbuchen; largest == 0 im Snapshot gilt als nicht gemessen
+void commit(stage_t stage, const snapshot_t &start, const snapshot_t &end);
+// Bedarf einer Stufe, der größte gemeldete Wert gilt
+void require(stage_t stage, pool_t pool, uint32_t bytes);
+// Vor einer Phase: false (mit Warnung), wenn der größte freie Block den Bedarf nicht deckt
+bool check(stage_t stage);
+
+const char *name(stage_t stage);
+// Kopie unter der Sperre der Stufe
+stage_mem_t stage(stage_t stage);
+
+void log_report();
+// Eine Zeile je Aufruf (Kopfzeile bei neuer Datei):
+// uptime_ms,int_free,int_largest,int_min,int_min_stage,psram_free,psram_largest,psram_min,psram_min_stage
+bool write_csv(storage::Backend &fs, const char *path);
+
+// Durchlauf einer Stufe von der Konstruktion bis end() bzw. zur Destruktion
+class Scope {
+public:
+    explicit Scope(stage_t stage) : m_stage(stage), m_start(capture(false)) {}
+    ~Scope() { end(); }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    void end() {
+        if (m_stage != STAGE_COUNT) {
+            commit(m_stage, m_start, capture(false));
+            m_stage = STAGE_COUNT;
+        }
+    }
+
+private:
+    stage_t m_stage;
+    snapshot_t m_start;
+};
+
+} // namespace memtel
+
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+#define MEM_SCOPE(var, stage) memtel::Scope var(stage)
+#define MEM_SCOPE_END(var) var.end()
+#else
+#define MEM_SCOPE(var, stage) ((void)0)
+#define MEM_SCOPE_END(var) ((void)0)
+#endif
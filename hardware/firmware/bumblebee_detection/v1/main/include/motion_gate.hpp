@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace motion {
+
+struct gate_config_t {
+    int step;                // Subsampling: jedes step-te Pixel in x und y (4 -> 56x56 bei 224x224)
+    uint8_t diff_threshold;  // Luma-Differenz zum Hintergrund, ab der ein Pixel als geändert gilt
+    float area_threshold;    // Anteil geänderter Pixel, ab dem der Detektor läuft
+    uint8_t bg_shift;        // Lernrate des Hintergrunds: bg += (y - bg) / 2^bg_shift
+    uint32_t force_every;    // spätestens nach so vielen übersprungenen Frames trotzdem inferieren (0 = nie)
+};
+
+gate_config_t default_gate_config();
+
+enum decision_t {
+    DECISION_SKIP = 0,  // keine Bewegung, Detektor nicht nötig
+    DECISION_INIT,      // erster Frame, Hintergrund wurde initialisiert
+    DECISION_MOTION,    // geänderte Fläche über area_threshold
+    DECISION_FORCED,    // periodische Inferenz für langsame Insekten
+    DECISION_COUNT
+};
+
+struct gate_stats_t {
+    uint32_t decisions[DECISION_COUNT];
+    uint32_t frames;
+    float last_changed_ratio;
+    int64_t last_cost_us;
+    int64_t total_cost_us;
+    int64_t max_cost_us;
+};
+
+// Billiges Vorfilter vor der Inferenz: vergleicht eine unterabgetastete Luma-Ebene
+// des RGB565-Frames (big endian) mit einem laufend nachgeführten Hintergrund.
+// Plattformunabhängig; Speicher wird nur in init() allokiert.
+class MotionGate {
+public:
+    bool init(const gate_config_t &cfg, int roi_width, int roi_height);
+
+    // Bewertet die ROI (x0, y0, roi_width x roi_height aus init) eines Frames
+    // mit frame_width Pixeln pro Zeile und führt den Hintergrund nach.
+    decision_t update(const uint8_t *rgb565, int frame_width, int x0, int y0);
+
+    static bool runs_detector(decision_t d) { return d != DECISION_SKIP; }
+
+    const gate_stats_t &stats() const { return m_stats; }
+    float skip_ratio() const;
+
+private:
+    gate_config_t m_cfg = {};
+    int m_plane_width = 0;
+    int m_plane_height = 0;
+    std::vector<uint16_t> m_background;  // Luma mit 8 Nachkommabits
+    bool m_initialized = false;
+    uint32_t m_since_inference = 0;
+    gate_stats_t m_stats = {};
+};
+
+} // namespace motion
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "capture_scheduler.hpp"
+#include "esp_jpeg_enc.h"
+#include "motion_gate.hpp"
+#include "tracker.hpp"
+
+// Gestufte Verarbeitung: capture -> preprocess+infer -> annotate+encode -> storage.
+// Jede Stufe ist ein eigener FreeRTOS-Task, verbunden über begrenzte Queues.
+// Frame-Records stammen aus einem festen Pool; ist er leer, wartet capture.
+// Alle Bildpuffer kommen aus einem beim Start dimensionierten bufpool::BufferPool,
+// im Dauerbetrieb werden keine Bildpuffer mehr allokiert.
+//
+// Core-Plan (ESP32-S3):
+//   Core 0: cam_task (esp32-camera), capture, encode, storage (SPI-DMA wartet meist)
+//   Core 1: infer allein, damit das Modell nicht mit Encode/SD konkurriert
+// Der JPEG-Encoder läuft deshalb ohne eigenen Huffman-Task (siehe jpeg_encoder.cpp).
+// Der Bewegungsfilter (motion::MotionGate) läuft in capture; Frames ohne Bewegung
+// werden dort verworfen und erreichen infer/encode/storage nicht.
+// Mit CONFIG_BEESENSE_INFER_TILED wird statt des Center-Crops der ganze Frame
+// konvertiert, in überlappenden Kacheln inferiert und vollständig archiviert.
+// Die Detektionen laufen in infer durch den tracking::Tracker, der Ein- und
+// Ausflüge an der Eingangslinie zählt.
+// encode kopiert fertige Records in einen Write-Behind-Ring im PSRAM
+// (writebehind::SpscRing) und gibt den Frame sofort frei; nur storage wartet auf
+// die SD-Karte, Latenzspitzen der Karte bremsen capture und infer nicht mehr.
+// Mit CAPTURE_JPEG liefert der Sensor JPEG: capture dekodiert nur den ROI (jpegdec::Decoder)
+// in einen RGB565-Slot, der für Gate, Konvertierung und Modell-Input den Framebuffer ersetzt,
+// und kopiert das Sensor-JPEG, das encode unverändert als Vollbild archiviert.
+// Was die Stufen mit einem Frame tun, steht in pipeline_stages.cpp (ohne FreeRTOS, auch
+// vom Host-Replay benutzt); hier bleiben Tasks, Queues und der Kamera-Lease.
+namespace detector {
+class DetectorService;
+}
+
+namespace pipeline {
+
+enum stage_t {
+    STAGE_CAPTURE = 0,
+    STAGE_INFER,
+    STAGE_ENCODE,
+    STAGE_STORAGE,
+    STAGE_COUNT
+};
+
+// Verhalten, wenn die Eingangs-Queue einer Stufe voll ist
+enum queue_policy_t {
+    POLICY_BLOCK,        // Produzent wartet (nichts geht verloren)
+    POLICY_DROP_OLDEST,  // ältesten Frame verwerfen, neuen einreihen
+};
+
+enum archive_mode_t {
+    ARCHIVE_FULL_FRAME,   // ganzer ROI-Bereich mit eingezeichneten Boxen
+    ARCHIVE_THUMBNAILS,   // je Detektion ein skalierter Ausschnitt (RECORD_THUMB), nur mit Segmenten
+};
+
+enum capture_format_t {
+    CAPTURE_RGB565,   // Framebuffer wird direkt gelesen
+    CAPTURE_JPEG,     // Sensor-JPEG, nur der ROI wird dekodiert, Vollbilder ohne Neukodierung
+};
+
+struct jpeg_capture_t {
+    int scale_shift;     // Decoder skaliert um 1 / 2^shift; frame_width/height = Sensorgröße >> shift
+    size_t max_bytes;    // größtes Sensor-JPEG, das archiviert werden kann
+};
+
+struct thumb_config_t {
+    int size;                      // Kantenlänge der Thumbnails in Pixel
+    float padding;                 // Rand je Seite, Anteil der längeren Boxseite
+    uint32_t context_interval_ms;  // höchstens so oft zusätzlich ein Vollbild, 0 = nie
+};
+
+struct storage_config_t {
+    bool segments;                       // Segment-Container statt einer JPEG-Datei pro Bild
+    uint32_t segment_bytes;
+    uint32_t segment_flush_ms;           // Group Commit der Segmente
+    size_t write_batch;                  // Schreibblock der Segmente, 0 = stdio-Puffer
+    bool detection_log;                  // <out_dir>/detections.bdet
+    uint32_t log_flush_ms;
+    size_t ring_bytes;                   // Write-Behind-Ring (PSRAM)
+};
+
+struct config_t {
+    int frame_width;                     // Kameraauflösung (bei JPEG nach Skalierung), bestimmt die Puffergrößen
+    int frame_height;
+    capture_format_t capture;
+    jpeg_capture_t jpeg_capture;         // nur CAPTURE_JPEG
+    uint32_t capture_interval_ms;        // fester Takt ohne Scheduler, 0 = Takt der langsamsten Stufe
+    queue_policy_t policy[STAGE_COUNT];  // Policy der Eingangs-Queue je Stufe (capture ungenutzt,
+                                         // storage: Ring voll -> warten oder neuen Record verwerfen)
+    const char *out_dir;
+    bool gate_enabled;                   // Bewegungsfilter vor der Inferenz
+    motion::gate_config_t gate;
+    bool tracker_enabled;                // Tracks über Frames und Zählung an der Eingangslinie
+    tracking::tracker_config_t tracker;
+    bool scheduler_enabled;              // Intervall nach Aktivität statt capture_interval_ms
+    scheduler::scheduler_config_t scheduler;
+    archive_mode_t archive;
+    thumb_config_t thumb;
+    bool annotate;                       // Boxen ins archivierte Vollbild zeichnen
+    storage_config_t storage;
+    uint8_t jpeg_quality;                // Archiv-JPEG, Encoder bleibt über alle Bilder offen
+    jpeg_subsampling_t jpeg_subsampling;
+};
+
+struct stage_stats_t {
+    uint32_t processed;
+    uint32_t dropped;   // aus der Eingangs-Queue verworfen
+    uint32_t failed;
+    int64_t busy_us;
+    int64_t max_us;
+    uint32_t last_us;   // letzter Durchlauf, liest der Scheduler aus capture
+};
+
+config_t default_config();
+
+bool start(const config_t &cfg, detector::DetectorService *detector);
+
+const stage_stats_t &stats(stage_t stage);
+void log_stats();
+
+} // namespace pipeline
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "buffer_pool.hpp"
+#include "capture_scheduler.hpp"
+#include "detector.hpp"
+#include "dl_image_define.hpp"
+#include "dl_image_jpeg.hpp"
+#include "jpeg_decoder.hpp"
+#include "jpeg_encoder.hpp"
+#include "motion_gate.hpp"
+#include "pipeline.hpp"
+#include "result_list.hpp"
+#include "sdkconfig.h"
+#include "segment_file.hpp"
+#include "tiling.hpp"
+#include "tracker.hpp"
+#include "write_behind.hpp"
+
+// Was die Pipeline-Stufen mit einem Frame tun, ohne FreeRTOS: Gate und ROI in capture,
+// Konvertierung, Modell und Tracker in infer, Annotation, Archivbild bzw. Thumbnails,
+// Box-Metadaten und Sidecar-Record in encode, der Write-Behind-Ring dazwischen und das
+// Abarbeiten des Rings in storage. pipeline.cpp ruft die Stufen aus seinen Tasks,
+// host/replay.cpp nacheinander in einem Thread. Tasks, Queues, Wartezeiten und der
+// Kamera-Lease bleiben beim Aufrufer; wo eine Stufe warten oder wecken muss, ruft sie
+// hooks_t.
+namespace stages {
+
+// Zustand eines Frames zwischen den Stufen. pipeline.cpp hängt den Kamera-Lease an.
+struct frame_t {
+    uint32_t id;
+    int64_t capture_us;
+    int frame_width;
+    int frame_height;
+    int x0;                                         // ROI-Ursprung im Frame
+    int y0;
+    dl::image::img_t fb;                            // RGB565-Aufnahme: Framebuffer, bis release_frame
+    bufpool::Buffer roi_buf;
+    bufpool::Buffer jpeg_buf;
+    bufpool::Buffer decoded_buf;                    // JPEG-Aufnahme: ROI als RGB565 big endian
+    bufpool::Buffer sensor_buf;                     // JPEG-Aufnahme: Sensor-JPEG fürs Archiv
+    size_t sensor_len;
+    uint32_t to_tensor_us;                          // Aufnahme bis Modell-Input, ohne Wartezeit in Queues
+    uint16_t model_id;                              // Modell, das results geliefert hat
+    dl::image::img_t roi;                           // RGB888 in roi_buf, Größe roi_width x roi_height
+    detector::ResultList results;                   // feste Kapazität, allokiert nicht
+    dl::image::jpeg_img_t jpeg;                     // zeigt in jpeg_buf
+};
+
+// Vom Treiber geliefertes Bild: RGB565 big endian oder bei CAPTURE_JPEG das Sensor-JPEG
+struct sensor_image_t {
+    const uint8_t *data;
+    size_t len;
+    int width;                                      // Sensorgröße, vor scale_shift
+    int height;
+};
+
+struct capture_result_t {
+    bool ok;
+    bool run_detector;                              // Gate offen, weiter an infer
+    bool motion;                                    // für den Scheduler
+};
+
+// Rückrufe in den Aufrufer, ctx wird durchgereicht
+struct hooks_t {
+    void *ctx;
+    void (*release_frame)(void *ctx, frame_t *f);   // Framebuffer wird nicht mehr gelesen
+    void (*ring_full)(void *ctx);                   // POLICY_BLOCK: warten, bis storage Platz macht
+    void (*ring_pushed)(void *ctx);                 // neuer Record für storage
+};
+
+struct setup_t {
+    int roi_width;                                  // konvertierter, inferierter und archivierter Bereich
+    int roi_height;
+    uint8_t frame_records;                          // frame_t im Umlauf, je ein ROI- und Sensor-JPEG-Slot
+    uint8_t decoded_slots;                          // JPEG-Aufnahme: dekodierte ROIs im Umlauf
+    hooks_t hooks;
+};
+
+// Was archiviert wurde, in beiden Archivmodi gleich gezählt (Vergleich auf denselben Daten)
+struct archive_stats_t {
+    uint32_t frames;        // gespeicherte Vollbilder (im Thumbnail-Modus nur Kontext)
+    uint32_t thumbs;
+    uint32_t detections;    // archivierte Boxen, als Thumbnail oder im Vollbild
+    uint64_t bytes;         // JPEG-Bytes an storage übergeben
+    uint32_t dropped;       // Record nicht in den Ring (zu groß, oder voll ohne POLICY_BLOCK)
+    uint32_t stalls;        // encode musste auf Platz im Ring warten
+    uint32_t sidecar_failed;  // Bild gespeichert, Sidecar-Record nicht
+};
+
+// Was die Aufnahme pro Frame kostet, zum Vergleich von RGB565- und JPEG-Aufnahme
+struct capture_cost_t {
+    uint32_t frames;
+    uint64_t sensor_bytes;     // per DMA vom Sensor in den Framebuffer
+    uint64_t decoded_bytes;    // JPEG: dekodierter ROI
+    uint64_t converted_bytes;  // RGB888-Ausschnitt
+    uint64_t copied_bytes;     // JPEG: Sensor-JPEG fürs Archiv kopiert
+    uint32_t too_large;        // JPEG: Sensor-JPEG größer als der Slot, nur das Archivbild entfällt
+    uint32_t no_slot;          // JPEG: kein SLOT_JPEG_IN frei, ebenso
+    uint32_t tensor_frames;
+    int64_t to_tensor_us;      // Dekodieren + Modell-Input bzw. Konvertierung, wenn der Detektor RGB888 liest
+    uint32_t max_to_tensor_us;
+};
+
+class Stages {
+public:
+    Stages() = default;
+    ~Stages();
+    Stages(const Stages &) = delete;
+    Stages &operator=(const Stages &) = delete;
+
+    // Encoder, Pool, Ring, Gate, Tracker und Scheduler anlegen, Segment und Detektions-Log
+    // öffnen. Danach allokieren die Stufen nicht mehr.
+    bool init(const pipeline::config_t &cfg, const setup_t &setup, detector::Detector *detector);
+
+    // Frame leer und mit der ROI-Geometrie, bevor er (wieder) in capture geht
+    void reset_frame(frame_t *f) const;
+
+    // Jede Stufe liefert, ob sie den Frame verarbeitet hat
+    capture_result_t capture(frame_t *f, const sensor_image_t &img, int64_t t_us);
+    bool infer(frame_t *f);
+    bool encode(frame_t *f);
+    bool pending() const { return m_ring.records() > 0; }
+    bool store_next();
+
+    // Aufnahmeintervall aus Aktivität; pipeline_us ist die zuletzt gemessene langsamste Stufe
+    uint32_t schedule(int64_t t_us, bool motion, uint32_t pipeline_us);
+
+    int roi_width() const { return m_roi_width; }
+    int roi_height() const { return m_roi_height; }
+    const archive_stats_t &archive() const { return m_archive; }
+    const capture_cost_t &capture_cost() const { return m_capture; }
+    const motion::MotionGate &gate() const { return m_gate; }
+    const tracking::Tracker &tracker() const { return m_tracker; }
+    const scheduler::CaptureScheduler &capture_scheduler() const { return m_scheduler; }
+    // Konsument des Rings, z.B. für einen Digest über die Records vor store_next()
+    writebehind::SpscRing &ring() { return m_ring; }
+#if CONFIG_BEESENSE_INFER_TILED
+    const tiling::layout_t &layout() const { return m_layout; }
+#endif
+    void log_stats() const;
+
+private:
+    struct source_t;
+    source_t source(const frame_t *f) const;
+    void release_source(frame_t *f);
+    void add_to_tensor(frame_t *f, int64_t us);
+    bool decode_roi(frame_t *f, const sensor_image_t &img);
+    void keep_sensor_jpeg(frame_t *f, const sensor_image_t &img);
+    void track(const frame_t *f);
+    void annotate(frame_t *f);
+#if CONFIG_BEESENSE_INFER_TILED
+    void infer_tiles(frame_t *f);
+#endif
+    segment::box_meta_t to_box_meta(const frame_t *f, const dl::detect::result_t &res) const;
+    segment::box_meta_t to_sensor_box_meta(const dl::detect::result_t &res) const;
+    bool push_record(uint32_t id, int64_t capture_us, uint16_t type, const void *meta, uint16_t meta_len,
+                     const dl::image::jpeg_img_t &jpeg);
+    bool archive_frame(frame_t *f);
+    bool archive_thumbnails(frame_t *f);
+
+    pipeline::config_t m_cfg = {};
+    setup_t m_setup = {};
+    detector::Detector *m_detector = nullptr;
+    int m_roi_width = 0;
+    int m_roi_height = 0;
+    uint32_t m_next_id = 0;
+    bufpool::BufferPool m_pool;
+    jpegenc::Encoder m_encoder;                 // nur encode, Handle und Puffer leben so lange wie die Stufen
+    jpegenc::Encoder m_thumb_encoder;           // Thumbnail-Modus, eigener Ausgabepuffer
+    jpegdec::Decoder m_decoder;                 // nur capture, JPEG-Aufnahme
+    bool m_convert_roi = true;                  // RGB888-ROI gebraucht (Archiv, Thumbnails, Kacheln, Kaskade)
+    bool m_keep_sensor_jpeg = false;            // Sensor-JPEG kopieren, weil Vollbilder archiviert werden
+    uint8_t *m_thumb_rgb = nullptr;             // skalierter Ausschnitt, thumb.size^2 * 3
+    int64_t m_last_context_us = 0;
+    motion::MotionGate m_gate;
+    tracking::Tracker m_tracker;
+    scheduler::CaptureScheduler m_scheduler;
+    std::atomic<uint32_t> m_detections{0};      // Boxen seit der letzten Scheduler-Entscheidung
+    writebehind::SpscRing m_ring;
+    void *m_ring_mem = nullptr;
+    archive_stats_t m_archive = {};
+    capture_cost_t m_capture = {};
+    std::vector<int> m_crop_area;               // Modell-Input-Bereich, nur in infer beschrieben
+#if CONFIG_BEESENSE_INFER_TILED
+    tiling::layout_t m_layout;
+    tiling::tile_box_t m_tile_boxes[tiling::MAX_TILES * detector::MAX_RESULTS];
+#endif
+};
+
+} // namespace stages
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include "dl_detect_define.hpp"
+
+namespace detector {
+
+static constexpr size_t MAX_RESULTS = 10;
+
+// Ergebnisliste mit fester Kapazität für den Frame-Pfad. Die Box-Vektoren aller Slots
+// werden im Konstruktor reserviert und danach nur noch überschrieben; clear() gibt
+// nichts frei. Ein std::vector<result_t> allokiert bei jedem push_back eine neue Box.
+class ResultList {
+public:
+    ResultList() {
+        for (auto &res : m_items) {
+            res.box.reserve(4);
+        }
+    }
+
+    void clear() { m_size = 0; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    bool full() const { return m_size == MAX_RESULTS; }
+
+    // Nächster freier Slot ohne Keypoints, nullptr wenn die Liste voll ist
+    dl::detect::result_t *add() {
+        if (full()) {
+            return nullptr;
+        }
+        dl::detect::result_t &slot = m_items[m_size++];
+        slot.keypoint.clear();
+        return &slot;
+    }
+
+    // Kopiert res in den nächsten Slot; false, wenn die Liste voll ist
+    bool push_back(const dl::detect::result_t &res) {
+        dl::detect::result_t *slot = add();
+        if (!slot) {
+            return false;
+        }
+        slot->category = res.category;
+        slot->score = res.score;
+        slot->box.assign(res.box.begin(), res.box.end());
+        slot->keypoint.assign(res.keypoint.begin(), res.keypoint.end());
+        return true;
+    }
+
+    // Übernimmt höchstens MAX_RESULTS Einträge aus [first, last)
+    template <typename It>
+    void assign(It first, It last) {
+        clear();
+        for (; first != last && push_back(*first); ++first) {
+        }
+    }
+
+    dl::detect::result_t *begin() { return m_items; }
+    dl::detect::result_t *end() { return m_items + m_size; }
+    const dl::detect::result_t *begin() const { return m_items; }
+    const dl::detect::result_t *end() const { return m_items + m_size; }
+    dl::detect::result_t &operator[](size_t i) { return m_items[i]; }
+    const dl::detect::result_t &operator[](size_t i) const { return m_items[i]; }
+
+private:
+    dl::detect::result_t m_items[MAX_RESULTS];
+    size_t m_size = 0;
+};
+
+} // namespace detector
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace imgconv {
+
+struct roi_bench_t {
+    double ref_ns_px;       // skalare Referenz
+    double fast_ns_px;      // wortweiser Pfad (rgb565_roi_to_rgb888 vor enable_pie_kernel())
+    double pie_ns_px;       // rgb565_roi_to_rgb888_pie; auf dem Host nur das Modell des Kerns
+    double copy_ns_px;      // memcpy derselben Bytemenge: ROI lesen, RGB888 schreiben
+};
+
+// Misst die ROI-Konvertierung gegen die reine Speicherbandbreite, jeweils der beste von fünf
+// Durchgängen. frame und dst sollen dort liegen, wo sie im Betrieb liegen (auf dem Gerät
+// PSRAM): was zwischen fast und copy liegt, ist alles, was ein SIMD-Pfad (PIE) noch holen kann,
+// pie zeigt, wie viel der Kern davon holt.
+roi_bench_t bench_rgb565_roi(const uint8_t *frame, int frame_width, int frame_height, int roi, uint8_t *dst,
+                             int iterations);
+
+void log_roi_bench(const roi_bench_t &r);
+
+} // namespace imgconv
@@ -1,17 +1,58 @@
 #pragma once
 
 #include "dl_image_define.hpp"
-#include "dl_cls_postprocessor.hpp"  // for dl::cls::result_t
+#include "dl_image_jpeg.hpp"
+#include "dl_detect_define.hpp"
+#include "detection_log.hpp"
+#include "segment_file.hpp"
+#include "storage_backend.hpp"
+#include <vector>
 
 namespace sdcard {
 
-bool init();
+// Clustergröße beim Formatieren; gebündelte Schreibzugriffe richten sich danach aus
+static constexpr size_t ALLOCATION_UNIT_SIZE = 16 * 1024;
+
+// Dateisystem einhängen und für alle folgenden Aufrufe verwenden: auf dem Gerät
+// storage::SdspiBackend, im Host-Build z.B. ein PosixBackend mit künstlicher Latenz
+bool init(storage::Backend &fs);
+storage::Backend *backend();
+
+// Schreibpuffer für Segmente, size wird auf ein Vielfaches von ALLOCATION_UNIT_SIZE aufgerundet.
+// Ohne Puffer schreibt das Segment über den stdio-Puffer.
+bool init_write_batch(size_t size);
+void log_write_stats();
 
 bool create_dir(const char *full_path);
 
 int count_files(const char *full_path);
 
-bool save_detected_jpeg(const dl::image::img_t &img, const dl::cls::result_t &best, const char *dir_full_path);
-bool save_classified_jpeg(const dl::image::img_t &img, const dl::cls::result_t &best, const char *dir_full_path);
+// Encode (RGB888 -> JPEG) und Schreiben getrennt, damit beides in eigenen Tasks laufen kann.
+// Der Encoder schreibt in outbuf, jpeg_img.data zeigt danach in diesen Puffer.
+bool encode_detected_jpeg(const dl::image::img_t &img, uint8_t *outbuf, size_t outbuf_size,
+                          dl::image::jpeg_img_t &jpeg_img);
+// ref (optional): Dateinummer für den Detektions-Sidecar
+bool write_detected_jpeg(const dl::image::jpeg_img_t &jpeg_img, const char *dir_full_path,
+                         detlog::image_ref_t *ref = nullptr);
+
+// Segment-Container (segment_file.hpp): alle Bilder einer Sitzung in einer vorallokierten
+// Datei <dir>/seg_<session>.open, nach dem Schließen .bseg. Beim Öffnen werden nicht
+// geschlossene Segmente früherer Sitzungen repariert. Ist ein Segment voll, folgt das nächste.
+bool open_segment(const char *dir_full_path, uint32_t capacity, uint32_t flush_interval_ms);
+// boxes in Koordinaten des gespeicherten Bildes, t_us der Aufnahmezeitpunkt (esp_timer),
+// ref (optional): Session und Record-Nummer für den Detektions-Sidecar
+bool append_detected_jpeg(const dl::image::jpeg_img_t &jpeg_img, const segment::box_meta_t *boxes, uint16_t box_count,
+                          int64_t t_us, detlog::image_ref_t *ref = nullptr);
+// Detektionsausschnitt (RECORD_THUMB), meta in Koordinaten des ROI-Bildes
+bool append_thumbnail(const dl::image::jpeg_img_t &jpeg_img, const segment::thumb_meta_t &meta, int64_t t_us);
+bool close_segment();
+
+// Detektions-Sidecar <dir>/detections.bdet (detection_log.hpp), über Boots fortgeschrieben
+bool open_detection_log(const char *dir_full_path, uint32_t flush_interval_ms);
+bool append_detections(detlog::record_t &rec);
+bool close_detection_log();
+
+// Encode und Schreiben in einem Aufruf, mit eigenem Ausgabepuffer (malloc pro Bild)
+bool save_detected_jpeg(const dl::image::img_t &img, const char *dir_full_path);
 
 } // namespace sdcard
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include "write_behind.hpp"
+
+// Append-only Container für eine Aufnahmesitzung: eine vorallokierte Datei mit
+// längenpräfixierten Records (JPEG + Detektions-Metadaten) statt einer Datei pro Bild.
+//
+//   [file_header_t 64 B][record][record]...[INDEX][record]...
+//   record = record_header_t (32 B) | meta | payload | Padding auf 4 Byte
+//
+// Jeder Record trägt Session-ID, laufende Nummer und CRC32 (IEEE, wie zlib.crc32)
+// über Header, Meta und Payload. Alle index_interval Records folgt ein INDEX-Record
+// mit den Offsets der vorangegangenen Records und dem Offset des vorigen INDEX
+// (Rückwärtskette für wahlfreien Zugriff). Hinter dem letzten gültigen Record
+// liegt beliebiger Inhalt (vorallokierte Cluster); Leser hören beim ersten
+// ungültigen Record auf. Little endian, plattformunabhängig (nur stdio bzw. storage::Backend).
+// Leser auf dem Host: scripts/extract_segments.py
+namespace segment {
+
+static constexpr uint32_t FILE_MAGIC = 0x47455342;    // "BSEG"
+static constexpr uint32_t RECORD_MAGIC = 0x43455242;  // "BREC"
+static constexpr uint16_t VERSION = 1;
+static constexpr uint32_t MAX_INDEX_INTERVAL = 256;
+
+enum record_type_t : uint16_t {
+    RECORD_JPEG = 1,
+    RECORD_INDEX = 2,
+    RECORD_THUMB = 3,
+};
+
+struct file_header_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t session;
+    uint32_t capacity;
+    uint32_t index_interval;
+    uint32_t reserved[10];
+    uint32_t crc;             // über die ersten 60 Byte
+};
+static_assert(sizeof(file_header_t) == 64, "segment file header must be 64 bytes");
+
+struct record_header_t {
+    uint32_t magic;
+    uint32_t session;
+    uint32_t seq;             // 0, 1, 2, ... innerhalb der Datei, INDEX eingeschlossen
+    uint16_t type;            // record_type_t
+    uint16_t meta_len;
+    uint32_t payload_len;
+    uint32_t crc;             // über Header (crc = 0), Meta und Payload
+    int64_t t_us;             // Aufnahmezeitpunkt, vom Schreiber festgelegt (Firmware: Unix-Zeit in µs)
+};
+static_assert(sizeof(record_header_t) == 32, "segment record header must be 32 bytes");
+
+// Meta eines JPEG-Records: box_meta_t[meta_len / sizeof(box_meta_t)]
+struct box_meta_t {
+    int16_t x1, y1, x2, y2;   // Koordinaten im gespeicherten Bild
+    uint16_t score_permille;
+    uint16_t category;
+};
+static_assert(sizeof(box_meta_t) == 12, "box meta must be 12 bytes");
+
+// Meta eines THUMB-Records (Ausschnitt um eine Detektion). Koordinaten wie bei
+// RECORD_JPEG im archivierten Bildbereich, auch wenn das Vollbild nicht gespeichert ist.
+struct thumb_meta_t {
+    uint32_t frame_id;        // Quellframe; ein gespeichertes Vollbild hat dasselbe t_us
+    int16_t crop_x1, crop_y1, crop_x2, crop_y2;  // ausgeschnittener Bereich vor dem Skalieren
+    box_meta_t box;
+};
+static_assert(sizeof(thumb_meta_t) == 24, "thumb meta must be 24 bytes");
+
+// Payload eines INDEX-Records: index_entry_t[], Meta: uint32_t Offset des vorigen INDEX (0 = keiner)
+struct index_entry_t {
+    uint32_t seq;
+    uint32_t offset;
+};
+
+struct writer_config_t {
+    uint32_t session;
+    uint32_t capacity;        // Dateigröße inkl. Vorallokation
+    uint32_t index_interval;  // Records zwischen zwei INDEX-Records (<= MAX_INDEX_INTERVAL)
+    int64_t flush_interval_us;  // Group Commit: fflush + fsync, sobald seit dem letzten so viel Zeit vergangen ist
+    uint8_t *io_buffer;       // optional: Records über writebehind::BatchFile in io_unit-Blöcken schreiben
+    uint32_t io_buffer_size;  // Vielfaches von io_unit
+    uint32_t io_unit;         // Allocation Unit des Dateisystems
+    storage::Backend *fs;     // optional, sonst direkt stdio/POSIX
+};
+
+struct writer_stats_t {
+    uint32_t records;
+    uint32_t index_blocks;
+    uint32_t flushes;
+    uint32_t full;            // wegen fehlender Kapazität abgelehnte Records
+    uint32_t bytes;           // belegt inkl. Header
+};
+
+struct scan_result_t {
+    bool header_ok;
+    uint32_t session;
+    uint32_t records;         // gültige Records inkl. INDEX
+    uint32_t jpegs;
+    uint32_t thumbs;
+    uint32_t valid_end;       // Offset hinter dem letzten gültigen Record
+    uint32_t last_index;      // Offset des letzten INDEX-Records (0 = keiner)
+};
+
+uint32_t crc32(uint32_t crc, const void *data, size_t len);
+
+// Prüft alle Records ab dem Dateianfang, ohne die Datei zu ändern.
+bool scan(FILE *f, scan_result_t &result);
+
+// Crash-Recovery: schneidet den Container hinter dem letzten vollständigen Record ab
+// (abgerissener Record am Ende und unbenutzte Vorallokation).
+bool recover(const char *path, scan_result_t &result, storage::Backend *fs = nullptr);
+
+class Writer {
+public:
+    ~Writer();
+
+    // Legt den Container an. Existiert path bereits (z.B. per f_expand vorallokiert),
+    // wird die Datei weiterverwendet, sonst bis capacity erweitert.
+    bool create(const char *path, const writer_config_t &cfg);
+    bool is_open() const { return m_file != nullptr; }
+
+    // false, wenn der Record nicht mehr in die Kapazität passt oder das Schreiben scheitert
+    bool append(int64_t t_us, const box_meta_t *boxes, uint16_t box_count, const void *jpeg, uint32_t jpeg_len);
+    bool append_thumb(int64_t t_us, const thumb_meta_t &meta, const void *jpeg, uint32_t jpeg_len);
+    bool flush();
+    // Letzten INDEX schreiben, auf die belegte Größe kürzen, schließen
+    bool close();
+
+    uint32_t remaining() const;
+    uint32_t session() const { return m_cfg.session; }
+    // Nummer des zuletzt angehängten JPEG- bzw. THUMB-Records
+    uint32_t last_seq() const { return m_last_seq; }
+    const writer_stats_t &stats() const { return m_stats; }
+    const writebehind::batch_stats_t &io_stats() const { return m_batch.stats(); }
+
+private:
+    bool write_record(uint16_t type, int64_t t_us, const void *meta, uint16_t meta_len, const void *payload,
+                      uint32_t payload_len);
+    bool write_index(int64_t t_us);
+    bool append_record(uint16_t type, int64_t t_us, const void *meta, uint16_t meta_len, const void *jpeg,
+                       uint32_t jpeg_len);
+    bool put(const void *data, uint32_t len);
+
+    FILE *m_file = nullptr;
+    storage::Backend *m_fs = nullptr;
+    writebehind::BatchFile m_batch;
+    writer_config_t m_cfg = {};
+    uint32_t m_offset = 0;
+    uint32_t m_seq = 0;
+    uint32_t m_last_seq = 0;
+    uint32_t m_last_index = 0;
+    int64_t m_last_flush_us = 0;
+    int64_t m_last_t_us = 0;
+    bool m_dirty = false;
+    index_entry_t m_pending[MAX_INDEX_INTERVAL] = {};
+    uint32_t m_pending_count = 0;
+    writer_stats_t m_stats = {};
+};
+
+} // namespace segment
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "sdkconfig.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "storage_backend.hpp"
+
+// Laufzeitprofil der Pipeline-Stufen und der SD-Pfade. Ein Span misst die Zeit zwischen
+// Konstruktion und Destruktion mit dem Zykluszähler der CPU (die Pipeline-Tasks sind an
+// einen Core gebunden, Spans wechseln den Core also nicht) und legt sie in µs im Ring
+// seiner Kennung ab. Ausgewertet werden die letzten WINDOW Dauern: p50, p95 und Maximum.
+//
+// Der 32-Bit-Zykluszähler läuft nach 2^32 Takten über (17.9 s bei 240 MHz). Jeder Span
+// nimmt deshalb zusätzlich esp_timer_get_time() mit; ab der halben Überlaufzeit gilt die
+// Dauer aus dem esp_timer, darunter die genauere aus den Zyklen (span_us).
+//
+// Jede Kennung hat genau einen schreibenden Task; Auswertung aus einem anderen Task liest
+// ohne Sperre und kann einen gerade geschriebenen Wert verpassen, mehr nicht. Die 64-Bit-
+// Summe liest sie über RunningTotal trotzdem nie halb geschrieben.
+//
+// Ohne CONFIG_BEESENSE_PROFILER sind PROFILE_SPAN und PROFILE_SPAN_END leer, die
+// Auswertung bleibt verfügbar und meldet nichts.
+namespace profiler {
+
+enum span_t : uint8_t {
+    SPAN_CAPTURE = 0,     // Frame von der Kamera leasen
+    SPAN_GATE,            // Bewegungsfilter
+    SPAN_DECODE,          // JPEG-Aufnahme: nur den ROI dekodieren
+    SPAN_CONVERT,         // RGB565-ROI -> RGB888 (Archivbild)
+    SPAN_PREPROCESS,      // Modell-Input füllen
+    SPAN_INFER,           // Modell + Postprocessing (Kacheln/Kaskade: ganzer Detektor)
+    SPAN_TRACK,
+    SPAN_ANNOTATE,        // Boxen einzeichnen
+    SPAN_ENCODE,          // JPEG des ROI-Bildes
+    SPAN_THUMBS,          // Ausschnitte skalieren und kodieren
+    SPAN_RING_PUSH,       // Record in den Write-Behind-Ring kopieren, inkl. Warten auf Platz
+    SPAN_STORE,           // storage: ein Record bis auf die Karte
+    SPAN_SD_INDEX,        // nächster Dateipfad aus dem Dateiindex
+    SPAN_SD_COUNT_FILES,
+    SPAN_SD_WRITE,        // einzelne JPEG-Datei schreiben
+    SPAN_SD_FILE_TIME,
+    SPAN_SD_APPEND,       // Record an das Segment anhängen (inkl. gebündelter Schreibzugriffe)
+    SPAN_SD_ROTATE,       // volles Segment schließen, nächstes anlegen
+    SPAN_COUNT
+};
+
+#if CONFIG_BEESENSE_PROFILER
+static constexpr size_t WINDOW = CONFIG_BEESENSE_PROFILER_WINDOW;
+#else
+static constexpr size_t WINDOW = 1;
+#endif
+
+// Die letzten N Werte; ein Schreiber, Leser kopieren
+template <size_t N>
+class SampleRing {
+public:
+    void push(uint32_t value) {
+        const uint32_t n = m_total.load(std::memory_order_relaxed);
+        m_samples[n % N] = value;
+        m_total.store(n + 1, std::memory_order_release);
+    }
+    uint32_t total() const { return m_total.load(std::memory_order_acquire); }
+    size_t size() const { return total() < N ? total() : N; }
+    // Kopiert die vorhandenen Werte (Reihenfolge beliebig), liefert ihre Anzahl
+    size_t copy(uint32_t *out) const {
+        const size_t n = size();
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = m_samples[i];
+        }
+        return n;
+    }
+    void reset() { m_total.store(0, std::memory_order_relaxed); }
+
+private:
+    uint32_t m_samples[N] = {};
+    std::atomic<uint32_t> m_total{0};
+};
+
+// 64-Bit-Summe mit einem Schreiber, ohne Sperre und ohne 64-Bit-Atomics (auf dem Xtensa nicht
+// lock-free): zwei Kopien aus je zwei 32-Bit-Hälften, m_seq zeigt auf die gültige. Der
+// Schreiber füllt die andere Kopie und schaltet dann um; ein Leser wiederholt nur, wenn
+// währenddessen umgeschaltet wurde. Bleibt der Schreiber mitten im Schreiben stehen (von
+// einem höher priorisierten Leser auf demselben Core verdrängt), ist das die ungültige
+// Kopie und der Leser kommt sofort durch.
+class RunningTotal {
+public:
+    void add(uint32_t value) {
+        const uint32_t seq = m_seq.load(std::memory_order_relaxed);
+        const uint64_t next = read(m_copies[seq & 1]) + value;
+        half_t &dst = m_copies[(seq + 1) & 1];
+        // Leser, die einen der folgenden Stores sehen, sehen auch das vorige Umschalten
+        std::atomic_thread_fence(std::memory_order_release);
+        dst.lo.store((uint32_t)next, std::memory_order_relaxed);
+        dst.hi.store((uint32_t)(next >> 32), std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_release);
+    }
+    uint64_t load() const {
+        uint32_t seq;
+        uint64_t value;
+        do {
+            seq = m_seq.load(std::memory_order_acquire);
+            value = read(m_copies[seq & 1]);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (m_seq.load(std::memory_order_relaxed) != seq);
+        return value;
+    }
+
+private:
+    struct half_t {
+        std::atomic<uint32_t> lo{0};
+        std::atomic<uint32_t> hi{0};
+    };
+    static uint64_t read(const half_t &h) {
+        return ((uint64_t)h.hi.load(std::memory_order_relaxed) << 32) | h.lo.load(std::memory_order_relaxed);
+    }
+    half_t m_copies[2];
+    std::atomic<uint32_t> m_seq{0};
+};
+
+// Nearest-rank-Perzentil (pct 0..100) über n Werte; sortiert samples teilweise um
+uint32_t percentile(uint32_t *samples, size_t n, int pct);
+
+struct summary_t {
+    uint32_t count;     // Spans seit Start
+    uint32_t window;    // davon ausgewertet
+    uint32_t p50_us;
+    uint32_t p95_us;
+    uint32_t max_us;
+    uint64_t total_us;  // Summe seit Start, für die Zeitanteile
+};
+
+const char *name(span_t id);
+
+// Zykluszahl pro µs und Eigenkosten eines Spans messen; vor dem ersten Span aufrufen
+void init();
+// Dauer eines Spans in µs aus der Zyklendifferenz und der esp_timer-Differenz: unterhalb der
+// halben Überlaufzeit des Zykluszählers die Zyklen, darüber der esp_timer; auf UINT32_MAX
+// (71 min) begrenzt. Negative esp_timer-Differenzen (Host-Replay mit virtueller Uhr) zählen
+// als kurz.
+uint32_t span_us(uint32_t cycles, int64_t elapsed_us);
+void record(span_t id, uint32_t us);
+// false, wenn für id noch nichts aufgezeichnet wurde
+bool summarize(span_t id, summary_t &out);
+
+// Tabelle aller Spans mit Werten auf UART, dazu der geschätzte Anteil der Messung selbst
+void log_report();
+// Hängt eine Zeile je Span an path an (Kopfzeile bei neuer Datei):
+// uptime_ms,span,count,window,p50_us,p95_us,max_us,total_ms
+bool write_csv(storage::Backend &fs, const char *path);
+
+class Span {
+public:
+    explicit Span(span_t id) : m_id(id), m_start_us(esp_timer_get_time()), m_start(esp_cpu_get_cycle_count()) {}
+    ~Span() { end(); }
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+    // Vorzeitig beenden, z.B. wenn der Rest der Funktion nicht mehr dazugehört
+    void end() {
+        if (m_id != SPAN_COUNT) {
+            const uint32_t cycles = esp_cpu_get_cycle_count() - m_start;
+            record(m_id, span_us(cycles, esp_timer_get_time() - m_start_us));
+            m_id = SPAN_COUNT;
+        }
+    }
+
+private:
+    span_t m_id;
+    int64_t m_start_us;
+    uint32_t m_start;
+};
+
+} // namespace profiler
+
+#if CONFIG_BEESENSE_PROFILER
+#define PROFILE_SPAN(var, id) profiler::Span var(id)
+#define PROFILE_SPAN_END(var) var.end()
+#else
+#define PROFILE_SPAN(var, id) ((void)0)
+#define PROFILE_SPAN_END(var) ((void)0)
+#endif
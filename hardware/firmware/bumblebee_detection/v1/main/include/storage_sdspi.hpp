@@ -0,0 +1,29 @@
+#pragma once
+
+#include "storage_backend.hpp"
+
+struct sdmmc_card_t;
+
+namespace storage {
+
+// SD-Karte über SPI (Pins aus sd_pins.h), FatFs im VFS unter /sdcard
+class SdspiBackend : public Backend {
+public:
+    static constexpr const char *MOUNT_POINT = "/sdcard";
+
+    const char *name() const override { return "sdspi"; }
+    bool mount() override;
+    void unmount() override;
+    bool is_mounted() const override { return m_mounted; }
+    bool free_space(space_t &space) override;
+
+    // f_expand: zusammenhängende Cluster, gebündelte Schreibzugriffe landen ohne FAT-Suche
+    bool preallocate(const char *path, uint32_t size) override;
+    bool set_file_time(const char *path, const struct tm &time) override;
+
+private:
+    sdmmc_card_t *m_card = nullptr;
+    bool m_mounted = false;
+};
+
+} // namespace storage
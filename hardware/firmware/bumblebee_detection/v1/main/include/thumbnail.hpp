@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// Ausschnitte um Detektionen für das Thumbnail-Archiv: quadratisch, mit Rand und auf
+// eine feste Kantenlänge skaliert, damit die Crops unabhängig von der Größe der Hummel
+// vergleichbar sind. Nur RGB888, läuft auch auf dem Host.
+namespace thumbs {
+
+static constexpr int MAX_SIZE = 256;
+
+struct rect_t {
+    int x1, y1, x2, y2;   // x2/y2 exklusiv
+};
+
+// Quadrat um die Box (x1, y1, x2, y2), je Seite um padding * längere Boxseite vergrößert,
+// mindestens min_side groß, höchstens so groß wie die kürzere Bildseite und ins Bild geschoben.
+rect_t square_crop(int x1, int y1, int x2, int y2, int img_width, int img_height, float padding, int min_side);
+
+// Bilineare Skalierung von crop auf size x size (size <= MAX_SIZE)
+bool resize_rgb888(const uint8_t *src, int src_width, int src_height, const rect_t &crop, uint8_t *dst, int size);
+
+} // namespace thumbs
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+namespace tiling {
+
+static constexpr int MAX_TILES = 24;
+
+struct tile_t {
+    int x0;
+    int y0;
+};
+
+// Überlappende Kacheln der Größe tile x tile, die den ganzen Frame abdecken.
+// Benachbarte Kacheln überlappen mindestens min_overlap Pixel; die Positionen
+// werden gleichmäßig verteilt, die letzte Kachel schließt bündig mit dem Rand ab.
+struct layout_t {
+    int tile_size;
+    int cols;
+    int rows;
+    int count;
+    tile_t tiles[MAX_TILES];
+};
+
+bool make_layout(int frame_width, int frame_height, int tile_size, int min_overlap, layout_t &layout);
+
+struct tile_box_t {
+    int box[4];     // x1, y1, x2, y2 in Framekoordinaten
+    float score;
+    int tile;       // Index der Kachel, aus der die Box stammt
+    int source;     // frei verwendbarer Index des Aufrufers
+};
+
+// NMS über Kachelgrenzen hinweg. Zusätzlich zur IoU werden an Nahtstellen
+// abgeschnittene Boxen erkannt: liegt eine Box einer anderen Kachel zu mehr als
+// ios_thr (Schnitt / kleinere Fläche) in einer besseren, wird sie verworfen und
+// die bessere auf die Vereinigung beider erweitert.
+// Sortiert boxes absteigend nach Score, gibt die Anzahl behaltener Boxen zurück
+// (diese stehen danach vorne im Array).
+int merge_boxes(tile_box_t *boxes, int count, float iou_thr, float ios_thr);
+
+} // namespace tiling
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+
+namespace tracking {
+
+static constexpr int MAX_TRACKS = 16;
+static constexpr int MAX_DETECTIONS = 16;
+static constexpr int MAX_EVENTS = MAX_TRACKS;
+
+struct box_t {
+    float x1, y1, x2, y2;  // Frame-Koordinaten
+};
+
+struct detection_t {
+    box_t box;
+    float score;
+};
+
+struct tracker_config_t {
+    float iou_threshold;      // Mindest-IoU zwischen vorhergesagtem Track und Detektion
+    uint32_t min_hits;        // Zuordnungen, bis ein Track bestätigt ist und zählt
+    int64_t max_coast_us;     // so lange ohne Detektion vorhersagen, danach Track löschen
+    float velocity_gain;      // Glättung der Geschwindigkeit (1 = nur letzte Messung)
+    float max_speed;          // px pro Sekunde; Suchradius für Tracks ohne Geschwindigkeitsschätzung
+    float line[4];            // Eingangslinie (x1, y1, x2, y2) als Gerade durch beide Punkte
+    float line_hysteresis;    // Abstand zur Linie (px), ab dem eine Seite gilt
+};
+
+// Linie horizontal durch die Bildmitte, Einflug = Bewegung nach unten
+tracker_config_t default_tracker_config(int frame_width, int frame_height);
+
+struct track_t {
+    uint32_t id;
+    float cx, cy, w, h;       // Zustand bei der letzten Zuordnung
+    float vx, vy;             // px pro Sekunde
+    int64_t last_us;          // Zeitpunkt der letzten Zuordnung
+    uint32_t hits;
+    int8_t side;              // Seite der Eingangslinie: -1, +1, 0 = noch unbekannt
+    bool confirmed;
+    float score;
+};
+
+enum direction_t {
+    DIRECTION_IN = 0,         // von der negativen auf die positive Seite der Linie
+    DIRECTION_OUT,
+};
+
+struct crossing_t {
+    uint32_t track_id;
+    direction_t direction;
+};
+
+struct tracker_stats_t {
+    uint32_t updates;
+    uint32_t tracks_created;
+    uint32_t tracks_confirmed;
+    uint32_t crossings[2];    // je direction_t
+    uint32_t dropped;         // Detektionen ohne freien Track-Platz
+};
+
+// Ordnet Detektionen über Frames per IoU gegen eine Vorhersage mit konstanter
+// Geschwindigkeit zu und zählt Querungen der Eingangslinie. Feste Kapazität,
+// keine Allokationen; zwischen zwei Inferenzen liefert predict() die Position.
+// Plattformunabhängig, nicht threadsicher (ein Task ruft update()).
+class Tracker {
+public:
+    void init(const tracker_config_t &cfg);
+
+    // Detektionen zum Zeitpunkt t_us zuordnen (höchstens MAX_DETECTIONS).
+    // Gibt die Anzahl der dabei erkannten Linienquerungen zurück, siehe crossing().
+    int update(const detection_t *dets, int count, int64_t t_us);
+
+    static box_t predict(const track_t &track, int64_t t_us);
+
+    int count() const { return m_count; }
+    const track_t &track(int i) const { return m_tracks[i]; }
+    const crossing_t &crossing(int i) const { return m_events[i]; }
+    const tracker_stats_t &stats() const { return m_stats; }
+
+private:
+    float affinity(const track_t &track, const box_t &predicted, const box_t &det, int64_t t_us) const;
+    int8_t side_of(float cx, float cy, int8_t previous) const;
+    void assign(track_t &track, const detection_t &det, int64_t t_us);
+
+    tracker_config_t m_cfg = {};
+    track_t m_tracks[MAX_TRACKS] = {};
+    int m_count = 0;
+    uint32_t m_next_id = 1;
+    float m_affinity[MAX_TRACKS][MAX_DETECTIONS] = {};
+    crossing_t m_events[MAX_EVENTS] = {};
+    int m_event_count = 0;
+    tracker_stats_t m_stats = {};
+};
+
+} // namespace tracking
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "storage_backend.hpp"
+
+// Write-behind zwischen Pipeline und SD-Karte:
+//
+//   SpscRing   lock-freier Byte-Ring (ein Produzent, ein Konsument) für Records
+//              variabler Länge. Der Produzent kopiert fertige JPEG-Records hinein und
+//              gibt seinen Frame sofort zurück; nur der Storage-Task wartet auf die Karte.
+//   BatchFile  sammelt sequentielle Schreibzugriffe in einem Puffer und schreibt nur
+//              ganze Vielfache der Allocation Unit ab Offsets auf deren Grenzen.
+//
+// Nur std::atomic und stdio bzw. storage::Backend, läuft auch auf dem Host (Speicher stellt der Aufrufer).
+namespace writebehind {
+
+struct ring_stats_t {
+    uint32_t pushed;
+    uint32_t dropped;      // Record passte nicht (Ring voll), Policy liegt beim Produzenten
+    uint32_t popped;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint32_t max_used;     // höchster Füllstand in Byte
+};
+
+class SpscRing {
+public:
+    // mem wird auf eine Zweierpotenz gekürzt, Records sind höchstens halb so groß
+    bool init(void *mem, size_t size);
+
+    // Produzent: Record aus count Teilen zusammensetzen. false, wenn er gerade nicht passt.
+    bool push(const void *const *parts, const uint32_t *lens, int count);
+    // Nur zählen, z.B. wenn der Produzent nach der Wartezeit aufgibt
+    void drop() { m_stats.dropped++; }
+
+    // Konsument: ältesten Record ansehen (nullptr = leer) und danach freigeben
+    const uint8_t *peek(uint32_t &len);
+    void pop();
+
+    size_t capacity() const { return m_size; }
+    size_t max_record() const { return m_size / 2 - sizeof(uint32_t); }
+    size_t used() const;
+    uint32_t records() const;
+    const ring_stats_t &stats() const { return m_stats; }
+
+private:
+    uint8_t *m_mem = nullptr;
+    uint32_t m_size = 0;
+    std::atomic<uint32_t> m_head{0};   // Schreibposition, nur der Produzent erhöht sie
+    std::atomic<uint32_t> m_tail{0};   // Leseposition, nur der Konsument erhöht sie
+    std::atomic<uint32_t> m_count{0};
+    uint32_t m_peeked = 0;             // Byte des aktuellen Records inkl. Wrap-Lücke
+    uint32_t m_peeked_len = 0;
+    ring_stats_t m_stats = {};
+};
+
+struct batch_stats_t {
+    uint32_t writes;         // fwrite-Aufrufe
+    uint64_t bytes;          // geschrieben, inkl. erneut geschriebener Teilblöcke
+    uint64_t rewritten;      // Teilblock vor einem sync(), beim nächsten Schreiben wiederholt
+    uint32_t syncs;
+    int64_t max_write_us;    // längster fwrite bzw. fflush + fsync
+};
+
+class BatchFile {
+public:
+    // f muss ungepuffert sein (setvbuf _IONBF), buf ein Vielfaches von unit.
+    // offset ist die aktuelle Dateiposition; Bytes ab der letzten unit-Grenze werden zurückgelesen.
+    // sync() geht über fs (ohne Angabe fflush + fsync).
+    bool attach(FILE *f, uint32_t offset, uint8_t *buf, uint32_t size, uint32_t unit,
+                storage::Backend *fs = nullptr);
+    void detach() { m_file = nullptr; }
+    bool is_attached() const { return m_file != nullptr; }
+
+    bool write(const void *data, uint32_t len);
+    // Teilblock schreiben und auf die Karte bringen; er bleibt im Puffer, damit der nächste
+    // Schreibzugriff wieder an der unit-Grenze beginnt
+    bool sync();
+
+    uint32_t offset() const { return m_base + m_fill; }
+    const batch_stats_t &stats() const { return m_stats; }
+
+private:
+    bool write_out(uint32_t len);
+
+    FILE *m_file = nullptr;
+    storage::Backend *m_fs = nullptr;
+    uint8_t *m_buf = nullptr;
+    uint32_t m_size = 0;
+    uint32_t m_unit = 0;
+    uint32_t m_base = 0;      // Dateioffset von m_buf[0], immer auf einer unit-Grenze
+    uint32_t m_fill = 0;
+    uint32_t m_synced = 0;    // davon bereits auf der Karte
+    batch_stats_t m_stats = {};
+};
+
+} // namespace writebehind
@@ -0,0 +1,128 @@
+#include "buffer_pool.hpp"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+namespace bufpool {
+
+static const char *TAG = "BUFPOOL";
+
+static const char *SLOT_NAMES[SLOT_TYPE_COUNT] = {"rgb565", "rgb888_roi", "jpeg_out", "jpeg_in"};
+
+// --------- Buffer ----------------------------------
+
+Buffer::Buffer(Buffer &&other)
+    : m_pool(other.m_pool), m_type(other.m_type), m_index(other.m_index), m_data(other.m_data), m_size(other.m_size) {
+    other.m_pool = nullptr;
+    other.m_data = nullptr;
+}
+
+Buffer &Buffer::operator=(Buffer &&other) {
+    if (this != &other) {
+        reset();
+        m_pool = other.m_pool;
+        m_type = other.m_type;
+        m_index = other.m_index;
+        m_data = other.m_data;
+        m_size = other.m_size;
+        other.m_pool = nullptr;
+        other.m_data = nullptr;
+    }
+    return *this;
+}
+
+void Buffer::reset() {
+    if (m_pool && m_data) {
+        m_pool->release(m_type, m_index);
+    }
+    m_pool = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+}
+
+// --------- BufferPool ----------------------------------
+
+pool_config_t make_config(int frame_width, int frame_height, int model_width, int model_height,
+                          uint8_t frames, uint8_t rois, uint8_t jpegs) {
+    pool_config_t cfg = {};
+    // Große, sequentiell gelesene/geschriebene Puffer liegen im PSRAM
+    cfg.slots[SLOT_RGB565_FRAME] = {(size_t)frame_width * frame_height * 2, frames, MALLOC_CAP_SPIRAM, 0};
+    cfg.slots[SLOT_RGB888_ROI] = {(size_t)model_width * model_height * 3, rois, MALLOC_CAP_SPIRAM, 0};
+    // JPEG mit Qualität 80 bleibt deutlich unter 1 Byte/Pixel. Intern wäre für den
+    // byteweise schreibenden Encoder schneller, mehrere Slots würden aber den internen
+    // RAM aufbrauchen, den das Modell zur Laufzeit braucht; daher nur als Fallback.
+    cfg.slots[SLOT_JPEG_OUT] = {(size_t)model_width * model_height, jpegs,
+                                MALLOC_CAP_SPIRAM, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT};
+    // Größe hängt von Sensorauflösung und -qualität ab, setzt die Pipeline
+    cfg.slots[SLOT_JPEG_IN] = {0, 0, MALLOC_CAP_SPIRAM, 0};
+    return cfg;
+}
+
+BufferPool::~BufferPool() {
+    for (int type = 0; type < SLOT_TYPE_COUNT; ++type) {
+        for (int i = 0; i < MAX_SLOTS_PER_TYPE; ++i) {
+            heap_caps_free(m_data[type][i]);
+            m_data[type][i] = nullptr;
+        }
+    }
+}
+
+bool BufferPool::init(const pool_config_t &cfg) {
+    m_cfg = cfg;
+    for (int type = 0; type < SLOT_TYPE_COUNT; ++type) {
+        const slot_config_t &slot = cfg.slots[type];
+        if (slot.count > MAX_SLOTS_PER_TYPE) {
+            ESP_LOGE(TAG, "%s: %u slots requested, max %d", SLOT_NAMES[type], slot.count, MAX_SLOTS_PER_TYPE);
+            return false;
+        }
+        uint32_t mask = 0;
+        for (int i = 0; i < slot.count; ++i) {
+            uint8_t *data = static_cast<uint8_t *>(heap_caps_malloc(slot.bytes, slot.caps));
+            if (!data && slot.fallback_caps) {
+                ESP_LOGW(TAG, "%s slot %d does not fit preferred memory, using fallback", SLOT_NAMES[type], i);
+                data = static_cast<uint8_t *>(heap_caps_malloc(slot.bytes, slot.fallback_caps));
+            }
+            if (!data) {
+                ESP_LOGE("MEM", "Failed to allocate %s slot (%u bytes)", SLOT_NAMES[type], (unsigned)slot.bytes);
+                return false;
+            }
+            m_data[type][i] = data;
+            mask |= 1u << i;
+        }
+        m_free_mask[type].store(mask);
+        ESP_LOGI(TAG, "%s: %u x %u bytes", SLOT_NAMES[type], slot.count, (unsigned)slot.bytes);
+    }
+    return true;
+}
+
+Buffer BufferPool::acquire(slot_type_t type) {
+    uint32_t mask = m_free_mask[type].load();
+    while (mask) {
+        int index = __builtin_ctz(mask);
+        if (m_free_mask[type].compare_exchange_weak(mask, mask & ~(1u << index))) {
+            return Buffer(this, type, index, m_data[type][index], m_cfg.slots[type].bytes);
+        }
+    }
+    m_exhausted[type]++;
+    return Buffer();
+}
+
+void BufferPool::release(slot_type_t type, int index) {
+    m_free_mask[type].fetch_or(1u << index);
+}
+
+int BufferPool::free_slots(slot_type_t type) const {
+    return __builtin_popcount(m_free_mask[type].load());
+}
+
+void BufferPool::log_stats() const {
+    for (int type = 0; type < SLOT_TYPE_COUNT; ++type) {
+        if (!m_cfg.slots[type].count) {
+            continue;
+        }
+        ESP_LOGI(TAG, "%-10s free %d/%u, exhausted %lu", SLOT_NAMES[type], free_slots(static_cast<slot_type_t>(type)),
+                 m_cfg.slots[type].count, (unsigned long)exhausted(static_cast<slot_type_t>(type)));
+    }
+}
+
+} // namespace bufpool
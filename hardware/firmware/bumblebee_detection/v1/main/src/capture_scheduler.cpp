@@ -0,0 +1,79 @@
+#include "capture_scheduler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace scheduler {
+
+static const char REASON_CODES[REASON_COUNT] = {'A', 'H', 'M', 'B'};
+
+// --------- Public API ----------------------------------
+
+scheduler_config_t default_scheduler_config() {
+    scheduler_config_t cfg = {};
+    cfg.floor_ms = 200;
+    // Im Leerlauf nicht langsamer als der frühere feste Takt: Bewegung sieht nur, wer aufnimmt,
+    // ein kurzer Besuch darf nicht zwischen zwei Aufnahmen fallen
+    cfg.ceiling_ms = 2000;
+    cfg.backoff = 2.0f;
+    cfg.hold_ms = 20000;
+    cfg.headroom = 1.2f;
+    cfg.density_alpha = 0.3f;
+    cfg.density_threshold = 0.2f;
+    return cfg;
+}
+
+void CaptureScheduler::init(const scheduler_config_t &cfg) {
+    m_cfg = cfg;
+    m_cfg.ceiling_ms = std::max(cfg.ceiling_ms, cfg.floor_ms);
+    m_cfg.backoff = std::max(cfg.backoff, 1.0f);
+    // Start mit dem Mindestintervall: nach dem Booten ist die Lage unbekannt, ohne Aktivität
+    // führt der Backoff in wenigen Entscheidungen auf ceiling_ms
+    m_interval_ms = m_cfg.floor_ms;
+    m_density = 0.0f;
+    m_last_active_us = 0;
+    m_seen_activity = false;
+    m_stats = {};
+}
+
+decision_t CaptureScheduler::update(const observation_t &obs) {
+    decision_t d = {};
+    d.sustainable_ms = std::max<uint32_t>(m_cfg.floor_ms, (uint32_t)(obs.pipeline_us * m_cfg.headroom / 1000.0f));
+    d.sustainable_ms = std::min(d.sustainable_ms, m_cfg.ceiling_ms);
+
+    m_density += m_cfg.density_alpha * ((float)obs.detections - m_density);
+    d.density = m_density;
+
+    uint32_t interval = m_interval_ms;
+    if (obs.detections > 0 || m_density >= m_cfg.density_threshold) {
+        m_last_active_us = obs.t_us;
+        m_seen_activity = true;
+        interval = d.sustainable_ms;
+        d.reason = REASON_ACTIVE;
+    } else if (m_seen_activity && obs.t_us - m_last_active_us < (int64_t)m_cfg.hold_ms * 1000) {
+        interval = d.sustainable_ms;
+        d.reason = REASON_HOLD;
+    } else if (obs.motion) {
+        interval = std::max(d.sustainable_ms, interval / 2);
+        d.reason = REASON_MOTION;
+    } else {
+        interval = std::min(m_cfg.ceiling_ms, std::max(d.sustainable_ms, (uint32_t)(interval * m_cfg.backoff)));
+        d.reason = REASON_BACKOFF;
+    }
+
+    if (interval != m_interval_ms) {
+        m_stats.changes++;
+    }
+    m_stats.decisions[d.reason]++;
+    m_interval_ms = interval;
+    d.interval_ms = interval;
+    return d;
+}
+
+int CaptureScheduler::format(char *buf, size_t len, const observation_t &obs, const decision_t &d) {
+    return snprintf(buf, len, "S,%lld,%lu,%c,%lu,%d,%lu,%.2f", (long long)(obs.t_us / 1000),
+                    (unsigned long)d.interval_ms, REASON_CODES[d.reason], (unsigned long)obs.detections,
+                    obs.motion ? 1 : 0, (unsigned long)(obs.pipeline_us / 1000), d.density);
+}
+
+} // namespace scheduler
@@ -0,0 +1,141 @@
+#include "detection_log.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include "esp_log.h"
+
+namespace detlog {
+
+static const char *TAG = "DETLOG";
+
+// --------- Internal helpers ----------------------------------
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static uint32_t header_crc(const file_header_t &h) {
+    return segment::crc32(0, &h, offsetof(file_header_t, crc));
+}
+
+// --------- Public API ----------------------------------
+
+Writer::~Writer() {
+    close();
+}
+
+bool Writer::create_header() {
+    file_header_t fh = {};
+    fh.magic = FILE_MAGIC;
+    fh.version = VERSION;
+    fh.header_size = sizeof(file_header_t);
+    fh.record_size = sizeof(record_t);
+    fh.max_boxes = MAX_BOXES;
+    fh.crc = header_crc(fh);
+    m_dirty = true;
+    return fwrite(&fh, sizeof(fh), 1, m_file) == 1;
+}
+
+// Header prüfen und hinter den letzten vollständigen Record springen
+bool Writer::check_header() {
+    file_header_t fh;
+    if (fread(&fh, sizeof(fh), 1, m_file) != 1 || fh.magic != FILE_MAGIC || fh.version != VERSION ||
+        fh.header_size != sizeof(file_header_t) || fh.record_size != sizeof(record_t) || fh.crc != header_crc(fh)) {
+        return false;
+    }
+    if (fseek(m_file, 0, SEEK_END) != 0) {
+        return false;
+    }
+    const long size = ftell(m_file);
+    if (size < (long)sizeof(file_header_t)) {
+        return false;
+    }
+    const uint32_t records = (uint32_t)(size - sizeof(file_header_t)) / sizeof(record_t);
+    const uint32_t valid_end = sizeof(file_header_t) + records * sizeof(record_t);
+    if ((long)valid_end != size) {
+        m_stats.truncated = (uint32_t)size - valid_end;
+        if (!m_fs->truncate(m_file, valid_end)) {
+            return false;
+        }
+    }
+    m_stats.existing = records;
+    return fseek(m_file, valid_end, SEEK_SET) == 0;
+}
+
+bool Writer::open(const char *path, int64_t flush_interval_us, storage::Backend *fs) {
+    if (m_file) {
+        return false;
+    }
+    m_fs = fs ? fs : &storage::default_backend();
+    m_stats = {};
+    m_flush_interval_us = flush_interval_us;
+    m_last_flush_us = now_us();
+
+    m_file = m_fs->open(path, "r+b");
+    bool ok;
+    if (m_file) {
+        ok = check_header();
+        if (!ok) {
+            ESP_LOGE(TAG, "%s is not a detection log of this version", path);
+        }
+    } else {
+        m_file = m_fs->open(path, "w+b");
+        ok = m_file && create_header();
+    }
+    if (!ok) {
+        if (m_file) {
+            fclose(m_file);
+            m_file = nullptr;
+        }
+        return false;
+    }
+    if (m_stats.truncated) {
+        ESP_LOGW(TAG, "%s: cut %lu bytes of a torn record", path, (unsigned long)m_stats.truncated);
+    }
+    ESP_LOGI(TAG, "Appending to %s (%lu records)", path, (unsigned long)m_stats.existing);
+    return flush();
+}
+
+bool Writer::append(record_t &rec) {
+    if (!m_file) {
+        return false;
+    }
+    rec.crc = segment::crc32(0, &rec, offsetof(record_t, crc));
+    if (fwrite(&rec, sizeof(rec), 1, m_file) != 1) {
+        return false;
+    }
+    m_stats.records++;
+    m_dirty = true;
+    const int64_t now = now_us();
+    if (now - m_last_flush_us >= m_flush_interval_us) {
+        m_last_flush_us = now;
+        return flush();
+    }
+    return true;
+}
+
+bool Writer::flush() {
+    if (!m_file || !m_dirty) {
+        return m_file != nullptr;
+    }
+    bool ok = m_fs->sync(m_file);
+    if (ok) {
+        m_dirty = false;
+        m_stats.flushes++;
+    }
+    return ok;
+}
+
+bool Writer::close() {
+    if (!m_file) {
+        return true;
+    }
+    bool ok = flush();
+    ok = (fclose(m_file) == 0) && ok;
+    m_file = nullptr;
+    return ok;
+}
+
+} // namespace detlog
@@ -0,0 +1,333 @@
+#include "detector_service.hpp"
+
+#include <algorithm>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "mem_telemetry.hpp"
+
+namespace detector {
+
+static const char *TAG = "DETECTOR";
+
+DetectorService::DetectorService(float min_score, const cascade_config_t &cascade)
+    : m_min_score(min_score), m_cascade(cascade) {
+    m_area.reserve(4);
+}
+
+DetectorService::~DetectorService() {
+    stop();
+}
+
+// --------- Internal helpers ----------------------------------
+
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+static memtel::snapshot_t to_snapshot(const bumblebee_detect::heap_mark_t &mark) {
+    memtel::snapshot_t snap;
+    for (int p = 0; p < memtel::POOL_COUNT; ++p) {
+        snap.pool[p] = {mark.free[p], mark.largest[p], mark.min_free[p]};
+    }
+    return snap;
+}
+
+// Stände aus dem ESPDet-Konstruktor verbuchen. Die PSRAM-Spitze beim Laden gilt als Bedarf
+// für das nächste Laden (reload). Näherung: esp-dl legt Parameter und Aktivierungen in
+// wenigen großen Blöcken an, verlangt wird trotzdem die ganze Spitze am Stück.
+static void commit_load(const BumblebeeDetect *detect) {
+    const bumblebee_detect::load_marks_t *marks = detect ? detect->load_marks() : nullptr;
+    if (!marks) {
+        return;
+    }
+    memtel::commit(memtel::STAGE_MODEL_LOAD, to_snapshot(marks->before), to_snapshot(marks->loaded));
+    memtel::commit(memtel::STAGE_MINIMIZE, to_snapshot(marks->loaded), to_snapshot(marks->minimized));
+    const memtel::stage_mem_t st = memtel::stage(memtel::STAGE_MODEL_LOAD);
+    const int32_t kept = st.retained[memtel::POOL_PSRAM];
+    memtel::require(memtel::STAGE_MODEL_LOAD, memtel::POOL_PSRAM,
+                    std::max(st.peak_use[memtel::POOL_PSRAM], kept > 0 ? (uint32_t)kept : 0u));
+}
+#endif
+
+bool DetectorService::load() {
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+    memtel::check(memtel::STAGE_MODEL_LOAD);
+#endif
+    int64_t start_us = esp_timer_get_time();
+    int pending = m_pending_model.exchange(-1);
+    if (pending >= 0) {
+        m_model_index.store(pending);
+    }
+    m_detect = new BumblebeeDetect(static_cast<BumblebeeDetect::model_type_t>(model_index()), false);
+    if (m_cascade.enabled) {
+        // Postprocessor-Schwelle von Stufe 1 auf screen_thr senken, sonst fällt
+        // alles unter der Manifest-Schwelle schon vor der Kaskadenentscheidung weg
+        m_screen = new BumblebeeDetect(
+            BumblebeeDetect::ESPDET_PICO_96_96_BUMBLEBEE, false,
+            std::min(m_cascade.screen_thr, bumblebee_detect::model_info(BumblebeeDetect::ESPDET_PICO_96_96_BUMBLEBEE).score_thr));
+    }
+    m_stats.last_load_us = esp_timer_get_time() - start_us;
+    m_stats.loads++;
+    publish_stats();
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+    commit_load(m_detect);
+    commit_load(m_screen);
+#endif
+
+    bool ok = m_detect->is_loaded() && (!m_screen || m_screen->is_loaded());
+    if (!ok) {
+        stop();
+        return false;
+    }
+    ESP_LOGI(TAG, "%s%s loaded in %lld ms", m_detect->info().name, m_screen ? " + 96x96 screen" : "",
+             m_stats.last_load_us / 1000);
+    return true;
+}
+
+void DetectorService::warmup(const dl::image::jpeg_img_t *warmup_jpeg) {
+    if (!warmup_jpeg) {
+        return;
+    }
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+    memtel::check(memtel::STAGE_WARMUP);
+#endif
+    MEM_SCOPE(mem, memtel::STAGE_WARMUP);
+    dl::image::img_t img = dl::image::sw_decode_jpeg(*warmup_jpeg, dl::image::DL_IMAGE_PIX_TYPE_RGB888);
+    if (!img.data) {
+        ESP_LOGW(TAG, "Could not decode warmup image");
+        return;
+    }
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+    // Das dekodierte Bild ist ein Block, beim nächsten Warmup (reload) wieder
+    memtel::require(memtel::STAGE_WARMUP, memtel::POOL_PSRAM, (uint32_t)img.width * img.height * 3);
+#endif
+
+    int64_t start_us = esp_timer_get_time();
+    if (m_screen) {
+        m_screen->run(img);
+    }
+    const auto &results = collect(m_detect->run(img));
+    m_stats.last_warmup_us = esp_timer_get_time() - start_us;
+    publish_stats();
+    ESP_LOGI(TAG, "Warmup done in %lld ms, %u result(s) on reference image",
+             m_stats.last_warmup_us / 1000, (unsigned)results.size());
+    heap_caps_free(img.data);
+}
+
+const ResultList &DetectorService::collect(std::list<dl::detect::result_t> &raw) {
+    m_results.clear();
+    for (const auto &res : raw) {
+        // MAX_RESULTS entspricht top_k des ESPDet-Postprocessors
+        if (res.category == 0 && res.score > m_min_score && !m_results.full()) {
+            m_results.push_back(res);
+        }
+    }
+    return m_results;
+}
+
+void DetectorService::record_call(int64_t end_us) {
+    int64_t call_us = end_us - m_call_start_us;
+    m_stats.calls++;
+    m_stats.total_call_us += call_us;
+    if (call_us > m_stats.max_call_us) {
+        m_stats.max_call_us = call_us;
+    }
+    publish_stats();
+}
+
+// Ein Aufruf pro Inferenz, gegen log_stats() aus dem Hauptloop praktisch nie umkämpft
+void DetectorService::publish_stats() {
+    std::lock_guard<std::mutex> lock(m_stats_lock);
+    m_published = m_stats;
+}
+
+// Im Inferenz-Task: nur hier werden m_stats und die Modell-Latenzen gelesen und geschrieben
+void DetectorService::select_for_budget(int budget_ms) {
+    // In der Kaskade enthält die Zykluszeit beide Stufen und taugt nicht als Modell-Latenz
+    if (m_stats.calls && !m_screen) {
+        bumblebee_detect::set_measured_latency(model_index(), m_stats.total_call_us / m_stats.calls / 1000);
+    }
+    int index = bumblebee_detect::select_model(budget_ms);
+    if (index >= 0 && index != model_index()) {
+        use_model(index);
+    }
+}
+
+void DetectorService::switch_pending() {
+    const int budget_ms = m_pending_budget_ms.exchange(-1);
+    if (budget_ms >= 0) {
+        select_for_budget(budget_ms);
+    }
+    int pending = m_pending_model.load();
+    if (pending < 0) {
+        return;
+    }
+    if (pending == model_index()) {
+        m_pending_model.compare_exchange_strong(pending, -1);
+        return;
+    }
+    int previous = model_index();
+    ESP_LOGI(TAG, "Switching model %s -> %s", bumblebee_detect::model_info(previous).name,
+             bumblebee_detect::model_info(pending).name);
+    stop();
+    // Laufzeitstatistik gilt pro Modell
+    m_stats.calls = 0;
+    m_stats.total_call_us = 0;
+    m_stats.max_call_us = 0;
+    m_stats.screen_fired = 0;
+    if (!load()) {
+        ESP_LOGE(TAG, "Failed to load model, falling back to %s", bumblebee_detect::model_info(previous).name);
+        m_pending_model.store(previous);
+        if (!load()) {
+            // Ohne Modell liefern preprocess()/infer() leere Ergebnisse, bis reload() gelingt
+            ESP_LOGE(TAG, "No model loaded");
+        }
+    }
+}
+
+const ResultList &DetectorService::cascade(const dl::image::img_t &img, const std::vector<int> &crop_area) {
+    m_call_start_us = esp_timer_get_time();
+
+    // Stufe 1: 96x96 auf dem ganzen Ausschnitt, Boxen der Treffer vereinigen
+    m_screen->preprocess(img, crop_area);
+    bool fired = false;
+    int box[4] = {img.width, img.height, 0, 0};
+    for (const auto &res : m_screen->infer(img.width, img.height)) {
+        if (res.category != 0 || res.score < m_cascade.screen_thr) {
+            continue;
+        }
+        fired = true;
+        box[0] = std::min(box[0], res.box[0]);
+        box[1] = std::min(box[1], res.box[1]);
+        box[2] = std::max(box[2], res.box[2]);
+        box[3] = std::max(box[3], res.box[3]);
+    }
+    int64_t screen_end_us = esp_timer_get_time();
+    m_stats.last_screen_us = screen_end_us - m_call_start_us;
+    m_stats.last_postprocess_us = m_screen->last_postprocess_us();
+
+    if (!fired) {
+        m_results.clear();
+        m_stats.last_confirm_us = 0;
+        record_call(screen_end_us);
+        return m_results;
+    }
+
+    // Stufe 2: 224x224 auf dem Ausschnitt oder nur auf der Umgebung der Stufe-1-Boxen
+    if (crop_area.empty()) {
+        m_area = {0, 0, img.width, img.height};
+    } else {
+        m_area.assign(crop_area.begin(), crop_area.end());
+    }
+    if (m_cascade.refine) {
+        int grow_x = std::max(m_cascade.refine_margin, (m_cascade.refine_min_size - (box[2] - box[0])) / 2);
+        int grow_y = std::max(m_cascade.refine_margin, (m_cascade.refine_min_size - (box[3] - box[1])) / 2);
+        m_area = {std::max(m_area[0], box[0] - grow_x), std::max(m_area[1], box[1] - grow_y),
+                  std::min(m_area[2], box[2] + grow_x), std::min(m_area[3], box[3] + grow_y)};
+    }
+    m_detect->preprocess(img, m_area);
+    const auto &results = collect(m_detect->infer(img.width, img.height));
+    int64_t end_us = esp_timer_get_time();
+
+    m_stats.last_confirm_us = end_us - screen_end_us;
+    m_stats.last_postprocess_us += m_detect->last_postprocess_us();
+    m_stats.screen_fired++;
+    record_call(end_us);
+    return results;
+}
+
+// --------- Public API ----------------------------------
+
+bool DetectorService::start(const dl::image::jpeg_img_t *warmup_jpeg) {
+    if (m_detect) {
+        return true;
+    }
+    if (!load()) {
+        ESP_LOGE(TAG, "Failed to load model");
+        return false;
+    }
+    warmup(warmup_jpeg);
+    return true;
+}
+
+bool DetectorService::reload(const dl::image::jpeg_img_t *warmup_jpeg) {
+    ESP_LOGI(TAG, "Reloading model");
+    // Altes Modell zuerst freigeben, zwei Modelle passen nicht gleichzeitig in den PSRAM
+    stop();
+    return start(warmup_jpeg);
+}
+
+void DetectorService::stop() {
+    delete m_detect;
+    m_detect = nullptr;
+    delete m_screen;
+    m_screen = nullptr;
+    m_results.clear();
+}
+
+void DetectorService::use_model(int index) {
+    if (index < 0 || index >= bumblebee_detect::model_count() || !bumblebee_detect::model_info(index).packed) {
+        ESP_LOGW(TAG, "Model %d is not available", index);
+        return;
+    }
+    m_pending_model.store(index);
+}
+
+void DetectorService::apply_budget(int budget_ms) {
+    if (budget_ms >= 0) {
+        m_pending_budget_ms.store(budget_ms);
+    }
+}
+
+void DetectorService::preprocess(const dl::image::img_t &img, const std::vector<int> &crop_area) {
+    switch_pending();
+    m_call_start_us = esp_timer_get_time();
+    if (!m_detect) {
+        return;
+    }
+    m_detect->preprocess(img, crop_area);
+    m_stats.last_preprocess_us = esp_timer_get_time() - m_call_start_us;
+}
+
+const ResultList &DetectorService::infer(int img_width, int img_height) {
+    if (!m_detect) {
+        m_results.clear();
+        return m_results;
+    }
+    int64_t start_us = esp_timer_get_time();
+    const auto &results = collect(m_detect->infer(img_width, img_height));
+    int64_t end_us = esp_timer_get_time();
+
+    m_stats.last_infer_us = end_us - start_us;
+    m_stats.last_postprocess_us = m_detect->last_postprocess_us();
+    record_call(end_us);
+    return results;
+}
+
+const ResultList &DetectorService::detect(const dl::image::img_t &img, const std::vector<int> &crop_area) {
+    switch_pending();
+    if (m_screen && m_detect) {
+        return cascade(img, crop_area);
+    }
+    preprocess(img, crop_area);
+    return infer(img.width, img.height);
+}
+
+detector_stats_t DetectorService::stats() const {
+    std::lock_guard<std::mutex> lock(m_stats_lock);
+    return m_published;
+}
+
+void DetectorService::log_stats() const {
+    const detector_stats_t s = stats();
+    int64_t avg_us = s.calls ? s.total_call_us / s.calls : 0;
+    ESP_LOGI(TAG, "model %s", bumblebee_detect::model_info(model_index()).name);
+    ESP_LOGI(TAG, "pre %lld us, infer %lld us (post %lld us), avg call %lld us, max %lld us (%lu calls) | load %lld ms (%lu loads)",
+             s.last_preprocess_us, s.last_infer_us, s.last_postprocess_us, avg_us, s.max_call_us,
+             (unsigned long)s.calls, s.last_load_us / 1000, (unsigned long)s.loads);
+    if (m_cascade.enabled) {
+        ESP_LOGI(TAG, "cascade: stage 2 in %lu/%lu cycles (%.1f%%), last screen %lld us, last confirm %lld us",
+                 (unsigned long)s.screen_fired, (unsigned long)s.calls,
+                 s.calls ? 100.0f * s.screen_fired / s.calls : 0.0f, s.last_screen_us, s.last_confirm_us);
+    }
+}
+
+} // namespace detector
@@ -0,0 +1,108 @@
+#include "frame_lease.hpp"
+
+#include <atomic>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+namespace camera {
+
+static const char *TAG = "FRAME_LEASE";
+
+// capture_task (Core 0, Frames ohne Bewegung bzw. JPEG) und infer_task (Core 1) geben Frames
+// zurück; jedes Feld ist für sich atomar. Die 64-Bit-Atomics sind auf dem Xtensa nicht
+// lock-free, bei ein bis zwei Rückgaben pro Frame spielt das keine Rolle.
+struct shared_stats_t {
+    std::atomic<uint32_t> leases{0};
+    std::atomic<uint32_t> late_releases{0};
+    std::atomic<int64_t> last_hold_us{0};
+    std::atomic<int64_t> max_hold_us{0};
+    std::atomic<int64_t> total_hold_us{0};
+};
+
+static shared_stats_t g_stats;
+
+// --------- Internal helpers ----------------------------------
+
+static void record_release(int64_t hold_us) {
+    g_stats.leases.fetch_add(1, std::memory_order_relaxed);
+    g_stats.last_hold_us.store(hold_us, std::memory_order_relaxed);
+    g_stats.total_hold_us.fetch_add(hold_us, std::memory_order_relaxed);
+    int64_t max_us = g_stats.max_hold_us.load(std::memory_order_relaxed);
+    while (hold_us > max_us &&
+           !g_stats.max_hold_us.compare_exchange_weak(max_us, hold_us, std::memory_order_relaxed)) {
+    }
+    if (hold_us > LEASE_HOLD_BUDGET_US) {
+        g_stats.late_releases.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// --------- Public API ----------------------------------
+
+FrameLease FrameLease::acquire() {
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb) {
+        ESP_LOGE(TAG, "Failed to capture image");
+        return FrameLease();
+    }
+    return FrameLease(fb);
+}
+
+FrameLease::FrameLease(camera_fb_t *fb) : m_fb(fb), m_acquired_us(esp_timer_get_time()) {}
+
+FrameLease::~FrameLease() {
+    release();
+}
+
+FrameLease::FrameLease(FrameLease &&other) : m_fb(other.m_fb), m_acquired_us(other.m_acquired_us) {
+    other.m_fb = nullptr;
+}
+
+FrameLease &FrameLease::operator=(FrameLease &&other) {
+    if (this != &other) {
+        release();
+        m_fb = other.m_fb;
+        m_acquired_us = other.m_acquired_us;
+        other.m_fb = nullptr;
+    }
+    return *this;
+}
+
+dl::image::img_t FrameLease::image() const {
+    dl::image::img_t img = {};
+    if (m_fb) {
+        img.data = m_fb->buf;
+        img.width = m_fb->width;
+        img.height = m_fb->height;
+        img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565;
+    }
+    return img;
+}
+
+void FrameLease::release() {
+    if (!m_fb) {
+        return;
+    }
+    esp_camera_fb_return(m_fb);
+    m_fb = nullptr;
+    record_release(esp_timer_get_time() - m_acquired_us);
+}
+
+lease_stats_t lease_stats() {
+    lease_stats_t s = {};
+    s.leases = g_stats.leases.load(std::memory_order_relaxed);
+    s.late_releases = g_stats.late_releases.load(std::memory_order_relaxed);
+    s.last_hold_us = g_stats.last_hold_us.load(std::memory_order_relaxed);
+    s.max_hold_us = g_stats.max_hold_us.load(std::memory_order_relaxed);
+    s.total_hold_us = g_stats.total_hold_us.load(std::memory_order_relaxed);
+    return s;
+}
+
+void log_lease_stats() {
+    const lease_stats_t s = lease_stats();
+    int64_t avg_us = s.leases ? s.total_hold_us / s.leases : 0;
+    ESP_LOGI(TAG, "held %lld us (avg %lld, max %lld), late releases %lu/%lu",
+             s.last_hold_us, avg_us, s.max_hold_us,
+             (unsigned long)s.late_releases, (unsigned long)s.leases);
+}
+
+} // namespace camera
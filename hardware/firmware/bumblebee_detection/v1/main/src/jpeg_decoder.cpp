@@ -0,0 +1,180 @@
+#include "jpeg_decoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+namespace jpegdec {
+
+static const char *TAG = "JPEGDEC";
+
+// --------- Public API ----------------------------------
+
+Decoder::~Decoder() {
+    close();
+}
+
+void Decoder::close() {
+    close_handle();
+    heap_caps_free(m_block);
+    m_block = nullptr;
+    m_block_size = 0;
+}
+
+void Decoder::close_handle() {
+    if (m_handle) {
+        jpeg_dec_close(m_handle);
+        m_handle = nullptr;
+    }
+}
+
+// Der Handle gilt für eine Ausgabegröße; Bilder gleicher Größe dekodieren ohne neue Allokation
+bool Decoder::open_handle(int out_width, int out_height, int scale_shift) {
+    if (m_handle && out_width == m_out_width && out_height == m_out_height && scale_shift == m_scale_shift) {
+        return true;
+    }
+    close_handle();
+    jpeg_dec_config_t cfg = DEFAULT_JPEG_DEC_CONFIG();
+    cfg.output_type = JPEG_PIXEL_FORMAT_RGB565_BE;
+    cfg.block_enable = true;
+    if (scale_shift) {
+        cfg.scale.width = out_width;
+        cfg.scale.height = out_height;
+    }
+    jpeg_error_t ret = jpeg_dec_open(&cfg, &m_handle);
+    if (ret != JPEG_ERR_OK) {
+        ESP_LOGE(TAG, "jpeg_dec_open failed (%d)", ret);
+        m_handle = nullptr;
+        return false;
+    }
+    m_out_width = out_width;
+    m_out_height = out_height;
+    m_scale_shift = scale_shift;
+    return true;
+}
+
+bool Decoder::reserve_block(size_t size) {
+    if (size <= m_block_size) {
+        return true;
+    }
+    heap_caps_free(m_block);
+    m_block = nullptr;
+    m_block_size = 0;
+    // Ausgabepuffer des Decoders müssen 16-Byte-ausgerichtet sein; eine Blockzeile ist klein
+    // genug für den internen RAM, der Decoder schreibt dort schneller als ins PSRAM
+    void *p = heap_caps_aligned_alloc(16, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!p) {
+        p = heap_caps_aligned_alloc(16, size, MALLOC_CAP_SPIRAM);
+    }
+    m_block = static_cast<uint8_t *>(p);
+    m_block_size = m_block ? size : 0;
+    return m_block != nullptr;
+}
+
+bool Decoder::run(jpeg_dec_handle_t handle, const uint8_t *jpeg, size_t len, int width, int height,
+                  int scale_shift, int x0, int y0, int roi_width, int roi_height, uint8_t *dst) {
+    jpeg_dec_io_t io = {};
+    io.inbuf = const_cast<uint8_t *>(jpeg);
+    io.inbuf_len = (int)len;
+    jpeg_dec_header_info_t info = {};
+    jpeg_error_t ret = jpeg_dec_parse_header(handle, &io, &info);
+    if (ret != JPEG_ERR_OK) {
+        ESP_LOGE(TAG, "Bad JPEG header (%d)", ret);
+        return false;
+    }
+    if ((int)info.width != width || (int)info.height != height) {
+        ESP_LOGE(TAG, "JPEG is %dx%d, expected %dx%d", (int)info.width, (int)info.height, width, height);
+        return false;
+    }
+
+    int block_len = 0;
+    int blocks = 0;
+    if (jpeg_dec_get_outbuf_len(handle, &block_len) != JPEG_ERR_OK ||
+        jpeg_dec_get_process_count(handle, &blocks) != JPEG_ERR_OK) {
+        return false;
+    }
+    const int row_bytes = (width >> scale_shift) * 2;
+    if (block_len <= 0 || block_len % row_bytes) {
+        ESP_LOGE(TAG, "Unexpected block size %d for rows of %d bytes", block_len, row_bytes);
+        return false;
+    }
+    if (!reserve_block(block_len)) {
+        ESP_LOGE(TAG, "Could not allocate %d byte block buffer", block_len);
+        return false;
+    }
+    const int block_rows = block_len / row_bytes;
+    const int y1 = y0 + roi_height;
+    const int needed = std::min(blocks, (y1 + block_rows - 1) / block_rows);
+    if (needed * block_rows < y1) {
+        return false;
+    }
+
+    io.outbuf = m_block;
+    io.out_size = block_len;
+    for (int b = 0; b < needed; ++b) {
+        const int consumed = io.inbuf_len - io.inbuf_remain;
+        io.inbuf += consumed;
+        io.inbuf_len = io.inbuf_remain;
+        ret = jpeg_dec_process(handle, &io);
+        if (ret != JPEG_ERR_OK) {
+            ESP_LOGE(TAG, "Decoding block %d failed (%d)", b, ret);
+            return false;
+        }
+        m_stats.blocks++;
+        const int first = b * block_rows;
+        for (int y = std::max(first, y0); y < std::min(first + block_rows, y1); ++y) {
+            memcpy(dst + (size_t)(y - y0) * roi_width * 2, m_block + (size_t)(y - first) * row_bytes + x0 * 2,
+                   (size_t)roi_width * 2);
+        }
+    }
+    m_stats.blocks_skipped += blocks - needed;
+    return true;
+}
+
+bool Decoder::decode_roi(const uint8_t *jpeg, size_t len, int width, int height, int scale_shift, int x0, int y0,
+                         int roi_width, int roi_height, uint8_t *dst) {
+    const int64_t start_us = esp_timer_get_time();
+    const int out_width = width >> std::clamp(scale_shift, 0, MAX_SCALE_SHIFT);
+    const int out_height = height >> std::clamp(scale_shift, 0, MAX_SCALE_SHIFT);
+    if (!jpeg || !dst || scale_shift < 0 || scale_shift > MAX_SCALE_SHIFT || x0 < 0 || y0 < 0 || roi_width <= 0 ||
+        roi_height <= 0 || x0 + roi_width > out_width || y0 + roi_height > out_height) {
+        ESP_LOGE(TAG, "ROI %d,%d %dx%d outside of %dx%d (1/%d)", x0, y0, roi_width, roi_height, out_width, out_height,
+                 1 << std::clamp(scale_shift, 0, MAX_SCALE_SHIFT));
+        m_stats.failed++;
+        return false;
+    }
+
+    if (!open_handle(out_width, out_height, scale_shift)) {
+        m_stats.failed++;
+        return false;
+    }
+    if (!run(m_handle, jpeg, len, width, height, scale_shift, x0, y0, roi_width, roi_height, dst)) {
+        // Nach einem kaputten Bild nicht auf den Zustand des Handles verlassen
+        close_handle();
+        m_stats.failed++;
+        return false;
+    }
+
+    const uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+    m_stats.images++;
+    m_stats.last_us = us;
+    m_stats.total_us += us;
+    m_stats.max_us = std::max(m_stats.max_us, us);
+    m_stats.in_bytes += len;
+    m_stats.out_bytes += (uint64_t)roi_width * roi_height * 2;
+    return true;
+}
+
+void Decoder::log_stats() const {
+    const uint32_t n = m_stats.images;
+    ESP_LOGI(TAG, "%lu images, avg %lu bytes in, %lu bytes out in %lld us, max %lu us, blocks %lu decoded / %lu "
+             "skipped, failed %lu",
+             (unsigned long)n, n ? (unsigned long)(m_stats.in_bytes / n) : 0UL,
+             n ? (unsigned long)(m_stats.out_bytes / n) : 0UL, n ? m_stats.total_us / n : 0LL,
+             (unsigned long)m_stats.max_us, (unsigned long)m_stats.blocks, (unsigned long)m_stats.blocks_skipped,
+             (unsigned long)m_stats.failed);
+}
+
+} // namespace jpegdec
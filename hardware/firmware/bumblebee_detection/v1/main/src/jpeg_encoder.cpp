@@ -0,0 +1,229 @@
+#include "jpeg_encoder.hpp"
+
+#include <algorithm>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "rgb565_roi.hpp"
+
+namespace jpegenc {
+
+static const char *TAG = "JPEGENC";
+
+// --------- Internal helpers ----------------------------------
+
+static size_t input_bytes_per_pixel(input_t input) {
+    switch (input) {
+    case INPUT_RGB888:
+        return 3;
+    case INPUT_GRAY:
+        return 1;
+    default:
+        return 2;   // RGB565 wird als YCbYCr kodiert
+    }
+}
+
+static bool same_config(const encoder_config_t &a, const encoder_config_t &b) {
+    return a.width == b.width && a.height == b.height && a.input == b.input && a.subsampling == b.subsampling &&
+           a.quality == b.quality;
+}
+
+// Tatsächlich verwendetes Subsampling
+static encoder_config_t effective(const encoder_config_t &cfg) {
+    encoder_config_t eff = cfg;
+    if ((cfg.input == INPUT_RGB565_BE || cfg.input == INPUT_YUYV) && cfg.subsampling == JPEG_SUBSAMPLE_444) {
+        // Mehr Chroma als im YCbYCr-Eingang steckt, würde nur hochgerechnet
+        eff.subsampling = JPEG_SUBSAMPLE_422;
+    }
+    if (cfg.input == INPUT_GRAY) {
+        eff.subsampling = JPEG_SUBSAMPLE_GRAY;
+    }
+    return eff;
+}
+
+static uint8_t *alloc_buffer(size_t size) {
+    // Eingangspuffer des Encoders müssen 16-Byte-ausgerichtet sein
+    void *p = heap_caps_aligned_alloc(16, size, MALLOC_CAP_SPIRAM);
+    if (!p) {
+        p = heap_caps_aligned_alloc(16, size, MALLOC_CAP_DEFAULT);
+    }
+    return static_cast<uint8_t *>(p);
+}
+
+// --------- Public API ----------------------------------
+
+size_t Encoder::output_size(const encoder_config_t &cfg) {
+    // Bei 4:4:4 und Qualität bis 80 bleibt JPEG unter 1 Byte/Pixel, weniger Chroma
+    // spart anteilig; darüber wächst der Puffer bei Bedarf (grow_output)
+    const encoder_config_t eff = effective(cfg);
+    const size_t pixels = (size_t)cfg.width * cfg.height;
+    size_t bytes;
+    if (eff.subsampling == JPEG_SUBSAMPLE_GRAY) {
+        bytes = pixels / 3;
+    } else if (eff.subsampling == JPEG_SUBSAMPLE_420) {
+        bytes = pixels / 2;
+    } else if (eff.subsampling == JPEG_SUBSAMPLE_422) {
+        bytes = pixels * 2 / 3;
+    } else {
+        bytes = pixels;
+    }
+    if (cfg.quality > 90) {
+        bytes *= 3;
+    } else if (cfg.quality > 80) {
+        bytes += bytes / 2;
+    }
+    return bytes + 1024;
+}
+
+Encoder::~Encoder() {
+    close();
+}
+
+bool Encoder::open(const encoder_config_t &cfg) {
+    if (m_handle && same_config(effective(cfg), m_cfg)) {
+        return true;
+    }
+    close();
+    if (cfg.width <= 0 || cfg.height <= 0 || cfg.quality == 0 || cfg.quality > 100 ||
+        (cfg.input == INPUT_RGB565_BE && (cfg.width & 1))) {
+        ESP_LOGE(TAG, "Invalid encoder config %dx%d q%u", cfg.width, cfg.height, cfg.quality);
+        return false;
+    }
+    m_cfg = effective(cfg);
+
+    // Encoder läuft komplett im aufrufenden Task; ein eigener Huffman-Task würde in der
+    // Detektions-Firmware auf dem Core der Inferenz landen (Core-Plan in pipeline.hpp)
+    jpeg_enc_config_t enc_cfg = {
+        .width = cfg.width,
+        .height = cfg.height,
+        .src_type = cfg.input == INPUT_RGB888 ? JPEG_PIXEL_FORMAT_RGB888
+                    : cfg.input == INPUT_GRAY ? JPEG_PIXEL_FORMAT_GRAY
+                                              : JPEG_PIXEL_FORMAT_YCbYCr,
+        .subsampling = m_cfg.subsampling,
+        .quality = cfg.quality,
+        .rotate = JPEG_ROTATE_0D,
+        .task_enable = false,
+        .hfm_task_priority = 13,
+        .hfm_task_core = 0,
+    };
+    jpeg_error_t ret = jpeg_enc_open(&enc_cfg, &m_handle);
+    if (ret != JPEG_ERR_OK) {
+        ESP_LOGE(TAG, "jpeg_enc_open failed (%d)", ret);
+        m_handle = nullptr;
+        return false;
+    }
+    if (cfg.input == INPUT_RGB565_BE) {
+        m_yuyv = alloc_buffer((size_t)cfg.width * cfg.height * 2);
+        if (!m_yuyv) {
+            ESP_LOGE(TAG, "Could not allocate YCbYCr buffer");
+            close();
+            return false;
+        }
+    }
+    m_stats.opens++;
+    ESP_LOGI(TAG, "Encoder %dx%d, input %d, subsampling %d, quality %u", cfg.width, cfg.height, cfg.input,
+             m_cfg.subsampling, cfg.quality);
+    return true;
+}
+
+void Encoder::close() {
+    if (m_handle) {
+        jpeg_enc_close(m_handle);
+        m_handle = nullptr;
+    }
+    heap_caps_free(m_yuyv);
+    m_yuyv = nullptr;
+    heap_caps_free(m_out);
+    m_out = nullptr;
+    m_out_size = 0;
+}
+
+bool Encoder::grow_output() {
+    const size_t size = m_out_size ? m_out_size * 2 : output_size(m_cfg);
+    uint8_t *out = alloc_buffer(size);
+    if (!out) {
+        return false;
+    }
+    heap_caps_free(m_out);
+    m_out = out;
+    m_out_size = size;
+    return true;
+}
+
+bool Encoder::process(const uint8_t *in, size_t in_size, uint8_t *outbuf, size_t outbuf_size,
+                      dl::image::jpeg_img_t &jpeg) {
+    const int64_t start_us = esp_timer_get_time();
+    int out_len = 0;
+    jpeg_error_t ret = jpeg_enc_process(m_handle, in, in_size, outbuf, outbuf_size, &out_len);
+    if (ret != JPEG_ERR_OK && outbuf == m_out && m_out_size < in_size && grow_output()) {
+        // Eigener Puffer zu knapp (sehr detailreiches Bild): einmal mit doppelter Größe
+        m_stats.grown++;
+        outbuf = m_out;
+        ret = jpeg_enc_process(m_handle, in, in_size, outbuf, m_out_size, &out_len);
+    }
+    const uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+    if (ret != JPEG_ERR_OK) {
+        ESP_LOGE(TAG, "JPEG encoding failed (%d)", ret);
+        m_stats.failed++;
+        return false;
+    }
+    jpeg.data = outbuf;
+    jpeg.data_len = out_len;
+
+    m_stats.images++;
+    m_stats.last_us = us;
+    m_stats.last_bytes = out_len;
+    m_stats.total_us += us;
+    m_stats.total_bytes += out_len;
+    m_stats.max_us = std::max(m_stats.max_us, us);
+    m_stats.max_bytes = std::max(m_stats.max_bytes, (uint32_t)out_len);
+    return true;
+}
+
+bool Encoder::encode(const uint8_t *data, uint8_t *outbuf, size_t outbuf_size, dl::image::jpeg_img_t &jpeg) {
+    if (!m_handle || !data || !outbuf) {
+        return false;
+    }
+    const size_t pixels = (size_t)m_cfg.width * m_cfg.height;
+    if (m_cfg.input == INPUT_RGB565_BE) {
+        imgconv::rgb565_roi_to_yuyv(data, m_cfg.width, m_cfg.height, 0, 0, m_cfg.width, m_cfg.height, m_yuyv);
+        data = m_yuyv;
+    }
+    return process(data, pixels * input_bytes_per_pixel(m_cfg.input), outbuf, outbuf_size, jpeg);
+}
+
+bool Encoder::encode(const uint8_t *data, dl::image::jpeg_img_t &jpeg) {
+    if (!m_out && !grow_output()) {
+        ESP_LOGE(TAG, "Could not allocate output buffer");
+        return false;
+    }
+    return encode(data, m_out, m_out_size, jpeg);
+}
+
+bool Encoder::encode_roi(const uint8_t *frame, int frame_width, int frame_height, int x0, int y0,
+                         dl::image::jpeg_img_t &jpeg) {
+    if (!m_handle || m_cfg.input != INPUT_RGB565_BE) {
+        return false;
+    }
+    if (!m_out && !grow_output()) {
+        ESP_LOGE(TAG, "Could not allocate output buffer");
+        return false;
+    }
+    if (!imgconv::rgb565_roi_to_yuyv(frame, frame_width, frame_height, x0, y0, m_cfg.width, m_cfg.height, m_yuyv)) {
+        ESP_LOGE(TAG, "ROI %d,%d %dx%d outside of %dx%d frame", x0, y0, m_cfg.width, m_cfg.height, frame_width,
+                 frame_height);
+        return false;
+    }
+    return process(m_yuyv, (size_t)m_cfg.width * m_cfg.height * 2, m_out, m_out_size, jpeg);
+}
+
+void Encoder::log_stats() const {
+    const uint32_t n = m_stats.images;
+    ESP_LOGI(TAG, "%dx%d q%u: %lu images, avg %lu bytes in %lld us, max %lu bytes / %lu us, failed %lu, grown %lu",
+             m_cfg.width, m_cfg.height, m_cfg.quality, (unsigned long)n,
+             n ? (unsigned long)(m_stats.total_bytes / n) : 0UL, n ? m_stats.total_us / n : 0LL,
+             (unsigned long)m_stats.max_bytes, (unsigned long)m_stats.max_us, (unsigned long)m_stats.failed,
+             (unsigned long)m_stats.grown);
+}
+
+} // namespace jpegenc
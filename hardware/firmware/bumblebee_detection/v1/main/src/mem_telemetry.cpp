@@ -0,0 +1,201 @@
+#include "mem_telemetry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+namespace memtel {
+
+static const char *TAG = "MEM";
+
+// Reihenfolge wie stage_t
+static const char *STAGE_NAMES[STAGE_COUNT] = {
+    "boot", "load", "minimize", "warmup", "start", "capture", "infer", "encode", "storage",
+};
+static const uint32_t POOL_CAPS[POOL_COUNT] = {MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_SPIRAM};
+static const char *POOL_NAMES[POOL_COUNT] = {"internal", "psram"};
+
+// Jede Stufe wird von genau einem Task verbucht; ihre Sperre schützt nur gegen den Bericht
+static std::mutex s_stage_locks[STAGE_COUNT];
+static stage_mem_t s_stages[STAGE_COUNT] = {};
+static std::mutex s_report_lock;                   // s_warned: check() und log_report()
+static bool s_warned[STAGE_COUNT][POOL_COUNT] = {};
+static std::atomic<uint8_t> s_min_stage[POOL_COUNT] = {};  // Phase mit dem letzten Tiefstand
+static uint32_t s_margin_pct = 25;
+
+// --------- Internal helpers ----------------------------------
+
+static uint32_t with_margin(uint32_t bytes) {
+    return (uint32_t)((uint64_t)bytes * (100 + s_margin_pct) / 100);
+}
+
+// Bedarf und Spitzen der Pipeline-Stufen (ab STAGE_CAPTURE, laufen immer wieder) gegen den
+// aktuellen Stand; je Stufe und Speicher eine Warnung, bis der Speicher wieder reicht.
+// Einmalige Phasen wie Laden und Warmup prüft check() direkt davor. Aufrufer hält s_report_lock.
+static void check_all(const snapshot_t &now) {
+    for (int s = STAGE_CAPTURE; s < STAGE_COUNT; ++s) {
+        const stage_mem_t st = stage((stage_t)s);
+        for (int p = 0; p < POOL_COUNT; ++p) {
+            const heap_t &h = now.pool[p];
+            const bool block_low = st.required[p] && h.largest < with_margin(st.required[p]);
+            const bool free_low = st.peak_use[p] && h.free < with_margin(st.peak_use[p]);
+            if (!block_low && !free_low) {
+                s_warned[s][p] = false;
+                continue;
+            }
+            if (s_warned[s][p]) {
+                continue;
+            }
+            s_warned[s][p] = true;
+            if (block_low) {
+                ESP_LOGW(TAG, "%s: largest free block %lu KB, %s needs %lu KB", POOL_NAMES[p],
+                         (unsigned long)(h.largest / 1024), STAGE_NAMES[s], (unsigned long)(st.required[p] / 1024));
+            } else {
+                ESP_LOGW(TAG, "%s: %lu KB free, %s peaked at %lu KB", POOL_NAMES[p], (unsigned long)(h.free / 1024),
+                         STAGE_NAMES[s], (unsigned long)(st.peak_use[p] / 1024));
+            }
+        }
+    }
+}
+
+// --------- Public API ----------------------------------
+
+void init(uint8_t warn_margin_pct) {
+    s_margin_pct = warn_margin_pct;
+    const snapshot_t now = capture();
+    commit(STAGE_BOOT, now, now);
+}
+
+snapshot_t capture(bool with_largest) {
+    snapshot_t snap = {};
+    for (int p = 0; p < POOL_COUNT; ++p) {
+        snap.pool[p].free = heap_caps_get_free_size(POOL_CAPS[p]);
+        snap.pool[p].min_free = heap_caps_get_minimum_free_size(POOL_CAPS[p]);
+        if (with_largest) {
+            snap.pool[p].largest = heap_caps_get_largest_free_block(POOL_CAPS[p]);
+        }
+    }
+    return snap;
+}
+
+void commit(stage_t stage, const snapshot_t &start, const snapshot_t &end) {
+    std::lock_guard<std::mutex> lock(s_stage_locks[stage]);
+    stage_mem_t &st = s_stages[stage];
+    st.runs++;
+    for (int p = 0; p < POOL_COUNT; ++p) {
+        const heap_t &a = start.pool[p];
+        const heap_t &b = end.pool[p];
+        st.last[p] = b;
+        if (st.runs == 1 || b.free < st.low_free[p]) {
+            st.low_free[p] = b.free;
+        }
+        if (b.largest && (!st.low_largest[p] || b.largest < st.low_largest[p])) {
+            st.low_largest[p] = b.largest;
+        }
+        st.retained[p] = (int32_t)(a.free - b.free);
+        if (b.min_free < a.min_free) {
+            st.peak_use[p] = std::max(st.peak_use[p], a.free - std::min(a.free, b.min_free));
+            s_min_stage[p].store(stage, std::memory_order_relaxed);
+        }
+    }
+}
+
+void require(stage_t stage, pool_t pool, uint32_t bytes) {
+    std::lock_guard<std::mutex> lock(s_stage_locks[stage]);
+    s_stages[stage].required[pool] = std::max(s_stages[stage].required[pool], bytes);
+}
+
+bool check(stage_t stage) {
+    const snapshot_t now = capture();
+    std::lock_guard<std::mutex> lock(s_report_lock);
+    check_all(now);
+    const stage_mem_t st = memtel::stage(stage);
+    bool ok = true;
+    for (int p = 0; p < POOL_COUNT; ++p) {
+        const uint32_t need = st.required[p];
+        const uint32_t largest = now.pool[p].largest;
+        if (need && largest < need) {
+            ESP_LOGE(TAG, "%s: %s needs a %lu KB block, largest free is %lu KB", POOL_NAMES[p], STAGE_NAMES[stage],
+                     (unsigned long)(need / 1024), (unsigned long)(largest / 1024));
+            ok = false;
+        } else if (need && largest < with_margin(need)) {
+            ESP_LOGW(TAG, "%s: largest free block %lu KB, %s needs %lu KB", POOL_NAMES[p],
+                     (unsigned long)(largest / 1024), STAGE_NAMES[stage], (unsigned long)(need / 1024));
+        }
+    }
+    return ok;
+}
+
+const char *name(stage_t stage) {
+    return stage < STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
+
+stage_mem_t stage(stage_t stage) {
+    std::lock_guard<std::mutex> lock(s_stage_locks[stage]);
+    return s_stages[stage];
+}
+
+void log_report() {
+    const snapshot_t now = capture();
+    std::lock_guard<std::mutex> lock(s_report_lock);
+    check_all(now);
+    for (int p = 0; p < POOL_COUNT; ++p) {
+        const heap_t &h = now.pool[p];
+        ESP_LOGI(TAG, "%-8s free %lu KB, largest block %lu KB, min ever %lu KB (set in %s)", POOL_NAMES[p],
+                 (unsigned long)(h.free / 1024), (unsigned long)(h.largest / 1024), (unsigned long)(h.min_free / 1024),
+                 STAGE_NAMES[s_min_stage[p].load(std::memory_order_relaxed)]);
+    }
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        const stage_mem_t st = stage((stage_t)s);
+        if (!st.runs) {
+            continue;
+        }
+        // Größter Block nur, wo gemessen (Laden, minimize())
+        char largest[POOL_COUNT][12];
+        for (int p = 0; p < POOL_COUNT; ++p) {
+            if (st.low_largest[p]) {
+                snprintf(largest[p], sizeof(largest[p]), "%lu", (unsigned long)(st.low_largest[p] / 1024));
+            } else {
+                snprintf(largest[p], sizeof(largest[p]), "-");
+            }
+        }
+        ESP_LOGI(TAG, "%-8s int low %lu/%s KB, peak %lu KB, kept %ld KB | psram low %lu/%s KB, peak %lu KB, "
+                 "kept %ld KB (%lu runs)",
+                 STAGE_NAMES[s], (unsigned long)(st.low_free[POOL_INTERNAL] / 1024), largest[POOL_INTERNAL],
+                 (unsigned long)(st.peak_use[POOL_INTERNAL] / 1024), (long)(st.retained[POOL_INTERNAL] / 1024),
+                 (unsigned long)(st.low_free[POOL_PSRAM] / 1024), largest[POOL_PSRAM],
+                 (unsigned long)(st.peak_use[POOL_PSRAM] / 1024), (long)(st.retained[POOL_PSRAM] / 1024),
+                 (unsigned long)st.runs);
+    }
+}
+
+bool write_csv(storage::Backend &fs, const char *path) {
+    const snapshot_t now = capture();
+    FILE *f = fs.open(path, "a");
+    if (!f) {
+        ESP_LOGE(TAG, "Could not open %s", path);
+        return false;
+    }
+    bool ok = true;
+    if (fseek(f, 0, SEEK_END) == 0 && ftell(f) == 0) {
+        ok = fputs("uptime_ms,int_free,int_largest,int_min,int_min_stage,"
+                   "psram_free,psram_largest,psram_min,psram_min_stage\n", f) >= 0;
+    }
+    const heap_t &i = now.pool[POOL_INTERNAL];
+    const heap_t &s = now.pool[POOL_PSRAM];
+    ok = ok && fprintf(f, "%lld,%lu,%lu,%lu,%s,%lu,%lu,%lu,%s\n", (long long)(esp_timer_get_time() / 1000),
+                       (unsigned long)i.free, (unsigned long)i.largest, (unsigned long)i.min_free,
+                       STAGE_NAMES[s_min_stage[POOL_INTERNAL].load(std::memory_order_relaxed)], (unsigned long)s.free,
+                       (unsigned long)s.largest, (unsigned long)s.min_free,
+                       STAGE_NAMES[s_min_stage[POOL_PSRAM].load(std::memory_order_relaxed)]) > 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        ESP_LOGE(TAG, "Could not write %s", path);
+    }
+    return ok;
+}
+
+} // namespace memtel
@@ -0,0 +1,104 @@
+#include "motion_gate.hpp"
+
+#include <chrono>
+#include <cstdlib>
+
+namespace motion {
+
+// --------- Internal helpers ----------------------------------
+
+// Luma (BT.601, ganzzahlig) eines RGB565-Pixels in big endian Byte-Reihenfolge
+static inline uint8_t luma(const uint8_t *px) {
+    const uint32_t r = px[0] & 0xF8;
+    const uint32_t g = ((px[0] & 0x07) << 5) | ((px[1] & 0xE0) >> 3);
+    const uint32_t b = (px[1] & 0x1F) << 3;
+    return static_cast<uint8_t>((r * 77 + g * 150 + b * 29) >> 8);
+}
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// --------- Public API ----------------------------------
+
+gate_config_t default_gate_config() {
+    gate_config_t cfg = {};
+    cfg.step = 4;
+    cfg.diff_threshold = 24;
+    cfg.area_threshold = 0.01f;
+    cfg.bg_shift = 4;
+    cfg.force_every = 15;
+    return cfg;
+}
+
+bool MotionGate::init(const gate_config_t &cfg, int roi_width, int roi_height) {
+    if (cfg.step <= 0 || roi_width < cfg.step || roi_height < cfg.step) {
+        return false;
+    }
+    m_cfg = cfg;
+    m_plane_width = roi_width / cfg.step;
+    m_plane_height = roi_height / cfg.step;
+    m_background.assign(static_cast<size_t>(m_plane_width) * m_plane_height, 0);
+    m_initialized = false;
+    m_since_inference = 0;
+    m_stats = {};
+    return true;
+}
+
+decision_t MotionGate::update(const uint8_t *rgb565, int frame_width, int x0, int y0) {
+    const int64_t start_us = now_us();
+    const size_t stride = static_cast<size_t>(frame_width) * 2;
+    const int step = m_cfg.step;
+    // Pixel in der Mitte jeder step x step Zelle abtasten
+    const uint8_t *origin = rgb565 + (y0 + step / 2) * stride + (x0 + step / 2) * 2;
+
+    uint32_t changed = 0;
+    uint16_t *bg = m_background.data();
+    for (int y = 0; y < m_plane_height; ++y) {
+        const uint8_t *px = origin + y * step * stride;
+        for (int x = 0; x < m_plane_width; ++x, px += step * 2, ++bg) {
+            const int cur = luma(px);
+            if (!m_initialized) {
+                *bg = static_cast<uint16_t>(cur << 8);
+                continue;
+            }
+            if (std::abs(cur - (*bg >> 8)) > m_cfg.diff_threshold) {
+                ++changed;
+            }
+            *bg = static_cast<uint16_t>(*bg + (((cur << 8) - *bg) >> m_cfg.bg_shift));
+        }
+    }
+
+    const uint32_t total = static_cast<uint32_t>(m_plane_width * m_plane_height);
+    m_stats.last_changed_ratio = total ? static_cast<float>(changed) / total : 0.0f;
+
+    decision_t decision;
+    if (!m_initialized) {
+        m_initialized = true;
+        decision = DECISION_INIT;
+    } else if (m_stats.last_changed_ratio > m_cfg.area_threshold) {
+        decision = DECISION_MOTION;
+    } else if (m_cfg.force_every && m_since_inference + 1 >= m_cfg.force_every) {
+        decision = DECISION_FORCED;
+    } else {
+        decision = DECISION_SKIP;
+    }
+    m_since_inference = (decision == DECISION_SKIP) ? m_since_inference + 1 : 0;
+
+    m_stats.frames++;
+    m_stats.decisions[decision]++;
+    m_stats.last_cost_us = now_us() - start_us;
+    m_stats.total_cost_us += m_stats.last_cost_us;
+    if (m_stats.last_cost_us > m_stats.max_cost_us) {
+        m_stats.max_cost_us = m_stats.last_cost_us;
+    }
+    return decision;
+}
+
+float MotionGate::skip_ratio() const {
+    return m_stats.frames ? static_cast<float>(m_stats.decisions[DECISION_SKIP]) / m_stats.frames : 0.0f;
+}
+
+} // namespace motion
@@ -0,0 +1,441 @@
+#include "pipeline.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "detector_service.hpp"
+#include "frame_lease.hpp"
+#include "mem_telemetry.hpp"
+#include "pipeline_stages.hpp"
+#include "sd_card.hpp"
+#include "span_profiler.hpp"
+#include "write_behind.hpp"
+
+namespace pipeline {
+
+static const char *TAG = "PIPELINE";
+
+static constexpr int MODEL_IMG_SIZE = 224;
+
+// Records im Umlauf: je eine Queue-Position pro Stufe plus je einer in Arbeit.
+// storage hat keine Frame-Queue, encode kopiert fertige Records in den Write-Behind-Ring.
+static constexpr int FRAME_POOL_SIZE = 6;
+static constexpr UBaseType_t QUEUE_DEPTH[STAGE_COUNT] = {0, 1, 2, 0};
+// JPEG-Aufnahme: der dekodierte ROI lebt von capture bis zum Modell-Input (capture, Queue von infer, infer)
+static constexpr uint8_t DECODED_SLOTS = QUEUE_DEPTH[STAGE_INFER] + 2;
+// Wartezeit von encode zwischen zwei Versuchen, wenn der Ring voll ist (POLICY_BLOCK)
+static constexpr uint32_t RING_POLL_MS = 10;
+#if CONFIG_BEESENSE_PROFILER
+// storage hängt das Laufzeitprofil in diesem Abstand an <out_dir>/profile.csv an
+static constexpr int64_t PROFILE_CSV_INTERVAL_US = (int64_t)CONFIG_BEESENSE_PROFILER_CSV_S * 1000000;
+#endif
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+// storage hängt den Speicherstand in diesem Abstand an <out_dir>/memory.csv an
+static constexpr int64_t MEM_CSV_INTERVAL_US = (int64_t)CONFIG_BEESENSE_MEM_CSV_S * 1000000;
+#endif
+
+struct task_desc_t {
+    const char *name;
+    uint32_t stack_size;
+    UBaseType_t priority;
+    BaseType_t core;
+};
+
+static constexpr task_desc_t TASKS[STAGE_COUNT] = {
+    {"pl_capture", 4 * 1024, 6, 0},
+    {"pl_infer", 8 * 1024, 5, 1},
+    {"pl_encode", 6 * 1024, 4, 0},
+    {"pl_storage", 6 * 1024, 3, 0},
+};
+
+// Frame-Record der Tasks: Zustand der Stufen plus der Kamera-Lease, den nur die Tasks kennen
+struct frame_t : stages::frame_t {
+    camera::FrameLease lease;
+};
+
+static frame_t s_frames[FRAME_POOL_SIZE];
+static stages::Stages s_stages;
+static TaskHandle_t s_storage_task = nullptr;
+static QueueHandle_t s_free_q = nullptr;
+static QueueHandle_t s_queues[STAGE_COUNT] = {};
+static stage_stats_t s_stats[STAGE_COUNT] = {};
+static config_t s_cfg;
+static int64_t s_start_us = 0;
+
+// --------- Internal helpers ----------------------------------
+
+static void recycle(frame_t *f) {
+    f->lease.release();
+    s_stages.reset_frame(f);
+    xQueueSend(s_free_q, &f, portMAX_DELAY);
+}
+
+// Reicht einen Frame an die Eingangs-Queue von stage weiter (je nach Policy der Stufe)
+static void push(stage_t stage, frame_t *f) {
+    QueueHandle_t q = s_queues[stage];
+    if (s_cfg.policy[stage] == POLICY_BLOCK) {
+        xQueueSend(q, &f, portMAX_DELAY);
+        return;
+    }
+    while (xQueueSend(q, &f, 0) != pdTRUE) {
+        frame_t *oldest = nullptr;
+        if (xQueueReceive(q, &oldest, 0) == pdTRUE) {
+            s_stats[stage].dropped++;
+            recycle(oldest);
+        }
+    }
+}
+
+static frame_t *pop(stage_t stage) {
+    frame_t *f = nullptr;
+    xQueueReceive(s_queues[stage], &f, portMAX_DELAY);
+    return f;
+}
+
+static void record(stage_t stage, int64_t start_us, bool ok) {
+    int64_t us = esp_timer_get_time() - start_us;
+    stage_stats_t &st = s_stats[stage];
+    st.busy_us += us;
+    st.max_us = std::max(st.max_us, us);
+    st.last_us = (uint32_t)us;
+    if (ok) {
+        st.processed++;
+    } else {
+        st.failed++;
+    }
+}
+
+// Rückrufe der Stufen: Lease zurückgeben, auf Platz im Ring warten, storage wecken
+static void release_frame(void *, stages::frame_t *f) {
+    static_cast<frame_t *>(f)->lease.release();
+    f->fb = {};
+}
+
+static void ring_full(void *) {
+    vTaskDelay(pdMS_TO_TICKS(RING_POLL_MS));
+}
+
+static void ring_pushed(void *) {
+    xTaskNotifyGive(s_storage_task);
+}
+
+// --------- Stage tasks ----------------------------------
+
+static void capture_task(void *) {
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true) {
+        frame_t *f = nullptr;
+        xQueueReceive(s_free_q, &f, portMAX_DELAY);
+
+        int64_t start_us = esp_timer_get_time();
+        MEM_SCOPE(mem, memtel::STAGE_CAPTURE);
+        PROFILE_SPAN(capture_span, profiler::SPAN_CAPTURE);
+        f->lease = camera::FrameLease::acquire();
+        PROFILE_SPAN_END(capture_span);
+        const camera_fb_t *fb = f->lease.fb();
+        stages::sensor_image_t img = {};
+        if (fb) {
+            img = {fb->buf, fb->len, (int)fb->width, (int)fb->height};
+        }
+        const stages::capture_result_t r = s_stages.capture(f, img, start_us);
+        MEM_SCOPE_END(mem);
+        record(STAGE_CAPTURE, start_us, r.ok);
+        if (r.ok && r.run_detector) {
+            push(STAGE_INFER, f);
+        } else {
+            recycle(f);
+        }
+
+        // Aufnahmeintervall aus Aktivität und der zuletzt gemessenen langsamsten Stufe
+        uint32_t pipeline_us = 0;
+        for (int stage = STAGE_INFER; stage < STAGE_COUNT; ++stage) {
+            pipeline_us = std::max(pipeline_us, s_stats[stage].last_us);
+        }
+        uint32_t interval_ms = s_stages.schedule(esp_timer_get_time(), r.motion, pipeline_us);
+        if (interval_ms) {
+            vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(interval_ms));
+        } else if (!r.ok) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+    }
+}
+
+static void infer_task(void *) {
+    while (true) {
+        frame_t *f = pop(STAGE_INFER);
+        int64_t start_us = esp_timer_get_time();
+        MEM_SCOPE(mem, memtel::STAGE_INFER);
+        bool ok = s_stages.infer(f);
+        MEM_SCOPE_END(mem);
+        record(STAGE_INFER, start_us, ok);
+
+        if (ok) {
+            push(STAGE_ENCODE, f);
+        } else {
+            recycle(f);
+        }
+    }
+}
+
+static void encode_task(void *) {
+    while (true) {
+        frame_t *f = pop(STAGE_ENCODE);
+        int64_t start_us = esp_timer_get_time();
+        MEM_SCOPE(mem, memtel::STAGE_ENCODE);
+        bool ok = s_stages.encode(f);
+        MEM_SCOPE_END(mem);
+        record(STAGE_ENCODE, start_us, ok);
+        // Records, die nicht in den Ring kamen, zählen als von storage verworfen
+        s_stats[STAGE_STORAGE].dropped = s_stages.archive().dropped;
+        recycle(f);
+    }
+}
+
+// Konsument des Rings: einziger Task, der auf die SD-Karte schreibt
+#if CONFIG_BEESENSE_PROFILER
+// Profil auf die Karte, aus storage, damit weiterhin nur ein Task auf die SD-Karte schreibt
+static void write_profile() {
+    static int64_t last_us = esp_timer_get_time();
+    const int64_t now = esp_timer_get_time();
+    if (now - last_us < PROFILE_CSV_INTERVAL_US || !sdcard::backend()) {
+        return;
+    }
+    last_us = now;
+    char path[96];
+    snprintf(path, sizeof(path), "%s/profile.csv", s_cfg.out_dir);
+    profiler::write_csv(*sdcard::backend(), path);
+}
+#endif
+
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+// Speicherstand auf die Karte, ebenfalls aus storage
+static void write_memory() {
+    static int64_t last_us = esp_timer_get_time();
+    const int64_t now = esp_timer_get_time();
+    if (now - last_us < MEM_CSV_INTERVAL_US || !sdcard::backend()) {
+        return;
+    }
+    last_us = now;
+    char path[96];
+    snprintf(path, sizeof(path), "%s/memory.csv", s_cfg.out_dir);
+    memtel::write_csv(*sdcard::backend(), path);
+}
+#endif
+
+// Ohne Records wartet storage höchstens bis zur nächsten fälligen CSV-Zeile
+static TickType_t storage_idle_wait() {
+    TickType_t wait = portMAX_DELAY;
+#if CONFIG_BEESENSE_PROFILER
+    wait = std::min<TickType_t>(wait, pdMS_TO_TICKS(CONFIG_BEESENSE_PROFILER_CSV_S * 1000));
+#endif
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+    wait = std::min<TickType_t>(wait, pdMS_TO_TICKS(CONFIG_BEESENSE_MEM_CSV_S * 1000));
+#endif
+    return wait;
+}
+
+static void storage_task(void *) {
+    const TickType_t idle_wait = storage_idle_wait();
+    while (true) {
+#if CONFIG_BEESENSE_PROFILER
+        write_profile();
+#endif
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+        write_memory();
+#endif
+        if (!s_stages.pending()) {
+            ulTaskNotifyTake(pdTRUE, idle_wait);
+            continue;
+        }
+        int64_t start_us = esp_timer_get_time();
+        MEM_SCOPE(mem, memtel::STAGE_STORAGE);
+        bool ok = s_stages.store_next();
+        MEM_SCOPE_END(mem);
+        record(STAGE_STORAGE, start_us, ok);
+    }
+}
+
+static const TaskFunction_t TASK_FUNCS[STAGE_COUNT] = {capture_task, infer_task, encode_task, storage_task};
+
+// --------- Public API ----------------------------------
+
+config_t default_config() {
+    config_t cfg = {};
+    cfg.frame_width = 320;   // FRAMESIZE_QVGA
+    cfg.frame_height = 240;
+    cfg.capture = CAPTURE_RGB565;
+    cfg.jpeg_capture = {0, 0};
+#if CONFIG_BEESENSE_CAPTURE_JPEG
+    cfg.capture = CAPTURE_JPEG;
+    cfg.jpeg_capture.scale_shift = CONFIG_BEESENSE_CAPTURE_JPEG_SCALE_SHIFT;
+    cfg.jpeg_capture.max_bytes = CONFIG_BEESENSE_CAPTURE_JPEG_MAX_KB * 1024;
+#if CONFIG_BEESENSE_CAPTURE_JPEG_SVGA
+    cfg.frame_width = 800 >> CONFIG_BEESENSE_CAPTURE_JPEG_SCALE_SHIFT;
+    cfg.frame_height = 600 >> CONFIG_BEESENSE_CAPTURE_JPEG_SCALE_SHIFT;
+#elif CONFIG_BEESENSE_CAPTURE_JPEG_VGA
+    cfg.frame_width = 640 >> CONFIG_BEESENSE_CAPTURE_JPEG_SCALE_SHIFT;
+    cfg.frame_height = 480 >> CONFIG_BEESENSE_CAPTURE_JPEG_SCALE_SHIFT;
+#else
+    cfg.frame_width = 320 >> CONFIG_BEESENSE_CAPTURE_JPEG_SCALE_SHIFT;
+    cfg.frame_height = 240 >> CONFIG_BEESENSE_CAPTURE_JPEG_SCALE_SHIFT;
+#endif
+#endif
+    cfg.capture_interval_ms = 2000;
+    cfg.policy[STAGE_CAPTURE] = POLICY_BLOCK;
+    cfg.policy[STAGE_INFER] = POLICY_DROP_OLDEST;  // lieber ein frischer Frame als ein alter
+    cfg.policy[STAGE_ENCODE] = POLICY_BLOCK;
+    cfg.policy[STAGE_STORAGE] = POLICY_BLOCK;
+    cfg.out_dir = "/sdcard/bumblebee_detect";
+    cfg.gate_enabled = true;
+    cfg.gate = motion::default_gate_config();
+    cfg.tracker_enabled = true;
+    cfg.tracker = tracking::default_tracker_config(cfg.frame_width, cfg.frame_height);
+    cfg.scheduler_enabled = true;
+    cfg.scheduler = scheduler::default_scheduler_config();
+    cfg.archive = ARCHIVE_FULL_FRAME;
+    cfg.thumb = {96, 0.25f, 60000};
+#if CONFIG_BEESENSE_ARCHIVE_THUMBNAILS
+    cfg.archive = ARCHIVE_THUMBNAILS;
+    cfg.thumb.size = CONFIG_BEESENSE_THUMB_SIZE;
+    cfg.thumb.padding = CONFIG_BEESENSE_THUMB_PADDING / 100.0f;
+    cfg.thumb.context_interval_ms = CONFIG_BEESENSE_THUMB_CONTEXT_S * 1000;
+#endif
+    cfg.annotate = false;
+#if CONFIG_BEESENSE_ANNOTATE_FRAMES
+    cfg.annotate = true;
+#endif
+    cfg.storage = {};
+    cfg.storage.ring_bytes = CONFIG_BEESENSE_WRITE_RING_KB * 1024;
+#if CONFIG_BEESENSE_STORAGE_SEGMENTS
+    cfg.storage.segments = true;
+    cfg.storage.segment_bytes = CONFIG_BEESENSE_SEGMENT_SIZE_MB * 1024 * 1024;
+    cfg.storage.segment_flush_ms = CONFIG_BEESENSE_SEGMENT_FLUSH_MS;
+    cfg.storage.write_batch = CONFIG_BEESENSE_WRITE_BATCH_KB * 1024;
+#endif
+#if CONFIG_BEESENSE_DETECTION_LOG
+    cfg.storage.detection_log = true;
+    cfg.storage.log_flush_ms = CONFIG_BEESENSE_DETECTION_LOG_FLUSH_MS;
+#endif
+    cfg.jpeg_quality = CONFIG_BEESENSE_JPEG_QUALITY;
+#if CONFIG_BEESENSE_JPEG_SUBSAMPLE_420
+    cfg.jpeg_subsampling = JPEG_SUBSAMPLE_420;
+#elif CONFIG_BEESENSE_JPEG_SUBSAMPLE_422
+    cfg.jpeg_subsampling = JPEG_SUBSAMPLE_422;
+#else
+    cfg.jpeg_subsampling = JPEG_SUBSAMPLE_444;
+#endif
+    return cfg;
+}
+
+bool start(const config_t &cfg, detector::DetectorService *detector) {
+    if (s_free_q) {
+        ESP_LOGW(TAG, "Pipeline already running");
+        return true;
+    }
+    if (!detector || !detector->is_ready()) {
+        ESP_LOGE(TAG, "Detector not ready");
+        return false;
+    }
+    s_cfg = cfg;
+    MEM_SCOPE(mem, memtel::STAGE_PIPELINE_START);
+#if CONFIG_BEESENSE_PROFILER
+    profiler::init();
+#endif
+
+    s_free_q = xQueueCreate(FRAME_POOL_SIZE, sizeof(frame_t *));
+    for (int stage = STAGE_INFER; stage < STAGE_STORAGE; ++stage) {
+        s_queues[stage] = xQueueCreate(QUEUE_DEPTH[stage], sizeof(frame_t *));
+    }
+    if (!s_free_q || !s_queues[STAGE_INFER] || !s_queues[STAGE_ENCODE]) {
+        ESP_LOGE(TAG, "Failed to create queues");
+        return false;
+    }
+    // Konvertierter, inferierter und archivierter Bereich: Center-Crop in Modellgröße
+    // oder (CONFIG_BEESENSE_INFER_TILED) der ganze Frame, in Kacheln inferiert
+    stages::setup_t setup = {};
+    setup.roi_width = MODEL_IMG_SIZE;
+    setup.roi_height = MODEL_IMG_SIZE;
+#if CONFIG_BEESENSE_INFER_TILED
+    setup.roi_width = s_cfg.frame_width;
+    setup.roi_height = s_cfg.frame_height;
+#endif
+    setup.frame_records = FRAME_POOL_SIZE;
+    setup.decoded_slots = DECODED_SLOTS;
+    setup.hooks = {nullptr, release_frame, ring_full, ring_pushed};
+    if (!s_stages.init(s_cfg, setup, detector)) {
+        return false;
+    }
+    for (frame_t &f : s_frames) {
+        s_stages.reset_frame(&f);
+        frame_t *p = &f;
+        xQueueSend(s_free_q, &p, 0);
+    }
+
+    // Ab hier laufen die Stufen und verbuchen ihren Speicher selbst
+    MEM_SCOPE_END(mem);
+    s_start_us = esp_timer_get_time();
+    // Von hinten nach vorne starten, damit jede Stufe ihren Konsumenten schon hat
+    for (int stage = STAGE_COUNT - 1; stage >= 0; --stage) {
+        const task_desc_t &t = TASKS[stage];
+        TaskHandle_t *handle = stage == STAGE_STORAGE ? &s_storage_task : nullptr;
+        if (xTaskCreatePinnedToCore(TASK_FUNCS[stage], t.name, t.stack_size, nullptr, t.priority, handle, t.core) !=
+            pdPASS) {
+            ESP_LOGE(TAG, "Failed to create task %s", t.name);
+            return false;
+        }
+    }
+    if (s_cfg.scheduler_enabled) {
+        ESP_LOGI(TAG, "Pipeline started (%d frame records, capture every %lu..%lu ms by activity)", FRAME_POOL_SIZE,
+                 (unsigned long)s_cfg.scheduler.floor_ms, (unsigned long)s_cfg.scheduler.ceiling_ms);
+    } else {
+        ESP_LOGI(TAG, "Pipeline started (%d frame records, capture every %lu ms)", FRAME_POOL_SIZE,
+                 (unsigned long)s_cfg.capture_interval_ms);
+    }
+    return true;
+}
+
+const stage_stats_t &stats(stage_t stage) {
+    return s_stats[stage];
+}
+
+void log_stats() {
+    static const char *names[STAGE_COUNT] = {"capture", "infer", "encode", "storage"};
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        const stage_stats_t &st = s_stats[stage];
+        uint32_t n = st.processed + st.failed;
+        UBaseType_t depth = s_queues[stage] ? uxQueueMessagesWaiting(s_queues[stage]) : 0;
+        ESP_LOGI(TAG, "%-8s ok %lu, failed %lu, dropped %lu, avg %lld us, max %lld us, queued %u", names[stage],
+                 (unsigned long)st.processed, (unsigned long)st.failed, (unsigned long)st.dropped,
+                 n ? st.busy_us / n : 0, st.max_us, (unsigned)depth);
+    }
+#if CONFIG_BEESENSE_INFER_TILED
+    const stage_stats_t &inf = s_stats[STAGE_INFER];
+    const tiling::layout_t &layout = s_stages.layout();
+    uint32_t frames = inf.processed + inf.failed;
+    ESP_LOGI(TAG, "tiles    %d per frame, avg %lld us per tile", layout.count,
+             frames ? inf.busy_us / ((int64_t)frames * layout.count) : 0);
+#endif
+    s_stages.log_stats();
+    int64_t elapsed_us = esp_timer_get_time() - s_start_us;
+    const writebehind::SpscRing &ring = s_stages.ring();
+    const writebehind::ring_stats_t &rs = ring.stats();
+    ESP_LOGI(TAG, "ring     %lu queued, %u of %u KB (max %lu KB), dropped %lu, stalls %lu, %.1f KB/s written",
+             (unsigned long)ring.records(), (unsigned)(ring.used() / 1024), (unsigned)(ring.capacity() / 1024),
+             (unsigned long)(rs.max_used / 1024), (unsigned long)rs.dropped, (unsigned long)s_stages.archive().stalls,
+             elapsed_us > 0 ? rs.bytes_out * 1e6 / 1024.0 / (double)elapsed_us : 0.0);
+    sdcard::log_write_stats();
+#if CONFIG_BEESENSE_PROFILER
+    profiler::log_report();
+#endif
+    if (elapsed_us > 0) {
+        ESP_LOGI(TAG, "Sustained %.2f frames/s stored",
+                 s_stats[STAGE_STORAGE].processed * 1e6 / (double)elapsed_us);
+    }
+}
+
+} // namespace pipeline
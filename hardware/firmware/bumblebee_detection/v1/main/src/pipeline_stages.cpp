@@ -0,0 +1,715 @@
+#include "pipeline_stages.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "dl_image_draw.hpp"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "detection_log.hpp"
+#include "mem_telemetry.hpp"
+#include "rgb565_roi.hpp"
+#include "sd_card.hpp"
+#include "span_profiler.hpp"
+#include "thumbnail.hpp"
+
+namespace stages {
+
+static const char *TAG = "PIPELINE";
+
+using detector::MAX_RESULTS;
+using pipeline::ARCHIVE_FULL_FRAME;
+using pipeline::ARCHIVE_THUMBNAILS;
+using pipeline::CAPTURE_JPEG;
+static_assert(detlog::MAX_BOXES == MAX_RESULTS, "detection record must hold all results");
+#if CONFIG_BEESENSE_INFER_TILED
+static constexpr int MODEL_IMG_SIZE = 224;
+// Zusammenführen von Boxen an Kachelnähten
+static constexpr float TILE_NMS_THR = 0.7f;
+static constexpr float TILE_IOS_THR = 0.6f;
+#endif
+
+enum stored_type_t : uint16_t {
+    STORED_FRAME = 0,   // Meta: detlog::record_t
+    STORED_THUMB,       // Meta: segment::thumb_meta_t
+};
+
+// Record im Write-Behind-Ring: stored_t | Meta (meta_len) | JPEG
+struct stored_t {
+    int64_t capture_us;
+    uint32_t id;
+    uint16_t type;      // stored_type_t
+    uint16_t meta_len;
+};
+
+// RGB565-Quelle für Gate, Konvertierung und Modell-Input: der Framebuffer oder bei
+// JPEG-Aufnahme der dekodierte ROI. (x0, y0) ist der ROI-Ursprung in dieser Quelle.
+struct Stages::source_t {
+    dl::image::img_t img;
+    int x0;
+    int y0;
+};
+
+Stages::~Stages() {
+    heap_caps_free(m_thumb_rgb);
+    heap_caps_free(m_ring_mem);
+}
+
+// --------- Internal helpers ----------------------------------
+
+Stages::source_t Stages::source(const frame_t *f) const {
+    if (m_cfg.capture != CAPTURE_JPEG) {
+        return {f->fb, f->x0, f->y0};
+    }
+    dl::image::img_t img = {};
+    img.data = f->decoded_buf.data();
+    img.width = m_roi_width;
+    img.height = m_roi_height;
+    img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565;
+    return {img, 0, 0};
+}
+
+// Quelle wird nach dem Modell-Input nicht mehr gelesen
+void Stages::release_source(frame_t *f) {
+    if (f->fb.data && m_setup.hooks.release_frame) {
+        m_setup.hooks.release_frame(m_setup.hooks.ctx, f);
+    }
+    f->fb = {};
+    f->decoded_buf.reset();
+}
+
+void Stages::add_to_tensor(frame_t *f, int64_t us) {
+    f->to_tensor_us += (uint32_t)us;
+    m_capture.tensor_frames++;
+    m_capture.to_tensor_us += f->to_tensor_us;
+    m_capture.max_to_tensor_us = std::max(m_capture.max_to_tensor_us, f->to_tensor_us);
+}
+
+static void log_results(const frame_t *f) {
+    if (f->results.empty()) {
+        ESP_LOGI(TAG, "#%lu nothing detected", (unsigned long)f->id);
+    }
+    for (const auto &res : f->results) {
+        ESP_LOGI(TAG, "#%lu [category: %d, score: %f, x1: %d, y1: %d, x2: %d, y2: %d]",
+                 (unsigned long)f->id, res.category, res.score,
+                 res.box[0], res.box[1], res.box[2], res.box[3]);
+    }
+}
+
+void Stages::annotate(frame_t *f) {
+    // BBoxen in das archivierte ROI-Bild zeichnen (rot)
+    static const std::vector<uint8_t> color = {255, 0, 0};
+    for (const auto &res : f->results) {
+        // Boxen sind in Framekoordinaten, gezeichnet wird im ROI-Bild
+        int x1 = std::clamp(res.box[0] - f->x0, 0, f->roi.width - 1);
+        int y1 = std::clamp(res.box[1] - f->y0, 0, f->roi.height - 1);
+        int x2 = std::clamp(res.box[2] - f->x0, 0, f->roi.width - 1);
+        int y2 = std::clamp(res.box[3] - f->y0, 0, f->roi.height - 1);
+        // Sortiere die Koordinaten, damit x1 < x2 und y1 < y2
+        if (x2 < x1) std::swap(x1, x2);
+        if (y2 < y1) std::swap(y1, y2);
+        dl::image::draw_hollow_rectangle(f->roi, x1, y1, x2, y2, color, 2);
+    }
+}
+
+#if CONFIG_BEESENSE_INFER_TILED
+// Inferiert alle Kacheln aus dem bereits konvertierten Vollbild und führt die
+// Boxen kachelübergreifend zusammen. Der Kamera-Frame ist dann schon zurückgegeben.
+void Stages::infer_tiles(frame_t *f) {
+    const int size = m_layout.tile_size;
+    int count = 0;
+    for (int t = 0; t < m_layout.count; ++t) {
+        const tiling::tile_t &tile = m_layout.tiles[t];
+        m_crop_area = {tile.x0, tile.y0, tile.x0 + size, tile.y0 + size};
+        for (const auto &res : m_detector->detect(f->roi, m_crop_area)) {
+            tiling::tile_box_t &b = m_tile_boxes[count];
+            b = {{res.box[0], res.box[1], res.box[2], res.box[3]}, res.score, t, count};
+            ++count;
+        }
+    }
+
+    int kept = tiling::merge_boxes(m_tile_boxes, count, TILE_NMS_THR, TILE_IOS_THR);
+    f->results.clear();
+    for (int i = 0; i < kept && !f->results.full(); ++i) {
+        const tiling::tile_box_t &b = m_tile_boxes[i];
+        dl::detect::result_t *res = f->results.add();
+        res->category = 0;
+        res->score = b.score;
+        res->box = {b.box[0], b.box[1], b.box[2], b.box[3]};
+    }
+}
+#endif
+
+// JPEG-Aufnahme: nur den ROI dekodieren, in Koordinaten des um scale_shift verkleinerten Frames
+bool Stages::decode_roi(frame_t *f, const sensor_image_t &img) {
+    f->decoded_buf = m_pool.acquire(bufpool::SLOT_RGB565_FRAME);
+    if (!f->decoded_buf) {
+        return false;
+    }
+    PROFILE_SPAN(span, profiler::SPAN_DECODE);
+    const bool ok = m_decoder.decode_roi(img.data, img.len, img.width, img.height, m_cfg.jpeg_capture.scale_shift,
+                                         f->x0, f->y0, m_roi_width, m_roi_height, f->decoded_buf.data());
+    PROFILE_SPAN_END(span);
+    if (ok) {
+        f->to_tensor_us = m_decoder.stats().last_us;
+        m_capture.decoded_bytes += (uint64_t)m_roi_width * m_roi_height * 2;
+    }
+    return ok;
+}
+
+// Sensor-JPEG unverändert fürs Archiv behalten; der Framebuffer geht danach sofort zurück
+// an den Treiber und kann nicht bis encode gehalten werden. Passt es nicht in den Slot,
+// oder ist kein Slot frei, bleibt f->sensor_buf leer: der Frame wird trotzdem ausgewertet,
+// nur nicht archiviert.
+void Stages::keep_sensor_jpeg(frame_t *f, const sensor_image_t &img) {
+    f->sensor_buf = m_pool.acquire(bufpool::SLOT_JPEG_IN);
+    if (!f->sensor_buf) {
+        ESP_LOGW(TAG, "#%lu no slot for the sensor JPEG, not archived", (unsigned long)f->id);
+        m_capture.no_slot++;
+        return;
+    }
+    if (img.len > f->sensor_buf.size()) {
+        ESP_LOGW(TAG, "#%lu sensor JPEG too large (%lu bytes), not archived", (unsigned long)f->id,
+                 (unsigned long)img.len);
+        m_capture.too_large++;
+        f->sensor_buf.reset();
+        return;
+    }
+    memcpy(f->sensor_buf.data(), img.data, img.len);
+    f->sensor_len = img.len;
+    m_capture.copied_bytes += img.len;
+}
+
+// Ergebnisse an den Tracker, Querungen der Eingangslinie protokollieren
+void Stages::track(const frame_t *f) {
+    PROFILE_SPAN(span, profiler::SPAN_TRACK);
+    tracking::detection_t dets[tracking::MAX_DETECTIONS];
+    int count = 0;
+    for (const auto &res : f->results) {
+        if (count == tracking::MAX_DETECTIONS) {
+            break;
+        }
+        dets[count++] = {{(float)res.box[0], (float)res.box[1], (float)res.box[2], (float)res.box[3]}, res.score};
+    }
+    int crossings = m_tracker.update(dets, count, f->capture_us);
+    for (int i = 0; i < crossings; ++i) {
+        const tracking::crossing_t &c = m_tracker.crossing(i);
+        ESP_LOGI(TAG, "Track #%lu %s (frame #%lu)", (unsigned long)c.track_id,
+                 c.direction == tracking::DIRECTION_IN ? "in" : "out", (unsigned long)f->id);
+    }
+}
+
+segment::box_meta_t Stages::to_box_meta(const frame_t *f, const dl::detect::result_t &res) const {
+    return {(int16_t)(res.box[0] - f->x0), (int16_t)(res.box[1] - f->y0), (int16_t)(res.box[2] - f->x0),
+            (int16_t)(res.box[3] - f->y0), (uint16_t)(res.score * 1000.0f + 0.5f), (uint16_t)res.category};
+}
+
+// Boxen zum unverändert archivierten Sensor-JPEG: Framekoordinaten, hochskaliert auf Sensorpixel
+segment::box_meta_t Stages::to_sensor_box_meta(const dl::detect::result_t &res) const {
+    const int shift = m_cfg.jpeg_capture.scale_shift;
+    return {(int16_t)(res.box[0] << shift), (int16_t)(res.box[1] << shift), (int16_t)(res.box[2] << shift),
+            (int16_t)(res.box[3] << shift), (uint16_t)(res.score * 1000.0f + 0.5f), (uint16_t)res.category};
+}
+
+// Produzent des Rings (encode). Der Frame kann danach sofort zurück in den Pool,
+// nur storage wartet auf die Karte. Bei POLICY_BLOCK wartet encode auf Platz
+// (Rückstau in die vorderen Queues), sonst wird der neue Record verworfen.
+bool Stages::push_record(uint32_t id, int64_t capture_us, uint16_t type, const void *meta, uint16_t meta_len,
+                         const dl::image::jpeg_img_t &jpeg) {
+    PROFILE_SPAN(span, profiler::SPAN_RING_PUSH);
+    const stored_t hdr = {capture_us, id, type, meta_len};
+    const void *parts[] = {&hdr, meta, jpeg.data};
+    const uint32_t lens[] = {sizeof(hdr), hdr.meta_len, (uint32_t)jpeg.data_len};
+    if (lens[0] + lens[1] + lens[2] > m_ring.max_record()) {
+        ESP_LOGE(TAG, "#%lu too large for the write ring (%lu bytes)", (unsigned long)id, (unsigned long)lens[2]);
+        m_ring.drop();
+        m_archive.dropped++;
+        return false;
+    }
+
+    bool stalled = false;
+    while (!m_ring.push(parts, lens, 3)) {
+        if (m_cfg.policy[pipeline::STAGE_STORAGE] != pipeline::POLICY_BLOCK || !m_setup.hooks.ring_full) {
+            m_ring.drop();
+            m_archive.dropped++;
+            return false;
+        }
+        if (!stalled) {
+            stalled = true;
+            m_archive.stalls++;
+        }
+        m_setup.hooks.ring_full(m_setup.hooks.ctx);
+    }
+    if (m_setup.hooks.ring_pushed) {
+        m_setup.hooks.ring_pushed(m_setup.hooks.ctx);
+    }
+    m_archive.bytes += jpeg.data_len;
+    return true;
+}
+
+// Ganzen ROI-Bereich kodieren und mit allen Boxen an storage übergeben. Bei JPEG-Aufnahme
+// geht stattdessen das Sensor-JPEG unverändert raus, die Boxen nur als Metadaten.
+bool Stages::archive_frame(frame_t *f) {
+    if (m_keep_sensor_jpeg && !f->sensor_buf) {
+        return true;  // Sensor-JPEG zu groß oder ohne Slot, in capture gezählt
+    }
+    const bool pass_through = static_cast<bool>(f->sensor_buf);
+    if (pass_through) {
+        f->jpeg.data = f->sensor_buf.data();
+        f->jpeg.data_len = f->sensor_len;
+    } else {
+        f->jpeg_buf = m_pool.acquire(bufpool::SLOT_JPEG_OUT);
+        PROFILE_SPAN(encode_span, profiler::SPAN_ENCODE);
+        bool ok = f->jpeg_buf && m_encoder.encode(static_cast<const uint8_t *>(f->roi.data), f->jpeg_buf.data(),
+                                                  f->jpeg_buf.size(), f->jpeg);
+        PROFILE_SPAN_END(encode_span);
+        if (!ok) {
+            return false;
+        }
+        const jpegenc::encode_stats_t &es = m_encoder.stats();
+        ESP_LOGI(TAG, "#%lu JPEG %lu bytes in %lu us", (unsigned long)f->id, (unsigned long)es.last_bytes,
+                 (unsigned long)es.last_us);
+    }
+
+    // Die Boxen reisen als fester Sidecar-Record mit, storage trägt die Bildreferenz ein
+    detlog::record_t rec = {};
+    rec.frame_id = f->id;
+    rec.model_id = f->model_id;
+    rec.t_us = f->capture_us;
+    if (pass_through) {
+        rec.image_width = (uint16_t)(f->frame_width << m_cfg.jpeg_capture.scale_shift);
+        rec.image_height = (uint16_t)(f->frame_height << m_cfg.jpeg_capture.scale_shift);
+        rec.flags |= detlog::FLAG_SENSOR_JPEG;
+    } else {
+        rec.image_width = (uint16_t)m_roi_width;
+        rec.image_height = (uint16_t)m_roi_height;
+        if (m_cfg.annotate && m_cfg.archive == ARCHIVE_FULL_FRAME) {
+            rec.flags |= detlog::FLAG_ANNOTATED;
+        }
+    }
+    rec.score_thr_permille = (uint16_t)(m_detector->min_score() * 1000.0f + 0.5f);
+    rec.nms_thr_permille = (uint16_t)(m_detector->nms_threshold() * 1000.0f + 0.5f);
+    for (const auto &res : f->results) {
+        if (rec.box_count == MAX_RESULTS) {
+            break;
+        }
+        rec.boxes[rec.box_count++] = pass_through ? to_sensor_box_meta(res) : to_box_meta(f, res);
+    }
+    if (push_record(f->id, f->capture_us, STORED_FRAME, &rec, sizeof(rec), f->jpeg)) {
+        m_archive.frames++;
+        m_archive.detections += rec.box_count;
+    }
+    return true;
+}
+
+// Thumbnail-Modus: je Detektion ein gepolsterter, auf thumb.size skalierter Ausschnitt aus
+// dem unbemalten ROI-Bild, dazu in großen Abständen ein Vollbild als Kontext
+bool Stages::archive_thumbnails(frame_t *f) {
+    const pipeline::thumb_config_t &tc = m_cfg.thumb;
+    bool ok = true;
+    for (const auto &res : f->results) {
+        const segment::box_meta_t box = to_box_meta(f, res);
+        const thumbs::rect_t crop = thumbs::square_crop(box.x1, box.y1, box.x2, box.y2, m_roi_width, m_roi_height,
+                                                        tc.padding, tc.size / 2);
+        dl::image::jpeg_img_t jpeg;
+        PROFILE_SPAN(thumb_span, profiler::SPAN_THUMBS);
+        if (!thumbs::resize_rgb888(static_cast<const uint8_t *>(f->roi.data), m_roi_width, m_roi_height, crop,
+                                   m_thumb_rgb, tc.size) ||
+            !m_thumb_encoder.encode(m_thumb_rgb, jpeg)) {
+            ok = false;
+            continue;
+        }
+        PROFILE_SPAN_END(thumb_span);
+        segment::thumb_meta_t meta = {f->id, (int16_t)crop.x1, (int16_t)crop.y1, (int16_t)crop.x2, (int16_t)crop.y2,
+                                      box};
+        if (push_record(f->id, f->capture_us, STORED_THUMB, &meta, sizeof(meta), jpeg)) {
+            m_archive.thumbs++;
+            m_archive.detections++;
+        }
+    }
+
+    const int64_t now = esp_timer_get_time();
+    if (tc.context_interval_ms && now - m_last_context_us >= (int64_t)tc.context_interval_ms * 1000) {
+        // Kontextbild zählt seine Boxen nicht noch einmal
+        const uint32_t detections = m_archive.detections;
+        m_last_context_us = now;
+        ok = archive_frame(f) && ok;
+        m_archive.detections = detections;
+    }
+    return ok;
+}
+
+// --------- Public API ----------------------------------
+
+bool Stages::init(const pipeline::config_t &cfg, const setup_t &setup, detector::Detector *detector) {
+    m_cfg = cfg;
+    m_setup = setup;
+    m_detector = detector;
+    m_roi_width = setup.roi_width;
+    m_roi_height = setup.roi_height;
+#if CONFIG_BEESENSE_INFER_TILED
+    if (!tiling::make_layout(m_roi_width, m_roi_height, MODEL_IMG_SIZE, CONFIG_BEESENSE_TILE_MIN_OVERLAP, m_layout)) {
+        ESP_LOGE(TAG, "No tile layout for %dx%d frames", m_roi_width, m_roi_height);
+        return false;
+    }
+    ESP_LOGI(TAG, "Tiled inference: %dx%d tiles of %d px", m_layout.cols, m_layout.rows, m_layout.tile_size);
+#endif
+
+    const bool jpeg = m_cfg.capture == CAPTURE_JPEG;
+    if (jpeg && (m_cfg.jpeg_capture.scale_shift < 0 || m_cfg.jpeg_capture.scale_shift > jpegdec::MAX_SCALE_SHIFT)) {
+        ESP_LOGE(TAG, "Invalid JPEG decode scale shift %d", m_cfg.jpeg_capture.scale_shift);
+        return false;
+    }
+    if (jpeg && (m_cfg.frame_width < m_roi_width || m_cfg.frame_height < m_roi_height)) {
+        ESP_LOGE(TAG, "Decoded %dx%d frame is smaller than the %dx%d inference area", m_cfg.frame_width,
+                 m_cfg.frame_height, m_roi_width, m_roi_height);
+        return false;
+    }
+    // Kacheln, Kaskade und Thumbnails lesen den RGB888-Ausschnitt; ohne sie geht der
+    // dekodierte ROI direkt in den Modell-Input
+    m_convert_roi = !jpeg || m_cfg.archive == ARCHIVE_THUMBNAILS || detector->cascade_enabled();
+#if CONFIG_BEESENSE_INFER_TILED
+    m_convert_roi = true;
+#endif
+    m_keep_sensor_jpeg = jpeg && (m_cfg.archive == ARCHIVE_FULL_FRAME || m_cfg.thumb.context_interval_ms);
+    if (!jpeg) {
+        // Bei JPEG-Aufnahme wird das Vollbild nicht neu kodiert
+        const jpegenc::encoder_config_t enc_cfg = {m_roi_width, m_roi_height, jpegenc::INPUT_RGB888,
+                                                   m_cfg.jpeg_subsampling, m_cfg.jpeg_quality};
+        if (!m_encoder.open(enc_cfg)) {
+            return false;
+        }
+    }
+    if (m_cfg.archive == ARCHIVE_THUMBNAILS) {
+        if (!m_cfg.storage.segments) {
+            ESP_LOGE(TAG, "Thumbnail archive needs segment storage");
+            return false;
+        }
+        const int size = m_cfg.thumb.size;
+        const jpegenc::encoder_config_t thumb_cfg = {size, size, jpegenc::INPUT_RGB888, m_cfg.jpeg_subsampling,
+                                                     m_cfg.jpeg_quality};
+        if (size > 0 && size <= thumbs::MAX_SIZE) {
+            m_thumb_rgb = static_cast<uint8_t *>(heap_caps_malloc(size * size * 3, MALLOC_CAP_SPIRAM));
+        }
+        if (!m_thumb_rgb || !m_thumb_encoder.open(thumb_cfg)) {
+            ESP_LOGE(TAG, "Could not set up %dx%d thumbnails", size, size);
+            return false;
+        }
+#if CONFIG_BEESENSE_MEM_TELEMETRY
+        // Zu knapper Ausgabepuffer wird in encode verdoppelt (Encoder::grow_output)
+        memtel::require(memtel::STAGE_ENCODE, memtel::POOL_PSRAM,
+                        2 * (uint32_t)jpegenc::Encoder::output_size(m_thumb_encoder.config()));
+#endif
+        // erstes Kontextbild erst nach einem Intervall
+        m_last_context_us = esp_timer_get_time();
+    }
+
+    // Ein ROI-Slot pro Record; der JPEG-Slot wird nur in encode gebraucht, danach liegt der Record im Ring
+    const uint8_t decoded_slots = jpeg ? setup.decoded_slots : 0;
+    const uint8_t roi_slots = m_convert_roi ? setup.frame_records : 0;
+    const uint8_t jpeg_slots = m_encoder.is_open() ? 1 : 0;
+    bufpool::pool_config_t pool_cfg = bufpool::make_config(m_roi_width, m_roi_height, m_roi_width, m_roi_height,
+                                                           decoded_slots, roi_slots, jpeg_slots);
+    if (jpeg_slots) {
+        pool_cfg.slots[bufpool::SLOT_JPEG_OUT].bytes = jpegenc::Encoder::output_size(m_encoder.config());
+    }
+    if (m_keep_sensor_jpeg) {
+        // Sensor-JPEG lebt von capture bis zum Ring, wie ein Frame-Record
+        pool_cfg.slots[bufpool::SLOT_JPEG_IN] = {m_cfg.jpeg_capture.max_bytes, setup.frame_records,
+                                                 MALLOC_CAP_SPIRAM, 0};
+    }
+    if (!m_pool.init(pool_cfg)) {
+        return false;
+    }
+    m_crop_area.reserve(4);
+
+    const size_t ring_size = m_cfg.storage.ring_bytes;
+    m_ring_mem = heap_caps_malloc(ring_size, MALLOC_CAP_SPIRAM);
+    if (!m_ring_mem || !m_ring.init(m_ring_mem, ring_size)) {
+        ESP_LOGE(TAG, "Could not allocate %u KB write ring", (unsigned)(ring_size / 1024));
+        return false;
+    }
+    if (m_cfg.storage.segments) {
+        if (m_cfg.storage.write_batch && !sdcard::init_write_batch(m_cfg.storage.write_batch)) {
+            return false;
+        }
+        if (!sdcard::open_segment(m_cfg.out_dir, m_cfg.storage.segment_bytes, m_cfg.storage.segment_flush_ms)) {
+            ESP_LOGE(TAG, "Could not open output segment in %s", m_cfg.out_dir);
+            return false;
+        }
+    }
+    if (m_cfg.storage.detection_log && !sdcard::open_detection_log(m_cfg.out_dir, m_cfg.storage.log_flush_ms)) {
+        ESP_LOGE(TAG, "Could not open detection log in %s", m_cfg.out_dir);
+        return false;
+    }
+    if (m_cfg.tracker_enabled) {
+        m_tracker.init(m_cfg.tracker);
+    }
+    if (m_cfg.scheduler_enabled) {
+        m_scheduler.init(m_cfg.scheduler);
+    }
+    if (m_cfg.gate_enabled && !m_gate.init(m_cfg.gate, m_roi_width, m_roi_height)) {
+        ESP_LOGE(TAG, "Invalid motion gate config");
+        return false;
+    }
+    return true;
+}
+
+void Stages::reset_frame(frame_t *f) const {
+    f->fb = {};
+    f->roi_buf.reset();
+    f->jpeg_buf.reset();
+    f->decoded_buf.reset();
+    f->sensor_buf.reset();
+    f->sensor_len = 0;
+    f->roi.width = m_roi_width;
+    f->roi.height = m_roi_height;
+    f->roi.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB888;
+    f->roi.data = nullptr;
+    f->jpeg = {};
+    f->results.clear();
+}
+
+capture_result_t Stages::capture(frame_t *f, const sensor_image_t &img, int64_t t_us) {
+    capture_result_t r = {};
+    const bool jpeg = m_cfg.capture == CAPTURE_JPEG;
+    const int shift = jpeg ? m_cfg.jpeg_capture.scale_shift : 0;
+    r.ok = img.data && (img.width >> shift) >= m_roi_width && (img.height >> shift) >= m_roi_height;
+    if (r.ok) {
+        f->id = m_next_id++;
+        f->capture_us = t_us;
+        f->frame_width = img.width >> shift;
+        f->frame_height = img.height >> shift;
+        f->x0 = (f->frame_width - m_roi_width) / 2;
+        f->y0 = (f->frame_height - m_roi_height) / 2;
+        f->to_tensor_us = 0;
+        if (!jpeg) {
+            f->fb = {const_cast<uint8_t *>(img.data), (uint16_t)img.width, (uint16_t)img.height,
+                     dl::image::DL_IMAGE_PIX_TYPE_RGB565};
+        }
+        m_capture.frames++;
+        m_capture.sensor_bytes += img.len;
+        r.ok = !jpeg || decode_roi(f, img);
+    }
+    if (r.ok) {
+        r.run_detector = true;
+        const source_t src = source(f);
+        // Bewegungsfilter auf Core 0, damit Frames ohne Bewegung Core 1 gar nicht erst belegen
+        if (m_cfg.gate_enabled) {
+            PROFILE_SPAN(gate_span, profiler::SPAN_GATE);
+            motion::decision_t decision =
+                m_gate.update(static_cast<const uint8_t *>(src.img.data), src.img.width, src.x0, src.y0);
+            r.run_detector = motion::MotionGate::runs_detector(decision);
+            r.motion = decision == motion::DECISION_MOTION;
+        }
+        if (r.run_detector && m_keep_sensor_jpeg) {
+            keep_sensor_jpeg(f, img);
+        }
+        if (jpeg && m_setup.hooks.release_frame) {
+            m_setup.hooks.release_frame(m_setup.hooks.ctx, f);
+        }
+    }
+    return r;
+}
+
+bool Stages::infer(frame_t *f) {
+    const source_t src = source(f);
+    bool ok = true;
+    int64_t convert_us = 0;
+    if (m_convert_roi) {
+        f->roi_buf = m_pool.acquire(bufpool::SLOT_RGB888_ROI);
+        f->roi.data = f->roi_buf.data();
+
+        // Archivbild direkt aus dem Framebuffer bzw. dem dekodierten ROI konvertieren
+        PROFILE_SPAN(convert_span, profiler::SPAN_CONVERT);
+        const int64_t convert_start_us = esp_timer_get_time();
+        ok = f->roi_buf && imgconv::rgb565_roi_to_rgb888(static_cast<const uint8_t *>(src.img.data),
+                                                         src.img.width, src.img.height, src.x0, src.y0,
+                                                         m_roi_width, m_roi_height, f->roi_buf.data());
+        convert_us = esp_timer_get_time() - convert_start_us;
+        m_capture.converted_bytes += (uint64_t)m_roi_width * m_roi_height * 3;
+        PROFILE_SPAN_END(convert_span);
+    }
+#if CONFIG_BEESENSE_INFER_TILED
+    // Kacheln werden aus dem RGB888-Vollbild gelesen, der Frame wird nicht mehr gebraucht
+    release_source(f);
+    if (ok) {
+        add_to_tensor(f, convert_us);
+        PROFILE_SPAN(span, profiler::SPAN_INFER);
+        infer_tiles(f);
+    } else {
+#else
+    if (m_detector->cascade_enabled()) {
+        // Beide Kaskadenstufen lesen aus dem RGB888-Ausschnitt, der Frame wird nicht mehr gebraucht
+        release_source(f);
+        if (ok) {
+            add_to_tensor(f, convert_us);
+            PROFILE_SPAN(span, profiler::SPAN_INFER);
+            const auto &results = m_detector->detect(f->roi);
+            f->results.assign(results.begin(), results.end());
+            for (auto &res : f->results) {
+                res.box = {res.box[0] + f->x0, res.box[1] + f->y0, res.box[2] + f->x0, res.box[3] + f->y0};
+            }
+        }
+    } else {
+        // Modell-Input direkt aus dem Framebuffer bzw. dem dekodierten ROI, danach Quelle zurückgeben
+        if (ok) {
+            PROFILE_SPAN(span, profiler::SPAN_PREPROCESS);
+            const int64_t preprocess_start_us = esp_timer_get_time();
+            m_crop_area = {src.x0, src.y0, src.x0 + m_roi_width, src.y0 + m_roi_height};
+            m_detector->preprocess(src.img, m_crop_area);
+            add_to_tensor(f, esp_timer_get_time() - preprocess_start_us);
+        }
+        release_source(f);
+        if (ok) {
+            PROFILE_SPAN(span, profiler::SPAN_INFER);
+            const auto &results = m_detector->infer(src.img.width, src.img.height);
+            f->results.assign(results.begin(), results.end());
+            // Boxen in Framekoordinaten, auch wenn die Quelle nur der ROI war
+            const int dx = f->x0 - src.x0;
+            const int dy = f->y0 - src.y0;
+            for (auto &res : f->results) {
+                res.box = {res.box[0] + dx, res.box[1] + dy, res.box[2] + dx, res.box[3] + dy};
+            }
+        }
+    }
+    if (!ok) {
+#endif
+        ESP_LOGE(TAG, "Could not convert frame #%lu", (unsigned long)f->id);
+    }
+    if (ok) {
+        f->model_id = (uint16_t)m_detector->model_index();
+        m_detections.fetch_add(f->results.size());
+    }
+    if (ok && m_cfg.tracker_enabled) {
+        track(f);
+    }
+    return ok;
+}
+
+bool Stages::encode(frame_t *f) {
+    log_results(f);
+    if (m_cfg.archive == ARCHIVE_THUMBNAILS) {
+        return archive_thumbnails(f);
+    }
+    // Das Sensor-JPEG bleibt unbemalt, auch wenn es nicht archiviert wird
+    if (m_cfg.annotate && !m_keep_sensor_jpeg) {
+        PROFILE_SPAN(annotate_span, profiler::SPAN_ANNOTATE);
+        annotate(f);
+        PROFILE_SPAN_END(annotate_span);
+    }
+    return archive_frame(f);
+}
+
+// Konsument des Rings: einziger Schreiber auf die SD-Karte
+bool Stages::store_next() {
+    uint32_t len = 0;
+    const uint8_t *rec = m_ring.peek(len);
+    if (!rec) {
+        return false;
+    }
+    PROFILE_SPAN(store_span, profiler::SPAN_STORE);
+    stored_t hdr;
+    memcpy(&hdr, rec, sizeof(hdr));
+    const uint8_t *meta = rec + sizeof(hdr);
+    dl::image::jpeg_img_t jpeg = {};
+    jpeg.data = (void *)(meta + hdr.meta_len);
+    jpeg.data_len = len - sizeof(hdr) - hdr.meta_len;
+    bool ok;
+    if (hdr.type == STORED_THUMB) {
+        segment::thumb_meta_t thumb;
+        memcpy(&thumb, meta, sizeof(thumb));
+        ok = m_cfg.storage.segments && sdcard::append_thumbnail(jpeg, thumb, hdr.capture_us);
+    } else {
+        detlog::record_t det;
+        memcpy(&det, meta, sizeof(det));
+        ok = m_cfg.storage.segments
+                 ? sdcard::append_detected_jpeg(jpeg, det.boxes, det.box_count, hdr.capture_us, &det.image)
+                 : sdcard::write_detected_jpeg(jpeg, m_cfg.out_dir, &det.image);
+        // Sidecar nur zu tatsächlich gespeicherten Bildern
+        if (ok && m_cfg.storage.detection_log && !sdcard::append_detections(det)) {
+            m_archive.sidecar_failed++;
+        }
+    }
+    PROFILE_SPAN_END(store_span);
+    m_ring.pop();
+    return ok;
+}
+
+uint32_t Stages::schedule(int64_t t_us, bool motion, uint32_t pipeline_us) {
+    if (!m_cfg.scheduler_enabled) {
+        return m_cfg.capture_interval_ms;
+    }
+    scheduler::observation_t obs = {};
+    obs.t_us = t_us;
+    obs.detections = m_detections.exchange(0);
+    obs.motion = motion;
+    obs.pipeline_us = pipeline_us;
+
+    uint32_t previous_ms = m_scheduler.interval_ms();
+    scheduler::decision_t d = m_scheduler.update(obs);
+    char line[64];
+    scheduler::CaptureScheduler::format(line, sizeof(line), obs, d);
+    if (d.interval_ms != previous_ms) {
+        ESP_LOGI(TAG, "%s", line);
+    } else {
+        ESP_LOGD(TAG, "%s", line);
+    }
+    return d.interval_ms;
+}
+
+void Stages::log_stats() const {
+    if (m_cfg.gate_enabled) {
+        const motion::gate_stats_t &gs = m_gate.stats();
+        ESP_LOGI(TAG, "gate     skip %lu, motion %lu, forced %lu (skip ratio %.2f), cost avg %lld us, max %lld us",
+                 (unsigned long)gs.decisions[motion::DECISION_SKIP],
+                 (unsigned long)gs.decisions[motion::DECISION_MOTION],
+                 (unsigned long)gs.decisions[motion::DECISION_FORCED], m_gate.skip_ratio(),
+                 gs.frames ? (long long)(gs.total_cost_us / gs.frames) : 0LL, (long long)gs.max_cost_us);
+    }
+    if (m_cfg.tracker_enabled) {
+        const tracking::tracker_stats_t &ts = m_tracker.stats();
+        ESP_LOGI(TAG, "tracker  %d active, %lu created, %lu confirmed, in %lu, out %lu, dropped %lu", m_tracker.count(),
+                 (unsigned long)ts.tracks_created, (unsigned long)ts.tracks_confirmed,
+                 (unsigned long)ts.crossings[tracking::DIRECTION_IN], (unsigned long)ts.crossings[tracking::DIRECTION_OUT],
+                 (unsigned long)ts.dropped);
+    }
+    if (m_cfg.scheduler_enabled) {
+        const scheduler::scheduler_stats_t &ss = m_scheduler.stats();
+        ESP_LOGI(TAG, "schedule %lu ms now, active %lu, hold %lu, motion %lu, backoff %lu, %lu changes",
+                 (unsigned long)m_scheduler.interval_ms(), (unsigned long)ss.decisions[scheduler::REASON_ACTIVE],
+                 (unsigned long)ss.decisions[scheduler::REASON_HOLD], (unsigned long)ss.decisions[scheduler::REASON_MOTION],
+                 (unsigned long)ss.decisions[scheduler::REASON_BACKOFF], (unsigned long)ss.changes);
+    }
+    const capture_cost_t &cc = m_capture;
+    const uint32_t captured = std::max<uint32_t>(cc.frames, 1);
+    ESP_LOGI(TAG, "capture  %s, per frame %llu bytes sensor, %llu decoded, %llu converted, %llu copied; "
+             "to tensor avg %lld us, max %lu us; not archived: too large %lu, no slot %lu",
+             m_cfg.capture == CAPTURE_JPEG ? "jpeg" : "rgb565", (unsigned long long)(cc.sensor_bytes / captured),
+             (unsigned long long)(cc.decoded_bytes / captured), (unsigned long long)(cc.converted_bytes / captured),
+             (unsigned long long)(cc.copied_bytes / captured),
+             cc.tensor_frames ? (long long)(cc.to_tensor_us / cc.tensor_frames) : 0LL,
+             (unsigned long)cc.max_to_tensor_us, (unsigned long)cc.too_large, (unsigned long)cc.no_slot);
+    if (m_cfg.capture == CAPTURE_JPEG) {
+        m_decoder.log_stats();
+    }
+    m_pool.log_stats();
+    if (m_encoder.is_open()) {
+        m_encoder.log_stats();
+    }
+    if (m_cfg.archive == ARCHIVE_THUMBNAILS) {
+        m_thumb_encoder.log_stats();
+    }
+    ESP_LOGI(TAG, "archive  %lu detections, %lu thumbs, %lu frames, %llu KB, %lu bytes per detection",
+             (unsigned long)m_archive.detections, (unsigned long)m_archive.thumbs, (unsigned long)m_archive.frames,
+             (unsigned long long)(m_archive.bytes / 1024),
+             m_archive.detections ? (unsigned long)(m_archive.bytes / m_archive.detections) : 0UL);
+    if (m_cfg.storage.detection_log) {
+        ESP_LOGI(TAG, "sidecar  %u bytes per frame, failed %lu", (unsigned)sizeof(detlog::record_t),
+                 (unsigned long)m_archive.sidecar_failed);
+    }
+}
+
+} // namespace stages
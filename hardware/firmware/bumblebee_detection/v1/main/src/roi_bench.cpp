@@ -0,0 +1,69 @@
+#include "roi_bench.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "rgb565_roi.hpp"
+
+namespace imgconv {
+
+static const char *TAG = "ROI_BENCH";
+
+// --------- Internal helpers ----------------------------------
+
+template <typename F>
+static double best_ns_per_px(int iterations, int roi, F fn) {
+    double best = 1e30;
+    for (int run = 0; run < 5; ++run) {
+        const int64_t t0 = esp_timer_get_time();
+        for (int i = 0; i < iterations; ++i) {
+            fn();
+        }
+        const double ns = (double)(esp_timer_get_time() - t0) * 1000.0;
+        best = std::min(best, ns / iterations / ((double)roi * roi));
+    }
+    return best;
+}
+
+// --------- Public API ----------------------------------
+
+roi_bench_t bench_rgb565_roi(const uint8_t *frame, int frame_width, int frame_height, int roi, uint8_t *dst,
+                             int iterations) {
+    const int x0 = (frame_width - roi) / 2;
+    const int y0 = (frame_height - roi) / 2;
+    roi_bench_t r = {};
+    r.ref_ns_px = best_ns_per_px(iterations, roi, [&] {
+        rgb565_roi_to_rgb888_ref(frame, frame_width, frame_height, x0, y0, roi, roi, dst);
+    });
+    r.fast_ns_px = best_ns_per_px(iterations, roi, [&] {
+        rgb565_roi_to_rgb888(frame, frame_width, frame_height, x0, y0, roi, roi, dst);
+    });
+    r.pie_ns_px = best_ns_per_px(iterations, roi, [&] {
+        rgb565_roi_to_rgb888_pie(frame, frame_width, frame_height, x0, y0, roi, roi, dst);
+    });
+    // Gleiche Zugriffe ohne Rechnung: je ROI-Zeile 2 Byte/px lesen, 3 Byte/px schreiben
+    r.copy_ns_px = best_ns_per_px(iterations, roi, [&] {
+        const uint8_t *src = frame + ((size_t)y0 * frame_width + x0) * 2;
+        uint8_t *out = dst;
+        for (int y = 0; y < roi; ++y) {
+            memcpy(out, src, (size_t)roi * 2);
+            memcpy(out + (size_t)roi * 2, src, (size_t)roi);
+            src += (size_t)frame_width * 2;
+            out += (size_t)roi * 3;
+        }
+    });
+    return r;
+}
+
+void log_roi_bench(const roi_bench_t &r) {
+    ESP_LOGI(TAG, "reference %.3f ns/px, word-wise %.3f ns/px (%.2fx), memcpy bound %.3f ns/px", r.ref_ns_px,
+             r.fast_ns_px, r.fast_ns_px > 0 ? r.ref_ns_px / r.fast_ns_px : 0.0, r.copy_ns_px);
+    ESP_LOGI(TAG, "word-wise is %.2fx the memcpy bound, a SIMD path could save at most %.0f%%",
+             r.copy_ns_px > 0 ? r.fast_ns_px / r.copy_ns_px : 0.0,
+             r.fast_ns_px > r.copy_ns_px ? 100.0 * (r.fast_ns_px - r.copy_ns_px) / r.fast_ns_px : 0.0);
+    ESP_LOGI(TAG, "PIE %.3f ns/px (%.2fx word-wise, %.2fx the memcpy bound)", r.pie_ns_px,
+             r.pie_ns_px > 0 ? r.fast_ns_px / r.pie_ns_px : 0.0, r.copy_ns_px > 0 ? r.pie_ns_px / r.copy_ns_px : 0.0);
+}
+
+} // namespace imgconv
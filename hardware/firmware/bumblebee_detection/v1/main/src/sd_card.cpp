@@ -1,170 +1,161 @@
 #include "sd_card.hpp"
 
 #include "esp_log.h"
-#include "esp_err.h"
-#include "esp_vfs_fat.h"
-#include "sdmmc_cmd.h"
-#include "driver/sdspi_host.h"
-#include "driver/gpio.h"
 
-
-#include <sys/stat.h>
 #include <time.h>
-#include <dirent.h>
+#include <sys/time.h>
+#include <cerrno>
 #include <cstring>
 #include <cstdio>
-#include "ff.h" // Für FATFS Zeitstempel
-
-#include "esp_jpeg_enc.h"
-#include "dl_image_jpeg.hpp"
 
-#include "include/sd_pins.h"  // the board-specific SD + SPI pins
+#include "detection_log.hpp"
+#include "file_index.hpp"
+#include "segment_file.hpp"
+#include "span_profiler.hpp"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "esp_random.h"
+#include "esp_timer.h"
 
 namespace sdcard {
 
 static const char *TAG = "SDCARD";
-static constexpr const char *MOUNT_POINT = "/sdcard";
 
-static sdmmc_card_t *g_card = nullptr;
+static storage::Backend *g_fs = nullptr;
 static bool g_mounted = false;
+static fileindex::FileIndex g_index;  // Dateinummern für das zuletzt verwendete Ausgabeverzeichnis
 
-// --------- Internal helpers ----------------------------------
+static segment::Writer g_segment;
+static char g_segment_dir[64] = {};
+static char g_segment_path[96] = {};
+static uint32_t g_segment_capacity = 0;
+static uint32_t g_segment_flush_ms = 0;
+static uint8_t *g_batch_buf = nullptr;
+static size_t g_batch_size = 0;
+static detlog::Writer g_detections;
 
-static void init_sd_enable_pin(void) {
-    gpio_config_t io_conf = {};
-    io_conf.pin_bit_mask = (1ULL << SD_ENABLE);
-    io_conf.mode         = GPIO_MODE_OUTPUT;
-    io_conf.pull_up_en   = GPIO_PULLUP_DISABLE;
-    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
-    io_conf.intr_type    = GPIO_INTR_DISABLE;
-    gpio_config(&io_conf);
-
-    // Active level depends on hardware
-    gpio_set_level(SD_ENABLE, 0);
-}
+// --------- Internal helpers ----------------------------------
 
-static bool mount_sdcard_spi() {
-    if (g_mounted) {
-        return true;
+// Nächster freier Dateipfad im Stunden-Shard von dir. Die Indexdatei wird nur beim
+// ersten Zugriff auf ein Verzeichnis gelesen (bzw. per Scan wiederhergestellt).
+static bool next_output_path(const char *dir, const struct tm &now, char *path, size_t len) {
+    PROFILE_SPAN(span, profiler::SPAN_SD_INDEX);
+    if (!g_index.is_open() || strcmp(g_index.root(), dir) != 0) {
+        if (!g_index.open(dir, "bumblebee", g_fs)) {
+            ESP_LOGE(TAG, "Could not open file index in %s (errno=%d)", dir, errno);
+            return false;
+        }
+        const fileindex::index_stats_t &st = g_index.stats();
+        ESP_LOGI(TAG, "File index %s: next #%lu (%s)", dir, (unsigned long)g_index.next_sequence(),
+                 st.scanned_files ? "recovered by scan" : "from index file");
     }
+    return g_index.next_path(now, path, len);
+}
 
-    init_sd_enable_pin();
-    esp_err_t ret;
-
-    // Options for mounting the filesystem.
-    // If format_if_mount_failed is set to true, SD card will be partitioned and
-    // formatted in case when mounting fails.
-    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
-        .format_if_mount_failed = false,
-        .max_files = 5,
-        .allocation_unit_size = 16 * 1024,
-        .disk_status_check_enable = false,
-        .use_one_fat = false
-    };
-
-    ESP_LOGI(TAG, "Initializing SD card over SPI");
-
-    // By default, SD card frequency is initialized to SDMMC_FREQ_DEFAULT (20MHz)
-    // For setting a specific frequency, use host.max_freq_khz (range 400kHz - 20MHz for SDSPI)
-    // Example: for fixed frequency of 10MHz, use host.max_freq_khz = 10000;
-    // host.'slot' should be set to an sdspi device initialized by `sdspi_host_init_device()`.
-    // SDSPI_HOST_DEFAULT: https://github.com/espressif/esp-idf/blob/1bbf04cb4cf54d74c1fe21ed12dbf91eb7fb1019/components/esp_driver_sdspi/include/driver/sdspi_host.h#L44
-    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
-    host.max_freq_khz = 5000;
-
-    constexpr spi_host_device_t SPI_HOST_ID = SPI3_HOST;
-    host.slot = SPI_HOST_ID;
-
-    spi_bus_config_t bus_cfg = {};
-    bus_cfg.mosi_io_num      = PIN_NUM_MOSI;
-    bus_cfg.miso_io_num      = PIN_NUM_MISO;
-    bus_cfg.sclk_io_num      = PIN_NUM_CLK;
-    bus_cfg.quadwp_io_num    = -1;
-    bus_cfg.quadhd_io_num    = -1;
-    bus_cfg.max_transfer_sz  = 4000;
-
-    ESP_LOGI(TAG, "Initializing SPI bus");
-    ret = spi_bus_initialize(SPI_HOST_ID, &bus_cfg, SDSPI_DEFAULT_DMA);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize SPI bus: %s", esp_err_to_name(ret));
+// "<name>.open" -> "<name>.bseg"
+static bool finish_segment_name(const char *open_path) {
+    char closed[96];
+    strlcpy(closed, open_path, sizeof(closed));
+    char *ext = strrchr(closed, '.');
+    if (!ext) {
         return false;
     }
+    strlcpy(ext, ".bseg", sizeof(closed) - (ext - closed));
+    return g_fs->rename(open_path, closed);
+}
 
-    // card select output ?
-    gpio_reset_pin(PIN_NUM_CS);
-    gpio_set_direction(PIN_NUM_CS, GPIO_MODE_OUTPUT);
-    gpio_set_level(PIN_NUM_CS, 1); // inactive
-
-    // This initializes the slot without card detect (CD) and write protect (WP) signals.
-    // Modify slot_config.gpio_cd and slot_config.gpio_wp if your board has these signals.
-    // sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
-    sdspi_device_config_t slot_config = {};
-    slot_config.host_id      = SPI_HOST_ID;
-    slot_config.gpio_cs      = PIN_NUM_CS;
-    slot_config.gpio_cd      = SD_SW;
-    slot_config.gpio_wp      = SDSPI_SLOT_NO_WP;
-    slot_config.gpio_int     = GPIO_NUM_NC;
-    slot_config.gpio_wp_polarity = SDSPI_IO_ACTIVE_LOW;
-    //slot_config.duty_cycle_pos = 0;
-
-    // spi_host_device_t host_id; ///< SPI host to use, SPIx_HOST (see spi_types.h)
-    ESP_LOGI(TAG, "Mounting FAT filesystem at %s", MOUNT_POINT);
-    // gpio_set_level(SD_ENABLE, 1);
-    ret = esp_vfs_fat_sdspi_mount(MOUNT_POINT, &host, &slot_config, &mount_config, &g_card);
-
-    if (ret != ESP_OK) {
-        if (ret == ESP_FAIL) {
-            ESP_LOGE("SD", "Failed to mount filesystem (ret == ESP_FAIL). Look into esp_vfs_fat_sdspi_mount() "
-                           "If you want the card to be formatted, set the CONFIG_EXAMPLE_FORMAT_IF_MOUNT_FAILED menuconfig option.");
+// Segmente, die beim letzten Lauf nicht geschlossen wurden: abgerissenen Record abschneiden
+static void recover_open_segments(const char *dir) {
+    g_fs->list_dir(dir, [](const storage::dir_entry_t &entry, void *ctx) {
+        const char *ext = strrchr(entry.name, '.');
+        if (entry.is_dir || !ext || strcmp(ext, ".open") != 0) {
+            return true;
+        }
+        char path[96];
+        snprintf(path, sizeof(path), "%s/%s", static_cast<const char *>(ctx), entry.name);
+        segment::scan_result_t res;
+        if (segment::recover(path, res, g_fs) && finish_segment_name(path)) {
+            ESP_LOGW(TAG, "Recovered segment %s: %lu images, %lu bytes", path, (unsigned long)res.jpegs,
+                     (unsigned long)res.valid_end);
         } else {
-            ESP_LOGE("SD", "Failed to initialize the card (%s). Look into esp_vfs_fat_sdspi_mount() "
-                           "Make sure SD card lines have pull-up resistors in place.",
-                     esp_err_to_name(ret));
-            }
+            ESP_LOGE(TAG, "Could not recover segment %s", path);
+        }
+        return true;
+    }, const_cast<char *>(dir));
+}
+
+static bool start_segment() {
+    uint32_t session = esp_random();
+    snprintf(g_segment_path, sizeof(g_segment_path), "%s/seg_%08lx.open", g_segment_dir, (unsigned long)session);
+
+    // Zusammenhängende Cluster, wenn das Backend es kann; sonst erweitert der Writer die Datei selbst
+    g_fs->preallocate(g_segment_path, g_segment_capacity);
+
+    segment::writer_config_t cfg = {};
+    cfg.session = session;
+    cfg.capacity = g_segment_capacity;
+    cfg.index_interval = 64;
+    cfg.flush_interval_us = (int64_t)g_segment_flush_ms * 1000;
+    cfg.io_buffer = g_batch_buf;
+    cfg.io_buffer_size = g_batch_size;
+    cfg.io_unit = ALLOCATION_UNIT_SIZE;
+    cfg.fs = g_fs;
+    if (!g_segment.create(g_segment_path, cfg)) {
+        ESP_LOGE(TAG, "Could not create segment %s", g_segment_path);
         return false;
     }
-
-    // Card has been initialized, print its properties
-    sdmmc_card_print_info(stdout, g_card);
-    g_mounted = true;
-    ESP_LOGI(TAG, "SD card mounted successfully");
+    ESP_LOGI(TAG, "Writing segment %s (%lu KB)", g_segment_path, (unsigned long)(g_segment_capacity / 1024));
     return true;
 }
 
-// Encode an RGB888 image to JPEG into jpeg_img.
-// img.pix_type must be DL_IMAGE_PIX_TYPE_RGB888.
-static jpeg_error_t encode_img_to_jpeg(const dl::image::img_t *img, dl::image::jpeg_img_t *jpeg_img, jpeg_enc_config_t cfg) {
-    jpeg_enc_handle_t jpeg_enc = nullptr;
-    jpeg_error_t ret = jpeg_enc_open(&cfg, &jpeg_enc);
-    if (ret != JPEG_ERR_OK) {
-        return ret;
-    }
+// --------- Public API ----------------------------------
 
-    const int outbuf_size = 100 * 1024; // 100 KB
-    uint8_t *outbuf = static_cast<uint8_t*>(calloc(1, outbuf_size));
-    if (!outbuf) {
-        jpeg_enc_close(jpeg_enc);
-        return JPEG_ERR_NO_MEM;
+bool init(storage::Backend &fs) {
+    if (!fs.mount()) {
+        return false;
     }
-
-    const int in_size = img->width * img->height * 3; // RGB888
-    int out_len = 0;
-    ret = jpeg_enc_process(jpeg_enc, static_cast<const uint8_t*>(img->data), in_size, outbuf, outbuf_size, &out_len);
-    if (ret == JPEG_ERR_OK) {
-        jpeg_img->data = outbuf;
-        jpeg_img->data_len = out_len;
-    } else {
-        free(outbuf);
+    g_fs = &fs;
+    g_mounted = true;
+    storage::space_t space;
+    if (fs.free_space(space)) {
+        ESP_LOGI(TAG, "%s: %llu of %llu MB free", fs.name(), (unsigned long long)(space.free >> 20),
+                 (unsigned long long)(space.total >> 20));
     }
+    return true;
+}
 
-    jpeg_enc_close(jpeg_enc);
-    return ret;
+storage::Backend *backend() {
+    return g_fs;
 }
 
-// --------- Public API ----------------------------------
+bool init_write_batch(size_t size) {
+    size = (size + ALLOCATION_UNIT_SIZE - 1) / ALLOCATION_UNIT_SIZE * ALLOCATION_UNIT_SIZE;
+    if (g_batch_buf) {
+        return g_batch_size == size;
+    }
+    // Interner DMA-fähiger RAM erspart dem SPI-Treiber das Umkopieren, sonst PSRAM
+    g_batch_buf = static_cast<uint8_t *>(heap_caps_aligned_alloc(32, size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL));
+    if (!g_batch_buf) {
+        g_batch_buf = static_cast<uint8_t *>(heap_caps_aligned_alloc(32, size, MALLOC_CAP_SPIRAM));
+    }
+    if (!g_batch_buf) {
+        ESP_LOGE(TAG, "Could not allocate %u byte write batch", (unsigned)size);
+        return false;
+    }
+    g_batch_size = size;
+    ESP_LOGI(TAG, "Write batch %u KB (%s)", (unsigned)(size / 1024),
+             esp_ptr_internal(g_batch_buf) ? "internal" : "PSRAM");
+    return true;
+}
 
-bool init() {
-    return mount_sdcard_spi();
+void log_write_stats() {
+    if (!g_segment.is_open() || !g_batch_buf) {
+        return;
+    }
+    const writebehind::batch_stats_t &io = g_segment.io_stats();
+    ESP_LOGI(TAG, "segment  %lu writes, %llu KB (%llu KB rewritten), %lu syncs, worst %lld us",
+             (unsigned long)io.writes, (unsigned long long)(io.bytes / 1024),
+             (unsigned long long)(io.rewritten / 1024), (unsigned long)io.syncs, (long long)io.max_write_us);
 }
 
 bool create_dir(const char *full_path) {
@@ -172,149 +163,180 @@ bool create_dir(const char *full_path) {
         ESP_LOGE(TAG, "create_dir: SD not mounted");
         return false;
     }
-
-    struct stat st;
-    if (stat(full_path, &st) == 0) {
-        if (S_ISDIR(st.st_mode)) {
-            ESP_LOGI(TAG, "Dir already exists: %s", full_path);
-            return true;
-        } else {
-            ESP_LOGE(TAG, "Path exists but is not a directory: %s", full_path);
-            return false;
-        }
-    }
-
-    int res = mkdir(full_path, 0775);
-    if (res == 0) {
-        ESP_LOGI(TAG, "Created dir: %s", full_path);
-        return true;
-    } else {
+    if (!g_fs->make_dir(full_path)) {
         ESP_LOGE(TAG, "mkdir failed for %s (errno=%d)", full_path, errno);
         return false;
     }
+    return true;
 }
 
 int count_files(const char *path) {
+    PROFILE_SPAN(span, profiler::SPAN_SD_COUNT_FILES);
     int count = 0;
-    DIR *dir = opendir(path);
-    if (!dir) {
+    if (!g_mounted || !g_fs->list_dir(path, [](const storage::dir_entry_t &entry, void *ctx) {
+            if (!entry.is_dir) {
+                ++*static_cast<int *>(ctx);
+            }
+            return true;
+        }, &count)) {
         ESP_LOGE("FILE_COUNT", "Failed to open directory: %s", path);
         return -1;
     }
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != nullptr) {
-        // Skip current and parent directory entries
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
-
-        // Build full file path
-        char full_path[256];
-        // snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-        strlcpy(full_path, path, sizeof(full_path));
-        strlcat(full_path, "/", sizeof(full_path));
-        strlcat(full_path, entry->d_name, sizeof(full_path));
-        // Get file info
-        struct stat st;
-        if (stat(full_path, &st) == 0) {
-            if (S_ISREG(st.st_mode)) {
-                count++;
-            }
-        }
-        else {
-            ESP_LOGW("FILE_COUNT", "Could not stat file: %s", full_path);
-        }
-    }
-
-    closedir(dir);
     return count;
 }
 
-bool save_detected_jpeg(const dl::image::img_t &img,
-                          const dl::cls::result_t &best,
-                          const char *dir_full_path) {
+bool write_detected_jpeg(const dl::image::jpeg_img_t &jpeg_img, const char *dir_full_path, detlog::image_ref_t *ref) {
     if (!g_mounted) {
-        ESP_LOGE(TAG, "save_detected_jpeg: SD not mounted");
+        ESP_LOGE(TAG, "write_detected_jpeg: SD not mounted");
         return false;
     }
-    if (!img.data) {
-        ESP_LOGE(TAG, "save_detected_jpeg: image has no data");
+
+    time_t t = time(NULL);
+    struct tm tm_now = {};
+    bool have_time = localtime_r(&t, &tm_now) != nullptr;
+
+    // Fortlaufende Nummer aus dem Index statt Verzeichnis-Scan, Ablage in <dir>/<YYYYMMDD>/<HH>/
+    char filepath[256];
+    if (!next_output_path(dir_full_path, tm_now, filepath, sizeof(filepath))) {
         return false;
     }
-    if (img.pix_type != dl::image::DL_IMAGE_PIX_TYPE_RGB888) {
-        ESP_LOGE(TAG, "save_detected_jpeg: image is not RGB888");
+    if (ref) {
+        *ref = {0, g_index.next_sequence() - 1};
+    }
+
+    ESP_LOGI(TAG, "Saving detected JPEG: %s", filepath);
+
+    PROFILE_SPAN(write_span, profiler::SPAN_SD_WRITE);
+    if (!g_fs->write_file(filepath, jpeg_img.data, jpeg_img.data_len)) {
+        ESP_LOGE(TAG, "Failed to save JPEG: %s", filepath);
         return false;
     }
+    PROFILE_SPAN_END(write_span);
+
+    // Änderungsdatum setzen (aktuelles Systemdatum/Zeit), soweit das Backend es kann
+    PROFILE_SPAN(time_span, profiler::SPAN_SD_FILE_TIME);
+    if (!have_time) {
+        ESP_LOGW(TAG, "Could not get localtime for file time: %s", filepath);
+    } else if (!g_fs->set_file_time(filepath, tm_now)) {
+        ESP_LOGW(TAG, "Could not set file time: %s", filepath);
+    }
+    PROFILE_SPAN_END(time_span);
 
-    // Make sure directory exists
+    ESP_LOGI(TAG, "Saved successfully");
+    return true;
+}
+
+bool open_segment(const char *dir_full_path, uint32_t capacity, uint32_t flush_interval_ms) {
+    if (!g_mounted) {
+        ESP_LOGE(TAG, "open_segment: SD not mounted");
+        return false;
+    }
     if (!create_dir(dir_full_path)) {
         return false;
     }
+    close_segment();
+    strlcpy(g_segment_dir, dir_full_path, sizeof(g_segment_dir));
+    g_segment_capacity = capacity;
+    g_segment_flush_ms = flush_interval_ms;
+    recover_open_segments(g_segment_dir);
+    return start_segment();
+}
+
+// Aufnahmezeit als Unix-Zeit, t_us ist esp_timer-Zeit
+static int64_t wall_time_us(int64_t t_us) {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - (esp_timer_get_time() - t_us);
+}
 
-    // Encode to JPEG
-    dl::image::jpeg_img_t jpeg_img;
-    jpeg_enc_config_t enc_cfg = {
-        .width = img.width,
-        .height = img.height,
-        .src_type = JPEG_PIXEL_FORMAT_RGB888,
-        .subsampling = JPEG_SUBSAMPLE_444,
-        .quality = 80,
-        .rotate = JPEG_ROTATE_0D,
-        .task_enable = true,
-        .hfm_task_priority = 13,
-        .hfm_task_core = 1,
-    };
-
-    jpeg_error_t enc_ret = encode_img_to_jpeg(&img, &jpeg_img, enc_cfg);
-    if (enc_ret != JPEG_ERR_OK) {
-        ESP_LOGE(TAG, "JPEG encoding failed (%d)", enc_ret);
+// append() einmal wiederholen, wenn das Segment voll war und ein neues begonnen wurde
+template <typename Append>
+static bool append_rotating(const char *what, Append append) {
+    if (!g_segment.is_open()) {
+        ESP_LOGE(TAG, "%s: no open segment", what);
         return false;
     }
-
-    // Determine next index in directory
-    int idx = count_files(dir_full_path);
-    if (idx < 0) {
-        free(jpeg_img.data);
+    const uint32_t full_before = g_segment.stats().full;
+    PROFILE_SPAN(append_span, profiler::SPAN_SD_APPEND);
+    if (append()) {
+        return true;
+    }
+    PROFILE_SPAN_END(append_span);
+    if (g_segment.stats().full == full_before) {
+        ESP_LOGE(TAG, "Write to segment %s failed", g_segment_path);
         return false;
     }
+    // Segment voll: abschließen und im nächsten weiterschreiben
+    PROFILE_SPAN(rotate_span, profiler::SPAN_SD_ROTATE);
+    if (!close_segment() || !start_segment()) {
+        return false;
+    }
+    PROFILE_SPAN_END(rotate_span);
+    PROFILE_SPAN(retry_span, profiler::SPAN_SD_APPEND);
+    return append();
+}
 
+bool append_detected_jpeg(const dl::image::jpeg_img_t &jpeg_img, const segment::box_meta_t *boxes, uint16_t count,
+                          int64_t t_us, detlog::image_ref_t *ref) {
+    const int64_t wall_us = wall_time_us(t_us);
+    const bool ok = append_rotating("append_detected_jpeg", [&] {
+        return g_segment.append(wall_us, boxes, count, jpeg_img.data, (uint32_t)jpeg_img.data_len);
+    });
+    if (ok && ref) {
+        *ref = {g_segment.session(), g_segment.last_seq()};
+    }
+    return ok;
+}
 
-    char filepath[256];
-    std::snprintf(filepath, sizeof(filepath), "%s/bumblebee_%04d.jpg", dir_full_path, idx + 1);
+bool append_thumbnail(const dl::image::jpeg_img_t &jpeg_img, const segment::thumb_meta_t &meta, int64_t t_us) {
+    const int64_t wall_us = wall_time_us(t_us);
+    return append_rotating("append_thumbnail", [&] {
+        return g_segment.append_thumb(wall_us, meta, jpeg_img.data, (uint32_t)jpeg_img.data_len);
+    });
+}
 
-    ESP_LOGI(TAG, "Saving detected JPEG: %s", filepath);
+bool close_segment() {
+    if (!g_segment.is_open()) {
+        return true;
+    }
+    const segment::writer_stats_t st = g_segment.stats();
+    bool ok = g_segment.close() && finish_segment_name(g_segment_path);
+    ESP_LOGI(TAG, "Closed segment %s: %lu records, %lu KB, %lu flushes", g_segment_path, (unsigned long)st.records,
+             (unsigned long)(st.bytes / 1024), (unsigned long)st.flushes);
+    return ok;
+}
 
-    esp_err_t write_err = dl::image::write_jpeg(jpeg_img, filepath);
-    if (write_err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save JPEG: %s", filepath);
-        free(jpeg_img.data);
+bool open_detection_log(const char *dir_full_path, uint32_t flush_interval_ms) {
+    if (!g_mounted) {
+        ESP_LOGE(TAG, "open_detection_log: SD not mounted");
         return false;
     }
+    if (!create_dir(dir_full_path)) {
+        return false;
+    }
+    close_detection_log();
+    char path[96];
+    snprintf(path, sizeof(path), "%s/detections.bdet", dir_full_path);
+    return g_detections.open(path, (int64_t)flush_interval_ms * 1000, g_fs);
+}
 
-    // Änderungsdatum setzen (aktuelles Systemdatum/Zeit) via FATFS
-    // Nur möglich, wenn FF_USE_CHMOD und FF_FS_NORTC == 0 in FATFS Konfiguration
-    struct tm *tm_now;
-    time_t t = time(NULL);
-    tm_now = localtime(&t);
-    if (tm_now) {
-        FILINFO finfo = {0};
-        finfo.fdate = ((tm_now->tm_year - 80) << 9) | ((tm_now->tm_mon + 1) << 5) | tm_now->tm_mday;
-        finfo.ftime = (tm_now->tm_hour << 11) | (tm_now->tm_min << 5) | (tm_now->tm_sec / 2);
-#ifdef f_utime
-        if (f_utime(filepath, &finfo) != 0) {
-            ESP_LOGW(TAG, "Could not set FATFS file time: %s", filepath);
-        }
-#else
-        ESP_LOGW(TAG, "f_utime nicht verfügbar, Änderungsdatum kann nicht gesetzt werden: %s", filepath);
-#endif
-    } else {
-        ESP_LOGW(TAG, "Could not get localtime for file time: %s", filepath);
+bool append_detections(detlog::record_t &rec) {
+    if (!g_detections.is_open()) {
+        ESP_LOGE(TAG, "append_detections: no open detection log");
+        return false;
     }
+    return g_detections.append(rec);
+}
 
-    ESP_LOGI(TAG, "Saved successfully");
-    free(jpeg_img.data);
-    return true;
+bool close_detection_log() {
+    if (!g_detections.is_open()) {
+        return true;
+    }
+    const detlog::writer_stats_t st = g_detections.stats();
+    bool ok = g_detections.close();
+    ESP_LOGI(TAG, "Closed detection log: %lu records appended, %lu flushes", (unsigned long)st.records,
+             (unsigned long)st.flushes);
+    return ok;
 }
 
 } // namespace sdcard
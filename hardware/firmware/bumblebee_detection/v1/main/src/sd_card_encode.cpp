@@ -0,0 +1,49 @@
+#include "sd_card.hpp"
+
+#include <cstdlib>
+#include "esp_log.h"
+#include "jpeg_encoder.hpp"
+
+// Encoder-Teil von sd_card: braucht esp_new_jpeg, im Host-Build ersetzt durch libjpeg
+// (host/jpeg_enc_host.cpp). Die Dateiablage liegt in sd_card.cpp.
+namespace sdcard {
+
+static const char *TAG = "SDCARD";
+static jpegenc::Encoder g_encoder;     // bleibt über alle Bilder offen, neu nur bei anderer Bildgröße
+
+bool encode_detected_jpeg(const dl::image::img_t &img, uint8_t *outbuf, size_t outbuf_size,
+                          dl::image::jpeg_img_t &jpeg_img) {
+    if (!img.data) {
+        ESP_LOGE(TAG, "encode_detected_jpeg: image has no data");
+        return false;
+    }
+    if (img.pix_type != dl::image::DL_IMAGE_PIX_TYPE_RGB888) {
+        ESP_LOGE(TAG, "encode_detected_jpeg: image is not RGB888");
+        return false;
+    }
+
+    const jpegenc::encoder_config_t enc_cfg = {img.width, img.height, jpegenc::INPUT_RGB888, JPEG_SUBSAMPLE_444, 80};
+    return g_encoder.open(enc_cfg) && g_encoder.encode(static_cast<const uint8_t *>(img.data), outbuf, outbuf_size,
+                                                       jpeg_img);
+}
+
+bool save_detected_jpeg(const dl::image::img_t &img, const char *dir_full_path) {
+    if (!backend()) {
+        ESP_LOGE(TAG, "save_detected_jpeg: SD not mounted");
+        return false;
+    }
+
+    const size_t outbuf_size = 100 * 1024; // 100 KB
+    uint8_t *outbuf = static_cast<uint8_t*>(malloc(outbuf_size));
+    if (!outbuf) {
+        ESP_LOGE(TAG, "JPEG encoding failed (%d)", JPEG_ERR_NO_MEM);
+        return false;
+    }
+
+    dl::image::jpeg_img_t jpeg_img;
+    bool ok = encode_detected_jpeg(img, outbuf, outbuf_size, jpeg_img) && write_detected_jpeg(jpeg_img, dir_full_path);
+    free(outbuf);
+    return ok;
+}
+
+} // namespace sdcard
@@ -0,0 +1,311 @@
+#include "segment_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+namespace segment {
+
+static constexpr uint32_t PAD = 4;
+
+// --------- Internal helpers ----------------------------------
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static uint32_t padded(uint32_t len) {
+    return (len + PAD - 1) & ~(PAD - 1);
+}
+
+static uint32_t record_size(uint16_t meta_len, uint32_t payload_len) {
+    return sizeof(record_header_t) + padded((uint32_t)meta_len + payload_len);
+}
+
+static uint32_t header_crc(const file_header_t &h) {
+    return crc32(0, &h, offsetof(file_header_t, crc));
+}
+
+// CRC über Meta und Payload in Blöcken lesen, ohne den ganzen Record zu puffern
+static bool crc_body(FILE *f, uint32_t len, uint32_t &crc) {
+    uint8_t buf[512];
+    while (len) {
+        size_t chunk = std::min<uint32_t>(len, sizeof(buf));
+        if (fread(buf, 1, chunk, f) != chunk) {
+            return false;
+        }
+        crc = crc32(crc, buf, chunk);
+        len -= chunk;
+    }
+    return true;
+}
+
+// --------- Public API ----------------------------------
+
+uint32_t crc32(uint32_t crc, const void *data, size_t len) {
+    static uint32_t table[256];
+    static bool table_ready = false;
+    if (!table_ready) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        table_ready = true;
+    }
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    while (len--) {
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+bool scan(FILE *f, scan_result_t &result) {
+    result = {};
+    file_header_t fh;
+    if (fseek(f, 0, SEEK_SET) != 0 || fread(&fh, sizeof(fh), 1, f) != 1) {
+        return false;
+    }
+    if (fh.magic != FILE_MAGIC || fh.version != VERSION || fh.crc != header_crc(fh)) {
+        return false;
+    }
+    result.header_ok = true;
+    result.session = fh.session;
+    result.valid_end = fh.header_size;
+
+    uint32_t offset = fh.header_size;
+    while (offset + sizeof(record_header_t) <= fh.capacity) {
+        record_header_t rh;
+        if (fseek(f, offset, SEEK_SET) != 0 || fread(&rh, sizeof(rh), 1, f) != 1) {
+            break;
+        }
+        // Reste früherer Dateien in vorallokierten Clustern scheitern an Session oder Nummer
+        if (rh.magic != RECORD_MAGIC || rh.session != fh.session || rh.seq != result.records) {
+            break;
+        }
+        uint32_t size = record_size(rh.meta_len, rh.payload_len);
+        if (size > fh.capacity - offset) {
+            break;
+        }
+        uint32_t expected = rh.crc;
+        rh.crc = 0;
+        uint32_t crc = crc32(0, &rh, sizeof(rh));
+        if (!crc_body(f, (uint32_t)rh.meta_len + rh.payload_len, crc) || crc != expected) {
+            break;
+        }
+        if (rh.type == RECORD_INDEX) {
+            result.last_index = offset;
+        } else if (rh.type == RECORD_JPEG) {
+            result.jpegs++;
+        } else if (rh.type == RECORD_THUMB) {
+            result.thumbs++;
+        }
+        result.records++;
+        offset += size;
+        result.valid_end = offset;
+    }
+    return true;
+}
+
+bool recover(const char *path, scan_result_t &result, storage::Backend *fs) {
+    if (!fs) {
+        fs = &storage::default_backend();
+    }
+    FILE *f = fs->open(path, "r+b");
+    if (!f) {
+        return false;
+    }
+    bool ok = scan(f, result) && fs->truncate(f, result.valid_end);
+    fclose(f);
+    return ok;
+}
+
+Writer::~Writer() {
+    close();
+}
+
+bool Writer::create(const char *path, const writer_config_t &cfg) {
+    if (m_file || cfg.index_interval == 0 || cfg.index_interval > MAX_INDEX_INTERVAL ||
+        cfg.capacity < sizeof(file_header_t) + 2 * sizeof(record_header_t)) {
+        return false;
+    }
+    m_fs = cfg.fs ? cfg.fs : &storage::default_backend();
+    // Vorallokierte Datei weiterverwenden, sonst neu anlegen
+    m_file = m_fs->open(path, "r+b");
+    if (!m_file) {
+        m_file = m_fs->open(path, "w+b");
+    }
+    if (!m_file) {
+        return false;
+    }
+    // Gebündelt schreibt BatchFile selbst in großen Blöcken, stdio soll nicht noch einmal kopieren
+    if (cfg.io_buffer) {
+        setvbuf(m_file, nullptr, _IONBF, 0);
+    }
+
+    m_cfg = cfg;
+    m_stats = {};
+    m_seq = 0;
+    m_last_index = 0;
+    m_pending_count = 0;
+    m_last_flush_us = now_us();
+
+    // Auf Kapazität erweitern, falls nicht schon vorallokiert
+    bool ok = fseek(m_file, 0, SEEK_END) == 0;
+    long size = ok ? ftell(m_file) : -1;
+    if (ok && size < (long)cfg.capacity) {
+        ok = fseek(m_file, cfg.capacity - 1, SEEK_SET) == 0 && fputc(0, m_file) != EOF;
+    }
+
+    file_header_t fh = {};
+    fh.magic = FILE_MAGIC;
+    fh.version = VERSION;
+    fh.header_size = sizeof(file_header_t);
+    fh.session = cfg.session;
+    fh.capacity = cfg.capacity;
+    fh.index_interval = cfg.index_interval;
+    fh.crc = header_crc(fh);
+    ok = ok && fseek(m_file, 0, SEEK_SET) == 0 && fwrite(&fh, sizeof(fh), 1, m_file) == 1;
+    if (!ok) {
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    m_offset = sizeof(file_header_t);
+    m_stats.bytes = m_offset;
+    m_dirty = true;
+    if (!flush()) {
+        return false;
+    }
+    if (cfg.io_buffer && !m_batch.attach(m_file, m_offset, cfg.io_buffer, cfg.io_buffer_size, cfg.io_unit, m_fs)) {
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool Writer::put(const void *data, uint32_t len) {
+    if (m_batch.is_attached()) {
+        return m_batch.write(data, len);
+    }
+    return fwrite(data, len, 1, m_file) == 1;
+}
+
+bool Writer::write_record(uint16_t type, int64_t t_us, const void *meta, uint16_t meta_len, const void *payload,
+                          uint32_t payload_len) {
+    record_header_t rh = {};
+    rh.magic = RECORD_MAGIC;
+    rh.session = m_cfg.session;
+    rh.seq = m_seq;
+    rh.type = type;
+    rh.meta_len = meta_len;
+    rh.payload_len = payload_len;
+    rh.t_us = t_us;
+    uint32_t crc = crc32(0, &rh, sizeof(rh));
+    crc = crc32(crc, meta, meta_len);
+    rh.crc = crc32(crc, payload, payload_len);
+
+    static const uint8_t zeros[PAD] = {};
+    const uint32_t body = (uint32_t)meta_len + payload_len;
+    bool ok = put(&rh, sizeof(rh)) && (!meta_len || put(meta, meta_len)) && (!payload_len || put(payload, payload_len)) &&
+              (padded(body) == body || put(zeros, padded(body) - body));
+    if (!ok) {
+        return false;
+    }
+    m_offset += record_size(meta_len, payload_len);
+    m_seq++;
+    m_stats.records++;
+    m_stats.bytes = m_offset;
+    m_dirty = true;
+    return true;
+}
+
+bool Writer::write_index(int64_t t_us) {
+    uint32_t prev = m_last_index;
+    uint32_t offset = m_offset;
+    if (!write_record(RECORD_INDEX, t_us, &prev, sizeof(prev), m_pending, m_pending_count * sizeof(index_entry_t))) {
+        return false;
+    }
+    m_last_index = offset;
+    m_pending_count = 0;
+    m_stats.index_blocks++;
+    return true;
+}
+
+uint32_t Writer::remaining() const {
+    // Platz für den abschließenden INDEX bleibt immer frei
+    const uint32_t index_reserve = record_size(sizeof(uint32_t), m_cfg.index_interval * sizeof(index_entry_t));
+    const uint32_t used = m_offset + index_reserve;
+    return used < m_cfg.capacity ? m_cfg.capacity - used : 0;
+}
+
+bool Writer::append(int64_t t_us, const box_meta_t *boxes, uint16_t box_count, const void *jpeg, uint32_t jpeg_len) {
+    return append_record(RECORD_JPEG, t_us, boxes, box_count * sizeof(box_meta_t), jpeg, jpeg_len);
+}
+
+bool Writer::append_thumb(int64_t t_us, const thumb_meta_t &meta, const void *jpeg, uint32_t jpeg_len) {
+    return append_record(RECORD_THUMB, t_us, &meta, sizeof(meta), jpeg, jpeg_len);
+}
+
+bool Writer::append_record(uint16_t type, int64_t t_us, const void *meta, uint16_t meta_len, const void *jpeg,
+                           uint32_t jpeg_len) {
+    if (!m_file) {
+        return false;
+    }
+    if (record_size(meta_len, jpeg_len) > remaining()) {
+        m_stats.full++;
+        return false;
+    }
+
+    const uint32_t offset = m_offset;
+    const uint32_t seq = m_seq;
+    m_last_t_us = t_us;
+    if (!write_record(type, t_us, meta, meta_len, jpeg, jpeg_len)) {
+        return false;
+    }
+    m_last_seq = seq;
+    m_pending[m_pending_count++] = {seq, offset};
+    if (m_pending_count == m_cfg.index_interval && !write_index(t_us)) {
+        return false;
+    }
+
+    const int64_t now = now_us();
+    if (now - m_last_flush_us >= m_cfg.flush_interval_us) {
+        m_last_flush_us = now;
+        return flush();
+    }
+    return true;
+}
+
+bool Writer::flush() {
+    if (!m_file || !m_dirty) {
+        return m_file != nullptr;
+    }
+    bool ok = m_batch.is_attached() ? m_batch.sync() : m_fs->sync(m_file);
+    if (ok) {
+        m_dirty = false;
+        m_stats.flushes++;
+    }
+    return ok;
+}
+
+bool Writer::close() {
+    if (!m_file) {
+        return true;
+    }
+    bool ok = (m_pending_count == 0 || write_index(m_last_t_us)) && flush();
+    ok = ok && m_fs->truncate(m_file, m_offset);
+    ok = (fclose(m_file) == 0) && ok;
+    m_file = nullptr;
+    m_batch.detach();
+    return ok;
+}
+
+} // namespace segment
@@ -0,0 +1,136 @@
+#include "span_profiler.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+
+namespace profiler {
+
+static const char *TAG = "PROFILE";
+
+// Reihenfolge wie span_t
+static const char *NAMES[SPAN_COUNT] = {
+    "capture",   "gate",     "decode",   "convert",  "preprocess", "infer",    "track",     "annotate", "encode",
+    "thumbs",    "ring_push", "store",   "sd_index", "sd_count",   "sd_write", "sd_ftime",  "sd_append", "sd_rotate",
+};
+
+static SampleRing<WINDOW> s_rings[SPAN_COUNT];
+static RunningTotal s_totals_us[SPAN_COUNT];
+static uint32_t s_ticks_per_us = 1;
+static int64_t s_cycles_trusted_us = INT64_MAX;  // halbe Überlaufzeit des Zykluszählers
+static uint32_t s_span_cost = 0;                  // Zyklen pro Span für Messung und Ablage
+static std::mutex s_scratch_lock;                 // log_report und write_csv laufen in verschiedenen Tasks
+static uint32_t s_scratch[WINDOW];
+
+// --------- Public API ----------------------------------
+
+uint32_t percentile(uint32_t *samples, size_t n, int pct) {
+    if (n == 0) {
+        return 0;
+    }
+    // kleinster Rang k mit k >= pct/100 * n
+    size_t rank = (n * (size_t)pct + 99) / 100;
+    rank = rank ? rank - 1 : 0;
+    std::nth_element(samples, samples + rank, samples + n);
+    return samples[rank];
+}
+
+const char *name(span_t id) {
+    return id < SPAN_COUNT ? NAMES[id] : "?";
+}
+
+void init() {
+    s_ticks_per_us = std::max<uint32_t>(1, esp_rom_get_cpu_ticks_per_us());
+    s_cycles_trusted_us = ((int64_t)1 << 31) / s_ticks_per_us;
+    // wie Span: zwei Zeitquellen lesen, umrechnen, in Ring und Summe ablegen
+    SampleRing<16> ring;
+    RunningTotal total;
+    const uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < 256; ++i) {
+        const int64_t t_us = esp_timer_get_time();
+        const uint32_t t = esp_cpu_get_cycle_count();
+        const uint32_t us = span_us(esp_cpu_get_cycle_count() - t, esp_timer_get_time() - t_us);
+        ring.push(us);
+        total.add(us);
+    }
+    s_span_cost = (esp_cpu_get_cycle_count() - start) / 256;
+}
+
+uint32_t span_us(uint32_t cycles, int64_t elapsed_us) {
+    if (elapsed_us < s_cycles_trusted_us) {
+        return cycles / s_ticks_per_us;
+    }
+    return (uint32_t)std::min<int64_t>(elapsed_us, UINT32_MAX);
+}
+
+void record(span_t id, uint32_t us) {
+    s_rings[id].push(us);
+    s_totals_us[id].add(us);
+}
+
+bool summarize(span_t id, summary_t &out) {
+    out = {};
+    const SampleRing<WINDOW> &ring = s_rings[id];
+    out.count = ring.total();
+    if (!out.count) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(s_scratch_lock);
+    const size_t n = ring.copy(s_scratch);
+    out.window = (uint32_t)n;
+    out.max_us = *std::max_element(s_scratch, s_scratch + n);
+    out.p95_us = percentile(s_scratch, n, 95);
+    out.p50_us = percentile(s_scratch, n, 50);
+    out.total_us = s_totals_us[id].load();
+    return true;
+}
+
+void log_report() {
+    uint64_t spans = 0;
+    for (int id = 0; id < SPAN_COUNT; ++id) {
+        summary_t s;
+        if (!summarize((span_t)id, s)) {
+            continue;
+        }
+        spans += s.count;
+        ESP_LOGI(TAG, "%-10s p50 %6lu us, p95 %6lu us, max %6lu us (last %lu of %lu), %llu ms total", NAMES[id],
+                 (unsigned long)s.p50_us, (unsigned long)s.p95_us, (unsigned long)s.max_us, (unsigned long)s.window,
+                 (unsigned long)s.count, (unsigned long long)(s.total_us / 1000));
+    }
+    const int64_t uptime_us = esp_timer_get_time();
+    if (spans && uptime_us > 0) {
+        const double cost_us = (double)spans * s_span_cost / s_ticks_per_us;
+        ESP_LOGI(TAG, "%llu spans, ~%lu cycles each, %.3f%% of uptime", (unsigned long long)spans,
+                 (unsigned long)s_span_cost, 100.0 * cost_us / (double)uptime_us);
+    }
+}
+
+bool write_csv(storage::Backend &fs, const char *path) {
+    FILE *f = fs.open(path, "a");
+    if (!f) {
+        ESP_LOGE(TAG, "Could not open %s", path);
+        return false;
+    }
+    bool ok = true;
+    if (fseek(f, 0, SEEK_END) == 0 && ftell(f) == 0) {
+        ok = fputs("uptime_ms,span,count,window,p50_us,p95_us,max_us,total_ms\n", f) >= 0;
+    }
+    const long long uptime_ms = esp_timer_get_time() / 1000;
+    for (int id = 0; id < SPAN_COUNT && ok; ++id) {
+        summary_t s;
+        if (summarize((span_t)id, s)) {
+            ok = fprintf(f, "%lld,%s,%lu,%lu,%lu,%lu,%lu,%llu\n", uptime_ms, NAMES[id], (unsigned long)s.count,
+                         (unsigned long)s.window, (unsigned long)s.p50_us, (unsigned long)s.p95_us,
+                         (unsigned long)s.max_us, (unsigned long long)(s.total_us / 1000)) > 0;
+        }
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        ESP_LOGE(TAG, "Could not write %s", path);
+    }
+    return ok;
+}
+
+} // namespace profiler
@@ -0,0 +1,161 @@
+#include "storage_sdspi.hpp"
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+#include "driver/sdspi_host.h"
+#include "driver/gpio.h"
+#include "ff.h" // Für FATFS Zeitstempel
+
+#include "include/sd_pins.h"  // the board-specific SD + SPI pins
+#include "sd_card.hpp"        // ALLOCATION_UNIT_SIZE
+
+namespace storage {
+
+static const char *TAG = "SDCARD";
+static constexpr spi_host_device_t SPI_HOST_ID = SPI3_HOST;
+
+// --------- Internal helpers ----------------------------------
+
+static void init_sd_enable_pin(void) {
+    gpio_config_t io_conf = {};
+    io_conf.pin_bit_mask = (1ULL << SD_ENABLE);
+    io_conf.mode         = GPIO_MODE_OUTPUT;
+    io_conf.pull_up_en   = GPIO_PULLUP_DISABLE;
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.intr_type    = GPIO_INTR_DISABLE;
+    gpio_config(&io_conf);
+
+    // Active level depends on hardware
+    gpio_set_level(SD_ENABLE, 0);
+}
+
+// --------- Public API ----------------------------------
+
+bool SdspiBackend::mount() {
+    if (m_mounted) {
+        return true;
+    }
+
+    init_sd_enable_pin();
+    esp_err_t ret;
+
+    // Options for mounting the filesystem.
+    // If format_if_mount_failed is set to true, SD card will be partitioned and
+    // formatted in case when mounting fails.
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+        .format_if_mount_failed = false,
+        .max_files = 5,
+        .allocation_unit_size = sdcard::ALLOCATION_UNIT_SIZE,
+        .disk_status_check_enable = false,
+        .use_one_fat = false
+    };
+
+    ESP_LOGI(TAG, "Initializing SD card over SPI");
+
+    // By default, SD card frequency is initialized to SDMMC_FREQ_DEFAULT (20MHz)
+    // For setting a specific frequency, use host.max_freq_khz (range 400kHz - 20MHz for SDSPI)
+    // Example: for fixed frequency of 10MHz, use host.max_freq_khz = 10000;
+    // host.'slot' should be set to an sdspi device initialized by `sdspi_host_init_device()`.
+    // SDSPI_HOST_DEFAULT: https://github.com/espressif/esp-idf/blob/1bbf04cb4cf54d74c1fe21ed12dbf91eb7fb1019/components/esp_driver_sdspi/include/driver/sdspi_host.h#L44
+    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+    host.max_freq_khz = 5000;
+
+    host.slot = SPI_HOST_ID;
+
+    spi_bus_config_t bus_cfg = {};
+    bus_cfg.mosi_io_num      = PIN_NUM_MOSI;
+    bus_cfg.miso_io_num      = PIN_NUM_MISO;
+    bus_cfg.sclk_io_num      = PIN_NUM_CLK;
+    bus_cfg.quadwp_io_num    = -1;
+    bus_cfg.quadhd_io_num    = -1;
+    bus_cfg.max_transfer_sz  = 4000;
+
+    ESP_LOGI(TAG, "Initializing SPI bus");
+    ret = spi_bus_initialize(SPI_HOST_ID, &bus_cfg, SDSPI_DEFAULT_DMA);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize SPI bus: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    // card select output ?
+    gpio_reset_pin(PIN_NUM_CS);
+    gpio_set_direction(PIN_NUM_CS, GPIO_MODE_OUTPUT);
+    gpio_set_level(PIN_NUM_CS, 1); // inactive
+
+    // This initializes the slot without card detect (CD) and write protect (WP) signals.
+    // Modify slot_config.gpio_cd and slot_config.gpio_wp if your board has these signals.
+    // sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
+    sdspi_device_config_t slot_config = {};
+    slot_config.host_id      = SPI_HOST_ID;
+    slot_config.gpio_cs      = PIN_NUM_CS;
+    slot_config.gpio_cd      = SD_SW;
+    slot_config.gpio_wp      = SDSPI_SLOT_NO_WP;
+    slot_config.gpio_int     = GPIO_NUM_NC;
+    slot_config.gpio_wp_polarity = SDSPI_IO_ACTIVE_LOW;
+    //slot_config.duty_cycle_pos = 0;
+
+    // spi_host_device_t host_id; ///< SPI host to use, SPIx_HOST (see spi_types.h)
+    ESP_LOGI(TAG, "Mounting FAT filesystem at %s", MOUNT_POINT);
+    // gpio_set_level(SD_ENABLE, 1);
+    ret = esp_vfs_fat_sdspi_mount(MOUNT_POINT, &host, &slot_config, &mount_config, &m_card);
+
+    if (ret != ESP_OK) {
+        if (ret == ESP_FAIL) {
+            ESP_LOGE("SD", "Failed to mount filesystem (ret == ESP_FAIL). Look into esp_vfs_fat_sdspi_mount() "
+                           "If you want the card to be formatted, set the CONFIG_EXAMPLE_FORMAT_IF_MOUNT_FAILED menuconfig option.");
+        } else {
+            ESP_LOGE("SD", "Failed to initialize the card (%s). Look into esp_vfs_fat_sdspi_mount() "
+                           "Make sure SD card lines have pull-up resistors in place.",
+                     esp_err_to_name(ret));
+            }
+        return false;
+    }
+
+    // Card has been initialized, print its properties
+    sdmmc_card_print_info(stdout, m_card);
+    m_mounted = true;
+    ESP_LOGI(TAG, "SD card mounted successfully");
+    return true;
+}
+
+void SdspiBackend::unmount() {
+    if (!m_mounted) {
+        return;
+    }
+    esp_vfs_fat_sdcard_unmount(MOUNT_POINT, m_card);
+    spi_bus_free(SPI_HOST_ID);
+    m_card = nullptr;
+    m_mounted = false;
+}
+
+bool SdspiBackend::free_space(space_t &space) {
+    space = {};
+    return m_mounted && esp_vfs_fat_info(MOUNT_POINT, &space.total, &space.free) == ESP_OK;
+}
+
+bool SdspiBackend::preallocate(const char *path, uint32_t size) {
+    esp_err_t err = esp_vfs_fat_create_contiguous_file(MOUNT_POINT, path, size, true);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "No contiguous preallocation for %s (%s)", path, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+bool SdspiBackend::set_file_time(const char *path, const struct tm &time) {
+    // Nur möglich, wenn FF_USE_CHMOD und FF_FS_NORTC == 0 in FATFS Konfiguration
+    FILINFO finfo = {0};
+    finfo.fdate = ((time.tm_year - 80) << 9) | ((time.tm_mon + 1) << 5) | time.tm_mday;
+    finfo.ftime = (time.tm_hour << 11) | (time.tm_min << 5) | (time.tm_sec / 2);
+#ifdef f_utime
+    return f_utime(path, &finfo) == 0;
+#else
+    (void)path;
+    (void)finfo;
+    return false;
+#endif
+}
+
+} // namespace storage
@@ -0,0 +1,77 @@
+#include "thumbnail.hpp"
+
+#include <algorithm>
+
+namespace thumbs {
+
+// --------- Internal helpers ----------------------------------
+
+// Quellposition und Gewicht (16.16) für jede Zielspalte bzw. -zeile, Pixelmitten aufeinander abgebildet
+static void sample_positions(int start, int length, int limit, int size, int *index, uint32_t *frac) {
+    const int64_t step = ((int64_t)length << 16) / size;
+    int64_t pos = step / 2 - (1 << 15) + ((int64_t)start << 16);
+    for (int i = 0; i < size; ++i, pos += step) {
+        int64_t p = std::max<int64_t>(pos, 0);
+        int idx = (int)(p >> 16);
+        if (idx >= limit - 1) {
+            index[i] = limit - 2 >= 0 ? limit - 2 : 0;
+            frac[i] = limit > 1 ? 1 << 16 : 0;
+        } else {
+            index[i] = idx;
+            frac[i] = (uint32_t)(p & 0xFFFF);
+        }
+    }
+}
+
+// --------- Public API ----------------------------------
+
+rect_t square_crop(int x1, int y1, int x2, int y2, int img_width, int img_height, float padding, int min_side) {
+    const int w = std::max(x2 - x1, 1);
+    const int h = std::max(y2 - y1, 1);
+    int side = std::max(w, h);
+    side += 2 * (int)(side * padding + 0.5f);
+    side = std::min(std::max(side, min_side), std::min(img_width, img_height));
+
+    const int cx = (x1 + x2) / 2;
+    const int cy = (y1 + y2) / 2;
+    rect_t r;
+    r.x1 = std::min(std::max(cx - side / 2, 0), img_width - side);
+    r.y1 = std::min(std::max(cy - side / 2, 0), img_height - side);
+    r.x2 = r.x1 + side;
+    r.y2 = r.y1 + side;
+    return r;
+}
+
+bool resize_rgb888(const uint8_t *src, int src_width, int src_height, const rect_t &crop, uint8_t *dst, int size) {
+    if (!src || !dst || size <= 0 || size > MAX_SIZE || crop.x1 < 0 || crop.y1 < 0 || crop.x2 > src_width ||
+        crop.y2 > src_height || crop.x2 <= crop.x1 || crop.y2 <= crop.y1) {
+        return false;
+    }
+
+    int xs[MAX_SIZE], ys[MAX_SIZE];
+    uint32_t xf[MAX_SIZE], yf[MAX_SIZE];
+    sample_positions(crop.x1, crop.x2 - crop.x1, src_width, size, xs, xf);
+    sample_positions(crop.y1, crop.y2 - crop.y1, src_height, size, ys, yf);
+
+    const int stride = src_width * 3;
+    for (int y = 0; y < size; ++y) {
+        const uint8_t *row0 = src + ys[y] * stride;
+        const uint8_t *row1 = src_height > 1 ? row0 + stride : row0;
+        const uint32_t fy = yf[y];
+        for (int x = 0; x < size; ++x) {
+            const int o0 = xs[x] * 3;
+            const int o1 = src_width > 1 ? o0 + 3 : o0;
+            const uint32_t fx = xf[x];
+            for (int c = 0; c < 3; ++c) {
+                // Zuerst horizontal (8.16), dann vertikal, gerundet
+                const uint32_t top = row0[o0 + c] * (65536 - fx) + row0[o1 + c] * fx;
+                const uint32_t bottom = row1[o0 + c] * (65536 - fx) + row1[o1 + c] * fx;
+                const uint64_t v = (uint64_t)top * (65536 - fy) + (uint64_t)bottom * fy;
+                *dst++ = (uint8_t)((v + (1ull << 31)) >> 32);
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace thumbs
@@ -0,0 +1,93 @@
+#include "tiling.hpp"
+
+#include <algorithm>
+
+namespace tiling {
+
+// --------- Internal helpers ----------------------------------
+
+// Kachelpositionen entlang einer Achse, gibt die Anzahl zurück
+static int axis_positions(int length, int tile, int min_overlap, int *pos, int max_count) {
+    if (length <= tile) {
+        pos[0] = 0;
+        return 1;
+    }
+    const int advance = tile - min_overlap;
+    if (advance <= 0) {
+        return 0;
+    }
+    const int n = 1 + (length - tile + advance - 1) / advance;
+    if (n > max_count) {
+        return 0;
+    }
+    for (int i = 0; i < n; ++i) {
+        pos[i] = (i * (length - tile) + (n - 1) / 2) / (n - 1);
+    }
+    return n;
+}
+
+static int area(const int *b) {
+    return std::max(0, b[2] - b[0]) * std::max(0, b[3] - b[1]);
+}
+
+static int intersection(const int *a, const int *b) {
+    const int w = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+    const int h = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+    return (w > 0 && h > 0) ? w * h : 0;
+}
+
+// --------- Public API ----------------------------------
+
+bool make_layout(int frame_width, int frame_height, int tile_size, int min_overlap, layout_t &layout) {
+    int xs[MAX_TILES];
+    int ys[MAX_TILES];
+    layout = {};
+    layout.tile_size = tile_size;
+    layout.cols = axis_positions(frame_width, tile_size, min_overlap, xs, MAX_TILES);
+    layout.rows = axis_positions(frame_height, tile_size, min_overlap, ys, MAX_TILES);
+    if (!layout.cols || !layout.rows || layout.cols * layout.rows > MAX_TILES) {
+        return false;
+    }
+    for (int r = 0; r < layout.rows; ++r) {
+        for (int c = 0; c < layout.cols; ++c) {
+            layout.tiles[layout.count++] = {xs[c], ys[r]};
+        }
+    }
+    return true;
+}
+
+int merge_boxes(tile_box_t *boxes, int count, float iou_thr, float ios_thr) {
+    std::sort(boxes, boxes + count, [](const tile_box_t &a, const tile_box_t &b) { return a.score > b.score; });
+
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        tile_box_t &cand = boxes[i];
+        bool suppressed = false;
+        for (int k = 0; k < kept && !suppressed; ++k) {
+            tile_box_t &keep = boxes[k];
+            const int inter = intersection(keep.box, cand.box);
+            if (!inter) {
+                continue;
+            }
+            const int a_keep = area(keep.box);
+            const int a_cand = area(cand.box);
+            const float iou = static_cast<float>(inter) / (a_keep + a_cand - inter);
+            const float ios = static_cast<float>(inter) / std::max(1, std::min(a_keep, a_cand));
+            if (iou > iou_thr) {
+                suppressed = true;
+            } else if (keep.tile != cand.tile && ios > ios_thr) {
+                keep.box[0] = std::min(keep.box[0], cand.box[0]);
+                keep.box[1] = std::min(keep.box[1], cand.box[1]);
+                keep.box[2] = std::max(keep.box[2], cand.box[2]);
+                keep.box[3] = std::max(keep.box[3], cand.box[3]);
+                suppressed = true;
+            }
+        }
+        if (!suppressed) {
+            boxes[kept++] = cand;
+        }
+    }
+    return kept;
+}
+
+} // namespace tiling
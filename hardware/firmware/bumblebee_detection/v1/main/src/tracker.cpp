@@ -0,0 +1,188 @@
+#include "tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tracking {
+
+// --------- Internal helpers ----------------------------------
+
+static float iou(const box_t &a, const box_t &b) {
+    float iw = std::min(a.x2, b.x2) - std::max(a.x1, b.x1);
+    float ih = std::min(a.y2, b.y2) - std::max(a.y1, b.y1);
+    if (iw <= 0 || ih <= 0) {
+        return 0.0f;
+    }
+    float inter = iw * ih;
+    float uni = (a.x2 - a.x1) * (a.y2 - a.y1) + (b.x2 - b.x1) * (b.y2 - b.y1) - inter;
+    return uni > 0 ? inter / uni : 0.0f;
+}
+
+// Frisch angelegte Tracks haben noch keine Geschwindigkeit; eine Hummel ist bei
+// 1-2 Inferenzen pro Sekunde meist weiter geflogen als ihre eigene Boxgröße.
+// Solange wird statt IoU die Nähe im Suchradius max_speed * dt bewertet, abgebildet
+// auf [iou_threshold, (1 + iou_threshold) / 2], damit echte Überlappung Vorrang hat.
+float Tracker::affinity(const track_t &track, const box_t &predicted, const box_t &det, int64_t t_us) const {
+    float a = iou(predicted, det);
+    if (track.hits >= 2) {
+        return a;
+    }
+    const float dx = (det.x1 + det.x2) * 0.5f - track.cx;
+    const float dy = (det.y1 + det.y2) * 0.5f - track.cy;
+    const float radius = m_cfg.max_speed * (t_us - track.last_us) * 1e-6f + std::max(track.w, track.h) * 0.5f;
+    const float dist = std::sqrt(dx * dx + dy * dy);
+    if (radius > 0 && dist < radius) {
+        a = std::max(a, m_cfg.iou_threshold + (1.0f - m_cfg.iou_threshold) * 0.5f * (1.0f - dist / radius));
+    }
+    return a;
+}
+
+int8_t Tracker::side_of(float cx, float cy, int8_t previous) const {
+    const float dx = m_cfg.line[2] - m_cfg.line[0];
+    const float dy = m_cfg.line[3] - m_cfg.line[1];
+    const float len = std::sqrt(dx * dx + dy * dy);
+    if (len <= 0) {
+        return 0;
+    }
+    // Vorzeichenbehafteter Abstand zur Geraden, innerhalb der Hysterese bleibt die alte Seite
+    float dist = (dx * (cy - m_cfg.line[1]) - dy * (cx - m_cfg.line[0])) / len;
+    if (std::fabs(dist) < m_cfg.line_hysteresis) {
+        return previous;
+    }
+    return dist > 0 ? 1 : -1;
+}
+
+void Tracker::assign(track_t &track, const detection_t &det, int64_t t_us) {
+    const float cx = (det.box.x1 + det.box.x2) * 0.5f;
+    const float cy = (det.box.y1 + det.box.y2) * 0.5f;
+    const float dt = (t_us - track.last_us) * 1e-6f;
+    if (dt > 0) {
+        const float mvx = (cx - track.cx) / dt;
+        const float mvy = (cy - track.cy) / dt;
+        // Zweite Zuordnung: erste Geschwindigkeitsmessung direkt übernehmen
+        const float gain = track.hits == 1 ? 1.0f : m_cfg.velocity_gain;
+        track.vx += gain * (mvx - track.vx);
+        track.vy += gain * (mvy - track.vy);
+    }
+    track.cx = cx;
+    track.cy = cy;
+    track.w = det.box.x2 - det.box.x1;
+    track.h = det.box.y2 - det.box.y1;
+    track.last_us = t_us;
+    track.score = det.score;
+    track.hits++;
+    if (!track.confirmed && track.hits >= m_cfg.min_hits) {
+        track.confirmed = true;
+        m_stats.tracks_confirmed++;
+    }
+
+    int8_t side = side_of(cx, cy, track.side);
+    if (track.confirmed && track.side != 0 && side != track.side && m_event_count < MAX_EVENTS) {
+        crossing_t &ev = m_events[m_event_count++];
+        ev.track_id = track.id;
+        ev.direction = side > 0 ? DIRECTION_IN : DIRECTION_OUT;
+        m_stats.crossings[ev.direction]++;
+    }
+    track.side = side;
+}
+
+// --------- Public API ----------------------------------
+
+tracker_config_t default_tracker_config(int frame_width, int frame_height) {
+    tracker_config_t cfg = {};
+    cfg.iou_threshold = 0.1f;
+    cfg.min_hits = 2;
+    cfg.max_coast_us = 6000000;
+    cfg.velocity_gain = 0.5f;
+    cfg.max_speed = 200.0f;
+    cfg.line[0] = 0;
+    cfg.line[1] = frame_height * 0.5f;
+    cfg.line[2] = static_cast<float>(frame_width);
+    cfg.line[3] = frame_height * 0.5f;
+    cfg.line_hysteresis = 8.0f;
+    return cfg;
+}
+
+void Tracker::init(const tracker_config_t &cfg) {
+    m_cfg = cfg;
+    m_count = 0;
+    m_next_id = 1;
+    m_event_count = 0;
+    m_stats = {};
+}
+
+box_t Tracker::predict(const track_t &track, int64_t t_us) {
+    const float dt = (t_us - track.last_us) * 1e-6f;
+    const float cx = track.cx + track.vx * dt;
+    const float cy = track.cy + track.vy * dt;
+    return {cx - track.w * 0.5f, cy - track.h * 0.5f, cx + track.w * 0.5f, cy + track.h * 0.5f};
+}
+
+int Tracker::update(const detection_t *dets, int count, int64_t t_us) {
+    count = std::min(count, MAX_DETECTIONS);
+    m_event_count = 0;
+    m_stats.updates++;
+
+    // Affinität jeder Detektion zu den auf t_us vorhergesagten Tracks
+    for (int t = 0; t < m_count; ++t) {
+        const box_t predicted = predict(m_tracks[t], t_us);
+        for (int d = 0; d < count; ++d) {
+            m_affinity[t][d] = affinity(m_tracks[t], predicted, dets[d].box, t_us);
+        }
+    }
+
+    // Greedy: jeweils das Paar mit der höchsten Affinität, bis keines mehr über der Schwelle liegt
+    bool track_used[MAX_TRACKS] = {};
+    bool det_used[MAX_DETECTIONS] = {};
+    while (true) {
+        int best_t = -1, best_d = -1;
+        float best = m_cfg.iou_threshold;
+        for (int t = 0; t < m_count; ++t) {
+            if (track_used[t]) {
+                continue;
+            }
+            for (int d = 0; d < count; ++d) {
+                if (!det_used[d] && m_affinity[t][d] >= best) {
+                    best = m_affinity[t][d];
+                    best_t = t;
+                    best_d = d;
+                }
+            }
+        }
+        if (best_t < 0) {
+            break;
+        }
+        track_used[best_t] = true;
+        det_used[best_d] = true;
+        assign(m_tracks[best_t], dets[best_d], t_us);
+    }
+
+    // Nicht zugeordnete Tracks laufen weiter, bis max_coast_us überschritten ist
+    int kept = 0;
+    for (int t = 0; t < m_count; ++t) {
+        if (track_used[t] || t_us - m_tracks[t].last_us <= m_cfg.max_coast_us) {
+            m_tracks[kept++] = m_tracks[t];
+        }
+    }
+    m_count = kept;
+
+    // Neue Tracks für übrige Detektionen
+    for (int d = 0; d < count; ++d) {
+        if (det_used[d]) {
+            continue;
+        }
+        if (m_count >= MAX_TRACKS) {
+            m_stats.dropped++;
+            continue;
+        }
+        track_t &track = m_tracks[m_count++];
+        track = {};
+        track.id = m_next_id++;
+        track.last_us = t_us;
+        assign(track, dets[d], t_us);
+        m_stats.tracks_created++;
+    }
+    return m_event_count;
+}
+
+} // namespace tracking
@@ -0,0 +1,206 @@
+#include "write_behind.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace writebehind {
+
+static constexpr uint32_t WRAP = 0xFFFFFFFF;  // Rest bis zum Ringende ist Lücke, Record beginnt bei 0
+static constexpr uint32_t PAD = 4;
+
+// --------- Internal helpers ----------------------------------
+
+static int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static uint32_t padded(uint32_t len) {
+    return (len + PAD - 1) & ~(PAD - 1);
+}
+
+// --------- SpscRing ----------------------------------
+
+bool SpscRing::init(void *mem, size_t size) {
+    if (!mem || ((uintptr_t)mem & (PAD - 1)) || size < 64) {
+        return false;
+    }
+    uint32_t pow2 = 64;
+    while ((size_t)pow2 * 2 <= size && pow2 < 0x80000000u) {
+        pow2 *= 2;
+    }
+    m_mem = static_cast<uint8_t *>(mem);
+    m_size = pow2;
+    m_head.store(0);
+    m_tail.store(0);
+    m_count.store(0);
+    m_stats = {};
+    return true;
+}
+
+bool SpscRing::push(const void *const *parts, const uint32_t *lens, int count) {
+    uint32_t len = 0;
+    for (int i = 0; i < count; ++i) {
+        len += lens[i];
+    }
+    if (!m_mem || len > max_record()) {
+        return false;
+    }
+
+    const uint32_t head = m_head.load(std::memory_order_relaxed);
+    const uint32_t tail = m_tail.load(std::memory_order_acquire);
+    const uint32_t pos = head & (m_size - 1);
+    const uint32_t contiguous = m_size - pos;
+    const uint32_t total = sizeof(uint32_t) + padded(len);
+    // Records liegen immer am Stück; passt der Rest bis zum Ende nicht, wird er übersprungen
+    const uint32_t need = total <= contiguous ? total : contiguous + total;
+    if (need > m_size - (head - tail)) {
+        return false;
+    }
+
+    uint8_t *p = m_mem + pos;
+    if (total > contiguous) {
+        memcpy(p, &WRAP, sizeof(WRAP));
+        p = m_mem;
+    }
+    memcpy(p, &len, sizeof(len));
+    p += sizeof(len);
+    for (int i = 0; i < count; ++i) {
+        memcpy(p, parts[i], lens[i]);
+        p += lens[i];
+    }
+
+    m_head.store(head + need, std::memory_order_release);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_stats.pushed++;
+    m_stats.bytes_in += len;
+    m_stats.max_used = std::max(m_stats.max_used, head + need - tail);
+    return true;
+}
+
+const uint8_t *SpscRing::peek(uint32_t &len) {
+    const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    const uint32_t head = m_head.load(std::memory_order_acquire);
+    if (!m_mem || head == tail) {
+        return nullptr;
+    }
+    uint32_t pos = tail & (m_size - 1);
+    uint32_t skip = 0;
+    memcpy(&len, m_mem + pos, sizeof(len));
+    if (len == WRAP) {
+        skip = m_size - pos;
+        pos = 0;
+        memcpy(&len, m_mem, sizeof(len));
+    }
+    m_peeked = skip + sizeof(uint32_t) + padded(len);
+    m_peeked_len = len;
+    return m_mem + pos + sizeof(uint32_t);
+}
+
+void SpscRing::pop() {
+    if (!m_peeked) {
+        return;
+    }
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + m_peeked, std::memory_order_release);
+    m_count.fetch_sub(1, std::memory_order_relaxed);
+    m_peeked = 0;
+    m_stats.popped++;
+    m_stats.bytes_out += m_peeked_len;
+}
+
+size_t SpscRing::used() const {
+    return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+}
+
+uint32_t SpscRing::records() const {
+    return m_count.load(std::memory_order_relaxed);
+}
+
+// --------- BatchFile ----------------------------------
+
+bool BatchFile::attach(FILE *f, uint32_t offset, uint8_t *buf, uint32_t size, uint32_t unit,
+                       storage::Backend *fs) {
+    if (!f || !buf || unit == 0 || size < unit || size % unit != 0) {
+        return false;
+    }
+    m_file = f;
+    m_fs = fs ? fs : &storage::default_backend();
+    m_buf = buf;
+    m_size = size;
+    m_unit = unit;
+    m_base = offset - offset % unit;
+    m_fill = offset - m_base;
+    m_synced = m_fill;
+    m_stats = {};
+    // Anfang des angebrochenen Blocks steht schon in der Datei
+    if (m_fill && (fseek(f, m_base, SEEK_SET) != 0 || fread(m_buf, 1, m_fill, f) != m_fill)) {
+        m_file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool BatchFile::write_out(uint32_t len) {
+    const int64_t start = now_us();
+    bool ok = fseek(m_file, m_base, SEEK_SET) == 0 && fwrite(m_buf, 1, len, m_file) == len;
+    m_stats.max_write_us = std::max(m_stats.max_write_us, now_us() - start);
+    if (ok) {
+        m_stats.writes++;
+        m_stats.bytes += len;
+        m_stats.rewritten += m_synced;
+    }
+    return ok;
+}
+
+bool BatchFile::write(const void *data, uint32_t len) {
+    if (!m_file) {
+        return false;
+    }
+    const uint8_t *src = static_cast<const uint8_t *>(data);
+    while (len) {
+        const uint32_t n = std::min(len, m_size - m_fill);
+        memcpy(m_buf + m_fill, src, n);
+        m_fill += n;
+        src += n;
+        len -= n;
+        if (m_fill == m_size) {
+            if (!write_out(m_size)) {
+                m_fill -= n;
+                return false;
+            }
+            m_base += m_size;
+            m_fill = 0;
+            m_synced = 0;
+        }
+    }
+    return true;
+}
+
+bool BatchFile::sync() {
+    if (!m_file) {
+        return false;
+    }
+    if (m_fill > m_synced && !write_out(m_fill)) {
+        return false;
+    }
+    const int64_t start = now_us();
+    bool ok = m_fs->sync(m_file);
+    m_stats.max_write_us = std::max(m_stats.max_write_us, now_us() - start);
+    if (!ok) {
+        return false;
+    }
+    m_stats.syncs++;
+    // Vollständige Blöcke sind erledigt, nur der angebrochene bleibt für das nächste Schreiben
+    const uint32_t keep = m_fill % m_unit;
+    if (m_fill != keep) {
+        memmove(m_buf, m_buf + m_fill - keep, keep);
+        m_base += m_fill - keep;
+        m_fill = keep;
+    }
+    m_synced = m_fill;
+    return true;
+}
+
+} // namespace writebehind
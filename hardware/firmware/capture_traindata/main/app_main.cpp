@@ -2,11 +2,18 @@
 #include "esp_imgfx_crop.h"
 #include "dl_image.hpp"
 #define MODEL_IMG_SIZE 224
+#define JPEG_QUALITY 80
 #include <stdio.h>
 #include <algorithm>
 #include "esp_camera.h"
 #include "esp_log.h"
 #include "sd_card.hpp"
+#include "motion_gate.hpp"
+#include "capture_scheduler.hpp"
+#include "jpeg_encoder.hpp"
+#include "rgb565_roi.hpp"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include <esp_system.h>
 #include <string.h>
 #include <vector>
@@ -15,7 +22,6 @@
 #include "freertos/task.h"
 #include "include/camera_pins.h"
 #include "dl_image_draw.hpp"
-#include "dl_image_color.hpp"
 
 // Camera Module pin mapping
 static camera_config_t camera_config = {
@@ -63,70 +69,55 @@ static esp_err_t init_camera(void)
     return err;
 }
 
-// Hilfsfunktion: Bild aufnehmen, croppen und in RGB888 konvertieren
-static bool capture_and_convert_image(dl::image::img_t &cropped_img) {
+static motion::MotionGate s_gate;
+static scheduler::CaptureScheduler s_scheduler;
+static jpegenc::Encoder s_encoder;
+static uint8_t *s_rgb888 = nullptr;  // nur 4:4:4: RGB888-Ausschnitt, einmal angelegt
+
+// 4:4:4 braucht die volle Chroma und geht über RGB888; 4:2:2 und 4:2:0 kodieren den
+// Ausschnitt über YCbYCr direkt aus dem Framebuffer
+static jpegenc::encoder_config_t encoder_config() {
+#if CONFIG_TRAINDATA_JPEG_SUBSAMPLE_420
+    return {MODEL_IMG_SIZE, MODEL_IMG_SIZE, jpegenc::INPUT_RGB565_BE, JPEG_SUBSAMPLE_420, JPEG_QUALITY};
+#elif CONFIG_TRAINDATA_JPEG_SUBSAMPLE_422
+    return {MODEL_IMG_SIZE, MODEL_IMG_SIZE, jpegenc::INPUT_RGB565_BE, JPEG_SUBSAMPLE_422, JPEG_QUALITY};
+#else
+    return {MODEL_IMG_SIZE, MODEL_IMG_SIZE, jpegenc::INPUT_RGB888, JPEG_SUBSAMPLE_444, JPEG_QUALITY};
+#endif
+}
+
+static bool encode_crop(const camera_fb_t *pic, int x0, int y0, dl::image::jpeg_img_t &jpeg) {
+    if (s_encoder.config().input == jpegenc::INPUT_RGB888) {
+        return imgconv::rgb565_roi_to_rgb888(pic->buf, pic->width, pic->height, x0, y0, MODEL_IMG_SIZE,
+                                             MODEL_IMG_SIZE, s_rgb888) &&
+               s_encoder.encode(s_rgb888, jpeg);
+    }
+    return s_encoder.encode_roi(pic->buf, pic->width, pic->height, x0, y0, jpeg);
+}
+
+// Hilfsfunktion: Bild aufnehmen und den 224x224 Ausschnitt kodieren, Subsampling nach
+// CONFIG_TRAINDATA_JPEG_SUBSAMPLING. jpeg zeigt in den Puffer des Encoders.
+// motion: Bewegungsfilter hat im Ausschnitt angeschlagen (steuert nur das Aufnahmeintervall).
+static bool capture_and_encode_image(dl::image::jpeg_img_t &jpeg, bool &motion) {
     camera_fb_t *pic = esp_camera_fb_get();
     if (!pic) {
         ESP_LOGE("CAM", "Failed to capture image");
         return false;
     }
-    dl::image::img_t img;
-    img.height = pic->height;
-    img.width = pic->width;
-    img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565;
-    img.data = malloc(pic->len);
-    if (!img.data) {
-        ESP_LOGE("MEM", "Memory allocation failed");
-        esp_camera_fb_return(pic);
-        return false;
-    }
-
-    memcpy(img.data, pic->buf, pic->len);
-    esp_camera_fb_return(pic);
 
-    // RGB565 -> RGB888 (ohne Crop)
-    dl::image::img_t rgb888_img;
-    rgb888_img.height = img.height;
-    rgb888_img.width = img.width;
-    rgb888_img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB888;
-    rgb888_img.data = malloc(img.width * img.height * 3);
-    if (!rgb888_img.data) {
-        ESP_LOGE("MEM", "Failed to allocate rgb888 buffer");
-        free(img.data);
-        return false;
-    }
-    dl::image::RGB5652RGB888<true, false> converter;
-    uint8_t* src = (uint8_t*)img.data;
-    uint8_t* dst = (uint8_t*)rgb888_img.data;
-    for (int i = 0; i < img.width * img.height; ++i) {
-        converter(src, dst);
-        src += 2;
-        dst += 3;
+    int x0 = (pic->width - MODEL_IMG_SIZE) / 2;
+    int y0 = (pic->height - MODEL_IMG_SIZE) / 2;
+    bool ok = encode_crop(pic, x0, y0, jpeg);
+    if (ok) {
+        motion = s_gate.update(pic->buf, pic->width, x0, y0) == motion::DECISION_MOTION;
     }
-
-    // Crop auf 224x224
-    cropped_img.height = MODEL_IMG_SIZE;
-    cropped_img.width = MODEL_IMG_SIZE;
-    cropped_img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB888;
-    cropped_img.data = malloc(MODEL_IMG_SIZE * MODEL_IMG_SIZE * 3);
-    if (!cropped_img.data) {
-        ESP_LOGE("MEM", "Failed to allocate cropped buffer");
-        free(img.data);
-        free(rgb888_img.data);
+    esp_camera_fb_return(pic);
+    if (!ok) {
+        ESP_LOGE("CAM", "Could not encode %dx%d crop", MODEL_IMG_SIZE, MODEL_IMG_SIZE);
         return false;
     }
-    int x0 = (rgb888_img.width - MODEL_IMG_SIZE) / 2;
-    int y0 = (rgb888_img.height - MODEL_IMG_SIZE) / 2;
-    for (int y = 0; y < MODEL_IMG_SIZE; ++y) {
-        int src_y = y0 + y;
-        memcpy(
-            (uint8_t*)cropped_img.data + y * MODEL_IMG_SIZE * 3,
-            (uint8_t*)rgb888_img.data + (src_y * rgb888_img.width + x0) * 3,
-            MODEL_IMG_SIZE * 3);
-    }
-
-    free(img.data);
-    free(rgb888_img.data);
+    const jpegenc::encode_stats_t &es = s_encoder.stats();
+    ESP_LOGI("JPEG", "%lu bytes in %lu us", (unsigned long)es.last_bytes, (unsigned long)es.last_us);
     return true;
 }
 
@@ -143,23 +134,62 @@ extern "C" void app_main(void)
         ESP_LOGE("APP", "Camera initialization failed");
         return;
     }
-    
+
+    if (imgconv::enable_pie_kernel()) {
+        ESP_LOGI("APP", "ROI conversion uses the PIE kernel");
+    } else {
+#if CONFIG_IDF_TARGET_ESP32S3
+        ESP_LOGW("APP", "PIE kernel differs from the reference, ROI conversion stays word-wise");
+#endif
+    }
+
+    s_gate.init(motion::default_gate_config(), MODEL_IMG_SIZE, MODEL_IMG_SIZE);
+    scheduler::scheduler_config_t sched_cfg = scheduler::default_scheduler_config();
+    sched_cfg.ceiling_ms = 1000;  // Trainingsdaten: mindestens der frühere feste 1-s-Takt
+    s_scheduler.init(sched_cfg);
+    const jpegenc::encoder_config_t enc_cfg = encoder_config();
+    if (enc_cfg.input == jpegenc::INPUT_RGB888) {
+        s_rgb888 = (uint8_t *)heap_caps_malloc((size_t)MODEL_IMG_SIZE * MODEL_IMG_SIZE * 3, MALLOC_CAP_SPIRAM);
+        if (!s_rgb888) {
+            ESP_LOGE("APP", "Could not allocate RGB888 crop buffer");
+            return;
+        }
+    }
+    if (!s_encoder.open(enc_cfg)) {
+        ESP_LOGE("APP", "JPEG encoder initialization failed");
+        return;
+    }
+
     while (true) {
         ESP_LOGI("MEM", "Free heap at start of loop: %lu bytes", esp_get_free_heap_size());
+        int64_t start_us = esp_timer_get_time();
 
-        dl::image::img_t cropped_img;
-        if (!capture_and_convert_image(cropped_img)) {
-            ESP_LOGE("CAM", "Could not take or convert picture");
+        dl::image::jpeg_img_t jpeg;
+        bool motion = false;
+        if (!capture_and_encode_image(jpeg, motion)) {
+            ESP_LOGE("CAM", "Could not take or encode picture");
             vTaskDelay(pdMS_TO_TICKS(1000));
             continue;
         }
 
         // Nur das gecroppte Bild speichern
-        dl::cls::result_t dummy_result = {};
-        sdcard::save_jpeg(cropped_img, dummy_result, "/sdcard/bumblebee_traindata");
-        heap_caps_free(cropped_img.data);
+        sdcard::write_jpeg(jpeg, "/sdcard/bumblebee_traindata");
+
+        // Ohne Detektor zählt Bewegung als Aktivität: bei Anflug sofort auf die Höchstrate
+        scheduler::observation_t obs = {};
+        obs.t_us = esp_timer_get_time();
+        obs.detections = motion ? 1 : 0;
+        obs.motion = motion;
+        obs.pipeline_us = (uint32_t)(obs.t_us - start_us);
+        uint32_t previous_ms = s_scheduler.interval_ms();
+        scheduler::decision_t decision = s_scheduler.update(obs);
+        if (decision.interval_ms != previous_ms) {
+            char line[64];
+            scheduler::CaptureScheduler::format(line, sizeof(line), obs, decision);
+            ESP_LOGI("SCHED", "%s", line);
+        }
 
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        vTaskDelay(pdMS_TO_TICKS(decision.interval_ms));
     }
 
 }
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace scheduler {
+
+struct scheduler_config_t {
+    uint32_t floor_ms;        // kürzestes Intervall, auch wenn die Pipeline schneller wäre
+    uint32_t ceiling_ms;      // längstes Intervall im Leerlauf (Nacht), Obergrenze des Backoffs
+    float backoff;            // Faktor pro ruhiger Entscheidung (> 1)
+    uint32_t hold_ms;         // nach der letzten Detektion so lange schnell bleiben
+    float headroom;           // Reserve auf die gemessene Pipeline-Latenz
+    float density_alpha;      // Glättung der Detektionsdichte (Detektionen pro Entscheidung)
+    float density_threshold;  // geglättete Dichte, ab der die Einflugschneise als belebt gilt
+};
+
+scheduler_config_t default_scheduler_config();
+
+// Beobachtung seit der letzten Entscheidung
+struct observation_t {
+    int64_t t_us;             // monotone Zeit
+    uint32_t detections;      // Boxen seit der letzten Entscheidung (0 ohne Detektor)
+    bool motion;              // Bewegungsfilter hat angeschlagen
+    uint32_t pipeline_us;     // Zeit der langsamsten Stufe pro Frame (0 = unbekannt)
+};
+
+enum reason_t {
+    REASON_ACTIVE = 0,        // Detektionen: maximal nachhaltige Rate
+    REASON_HOLD,              // kürzlich Detektionen, Rate halten
+    REASON_MOTION,            // nur Bewegung: Intervall halbieren
+    REASON_BACKOFF,           // Ruhe: Intervall exponentiell verlängern
+    REASON_COUNT
+};
+
+struct decision_t {
+    uint32_t interval_ms;
+    reason_t reason;
+    float density;
+    uint32_t sustainable_ms;  // aus der Pipeline-Latenz abgeleitetes Mindestintervall
+};
+
+struct scheduler_stats_t {
+    uint32_t decisions[REASON_COUNT];
+    uint32_t changes;         // Entscheidungen mit neuem Intervall
+};
+
+// Wählt das Aufnahmeintervall aus Detektionsdichte, Bewegung und Pipeline-Latenz.
+// Reine C++-Logik ohne Plattformabhängigkeit; die Zeit kommt über observation_t.
+class CaptureScheduler {
+public:
+    void init(const scheduler_config_t &cfg);
+
+    decision_t update(const observation_t &obs);
+    uint32_t interval_ms() const { return m_interval_ms; }
+    const scheduler_stats_t &stats() const { return m_stats; }
+
+    // Kompakte, wieder einlesbare Zeile: "S,<t_ms>,<interval_ms>,<reason>,<det>,<motion>,<pipe_ms>,<density>"
+    static int format(char *buf, size_t len, const observation_t &obs, const decision_t &d);
+
+private:
+    scheduler_config_t m_cfg = {};
+    uint32_t m_interval_ms = 0;
+    float m_density = 0.0f;
+    int64_t m_last_active_us = 0;
+    bool m_seen_activity = false;
+    scheduler_stats_t m_stats = {};
+};
+
+} // namespace scheduler
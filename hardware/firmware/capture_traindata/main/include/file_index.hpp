@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include "storage_backend.hpp"
+
+namespace fileindex {
+
+// Nummern, die pro Schreibzugriff auf die Indexdatei reserviert werden. Nach einem
+// Absturz gehen höchstens so viele Nummern verloren, doppelt vergeben wird keine.
+static constexpr uint32_t RESERVE_BLOCK = 64;
+
+struct index_stats_t {
+    uint32_t assigned;         // vergebene Pfade
+    uint32_t index_writes;     // Schreibzugriffe auf die Indexdatei
+    uint32_t shard_dirs;       // angelegte Stunden-Verzeichnisse
+    uint32_t scanned_files;    // Dateien im Wiederherstellungs-Scan (0 = Indexdatei war gültig)
+};
+
+// Fortlaufende Dateinummern ohne Verzeichnis-Scan pro Bild. Die nächste freie Nummer
+// steht in <root>/index.txt und wird nur beim Mount gelesen; fehlt die Datei oder ist
+// sie unlesbar, stellt ein einzelner Scan über alle Shards sie wieder her.
+// Ausgabe in Stunden-Shards <root>/<YYYYMMDD>/<HH>/<prefix>_<nummer>.jpg, damit kein
+// FAT-Verzeichnis unbegrenzt wächst. Dateizugriffe über storage::Backend (ohne Angabe
+// direkt stdio/POSIX), läuft auch auf dem Host.
+class FileIndex {
+public:
+    bool open(const char *root, const char *prefix, storage::Backend *fs = nullptr);
+    bool is_open() const { return m_open; }
+    const char *root() const { return m_root; }
+
+    // Pfad für die nächste Datei; legt den Shard für now bei Bedarf an
+    bool next_path(const struct tm &now, char *path, size_t len);
+
+    uint32_t next_sequence() const { return m_next; }
+    const index_stats_t &stats() const { return m_stats; }
+
+private:
+    bool persist(uint32_t reserved_until);
+    bool load();
+    uint32_t scan();
+    uint32_t scan_dir(const char *dir, int depth);
+    uint32_t scan_entry(const char *dir, int depth, const storage::dir_entry_t &entry);
+    bool ensure_shard(const struct tm &now);
+
+    storage::Backend *m_fs = nullptr;
+    bool m_open = false;
+    char m_root[64] = {};
+    char m_prefix[24] = {};
+    char m_shard[96] = {};
+    long m_shard_key = -1;     // YYYYMMDDHH des aktuellen Shards
+    uint32_t m_next = 1;
+    uint32_t m_reserved = 0;   // Nummern < m_reserved sind in der Indexdatei abgedeckt
+    index_stats_t m_stats = {};
+};
+
+} // namespace fileindex
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "dl_image_define.hpp"
+#include "esp_jpeg_enc.h"
+
+namespace jpegenc {
+
+enum input_t {
+    INPUT_RGB888 = 0,
+    INPUT_RGB565_BE,   // Kamera-Framebuffer; wird intern nach YCbYCr gewandelt
+    INPUT_YUYV,        // YCbYCr 4:2:2, z.B. PIXFORMAT_YUV422
+    INPUT_GRAY,
+};
+
+struct encoder_config_t {
+    int width;
+    int height;
+    input_t input;
+    jpeg_subsampling_t subsampling;  // RGB565/YUYV liefern höchstens 4:2:2 Chroma
+    uint8_t quality;                 // 1..100
+};
+
+struct encode_stats_t {
+    uint32_t images;
+    uint32_t failed;
+    uint32_t last_us;
+    uint32_t last_bytes;
+    int64_t total_us;
+    uint64_t total_bytes;
+    uint32_t max_us;
+    uint32_t max_bytes;
+    uint32_t opens;        // Encoder-Handles angelegt (ändert sich nur mit der Konfiguration)
+    uint32_t grown;        // eigener Ausgabepuffer musste vergrößert werden
+};
+
+// Langlebiger JPEG-Encoder (esp_new_jpeg) für eine Konfiguration aus Größe, Eingangsformat,
+// Subsampling und Qualität. Handle, Ausgabepuffer und bei RGB565 der YCbYCr-Zwischenpuffer
+// werden einmal angelegt und für jedes Bild wiederverwendet; open() mit gleicher
+// Konfiguration kostet nichts. Nicht threadsicher, ein Encoder pro Task.
+class Encoder {
+public:
+    ~Encoder();
+
+    bool open(const encoder_config_t &cfg);
+    void close();
+    bool is_open() const { return m_handle != nullptr; }
+    const encoder_config_t &config() const { return m_cfg; }
+
+    // Ganzes Bild im Eingangsformat der Konfiguration. Ohne outbuf schreibt der Encoder in
+    // seinen eigenen Puffer, jpeg.data bleibt bis zum nächsten encode() gültig.
+    bool encode(const uint8_t *data, uint8_t *outbuf, size_t outbuf_size, dl::image::jpeg_img_t &jpeg);
+    bool encode(const uint8_t *data, dl::image::jpeg_img_t &jpeg);
+    // Ausschnitt in Konfigurationsgröße direkt aus einem RGB565-Framebuffer (INPUT_RGB565_BE)
+    bool encode_roi(const uint8_t *frame, int frame_width, int frame_height, int x0, int y0,
+                    dl::image::jpeg_img_t &jpeg);
+
+    const encode_stats_t &stats() const { return m_stats; }
+    void log_stats() const;
+
+    // Ausgabepuffer, der für übliche Qualitäten reicht; bei Überlauf wächst der eigene Puffer
+    static size_t output_size(const encoder_config_t &cfg);
+
+private:
+    bool process(const uint8_t *in, size_t in_size, uint8_t *outbuf, size_t outbuf_size,
+                 dl::image::jpeg_img_t &jpeg);
+    bool grow_output();
+
+    jpeg_enc_handle_t m_handle = nullptr;
+    encoder_config_t m_cfg = {};
+    uint8_t *m_yuyv = nullptr;       // nur INPUT_RGB565_BE
+    uint8_t *m_out = nullptr;
+    size_t m_out_size = 0;
+    encode_stats_t m_stats = {};
+};
+
+} // namespace jpegenc
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+namespace imgconv {
+
+// Konvertiert einen Ausschnitt (ROI) eines RGB565-Bildes (big endian, wie vom
+// Kamera-Treiber geliefert) direkt nach RGB888. Es werden nur die Zeilen und
+// Spalten der ROI gelesen, dst muss roi_width * roi_height * 3 Bytes fassen.
+// Liefert false, wenn die ROI nicht vollständig im Quellbild liegt.
+bool rgb565_roi_to_rgb888(const uint8_t *src, int src_width, int src_height,
+                          int x0, int y0, int roi_width, int roi_height,
+                          uint8_t *dst);
+
+// Skalare Referenzimplementierung, bitgenau zu dl::image::RGB5652RGB888<true, false>.
+bool rgb565_roi_to_rgb888_ref(const uint8_t *src, int src_width, int src_height,
+                              int x0, int y0, int roi_width, int roi_height,
+                              uint8_t *dst);
+
+// Wie rgb565_roi_to_rgb888, aber immer über den PIE-Kern (rgb565_roi_esp32s3.S): je Zeile
+// skalar bis zur 16-Byte-Ausrichtung der Quelle, dann Blöcke zu 16 Pixeln, der Rest
+// wortweise. Auf anderen Zielen läuft statt des Kerns ein Modell seiner Anweisungen über
+// vier 32-bit Lanes, nur für Host-Tests und roi_bench, langsamer als der wortweise Pfad.
+bool rgb565_roi_to_rgb888_pie(const uint8_t *src, int src_width, int src_height,
+                              int x0, int y0, int roi_width, int roi_height,
+                              uint8_t *dst);
+
+// Vergleicht rgb565_roi_to_rgb888_pie auf einem Testmuster mit allen Ausrichtungen bitgenau
+// mit der Referenz.
+bool pie_kernel_matches_ref();
+
+// Einmal beim Start, bevor Tasks konvertieren: nur wenn der Kern die Prüfung besteht, nimmt
+// rgb565_roi_to_rgb888 ihn ab dann. Liefert, ob er aktiv ist; außer auf dem ESP32-S3 nie.
+bool enable_pie_kernel();
+
+// Wie oben, aber nach YCbYCr 4:2:2 (Y0 Cb Y1 Cr, JFIF-Vollbereich), 2 Byte pro Pixel.
+// Eingang für den JPEG-Encoder ohne RGB888-Zwischenbild; roi_width muss gerade sein.
+bool rgb565_roi_to_yuyv(const uint8_t *src, int src_width, int src_height,
+                        int x0, int y0, int roi_width, int roi_height,
+                        uint8_t *dst);
+
+} // namespace imgconv
@@ -2,6 +2,7 @@
 
 #include "dl_image_define.hpp"
 #include "dl_cls_postprocessor.hpp"  // for dl::cls::result_t
+#include "dl_image_jpeg.hpp"
 
 namespace sdcard {
 
@@ -11,6 +12,9 @@ bool create_dir(const char *full_path);
 
 int count_files(const char *full_path);
 
+// RGB888 kodieren und speichern
 bool save_jpeg(const dl::image::img_t &img, const dl::cls::result_t &best, const char *dir_full_path);
+// Fertiges JPEG unter der nächsten Nummer in <dir>/<YYYYMMDD>/<HH>/ ablegen
+bool write_jpeg(const dl::image::jpeg_img_t &jpeg_img, const char *dir_full_path);
 
 } // namespace sdcard
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+
+// Dateisystem unter sd_card, file_index und segment_file. Die Basisklasse arbeitet direkt mit
+// stdio/POSIX, also mit dem VFS auf dem Gerät bzw. dem normalen Dateisystem auf dem Host.
+// Backends überschreiben Mount, Freispeicher und was ihr Dateisystem besser kann
+// (SdspiBackend: FatFs-Zeitstempel und zusammenhängende Vorallokation; PosixBackend im
+// Host-Build: Pfadabbildung und künstliche Latenz).
+namespace storage {
+
+struct space_t {
+    uint64_t total;
+    uint64_t free;
+};
+
+struct dir_entry_t {
+    const char *name;
+    bool is_dir;
+};
+
+// false bricht die Auflistung ab
+using dir_visitor_t = bool (*)(const dir_entry_t &entry, void *ctx);
+
+class Backend {
+public:
+    virtual ~Backend() = default;
+
+    virtual const char *name() const { return "vfs"; }
+    virtual bool mount() { return true; }
+    virtual void unmount() {}
+    virtual bool is_mounted() const { return true; }
+    virtual bool free_space(space_t &space);
+
+    // true auch, wenn das Verzeichnis schon existiert
+    virtual bool make_dir(const char *path);
+    // "." und ".." werden übersprungen
+    virtual bool list_dir(const char *path, dir_visitor_t visit, void *ctx);
+    virtual bool rename(const char *from, const char *to);
+
+    // Alle Dateizugriffe laufen über stdio; sync() und truncate() statt fsync/ftruncate
+    // auf fileno(), weil ein Backend auch Streams ohne Deskriptor liefern kann
+    virtual FILE *open(const char *path, const char *mode);
+    virtual bool sync(FILE *f);
+    virtual bool truncate(FILE *f, uint32_t size);
+
+    // Datei mit size Bytes anlegen, möglichst zusammenhängend. false = nicht unterstützt,
+    // der Aufrufer erweitert die Datei dann selbst
+    virtual bool preallocate(const char *path, uint32_t size);
+    virtual bool set_file_time(const char *path, const struct tm &time);
+
+    // Ganze Datei ungepuffert mit einem einzigen Schreibzugriff bzw. an eine Datei anhängen
+    bool write_file(const char *path, const void *data, size_t len);
+    bool append_file(const char *path, const void *data, size_t len);
+};
+
+// Direkt auf stdio/POSIX, z.B. für Module, denen kein Backend übergeben wurde
+Backend &default_backend();
+
+} // namespace storage
@@ -0,0 +1,173 @@
+#include "file_index.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+namespace fileindex {
+
+static const char *INDEX_FILE = "index.txt";
+
+// --------- Internal helpers ----------------------------------
+
+// Nummer aus "<prefix>_<n>.jpg", sonst 0
+static uint32_t parse_sequence(const char *name, const char *prefix) {
+    size_t plen = strlen(prefix);
+    if (strncmp(name, prefix, plen) != 0 || name[plen] != '_') {
+        return 0;
+    }
+    char *end = nullptr;
+    unsigned long n = strtoul(name + plen + 1, &end, 10);
+    if (end == name + plen + 1 || strcasecmp(end, ".jpg") != 0) {
+        return 0;
+    }
+    return static_cast<uint32_t>(n);
+}
+
+static bool is_digits(const char *s, size_t n) {
+    if (strlen(s) != n) {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (s[i] < '0' || s[i] > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FileIndex::persist(uint32_t reserved_until) {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", m_root, INDEX_FILE);
+    FILE *f = m_fs->open(path, "w");
+    if (!f) {
+        return false;
+    }
+    bool ok = fprintf(f, "%lu\n", (unsigned long)reserved_until) > 0;
+    ok = (fclose(f) == 0) && ok;
+    if (ok) {
+        m_reserved = reserved_until;
+        m_stats.index_writes++;
+    }
+    return ok;
+}
+
+bool FileIndex::load() {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/%s", m_root, INDEX_FILE);
+    FILE *f = m_fs->open(path, "r");
+    if (!f) {
+        return false;
+    }
+    unsigned long value = 0;
+    bool ok = fscanf(f, "%lu", &value) == 1 && value > 0;
+    fclose(f);
+    if (ok) {
+        // Alles unterhalb der Reservierung kann schon vergeben sein
+        m_next = static_cast<uint32_t>(value);
+    }
+    return ok;
+}
+
+struct scan_ctx_t {
+    FileIndex *index;
+    const char *dir;
+    int depth;
+    uint32_t max_seq;
+};
+
+// Tiefe 0: root (auch Altbestand ohne Shards), 1: YYYYMMDD, 2: HH
+uint32_t FileIndex::scan_dir(const char *dir, int depth) {
+    scan_ctx_t ctx = {this, dir, depth, 0};
+    m_fs->list_dir(dir, [](const storage::dir_entry_t &entry, void *p) {
+        scan_ctx_t &c = *static_cast<scan_ctx_t *>(p);
+        uint32_t seq = c.index->scan_entry(c.dir, c.depth, entry);
+        if (seq > c.max_seq) {
+            c.max_seq = seq;
+        }
+        return true;
+    }, &ctx);
+    return ctx.max_seq;
+}
+
+uint32_t FileIndex::scan_entry(const char *dir, int depth, const storage::dir_entry_t &entry) {
+    if (entry.is_dir) {
+        if ((depth == 0 && is_digits(entry.name, 8)) || (depth == 1 && is_digits(entry.name, 2))) {
+            char sub[128];
+            snprintf(sub, sizeof(sub), "%s/%s", dir, entry.name);
+            return scan_dir(sub, depth + 1);
+        }
+        return 0;
+    }
+    uint32_t seq = parse_sequence(entry.name, m_prefix);
+    if (seq) {
+        m_stats.scanned_files++;
+    }
+    return seq;
+}
+
+uint32_t FileIndex::scan() {
+    return scan_dir(m_root, 0) + 1;
+}
+
+bool FileIndex::ensure_shard(const struct tm &now) {
+    long key = (long)(now.tm_year + 1900) * 1000000L + (now.tm_mon + 1) * 10000L + now.tm_mday * 100L + now.tm_hour;
+    if (key == m_shard_key) {
+        return true;
+    }
+    char day[80];
+    snprintf(day, sizeof(day), "%s/%08ld", m_root, key / 100);
+    snprintf(m_shard, sizeof(m_shard), "%s/%02ld", day, key % 100);
+    if (!m_fs->make_dir(day) || !m_fs->make_dir(m_shard)) {
+        m_shard_key = -1;
+        return false;
+    }
+    m_shard_key = key;
+    m_stats.shard_dirs++;
+    return true;
+}
+
+// --------- Public API ----------------------------------
+
+bool FileIndex::open(const char *root, const char *prefix, storage::Backend *fs) {
+    m_fs = fs ? fs : &storage::default_backend();
+    m_open = false;
+    m_shard_key = -1;
+    m_stats = {};
+    strncpy(m_root, root, sizeof(m_root) - 1);
+    m_root[sizeof(m_root) - 1] = '\0';
+    strncpy(m_prefix, prefix, sizeof(m_prefix) - 1);
+    m_prefix[sizeof(m_prefix) - 1] = '\0';
+    if (!m_fs->make_dir(m_root)) {
+        return false;
+    }
+
+    if (!load()) {
+        m_next = scan();
+    }
+    // Sofort neu reservieren: der alte Block kann schon teilweise belegt sein
+    if (!persist(m_next + RESERVE_BLOCK)) {
+        return false;
+    }
+    m_open = true;
+    return true;
+}
+
+bool FileIndex::next_path(const struct tm &now, char *path, size_t len) {
+    if (!m_open || !ensure_shard(now)) {
+        return false;
+    }
+    if (m_next >= m_reserved && !persist(m_next + RESERVE_BLOCK)) {
+        return false;
+    }
+    int n = snprintf(path, len, "%s/%s_%08lu.jpg", m_shard, m_prefix, (unsigned long)m_next);
+    if (n < 0 || (size_t)n >= len) {
+        return false;
+    }
+    m_next++;
+    m_stats.assigned++;
+    return true;
+}
+
+} // namespace fileindex
@@ -0,0 +1,362 @@
+#include "rgb565_roi.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_ESP32S3
+// rgb565_roi_esp32s3.S: blocks * 16 Pixel, src 16-Byte-, dst 4-Byte-ausgerichtet
+extern "C" void imgconv_rgb565_to_rgb888_pie(const uint8_t *src, uint8_t *dst, int blocks);
+#endif
+
+namespace imgconv {
+
+// 32-bit Zugriffe auf byteweise adressierte Puffer
+typedef uint32_t __attribute__((__may_alias__)) word_t;
+
+// Erst nach bestandener Prüfung in enable_pie_kernel() gesetzt, vor dem Start der Tasks
+static bool s_pie_enabled = false;
+
+// --------- Internal helpers ----------------------------------
+
+static bool roi_is_valid(const uint8_t *src, int src_width, int src_height,
+                         int x0, int y0, int roi_width, int roi_height,
+                         const uint8_t *dst) {
+    return src && dst && roi_width > 0 && roi_height > 0 && x0 >= 0 && y0 >= 0 &&
+           x0 + roi_width <= src_width && y0 + roi_height <= src_height;
+}
+
+static inline void convert_pixel(const uint8_t *src, uint8_t *dst) {
+    // src[0] = RRRRRGGG, src[1] = GGGBBBBB
+    dst[0] = src[0] & 0xF8;
+    dst[1] = ((src[0] & 0x07) << 5) | ((src[1] & 0xE0) >> 3);
+    dst[2] = (src[1] & 0x1F) << 3;
+}
+
+// Zwei Pixel pro 32-bit Wort: Byte 0/2 sind die High-Bytes, Byte 1/3 die Low-Bytes.
+// Ergebnis: R, G, B jeweils in den Lanes Bit 0..7 (Pixel 0) und Bit 16..23 (Pixel 1).
+static inline void split_pixel_pair(uint32_t w, uint32_t &r, uint32_t &g, uint32_t &b) {
+    const uint32_t hi = w & 0x00FF00FF;
+    const uint32_t lo = (w >> 8) & 0x00FF00FF;
+    r = hi & 0x00F800F8;
+    g = ((hi & 0x00070007) << 5) | ((lo >> 3) & 0x001C001C);
+    b = (lo & 0x001F001F) << 3;
+}
+
+// Konvertiert vier Pixel (8 Byte) in drei 32-bit Wörter (12 Byte RGB888).
+// Setzt little endian voraus (Xtensa/RISC-V der ESP32-Familie und x86).
+static inline void convert_quad(const word_t *src, word_t *dst) {
+    uint32_t ra, ga, ba, rb, gb, bb;
+    split_pixel_pair(src[0], ra, ga, ba);
+    split_pixel_pair(src[1], rb, gb, bb);
+
+    dst[0] = (ra & 0xFF) | ((ga & 0xFF) << 8) | ((ba & 0xFF) << 16) | ((ra & 0xFF0000) << 8);
+    dst[1] = ((ga >> 16) & 0xFF) | ((ba >> 8) & 0xFF00) | ((rb & 0xFF) << 16) | ((gb & 0xFF) << 24);
+    dst[2] = (bb & 0xFF) | ((rb >> 8) & 0xFF00) | (gb & 0xFF0000) | ((bb & 0xFF0000) << 8);
+}
+
+static void convert_row(const uint8_t *src, uint8_t *dst, int width) {
+    int x = 0;
+    // Wortweise nur bei ausgerichteten Zeilen, Xtensa erlaubt keine unausgerichteten Zugriffe
+    if ((reinterpret_cast<uintptr_t>(src) & 3) == 0 && (reinterpret_cast<uintptr_t>(dst) & 3) == 0) {
+        const word_t *s = reinterpret_cast<const word_t *>(src);
+        word_t *d = reinterpret_cast<word_t *>(dst);
+        for (; x + 8 <= width; x += 8) {
+            convert_quad(s, d);
+            convert_quad(s + 2, d + 3);
+            s += 4;
+            d += 6;
+        }
+        for (; x + 4 <= width; x += 4) {
+            convert_quad(s, d);
+            s += 2;
+            d += 3;
+        }
+    }
+    for (; x < width; ++x) {
+        convert_pixel(src + x * 2, dst + x * 3);
+    }
+}
+
+#if !CONFIG_IDF_TARGET_ESP32S3
+// Host-Modell von rgb565_roi_esp32s3.S: ein Q-Register als vier 32-bit Lanes, eine Zeile je
+// Anweisung des Kerns in derselben Reihenfolge. So prüfen die Host-Tests die Schritte des
+// Kerns bitgenau gegen die Referenz; auf dem Gerät prüft enable_pie_kernel() den Kern selbst.
+struct qreg_t {
+    uint32_t lane[4];
+};
+
+struct pie_model_t {
+    qreg_t q[8];
+    int sar = 0;
+
+    void vld_128_ip(int qa, const uint8_t *&p) {
+        memcpy(q[qa].lane, p, 16);
+        p += 16;
+    }
+    // q[a] = gerade, q[b] = ungerade Bytes von q[a]:q[b]
+    void vunzip_8(int qa, int qb) {
+        uint8_t all[32], even[16], odd[16];
+        memcpy(all, q[qa].lane, 16);
+        memcpy(all + 16, q[qb].lane, 16);
+        for (int i = 0; i < 16; ++i) {
+            even[i] = all[2 * i];
+            odd[i] = all[2 * i + 1];
+        }
+        memcpy(q[qa].lane, even, 16);
+        memcpy(q[qb].lane, odd, 16);
+    }
+    void vldbc_32_ip(int qa, const uint32_t *&p) {
+        for (uint32_t &l : q[qa].lane) {
+            l = *p;
+        }
+        ++p;
+    }
+    void andq(int qa, int qx, int qy) {
+        for (int i = 0; i < 4; ++i) {
+            q[qa].lane[i] = q[qx].lane[i] & q[qy].lane[i];
+        }
+    }
+    void orq(int qa, int qx, int qy) {
+        for (int i = 0; i < 4; ++i) {
+            q[qa].lane[i] = q[qx].lane[i] | q[qy].lane[i];
+        }
+    }
+    void vsl_32(int qa, int qs) {
+        for (int i = 0; i < 4; ++i) {
+            q[qa].lane[i] = q[qs].lane[i] << sar;
+        }
+    }
+    // ee.vsr.32 schiebt arithmetisch
+    void vsr_32(int qa, int qs) {
+        for (int i = 0; i < 4; ++i) {
+            q[qa].lane[i] = (uint32_t)((int32_t)q[qs].lane[i] >> sar);
+        }
+    }
+};
+
+static void imgconv_rgb565_to_rgb888_pie(const uint8_t *src, uint8_t *dst, int blocks) {
+    static const uint32_t masks[7] = {0xF8F8F8F8, 0xE0E0E0E0, 0x1C1C1C1C, 0x000000FF,
+                                      0x0000FF00, 0x00FF0000, 0xFF000000};
+    pie_model_t m;
+    for (; blocks > 0; --blocks) {
+        m.vld_128_ip(0, src);
+        m.vld_128_ip(1, src);
+        m.vunzip_8(0, 1);
+        const uint32_t *mask = masks;
+
+        m.vldbc_32_ip(7, mask);  // F8
+        m.andq(2, 0, 7);         // R
+        m.sar = 3;
+        m.vsl_32(4, 1);
+        m.andq(4, 4, 7);         // B
+        m.vsr_32(5, 1);
+        m.vldbc_32_ip(7, mask);  // E0
+        m.sar = 5;
+        m.vsl_32(3, 0);
+        m.andq(3, 3, 7);
+        m.vldbc_32_ip(7, mask);  // 1C
+        m.andq(5, 5, 7);
+        m.orq(3, 3, 5);          // G
+
+        m.vldbc_32_ip(7, mask);  // 000000FF
+        m.andq(5, 2, 7);         // o0 = R.b0
+        m.sar = 8;
+        m.vsr_32(1, 3);
+        m.andq(6, 1, 7);         // o1 = G.b1
+        m.sar = 16;
+        m.vsr_32(1, 4);
+        m.andq(0, 1, 7);         // o2 = B.b2
+
+        m.vldbc_32_ip(7, mask);  // 0000FF00
+        m.vsr_32(1, 2);
+        m.andq(1, 1, 7);
+        m.orq(0, 0, 1);          // o2 |= R.b3
+        m.andq(1, 4, 7);
+        m.orq(6, 6, 1);          // o1 |= B.b1
+        m.sar = 8;
+        m.vsl_32(1, 3);
+        m.andq(1, 1, 7);
+        m.orq(5, 5, 1);          // o0 |= G.b0
+
+        m.vldbc_32_ip(7, mask);  // 00FF0000
+        m.vsr_32(1, 3);
+        m.andq(1, 1, 7);
+        m.orq(0, 0, 1);          // o2 |= G.b3
+        m.andq(1, 2, 7);
+        m.orq(6, 6, 1);          // o1 |= R.b2
+        m.sar = 16;
+        m.vsl_32(1, 4);
+        m.andq(1, 1, 7);
+        m.orq(5, 5, 1);          // o0 |= B.b0
+
+        m.vldbc_32_ip(7, mask);  // FF000000
+        m.vsl_32(1, 2);
+        m.andq(1, 1, 7);
+        m.orq(5, 5, 1);          // o0 |= R.b1
+        m.andq(1, 4, 7);
+        m.orq(0, 0, 1);          // o2 |= B.b3
+        m.sar = 8;
+        m.vsl_32(1, 3);
+        m.andq(1, 1, 7);
+        m.orq(6, 6, 1);          // o1 |= G.b2
+
+        for (int k = 0; k < 4; ++k) {
+            memcpy(dst + 12 * k, &m.q[5].lane[k], 4);
+            memcpy(dst + 12 * k + 4, &m.q[6].lane[k], 4);
+            memcpy(dst + 12 * k + 8, &m.q[0].lane[k], 4);
+        }
+        dst += 48;
+    }
+}
+#endif
+
+// Bis zur 16-Byte-Ausrichtung der Quelle skalar, dann 16er-Blöcke durch den PIE-Kern, der
+// Rest wortweise. Passt das Ziel danach nicht auf 4 Byte, läuft die ganze Zeile wortweise.
+static void convert_row_pie(const uint8_t *src, uint8_t *dst, int width) {
+    int x = 0;
+    if (reinterpret_cast<uintptr_t>(src) & 1) {
+        convert_row(src, dst, width);
+        return;
+    }
+    for (; x < width && (reinterpret_cast<uintptr_t>(src + x * 2) & 15) != 0; ++x) {
+        convert_pixel(src + x * 2, dst + x * 3);
+    }
+    const int blocks = (width - x) / 16;
+    if (blocks > 0 && (reinterpret_cast<uintptr_t>(dst + x * 3) & 3) == 0) {
+        imgconv_rgb565_to_rgb888_pie(src + x * 2, dst + x * 3, blocks);
+        x += blocks * 16;
+    }
+    convert_row(src + x * 2, dst + x * 3, width - x);
+}
+
+static inline uint8_t clamp_u8(int v) {
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// Ein Pixelpaar nach Y0 Cb Y1 Cr; Chroma aus dem Mittel beider Pixel.
+// Koeffizienten JFIF (BT.601 Vollbereich) in 16.16-Festkomma.
+static inline void convert_pair_yuyv(const uint8_t *src, uint8_t *dst) {
+    uint8_t rgb[6];
+    convert_pixel(src, rgb);
+    convert_pixel(src + 2, rgb + 3);
+    const int r = rgb[0] + rgb[3], g = rgb[1] + rgb[4], b = rgb[2] + rgb[5];
+    dst[0] = (uint8_t)((19595 * rgb[0] + 38470 * rgb[1] + 7471 * rgb[2] + 32768) >> 16);
+    dst[1] = clamp_u8(((-11059 * r - 21709 * g + 32768 * b + 65536) >> 17) + 128);
+    dst[2] = (uint8_t)((19595 * rgb[3] + 38470 * rgb[4] + 7471 * rgb[5] + 32768) >> 16);
+    dst[3] = clamp_u8(((32768 * r - 27439 * g - 5329 * b + 65536) >> 17) + 128);
+}
+
+// --------- Public API ----------------------------------
+
+bool rgb565_roi_to_rgb888(const uint8_t *src, int src_width, int src_height,
+                          int x0, int y0, int roi_width, int roi_height,
+                          uint8_t *dst) {
+    if (!roi_is_valid(src, src_width, src_height, x0, y0, roi_width, roi_height, dst)) {
+        return false;
+    }
+
+    const size_t src_stride = static_cast<size_t>(src_width) * 2;
+    const size_t dst_stride = static_cast<size_t>(roi_width) * 3;
+    const uint8_t *src_row = src + y0 * src_stride + x0 * 2;
+    for (int y = 0; y < roi_height; ++y) {
+        if (s_pie_enabled) {
+            convert_row_pie(src_row, dst, roi_width);
+        } else {
+            convert_row(src_row, dst, roi_width);
+        }
+        src_row += src_stride;
+        dst += dst_stride;
+    }
+    return true;
+}
+
+bool rgb565_roi_to_rgb888_pie(const uint8_t *src, int src_width, int src_height,
+                              int x0, int y0, int roi_width, int roi_height,
+                              uint8_t *dst) {
+    if (!roi_is_valid(src, src_width, src_height, x0, y0, roi_width, roi_height, dst)) {
+        return false;
+    }
+
+    const size_t src_stride = static_cast<size_t>(src_width) * 2;
+    const size_t dst_stride = static_cast<size_t>(roi_width) * 3;
+    const uint8_t *src_row = src + y0 * src_stride + x0 * 2;
+    for (int y = 0; y < roi_height; ++y) {
+        convert_row_pie(src_row, dst, roi_width);
+        src_row += src_stride;
+        dst += dst_stride;
+    }
+    return true;
+}
+
+bool pie_kernel_matches_ref() {
+    // 64x8-Muster wie make_rgb565_pattern (rgb565_tensor.cpp); Ausschnitte mit allen
+    // Quell- und Zielversätzen, damit Vorlauf, Blöcke und Rest je einmal laufen
+    constexpr int W = 64, H = 8;
+    std::vector<uint8_t> frame(W * H * 2 + 16);
+    uint8_t *src = frame.data() + (16 - (reinterpret_cast<uintptr_t>(frame.data()) & 15)) % 16;
+    for (int i = 0; i < W * H; ++i) {
+        const uint16_t v = (uint16_t)(i * 40503u);
+        src[i * 2] = (uint8_t)(v >> 8);
+        src[i * 2 + 1] = (uint8_t)v;
+    }
+    std::vector<uint8_t> pie(W * H * 3 + 4), ref(W * H * 3);
+    for (int x0 = 0; x0 < 8; ++x0) {
+        for (int shift = 0; shift < 4; ++shift) {
+            const int w = W - x0 - shift;
+            if (!rgb565_roi_to_rgb888_pie(src, W, H, x0, 0, w, H, pie.data() + shift) ||
+                !rgb565_roi_to_rgb888_ref(src, W, H, x0, 0, w, H, ref.data()) ||
+                memcmp(pie.data() + shift, ref.data(), (size_t)w * H * 3) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool enable_pie_kernel() {
+#if CONFIG_IDF_TARGET_ESP32S3
+    s_pie_enabled = pie_kernel_matches_ref();
+#endif
+    return s_pie_enabled;
+}
+
+bool rgb565_roi_to_yuyv(const uint8_t *src, int src_width, int src_height,
+                        int x0, int y0, int roi_width, int roi_height,
+                        uint8_t *dst) {
+    if ((roi_width & 1) || !roi_is_valid(src, src_width, src_height, x0, y0, roi_width, roi_height, dst)) {
+        return false;
+    }
+
+    const size_t src_stride = static_cast<size_t>(src_width) * 2;
+    const uint8_t *src_row = src + y0 * src_stride + x0 * 2;
+    for (int y = 0; y < roi_height; ++y) {
+        for (int x = 0; x < roi_width; x += 2) {
+            convert_pair_yuyv(src_row + x * 2, dst);
+            dst += 4;
+        }
+        src_row += src_stride;
+    }
+    return true;
+}
+
+bool rgb565_roi_to_rgb888_ref(const uint8_t *src, int src_width, int src_height,
+                              int x0, int y0, int roi_width, int roi_height,
+                              uint8_t *dst) {
+    if (!roi_is_valid(src, src_width, src_height, x0, y0, roi_width, roi_height, dst)) {
+        return false;
+    }
+
+    for (int y = 0; y < roi_height; ++y) {
+        const uint8_t *src_px = src + ((y0 + y) * src_width + x0) * 2;
+        for (int x = 0; x < roi_width; ++x) {
+            convert_pixel(src_px, dst);
+            src_px += 2;
+            dst += 3;
+        }
+    }
+    return true;
+}
+
+} // namespace imgconv
@@ -15,10 +15,11 @@
 #include <cstdio>
 #include "ff.h" // Für FATFS Zeitstempel
 
-#include "esp_jpeg_enc.h"
 #include "dl_image_jpeg.hpp"
+#include "jpeg_encoder.hpp"
 
 #include "include/sd_pins.h"  // the board-specific SD + SPI pins
+#include "file_index.hpp"
 
 namespace sdcard {
 
@@ -27,6 +28,8 @@ static constexpr const char *MOUNT_POINT = "/sdcard";
 
 static sdmmc_card_t *g_card = nullptr;
 static bool g_mounted = false;
+static fileindex::FileIndex g_index;  // Dateinummern für das zuletzt verwendete Ausgabeverzeichnis
+static jpegenc::Encoder g_encoder;     // für save_jpeg, bleibt über alle Bilder offen
 
 // --------- Internal helpers ----------------------------------
 
@@ -131,34 +134,16 @@ static bool mount_sdcard_spi() {
     return true;
 }
 
-// Encode an RGB888 image to JPEG into jpeg_img.
-// img.pix_type must be DL_IMAGE_PIX_TYPE_RGB888.
-static jpeg_error_t encode_img_to_jpeg(const dl::image::img_t *img, dl::image::jpeg_img_t *jpeg_img, jpeg_enc_config_t cfg) {
-    jpeg_enc_handle_t jpeg_enc = nullptr;
-    jpeg_error_t ret = jpeg_enc_open(&cfg, &jpeg_enc);
-    if (ret != JPEG_ERR_OK) {
-        return ret;
-    }
-
-    const int outbuf_size = 100 * 1024; // 100 KB
-    uint8_t *outbuf = static_cast<uint8_t*>(calloc(1, outbuf_size));
-    if (!outbuf) {
-        jpeg_enc_close(jpeg_enc);
-        return JPEG_ERR_NO_MEM;
-    }
-
-    const int in_size = img->width * img->height * 3; // RGB888
-    int out_len = 0;
-    ret = jpeg_enc_process(jpeg_enc, static_cast<const uint8_t*>(img->data), in_size, outbuf, outbuf_size, &out_len);
-    if (ret == JPEG_ERR_OK) {
-        jpeg_img->data = outbuf;
-        jpeg_img->data_len = out_len;
-    } else {
-        free(outbuf);
+// Ganze Datei mit einem einzigen write; der stdio-Puffer würde nur in kleinen Stücken weiterreichen
+static bool write_file(const char *path, const void *data, size_t len) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
     }
-
-    jpeg_enc_close(jpeg_enc);
-    return ret;
+    setvbuf(f, nullptr, _IONBF, 0);
+    bool ok = fwrite(data, 1, len, f) == len;
+    ok = (fclose(f) == 0) && ok;
+    return ok;
 }
 
 // --------- Public API ----------------------------------
@@ -247,60 +232,50 @@ bool save_jpeg(const dl::image::img_t &img,
         return false;
     }
 
-    // Make sure directory exists
-    if (!create_dir(dir_full_path)) {
-        return false;
-    }
-
-    // Encode to JPEG
+    const jpegenc::encoder_config_t enc_cfg = {img.width, img.height, jpegenc::INPUT_RGB888, JPEG_SUBSAMPLE_444, 80};
     dl::image::jpeg_img_t jpeg_img;
-    jpeg_enc_config_t enc_cfg = {
-        .width = img.width,
-        .height = img.height,
-        .src_type = JPEG_PIXEL_FORMAT_RGB888,
-        .subsampling = JPEG_SUBSAMPLE_444,
-        .quality = 80,
-        .rotate = JPEG_ROTATE_0D,
-        .task_enable = true,
-        .hfm_task_priority = 13,
-        .hfm_task_core = 1,
-    };
-
-    jpeg_error_t enc_ret = encode_img_to_jpeg(&img, &jpeg_img, enc_cfg);
-    if (enc_ret != JPEG_ERR_OK) {
-        ESP_LOGE(TAG, "JPEG encoding failed (%d)", enc_ret);
+    if (!g_encoder.open(enc_cfg) || !g_encoder.encode(static_cast<const uint8_t *>(img.data), jpeg_img)) {
         return false;
     }
+    return write_jpeg(jpeg_img, dir_full_path);
+}
 
-    // Determine next index in directory
-    int idx = count_files(dir_full_path);
-    if (idx < 0) {
-        free(jpeg_img.data);
+bool write_jpeg(const dl::image::jpeg_img_t &jpeg_img, const char *dir_full_path) {
+    if (!g_mounted) {
+        ESP_LOGE(TAG, "write_jpeg: SD not mounted");
         return false;
     }
 
+    time_t t = time(NULL);
+    struct tm tm_now = {};
+    bool have_time = localtime_r(&t, &tm_now) != nullptr;
 
+    // Fortlaufende Nummer aus dem Index statt Verzeichnis-Scan, Ablage in <dir>/<YYYYMMDD>/<HH>/
+    if (!g_index.is_open() || strcmp(g_index.root(), dir_full_path) != 0) {
+        if (!g_index.open(dir_full_path, "bumblebee")) {
+            ESP_LOGE(TAG, "Could not open file index in %s (errno=%d)", dir_full_path, errno);
+            return false;
+        }
+        ESP_LOGI(TAG, "File index %s: next #%lu", dir_full_path, (unsigned long)g_index.next_sequence());
+    }
     char filepath[256];
-    std::snprintf(filepath, sizeof(filepath), "%s/bumblebee_%04d.jpg", dir_full_path, idx + 1);
+    if (!g_index.next_path(tm_now, filepath, sizeof(filepath))) {
+        return false;
+    }
 
     ESP_LOGI(TAG, "Saving detected JPEG: %s", filepath);
 
-    esp_err_t write_err = dl::image::write_jpeg(jpeg_img, filepath);
-    if (write_err != ESP_OK) {
+    if (!write_file(filepath, jpeg_img.data, jpeg_img.data_len)) {
         ESP_LOGE(TAG, "Failed to save JPEG: %s", filepath);
-        free(jpeg_img.data);
         return false;
     }
 
     // Änderungsdatum setzen (aktuelles Systemdatum/Zeit) via FATFS
     // Nur möglich, wenn FF_USE_CHMOD und FF_FS_NORTC == 0 in FATFS Konfiguration
-    struct tm *tm_now;
-    time_t t = time(NULL);
-    tm_now = localtime(&t);
-    if (tm_now) {
+    if (have_time) {
         FILINFO finfo = {0};
-        finfo.fdate = ((tm_now->tm_year - 80) << 9) | ((tm_now->tm_mon + 1) << 5) | tm_now->tm_mday;
-        finfo.ftime = (tm_now->tm_hour << 11) | (tm_now->tm_min << 5) | (tm_now->tm_sec / 2);
+        finfo.fdate = ((tm_now.tm_year - 80) << 9) | ((tm_now.tm_mon + 1) << 5) | tm_now.tm_mday;
+        finfo.ftime = (tm_now.tm_hour << 11) | (tm_now.tm_min << 5) | (tm_now.tm_sec / 2);
 #ifdef f_utime
         if (f_utime(filepath, &finfo) != 0) {
             ESP_LOGW(TAG, "Could not set FATFS file time: %s", filepath);
@@ -313,7 +288,6 @@ bool save_jpeg(const dl::image::img_t &img,
     }
 
     ESP_LOGI(TAG, "Saved successfully");
-    free(jpeg_img.data);
     return true;
 }
 
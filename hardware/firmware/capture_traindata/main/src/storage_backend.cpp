@@ -0,0 +1,97 @@
+#include "storage_backend.hpp"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace storage {
+
+// --------- Backend ----------------------------------
+
+bool Backend::free_space(space_t &space) {
+    space = {};
+    return false;
+}
+
+bool Backend::make_dir(const char *path) {
+    if (mkdir(path, 0775) == 0 || errno == EEXIST) {
+        struct stat st;
+        return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    return false;
+}
+
+bool Backend::list_dir(const char *path, dir_visitor_t visit, void *ctx) {
+    DIR *d = opendir(path);
+    if (!d) {
+        return false;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(d)) != nullptr) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        const dir_entry_t e = {entry->d_name, entry->d_type == DT_DIR};
+        if (!visit(e, ctx)) {
+            break;
+        }
+    }
+    closedir(d);
+    return true;
+}
+
+bool Backend::rename(const char *from, const char *to) {
+    return ::rename(from, to) == 0;
+}
+
+FILE *Backend::open(const char *path, const char *mode) {
+    return fopen(path, mode);
+}
+
+bool Backend::sync(FILE *f) {
+    return fflush(f) == 0 && fsync(fileno(f)) == 0;
+}
+
+bool Backend::truncate(FILE *f, uint32_t size) {
+    return fflush(f) == 0 && ftruncate(fileno(f), size) == 0;
+}
+
+bool Backend::preallocate(const char *, uint32_t) {
+    return false;
+}
+
+bool Backend::set_file_time(const char *, const struct tm &) {
+    return false;
+}
+
+bool Backend::write_file(const char *path, const void *data, size_t len) {
+    // Der stdio-Puffer würde nur in kleinen Stücken weiterreichen
+    FILE *f = open(path, "wb");
+    if (!f) {
+        return false;
+    }
+    setvbuf(f, nullptr, _IONBF, 0);
+    bool ok = fwrite(data, 1, len, f) == len;
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
+
+bool Backend::append_file(const char *path, const void *data, size_t len) {
+    FILE *f = open(path, "ab");
+    if (!f) {
+        return false;
+    }
+    setvbuf(f, nullptr, _IONBF, 0);
+    bool ok = fwrite(data, 1, len, f) == len;
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
+
+Backend &default_backend() {
+    static Backend backend;
+    return backend;
+}
+
+} // namespace storage
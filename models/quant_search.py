@@ -0,0 +1,220 @@
+"""Hilfen für die Mixed-Precision-Suche in quantize_onnx_model.py.
+
+LatencyModel schätzt die Inferenzzeit auf dem ESP32-S3 aus einer Kostentabelle je
+Operator (esp32s3_op_cost.json), evaluate_map misst mAP des quantisierten Graphen auf
+einem Test-Split. Beides läuft auf der CPU.
+"""
+import json
+import os
+
+import numpy as np
+import onnx
+
+# Operatoren, die die Suche auf int16 heben darf: die mit Gewichten, dort sitzt der Fehler
+PROMOTABLE_OPS = ("Conv", "Gemm", "MatMul")
+
+OUTPUT_NAMES = ["box0", "score0", "box1", "score1", "box2", "score2"]
+REG_MAX = 16
+
+
+def _numel(shape):
+    n = 1
+    for d in shape:
+        n *= d
+    return n
+
+
+class LatencyModel:
+    """Summe der Operatorkosten in ms; scale gleicht die Tabelle an eine gemessene Zeit an."""
+
+    def __init__(self, onnx_model, table_path):
+        with open(table_path) as f:
+            self.table = json.load(f)
+        self.scale = 1.0
+        model = onnx.shape_inference.infer_shapes(onnx_model)
+        shapes = {}
+        for vi in list(model.graph.input) + list(model.graph.value_info) + list(model.graph.output):
+            dims = vi.type.tensor_type.shape.dim
+            shapes[vi.name] = [d.dim_value if d.dim_value > 0 else 1 for d in dims]
+        for init in model.graph.initializer:
+            shapes[init.name] = list(init.dims)
+        # Layer am Modelleingang bleiben int8: sonst wird der Eingang int16, das Modell passt nicht
+        # mehr zum Manifest (quant "int8") und der direkte int8-Preprocess-Pfad fällt weg
+        inputs = {vi.name for vi in model.graph.input} - {init.name for init in model.graph.initializer}
+        self.input_layers = {node.name for node in model.graph.node if any(i in inputs for i in node.input)}
+
+        # name -> (kind, macs, out_elements, in_elements)
+        self.ops = {}
+        for node in model.graph.node:
+            out = shapes.get(node.output[0]) if node.output else None
+            if out is None:
+                continue
+            out_elements = _numel(out)
+            in_elements = sum(_numel(shapes[i]) for i in node.input if i in shapes)
+            kind, macs = node.op_type, 0
+            if node.op_type == "Conv" and len(node.input) > 1 and node.input[1] in shapes:
+                weight = shapes[node.input[1]]
+                group = next((a.i for a in node.attribute if a.name == "group"), 1)
+                macs = out_elements * _numel(weight[1:])
+                if group > 1 and weight[1] == 1:
+                    kind = "ConvDepthwise"
+            elif node.op_type in ("Gemm", "MatMul") and node.input[0] in shapes:
+                macs = out_elements * shapes[node.input[0]][-1]
+            self.ops[node.name] = (kind, macs, out_elements, in_elements)
+
+    def op_cycles(self, name, bits):
+        kind, macs, out_elements, in_elements = self.ops[name]
+        key = str(bits)
+        cycles = self.table["op_overhead_cycles"]
+        if kind in self.table["mac_cycles"]:
+            cycles += macs * self.table["mac_cycles"][kind][key]
+        else:
+            per_element = self.table["element_cycles"].get(kind, self.table["default_element_cycles"])
+            cycles += out_elements * per_element[key]
+        if bits != 8:
+            # Umquantisieren am Übergang zu den int8-Nachbarn
+            cycles += (in_elements + out_elements) * self.table["requant_cycles_per_element"]
+        return cycles
+
+    def estimate_ms(self, int16_layers=()):
+        int16_layers = set(int16_layers)
+        cycles = sum(self.op_cycles(name, 16 if name in int16_layers else 8) for name in self.ops)
+        return cycles / (self.table["clock_mhz"] * 1e3) * self.scale
+
+    def calibrate(self, reference_ms):
+        """Tabelle so skalieren, dass das reine int8-Modell reference_ms braucht."""
+        self.scale = 1.0
+        self.scale = reference_ms / self.estimate_ms()
+
+    def promotable(self):
+        return [name for name, (kind, *_) in self.ops.items()
+                if kind.startswith(PROMOTABLE_OPS) and name not in self.input_layers]
+
+
+# --------- mAP ----------------------------------
+
+
+def _decode(outputs, imgsz, strides, score_thr):
+    """Wie ESPDetPostProcessor: DFL über REG_MAX Bins, Zellmitte (x + 0.5) * stride."""
+    boxes, scores, classes = [], [], []
+    for head, stride in enumerate(strides):
+        box = outputs[2 * head][0]        # [4 * REG_MAX, H, W]
+        score = outputs[2 * head + 1][0]  # [C, H, W]
+        num_classes, h, w = score.shape
+        prob = 1.0 / (1.0 + np.exp(-score.reshape(num_classes, -1)))
+        cls = prob.argmax(axis=0)
+        conf = prob.max(axis=0)
+        keep = np.nonzero(conf > score_thr)[0]
+        if keep.size == 0:
+            continue
+        bins = box.reshape(4, REG_MAX, -1)[:, :, keep]
+        bins = np.exp(bins - bins.max(axis=1, keepdims=True))
+        dist = (bins * np.arange(REG_MAX)[None, :, None]).sum(axis=1) / bins.sum(axis=1)
+        cx = (keep % w + 0.5) * stride
+        cy = (keep // w + 0.5) * stride
+        boxes.append(np.stack([cx - dist[0] * stride, cy - dist[1] * stride,
+                               cx + dist[2] * stride, cy + dist[3] * stride], axis=1))
+        scores.append(conf[keep])
+        classes.append(cls[keep])
+    if not boxes:
+        return np.zeros((0, 4)), np.zeros(0), np.zeros(0, dtype=int)
+    return np.concatenate(boxes) / imgsz, np.concatenate(scores), np.concatenate(classes)
+
+
+def _iou(box, boxes):
+    x1 = np.maximum(box[0], boxes[:, 0])
+    y1 = np.maximum(box[1], boxes[:, 1])
+    x2 = np.minimum(box[2], boxes[:, 2])
+    y2 = np.minimum(box[3], boxes[:, 3])
+    inter = np.clip(x2 - x1, 0, None) * np.clip(y2 - y1, 0, None)
+    area = (box[2] - box[0]) * (box[3] - box[1])
+    areas = (boxes[:, 2] - boxes[:, 0]) * (boxes[:, 3] - boxes[:, 1])
+    return inter / np.maximum(area + areas - inter, 1e-12)
+
+
+def _nms(boxes, scores, classes, nms_thr, max_det):
+    order = np.argsort(-scores, kind="stable")
+    kept = []
+    while order.size and len(kept) < max_det:
+        i = order[0]
+        kept.append(i)
+        rest = order[1:]
+        overlap = _iou(boxes[i], boxes[rest]) > nms_thr
+        order = rest[~(overlap & (classes[rest] == classes[i]))]
+    return boxes[kept], scores[kept], classes[kept]
+
+
+def _load_labels(path):
+    if not os.path.exists(path):
+        return np.zeros((0, 4)), np.zeros(0, dtype=int)
+    rows = [line.split() for line in open(path) if len(line.split()) >= 5]
+    if not rows:
+        return np.zeros((0, 4)), np.zeros(0, dtype=int)
+    data = np.array([[float(v) for v in r[:5]] for r in rows])
+    cx, cy, w, h = data[:, 1], data[:, 2], data[:, 3], data[:, 4]
+    return np.stack([cx - w / 2, cy - h / 2, cx + w / 2, cy + h / 2], axis=1), data[:, 0].astype(int)
+
+
+def _average_precision(tp, scores, num_gt):
+    """COCO: Precision-Hüllkurve an 101 Recall-Punkten gemittelt."""
+    if num_gt == 0:
+        return float("nan")
+    if tp.size == 0:
+        return 0.0
+    order = np.argsort(-scores, kind="stable")
+    tp = tp[order]
+    tpc = np.cumsum(tp)
+    fpc = np.cumsum(1 - tp)
+    recall = tpc / num_gt
+    precision = tpc / (tpc + fpc)
+    envelope = np.maximum.accumulate(precision[::-1])[::-1]
+    points = np.linspace(0, 1, 101)
+    idx = np.searchsorted(recall, points, side="left")
+    return float(np.mean([envelope[i] if i < envelope.size else 0.0 for i in idx]))
+
+
+def evaluate_map(graph, dataset, label_dir, device, imgsz, strides=(8, 16, 32),
+                 score_thr=0.001, nms_thr=0.7, max_det=100):
+    """mAP@0.5 und mAP@0.5:0.95 des quantisierten Graphen (simuliert auf der CPU).
+
+    dataset liefert Bilder wie CaliDataset, Labels sind YOLO-txt mit gleichem Dateinamen.
+    """
+    from esp_ppq.executor import TorchExecutor
+    import torch
+
+    executor = TorchExecutor(graph=graph, device=device)
+    thresholds = np.arange(0.5, 0.96, 0.05)
+    matches = [[] for _ in thresholds]   # je Schwelle: (class, score, tp)
+    gt_count = {}
+    with torch.no_grad():
+        for i in range(len(dataset)):
+            image = dataset[i].unsqueeze(0).to(device)
+            outputs = [o.cpu().numpy() for o in executor.forward(inputs=image, output_names=OUTPUT_NAMES)]
+            boxes, scores, classes = _nms(*_decode(outputs, imgsz, strides, score_thr), nms_thr, max_det)
+            stem = os.path.splitext(os.path.basename(dataset.imgs_path[i]))[0]
+            gt_boxes, gt_classes = _load_labels(os.path.join(label_dir, stem + ".txt"))
+            for c in gt_classes:
+                gt_count[c] = gt_count.get(c, 0) + 1
+            for t, thr in enumerate(thresholds):
+                used = np.zeros(len(gt_boxes), dtype=bool)
+                for box, score, cls in zip(boxes, scores, classes):
+                    hit = 0
+                    candidates = np.nonzero((gt_classes == cls) & ~used)[0]
+                    if candidates.size:
+                        ious = _iou(box, gt_boxes[candidates])
+                        best = int(ious.argmax())
+                        if ious[best] >= thr:
+                            used[candidates[best]] = True
+                            hit = 1
+                    matches[t].append((cls, score, hit))
+
+    per_threshold = []
+    for t in range(len(thresholds)):
+        aps = []
+        for cls, num_gt in gt_count.items():
+            rows = [m for m in matches[t] if m[0] == cls]
+            tp = np.array([m[2] for m in rows], dtype=float)
+            scores = np.array([m[1] for m in rows], dtype=float)
+            aps.append(_average_precision(tp, scores, num_gt))
+        per_threshold.append(float(np.nanmean(aps)) if aps else 0.0)
+    return per_threshold[0], float(np.mean(per_threshold))
@@ -1,6 +1,11 @@
+import argparse
+import csv
+import json
 import os
+import shutil
 from esp_ppq import QuantizationSettingFactory
-from esp_ppq.api import espdl_quantize_onnx
+from esp_ppq.api import espdl_quantize_onnx, get_target_platform
+from esp_ppq.quantization.analyse import layerwise_error_analyse
 from torch.utils.data import DataLoader
 import torch
 from torch.utils.data import Dataset
@@ -9,6 +14,8 @@ from PIL import Image
 from onnxsim import simplify
 import onnx
 
+from quant_search import LatencyModel, evaluate_map
+
 
 class CaliDataset(Dataset):
     def __init__(self, path, img_shape=224):
@@ -45,7 +52,8 @@ def report_hook(blocknum, blocksize, total):
     print(f"\rDownloading calibration dataset: {percent:.2f}%", end="")
 
 
-def quant_espdet(onnx_path, target, num_of_bits, device, batchsz, imgsz, calib_dir, espdl_model_path):
+def quant_espdet(onnx_path, target, num_of_bits, device, batchsz, imgsz, calib_dir, espdl_model_path,
+                 int16_layers=(), error_report=True):
     INPUT_SHAPE = [3, *imgsz] if isinstance(imgsz, (list, tuple)) else [3, imgsz, imgsz]
     model = onnx.load(onnx_path)
     sim = True
@@ -73,6 +81,9 @@ def quant_espdet(onnx_path, target, num_of_bits, device, batchsz, imgsz, calib_d
     quant_setting.equalization_setting.opt_level = 2
     quant_setting.equalization_setting.interested_layers = None
 
+    # Mixed Precision: einzelne Layer auf int16
+    for name in int16_layers:
+        quant_setting.dispatching_table.append(name, get_target_platform(target, 16))
 
     quant_ppq_graph = espdl_quantize_onnx(
         onnx_import_file=onnx_path,
@@ -85,7 +96,7 @@ def quant_espdet(onnx_path, target, num_of_bits, device, batchsz, imgsz, calib_d
         collate_fn=collate_fn,
         setting=quant_setting,
         device=device,
-        error_report=True,
+        error_report=error_report,
         skip_export=False,
         export_test_values=False,
         verbose=0,
@@ -94,14 +105,140 @@ def quant_espdet(onnx_path, target, num_of_bits, device, batchsz, imgsz, calib_d
     return quant_ppq_graph  # , selected
 
 
+def search_espdet(onnx_path, target, imgsz, calib_dir, test_dir, espdl_model_path, budget_ms,
+                  cost_table="esp32s3_op_cost.json", reference_ms=None, max_candidates=8, label_dir=None):
+    """Mixed-Precision-Suche: die empfindlichsten Layer nach int16, solange das Latenzbudget reicht.
+
+    Reihenfolge aus dem Layer-Fehlerbericht (SNR) des reinen int8-Modells. Jeder Kandidat wird
+    quantisiert, exportiert und auf dem Test-Split bewertet; der genaueste im Budget ersetzt
+    espdl_model_path. Bericht: <modell>_search.csv und .json daneben.
+    """
+    device = "cpu"
+    label_dir = label_dir or test_dir.replace("images", "labels")
+    stem = os.path.splitext(espdl_model_path)[0]
+    work_dir = stem + "_search"
+    os.makedirs(work_dir, exist_ok=True)
+
+    def candidate_path(index):
+        return os.path.join(work_dir, f"c{index:02d}.espdl")
+
+    # 1. reines int8 als Basis und Layer-Fehler
+    baseline = quant_espdet(onnx_path, target, 8, device, 1, imgsz, calib_dir, candidate_path(0),
+                            error_report=False)
+    latency = LatencyModel(onnx.load(onnx_path), cost_table)
+    if reference_ms:
+        latency.calibrate(reference_ms)
+    else:
+        print("Latency table not calibrated (no --reference-ms): estimates are relative, the budget is only "
+              "a rough guide")
+    calib_loader = DataLoader(dataset=CaliDataset(calib_dir, img_shape=imgsz), batch_size=1, shuffle=False)
+    errors = layerwise_error_analyse(graph=baseline, running_device=device, dataloader=calib_loader,
+                                     collate_fn=lambda batch: batch.to(device), method="snr", verbose=False)
+    sensitivity = {name: float(err) for name, err in errors.items() if name in latency.promotable()}
+    ranked = sorted(sensitivity, key=lambda name: -sensitivity[name])
+
+    # 2. gierig nach Empfindlichkeit, Layer überspringen, die das Budget sprengen
+    sequence = []
+    for name in ranked:
+        if latency.estimate_ms(sequence + [name]) <= budget_ms:
+            sequence.append(name)
+    counts = [0]
+    n = 1
+    while n < len(sequence) and len(counts) < max_candidates - 1:
+        counts.append(n)
+        n *= 2
+    if sequence and len(counts) < max_candidates:
+        counts.append(len(sequence))
+
+    # 3. Kandidaten quantisieren und bewerten
+    test_set = CaliDataset(test_dir, img_shape=imgsz)
+    candidates = []
+    for index, count in enumerate(counts):
+        layers = sequence[:count]
+        graph = baseline if count == 0 else quant_espdet(
+            onnx_path, target, 8, device, 1, imgsz, calib_dir, candidate_path(index),
+            int16_layers=layers, error_report=False)
+        map50, map50_95 = evaluate_map(graph, test_set, label_dir, device, imgsz)
+        est_ms = latency.estimate_ms(layers)
+        candidates.append({
+            "candidate": index,
+            "int16_layers": layers,
+            "est_ms": round(est_ms, 2),
+            "fits": est_ms <= budget_ms,
+            "size_bytes": os.path.getsize(candidate_path(index)),
+            "map50": round(map50, 4),
+            "map50_95": round(map50_95, 4),
+        })
+        print(f"[{index}] int16 layers {count:3d}  est {est_ms:7.1f} ms  "
+              f"size {candidates[-1]['size_bytes']:8d} B  mAP50 {map50:.4f}  mAP50-95 {map50_95:.4f}")
+
+    fitting = [c for c in candidates if c["fits"]]
+    if fitting:
+        best = max(fitting, key=lambda c: (c["map50_95"], -c["est_ms"]))
+        # .json/.info von esp-ppq mitnehmen, damit sie zum Modell passen
+        for ext in (".espdl", ".json", ".info"):
+            src = os.path.splitext(candidate_path(best["candidate"]))[0] + ext
+            if os.path.exists(src):
+                shutil.copyfile(src, stem + ext)
+        print(f"Selected candidate {best['candidate']}: {best['est_ms']} ms, mAP50-95 {best['map50_95']}")
+    else:
+        best = None
+        print(f"No candidate fits {budget_ms} ms (int8 estimate {candidates[0]['est_ms']} ms), "
+              f"{espdl_model_path} left unchanged")
+
+    with open(stem + "_search.csv", "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["candidate", "int16_layers", "est_ms", "fits", "size_bytes", "map50", "map50_95", "layers"])
+        for c in candidates:
+            writer.writerow([c["candidate"], len(c["int16_layers"]), c["est_ms"], int(c["fits"]),
+                             c["size_bytes"], c["map50"], c["map50_95"], ";".join(c["int16_layers"])])
+    with open(stem + "_search.json", "w") as f:
+        json.dump({
+            "budget_ms": budget_ms,
+            "reference_ms": reference_ms,
+            "calibrated": bool(reference_ms),
+            "latency_scale": latency.scale,
+            "cost_table": cost_table,
+            "selected": best["candidate"] if best else None,
+            "sensitivity_snr": {name: sensitivity[name] for name in ranked},
+            "candidates": candidates,
+        }, f, indent=4)
+    return best
+
+
 if __name__ == "__main__":
-    quant_espdet(
-        onnx_path="runs/detect/train_224_224/weights/best.onnx",
-        target="esp32s3",
-        num_of_bits=8,
-        device='cpu',
-        batchsz=1,  # Batchgröße auf 1 setzen
-        imgsz=224,
-        calib_dir="calib_data",
-        espdl_model_path="quantized_model/espdet_pico_224_224_bumblebee.espdl",
-    )
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--search", action="store_true", help="mixed-precision search instead of plain int8")
+    parser.add_argument("--budget-ms", type=float, default=150, help="latency budget per frame on ESP32-S3")
+    parser.add_argument("--reference-ms", type=float, default=0,
+                        help="int8 latency measured on the device (profiler span 'infer'); the cost table is "
+                             "scaled to it. 0: table as is, uncalibrated")
+    parser.add_argument("--cost-table", default="esp32s3_op_cost.json")
+    parser.add_argument("--max-candidates", type=int, default=8)
+    parser.add_argument("--test-dir", default="../data/images/test")
+    args = parser.parse_args()
+
+    if args.search:
+        search_espdet(
+            onnx_path="runs/detect/train_224_224/weights/best.onnx",
+            target="esp32s3",
+            imgsz=224,
+            calib_dir="calib_data",
+            test_dir=args.test_dir,
+            espdl_model_path="quantized_model/espdet_pico_224_224_bumblebee.espdl",
+            budget_ms=args.budget_ms,
+            cost_table=args.cost_table,
+            reference_ms=args.reference_ms or None,
+            max_candidates=args.max_candidates,
+        )
+    else:
+        quant_espdet(
+            onnx_path="runs/detect/train_224_224/weights/best.onnx",
+            target="esp32s3",
+            num_of_bits=8,
+            device='cpu',
+            batchsz=1,  # Batchgröße auf 1 setzen
+            imgsz=224,
+            calib_dir="calib_data",
+            espdl_model_path="quantized_model/espdet_pico_224_224_bumblebee.espdl",
+        )
@@ -0,0 +1,182 @@
+"""Liest den Detektions-Sidecar (detections.bdet) der Firmware.
+
+Format siehe hardware/firmware/bumblebee_detection/v1/main/include/detection_log.hpp.
+Die Frames auf der Karte sind unbemalt; Boxen, Scores und Schwellen stehen nur im Sidecar.
+Die Bilder werden über die Referenz im Record gefunden: im Segment-Modus Session und
+Record-Nummer (seg_<session>.bseg), im Datei-Modus die Dateinummer (bumblebee_<nr>.jpg).
+
+    python detections.py list /pfad/zur/sdcard/bumblebee_detect
+    python detections.py yolo /pfad/zur/sdcard/bumblebee_detect -o dataset
+    python detections.py preview /pfad/zur/sdcard/bumblebee_detect -o preview
+
+"preview" braucht Pillow.
+"""
+import argparse
+import struct
+import zlib
+from pathlib import Path
+
+from extract_segments import RECORD_JPEG, read_records
+
+FILE_MAGIC = 0x54454442  # "BDET"
+VERSION = 1
+FLAG_ANNOTATED = 1
+FLAG_SENSOR_JPEG = 2
+
+FILE_HEADER = struct.Struct("<IHHHH16sI")  # 32 Byte
+RECORD = struct.Struct("<IIIHBBqHHHH120sII")  # 160 Byte
+BOX_META = struct.Struct("<hhhhHH")  # 12 Byte
+
+
+def read_log(path):
+    """Liefert die Records als dict bis zum ersten ungültigen Record."""
+    data = Path(path).read_bytes()
+    if len(data) < FILE_HEADER.size:
+        raise ValueError("Datei kürzer als der Header")
+    magic, version, header_size, record_size, max_boxes, _res, crc = FILE_HEADER.unpack_from(data, 0)
+    if magic != FILE_MAGIC or version != VERSION:
+        raise ValueError("kein Detektions-Log (Magic/Version)")
+    if zlib.crc32(data[:FILE_HEADER.size - 4]) != crc:
+        raise ValueError("Header-CRC falsch")
+    if record_size != RECORD.size:
+        raise ValueError(f"Recordgröße {record_size}, erwartet {RECORD.size}")
+
+    for offset in range(header_size, len(data) - record_size + 1, record_size):
+        (frame_id, session, seq, model_id, box_count, flags, t_us, width, height, score_thr, nms_thr, boxes,
+         _res, r_crc) = RECORD.unpack_from(data, offset)
+        if zlib.crc32(data[offset:offset + record_size - 4]) != r_crc or box_count > max_boxes:
+            break
+        yield {
+            "frame_id": frame_id,
+            "session": session,
+            "seq": seq,
+            "model_id": model_id,
+            "flags": flags,
+            "t_us": t_us,
+            "width": width,
+            "height": height,
+            "score_thr": score_thr / 1000.0,
+            "nms_thr": nms_thr / 1000.0,
+            "boxes": [(x1, y1, x2, y2, score / 1000.0, category)
+                      for x1, y1, x2, y2, score, category in BOX_META.iter_unpack(boxes[:box_count * BOX_META.size])],
+        }
+
+
+class Images:
+    """Findet das JPEG zu einem Record, Segmente werden einmal eingelesen."""
+
+    def __init__(self, root):
+        self.root = Path(root)
+        self.segments = {}
+        self.files = {p.name: p for p in self.root.rglob("bumblebee_*.jpg")}
+
+    def _segment(self, session):
+        if session not in self.segments:
+            jpegs = {}
+            for suffix in (".bseg", ".open"):
+                path = self.root / f"seg_{session:08x}{suffix}"
+                if path.exists():
+                    try:
+                        jpegs = {seq: payload for seq, r_type, _t, _meta, payload in read_records(path.read_bytes())
+                                 if r_type == RECORD_JPEG}
+                    except ValueError as err:
+                        print(f"{path}: übersprungen ({err})")
+                    break
+            self.segments[session] = jpegs
+        return self.segments[session]
+
+    def get(self, rec):
+        if rec["session"]:
+            return self._segment(rec["session"]).get(rec["seq"])
+        path = self.files.get(f"bumblebee_{rec['seq']:08d}.jpg")
+        return path.read_bytes() if path else None
+
+
+def image_name(rec):
+    if rec["session"]:
+        return f"seg_{rec['session']:08x}_{rec['seq']:08d}"
+    return f"bumblebee_{rec['seq']:08d}"
+
+
+def find_log(path):
+    path = Path(path)
+    return (path / "detections.bdet", path) if path.is_dir() else (path, path.parent)
+
+
+def cmd_list(records, _images, _out):
+    print("frame_id,image,t_us,model_id,flags,width,height,score_thr,nms_thr,category,score,x1,y1,x2,y2")
+    for rec in records:
+        head = (f"{rec['frame_id']},{image_name(rec)},{rec['t_us']},{rec['model_id']},{rec['flags']},"
+                f"{rec['width']},{rec['height']},{rec['score_thr']},{rec['nms_thr']}")
+        for x1, y1, x2, y2, score, category in rec["boxes"] or [(None,) * 6]:
+            print(head + "," + ",".join("" if v is None else str(v) for v in (category, score, x1, y1, x2, y2)))
+
+
+def yolo_line(box, width, height):
+    x1, y1, x2, y2, _score, category = box
+    x1, x2 = sorted((min(max(x1, 0), width), min(max(x2, 0), width)))
+    y1, y2 = sorted((min(max(y1, 0), height), min(max(y2, 0), height)))
+    return (f"{category} {(x1 + x2) / 2 / width:.6f} {(y1 + y2) / 2 / height:.6f} "
+            f"{(x2 - x1) / width:.6f} {(y2 - y1) / height:.6f}")
+
+
+def cmd_yolo(records, images, out):
+    (out / "images").mkdir(parents=True, exist_ok=True)
+    (out / "labels").mkdir(parents=True, exist_ok=True)
+    count = skipped = 0
+    for rec in records:
+        jpeg = images.get(rec)
+        # Bemalte Frames taugen nicht als Trainingsdaten
+        if jpeg is None or rec["flags"] & FLAG_ANNOTATED:
+            skipped += 1
+            continue
+        name = image_name(rec)
+        (out / "images" / f"{name}.jpg").write_bytes(jpeg)
+        lines = [yolo_line(box, rec["width"], rec["height"]) for box in rec["boxes"]]
+        (out / "labels" / f"{name}.txt").write_text("".join(line + "\n" for line in lines))
+        count += 1
+    print(f"{count} Bilder mit Labels nach {out}, {skipped} übersprungen")
+
+
+def cmd_preview(records, images, out):
+    import io
+    from PIL import Image, ImageDraw
+
+    out.mkdir(parents=True, exist_ok=True)
+    count = 0
+    for rec in records:
+        jpeg = images.get(rec)
+        if jpeg is None:
+            continue
+        img = Image.open(io.BytesIO(jpeg)).convert("RGB")
+        draw = ImageDraw.Draw(img)
+        for x1, y1, x2, y2, score, _category in rec["boxes"]:
+            draw.rectangle([min(x1, x2), min(y1, y2), max(x1, x2), max(y1, y2)], outline=(255, 0, 0), width=2)
+            draw.text((min(x1, x2) + 2, min(y1, y2) + 2), f"{score:.2f}", fill=(255, 0, 0))
+        img.save(out / f"{image_name(rec)}.jpg", quality=90)
+        count += 1
+    print(f"{count} Vorschaubilder nach {out}")
+
+
+COMMANDS = {"list": cmd_list, "yolo": cmd_yolo, "preview": cmd_preview}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("command", choices=sorted(COMMANDS))
+    parser.add_argument("input", type=Path, help="detections.bdet oder das Ausgabeverzeichnis der Firmware")
+    parser.add_argument("-o", "--out", type=Path, default=Path("detections"), help="Zielverzeichnis")
+    parser.add_argument("--images", type=Path, help="Verzeichnis mit Segmenten bzw. JPEGs, "
+                        "Standard: neben dem Log")
+    args = parser.parse_args()
+
+    log, root = find_log(args.input)
+    try:
+        records = list(read_log(log))
+    except ValueError as err:
+        raise SystemExit(f"{log}: {err}")
+    COMMANDS[args.command](records, Images(args.images or root), args.out)
+
+
+if __name__ == "__main__":
+    main()
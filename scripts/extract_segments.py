@@ -0,0 +1,115 @@
+"""Extrahiert JPEGs und Detektionen aus Segment-Containern (*.bseg) der Firmware.
+
+Format siehe hardware/firmware/bumblebee_detection/v1/main/include/segment_file.hpp.
+Pro Segment entstehen <out>/<segment>/<seq>.jpg und eine detections.csv mit den Boxen,
+Thumbnails (Archivmodus "thumbnails") landen in <out>/<segment>/thumbs/ mit einer thumbs.csv.
+
+    python extract_segments.py /pfad/zur/sdcard/bumblebee_detect -o extracted
+"""
+import argparse
+import csv
+import struct
+import zlib
+from pathlib import Path
+
+FILE_MAGIC = 0x47455342  # "BSEG"
+RECORD_MAGIC = 0x43455242  # "BREC"
+VERSION = 1
+RECORD_JPEG = 1
+RECORD_INDEX = 2
+RECORD_THUMB = 3
+
+FILE_HEADER = struct.Struct("<IHHIII40sI")  # 64 Byte
+RECORD_HEADER = struct.Struct("<IIIHHIIq")  # 32 Byte
+BOX_META = struct.Struct("<hhhhHH")  # 12 Byte
+THUMB_META = struct.Struct("<Ihhhh" + BOX_META.format[1:])  # 24 Byte: frame_id, crop, box
+
+
+def padded(n):
+    return (n + 3) & ~3
+
+
+def read_records(data):
+    """Liefert (seq, type, t_us, meta, payload) bis zum ersten ungültigen Record."""
+    if len(data) < FILE_HEADER.size:
+        raise ValueError("Datei kürzer als der Header")
+    magic, version, header_size, session, capacity, _interval, _res, crc = FILE_HEADER.unpack_from(data, 0)
+    if magic != FILE_MAGIC or version != VERSION:
+        raise ValueError("kein Segment-Container (Magic/Version)")
+    if zlib.crc32(data[:FILE_HEADER.size - 4]) != crc:
+        raise ValueError("Header-CRC falsch")
+
+    offset, seq = header_size, 0
+    end = min(len(data), capacity)
+    while offset + RECORD_HEADER.size <= end:
+        r_magic, r_session, r_seq, r_type, meta_len, payload_len, r_crc, t_us = RECORD_HEADER.unpack_from(data, offset)
+        if r_magic != RECORD_MAGIC or r_session != session or r_seq != seq:
+            break
+        body_start = offset + RECORD_HEADER.size
+        body_end = body_start + meta_len + payload_len
+        if body_end > end:
+            break
+        header = RECORD_HEADER.pack(r_magic, r_session, r_seq, r_type, meta_len, payload_len, 0, t_us)
+        if zlib.crc32(data[body_start:body_end], zlib.crc32(header)) != r_crc:
+            break
+        meta = data[body_start:body_start + meta_len]
+        payload = data[body_start + meta_len:body_end]
+        yield r_seq, r_type, t_us, meta, payload
+        offset = body_start + padded(meta_len + payload_len)
+        seq += 1
+
+
+def extract(segment, out_dir, writer, thumb_writer):
+    data = segment.read_bytes()
+    target = out_dir / segment.stem
+    target.mkdir(parents=True, exist_ok=True)
+    count = thumbs = 0
+    for seq, r_type, t_us, meta, payload in read_records(data):
+        name = f"{seq:08d}.jpg"
+        if r_type == RECORD_JPEG:
+            (target / name).write_bytes(payload)
+            for x1, y1, x2, y2, score, category in BOX_META.iter_unpack(meta):
+                writer.writerow([segment.name, name, t_us, category, score / 1000.0, x1, y1, x2, y2])
+            count += 1
+        elif r_type == RECORD_THUMB:
+            (target / "thumbs").mkdir(exist_ok=True)
+            (target / "thumbs" / name).write_bytes(payload)
+            frame_id, cx1, cy1, cx2, cy2, x1, y1, x2, y2, score, category = THUMB_META.unpack(meta)
+            thumb_writer.writerow([segment.name, f"thumbs/{name}", t_us, frame_id, category, score / 1000.0,
+                                   x1, y1, x2, y2, cx1, cy1, cx2, cy2])
+            thumbs += 1
+    return count, thumbs
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("inputs", nargs="+", type=Path, help="Segment-Dateien oder Verzeichnisse")
+    parser.add_argument("-o", "--out", type=Path, default=Path("extracted"), help="Zielverzeichnis")
+    args = parser.parse_args()
+
+    segments = []
+    for path in args.inputs:
+        if path.is_dir():
+            segments += sorted(path.rglob("*.bseg")) + sorted(path.rglob("*.open"))
+        else:
+            segments.append(path)
+
+    args.out.mkdir(parents=True, exist_ok=True)
+    with open(args.out / "detections.csv", "w", newline="") as f, \
+            open(args.out / "thumbs.csv", "w", newline="") as tf:
+        writer = csv.writer(f)
+        writer.writerow(["segment", "image", "t_us", "category", "score", "x1", "y1", "x2", "y2"])
+        thumb_writer = csv.writer(tf)
+        thumb_writer.writerow(["segment", "image", "t_us", "frame_id", "category", "score", "x1", "y1", "x2", "y2",
+                               "crop_x1", "crop_y1", "crop_x2", "crop_y2"])
+        for segment in segments:
+            try:
+                count, thumbs = extract(segment, args.out, writer, thumb_writer)
+            except ValueError as err:
+                print(f"{segment}: übersprungen ({err})")
+                continue
+            print(f"{segment}: {count} Bilder, {thumbs} Thumbnails")
+
+
+if __name__ == "__main__":
+    main()